@@ -8,6 +8,7 @@
 #include "imgui_impl.h"
 
 #include "grid.h"
+#include "heightmap_generator.hpp"
 #include "simplex.h"
 #include "erosion.hpp"
 #include "OpenSimplexNoise.h"
@@ -1360,7 +1361,7 @@ float obterValorRuido(glm::vec3 pos){
     return glm::max(noiseFBM, noiseFBM + noiseRMF);
 }
 
-void gerarAltura(int h, int h1, int w, float tamAmostra, float *zf_arr){
+void gerarAltura(int h, int h1, int w, float tamAmostra, float *zf_arr, HeightRangeReducer *intervalo){
     //LOG("De %i\n", h);
      for (int j = h; j < h1; j++){
         for (int i = 0; i < w; i++) {
@@ -1386,6 +1387,33 @@ void gerarAltura(int h, int h1, int w, float tamAmostra, float *zf_arr){
             zf_arr[i + w*j] = h;
         }
     }
+
+    // Intervalo das alturas, bloco a bloco, enquanto as linhas ainda estão em cache
+    for (int y0 = h; y0 < h1; y0 += HeightmapGenerator::TILE_SIZE)
+        for (int x0 = 0; x0 < w; x0 += HeightmapGenerator::TILE_SIZE)
+            intervalo->reduce(zf_arr, w, x0, y0,
+                              std::min(x0 + HeightmapGenerator::TILE_SIZE, w),
+                              std::min(y0 + HeightmapGenerator::TILE_SIZE, h1));
+}
+
+// Normaliza e empacota as linhas [h, h1) nas texturas
+void empacotarAltura(int h, int h1, int w, HeightRange intervalo, const float *zf_arr,
+                     uint16_t *texels2, uint16_t *dmap){
+    const float escala = 1.f / (intervalo.max - intervalo.min);
+
+    for (int j = h; j < h1; ++j){
+        for (int i = 0; i < w; ++i) {
+            float h = (zf_arr[i + w*j] - intervalo.min) * escala;
+
+            uint16_t h16 = uint16_t(h * ((1 << 16) - 1));
+            uint16_t h2 = h * h * ((1 << 16) - 1);
+            texels2[i + w * j] = h16;
+
+            // Implementação original
+            dmap[    2 * (i + w * j)] = h16;
+            dmap[1 + 2 * (i + w * j)] = h2;
+        }
+    }
 }
 
 bool gerarTextura(int dmapID, int smapID)
@@ -1396,8 +1424,6 @@ bool gerarTextura(int dmapID, int smapID)
 
 
     // Variaveis inseridas para o projeto
-    float max = -1000000000000000000000000000000000000000000000000000000.f;
-    float min = 1000000000000000000000000000000000000000000000000000000.f;
     float scale = 2.f; // Escala do FBM
 
 /*     int w = g_terrain.dmap.width/10;
@@ -1414,6 +1440,7 @@ bool gerarTextura(int dmapID, int smapID)
     std::vector<uint16_t> texels2(w*h);
     std::vector<float> normals(w*h*2);
     float *zf_arr = new float [w*h];
+    HeightRangeReducer reducer(w, h);
     
     float tamAmostra = 0.0001*(float)scaleTER;
     //LOG("Loading --------------tamAmostra%f\n", tamAmostra);
@@ -1430,14 +1457,14 @@ bool gerarTextura(int dmapID, int smapID)
     int sz6 = part*6;
     int sz7 = part*7;
 
-    std::thread th1(gerarAltura, sz0, sz1, w, tamAmostra, zf_arr);
-    std::thread th2(gerarAltura, sz1, sz2, w, tamAmostra, zf_arr);
-    std::thread th3(gerarAltura, sz2, sz3, w, tamAmostra, zf_arr);
-    std::thread th4(gerarAltura, sz3, sz4, w, tamAmostra, zf_arr);
-    std::thread th5(gerarAltura, sz4, sz5, w, tamAmostra, zf_arr);
-    std::thread th6(gerarAltura, sz5, sz6, w, tamAmostra, zf_arr);
-    std::thread th7(gerarAltura, sz6, sz7, w, tamAmostra, zf_arr);
-    std::thread th8(gerarAltura, sz7, w, w, tamAmostra, zf_arr);
+    std::thread th1(gerarAltura, sz0, sz1, w, tamAmostra, zf_arr, &reducer);
+    std::thread th2(gerarAltura, sz1, sz2, w, tamAmostra, zf_arr, &reducer);
+    std::thread th3(gerarAltura, sz2, sz3, w, tamAmostra, zf_arr, &reducer);
+    std::thread th4(gerarAltura, sz3, sz4, w, tamAmostra, zf_arr, &reducer);
+    std::thread th5(gerarAltura, sz4, sz5, w, tamAmostra, zf_arr, &reducer);
+    std::thread th6(gerarAltura, sz5, sz6, w, tamAmostra, zf_arr, &reducer);
+    std::thread th7(gerarAltura, sz6, sz7, w, tamAmostra, zf_arr, &reducer);
+    std::thread th8(gerarAltura, sz7, w, w, tamAmostra, zf_arr, &reducer);
 
     th1.join();
     th2.join();
@@ -1447,36 +1474,30 @@ bool gerarTextura(int dmapID, int smapID)
     th6.join();
     th7.join();
     th8.join();
-  
-    for (int j = 0; j < h; ++j){
-        for (int i = 0; i < w; ++i) {
-
-            float height = zf_arr[i + w*j];         
-
-            min = glm::min(min, height);
-
-            max = glm::max(max, height);
-        }
-    }
 
     //Erosion eroder = Erosion();
     //zf_arr = eroder.erode(zf_arr, w, 200000);
 
-    //LOG("(min2:%f, max2:%f), \n", min2, max2);
-    for (int j = 0; j < h; ++j){
-        for (int i = 0; i < w; ++i) {  
-            float h = (zf_arr[i + w*j]-min)/(max-min);
+    // O intervalo já foi reduzido pelas threads: só falta normalizar, nas mesmas faixas
+    const HeightRange intervalo = reducer.range();
+    std::thread tp1(empacotarAltura, sz0, sz1, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp2(empacotarAltura, sz1, sz2, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp3(empacotarAltura, sz2, sz3, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp4(empacotarAltura, sz3, sz4, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp5(empacotarAltura, sz4, sz5, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp6(empacotarAltura, sz5, sz6, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp7(empacotarAltura, sz6, sz7, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+    std::thread tp8(empacotarAltura, sz7, w, w, intervalo, zf_arr, &texels2[0], &dmap[0]);
+
+    tp1.join();
+    tp2.join();
+    tp3.join();
+    tp4.join();
+    tp5.join();
+    tp6.join();
+    tp7.join();
+    tp8.join();
 
-            uint16_t h16 = uint16_t(h * ((1 << 16) - 1));
-            uint16_t h2 = h * h * ((1 << 16) - 1);
-            texels2[i + w * j] = h16;
-                        
-            // Implementação original
-            dmap[    2 * (i + w * j)] = h16;
-            dmap[1 + 2 * (i + w * j)] = h2;
-        }        
-    }
-    
     // Exiba o tempo de execução
     double now = glfwGetTime();
     double deltaTime1 = now - lastTime;
@@ -0,0 +1,355 @@
+#ifndef CBT_BUFFER_HPP
+#define CBT_BUFFER_HPP
+
+// requires the OpenGL 4.5 entry points (include glad before this file)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+/*******************************************************************************
+ * CbtDirtyBlocks -- Set of the BLOCK_SIZE-byte blocks of a CBT heap
+ *
+ * The CPU subdivision marks the blocks that its split and merge passes
+ * write, including the sum-reduction counters that the next reduction
+ * rewrites, so that uploads never have to compare heaps. Marking is
+ * thread-safe (it runs from the update callbacks); the other methods are
+ * not and must be called once the pass is done.
+ *
+ */
+class CbtDirtyBlocks {
+public:
+    enum {BLOCK_SIZE = 64};
+
+    explicit CbtDirtyBlocks(int64_t heapByteSize):
+        m_heapByteSize(heapByteSize),
+        m_blockCount((heapByteSize + BLOCK_SIZE - 1) / BLOCK_SIZE),
+        m_words((m_blockCount + 63) / 64),
+        m_isEmpty(true)
+    {
+        clear();
+    }
+
+    CbtDirtyBlocks(const CbtDirtyBlocks &other):
+        m_heapByteSize(other.m_heapByteSize),
+        m_blockCount(other.m_blockCount),
+        m_words(other.m_words.size()),
+        m_isEmpty(true)
+    {
+        *this = other;
+    }
+
+    CbtDirtyBlocks &operator=(const CbtDirtyBlocks &other)
+    {
+        for (size_t i = 0; i < m_words.size(); ++i)
+            m_words[i].store(other.m_words[i].load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+        m_isEmpty.store(other.isEmpty(), std::memory_order_relaxed);
+
+        return *this;
+    }
+
+    int64_t heapByteSize() const { return m_heapByteSize; }
+    bool isEmpty() const { return m_isEmpty.load(std::memory_order_relaxed); }
+
+    // marks the blocks that hold the bits [bitOffset, bitOffset + bitCount)
+    void markBits(int64_t bitOffset, int64_t bitCount)
+    {
+        const int64_t first = (bitOffset >> 3) / BLOCK_SIZE;
+        const int64_t last = ((bitOffset + bitCount - 1) >> 3) / BLOCK_SIZE;
+
+        for (int64_t blockID = first; blockID <= last; ++blockID)
+            markBlock(blockID);
+    }
+
+    void markBlock(int64_t blockID)
+    {
+        std::atomic<uint64_t> &word = m_words[blockID >> 6];
+        const uint64_t bit = 1ULL << (blockID & 63);
+
+        // most marks hit blocks that are already dirty: read before writing
+        if (!(word.load(std::memory_order_relaxed) & bit))
+            word.fetch_or(bit, std::memory_order_relaxed);
+        if (m_isEmpty.load(std::memory_order_relaxed))
+            m_isEmpty.store(false, std::memory_order_relaxed);
+    }
+
+    void markAll()
+    {
+        for (int64_t blockID = 0; blockID < m_blockCount; ++blockID)
+            markBlock(blockID);
+    }
+
+    void merge(const CbtDirtyBlocks &other)
+    {
+        if (other.isEmpty())
+            return;
+
+        for (size_t i = 0; i < m_words.size(); ++i)
+            m_words[i].fetch_or(other.m_words[i].load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+        m_isEmpty.store(false, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < m_words.size(); ++i)
+            m_words[i].store(0u, std::memory_order_relaxed);
+        m_isEmpty.store(true, std::memory_order_relaxed);
+    }
+
+    // calls f(byteOffset, byteSize) for each run of consecutive dirty blocks
+    template <typename F>
+    void forEachRange(F f) const
+    {
+        int64_t rangeBegin = -1;
+
+        if (isEmpty())
+            return;
+
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            const uint64_t bits = m_words[i].load(std::memory_order_relaxed);
+
+            // whole words of clean or dirty blocks leave the run as it is
+            if ((rangeBegin < 0 && bits == 0u) || (rangeBegin >= 0 && bits == ~0ULL))
+                continue;
+
+            for (int64_t j = 0; j < 64; ++j) {
+                const int64_t blockID = (int64_t)i * 64 + j;
+                const bool isDirty = (bits >> j) & 1u;
+
+                if (isDirty && rangeBegin < 0) {
+                    rangeBegin = blockID;
+                } else if (!isDirty && rangeBegin >= 0) {
+                    emitRange(rangeBegin, blockID, f);
+                    rangeBegin = -1;
+                }
+            }
+        }
+
+        if (rangeBegin >= 0)
+            emitRange(rangeBegin, m_blockCount, f);
+    }
+
+private:
+    template <typename F>
+    void emitRange(int64_t blockBegin, int64_t blockEnd, F f) const
+    {
+        const int64_t offset = blockBegin * BLOCK_SIZE;
+        const int64_t end = std::min(blockEnd * BLOCK_SIZE, m_heapByteSize);
+
+        f(offset, end - offset);
+    }
+
+    int64_t m_heapByteSize;
+    int64_t m_blockCount;
+    std::vector<std::atomic<uint64_t> > m_words;
+    std::atomic<bool> m_isEmpty;
+};
+
+/*******************************************************************************
+ * CbtBufferStream -- Streams a CPU-side CBT heap to the GPU without reallocation
+ *
+ * The buffer holds three copies (slots) of the heap and is mapped once with
+ * GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT. Each slot keeps the set of
+ * blocks it is missing: staging the blocks that the CPU tree wrote adds
+ * them to every slot. A flush then selects the next slot, waits for (or, if
+ * asked, gives up on) the fence that protects it, and copies its missing
+ * blocks from the current heap, before binding that slot to the SSBO
+ * binding point. Since the slot being written is never the one the GPU
+ * currently reads, no implicit synchronization happens in the driver, and
+ * a frame where the tree barely changes costs a few hundred bytes of
+ * writes, with no pass over the heap.
+ *
+ * Usage:
+ *      stream.upload(cbt_GetHeap(cbt), dirtyBlocks); // or stage() + flush()
+ *      dirtyBlocks.clear();
+ *      ... GL commands reading the CBT ...
+ *      stream.fence();
+ *
+ */
+class CbtBufferStream {
+public:
+    enum {SLOT_COUNT = 3};
+
+    CbtBufferStream(GLuint binding, int64_t heapByteSize, const char *heap):
+        m_binding(binding),
+        m_heapByteSize(heapByteSize),
+        m_slotStride(0),
+        m_slot(0),
+        m_uploadByteCount(0),
+        m_buffer(0),
+        m_mappedData(NULL),
+        m_missingBlocks(SLOT_COUNT, CbtDirtyBlocks(heapByteSize))
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT
+                               | GL_MAP_PERSISTENT_BIT
+                               | GL_MAP_COHERENT_BIT;
+        GLint alignment = 1;
+
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_slotStride = ((heapByteSize + alignment - 1) / alignment) * alignment;
+
+        glCreateBuffers(1, &m_buffer);
+        glNamedBufferStorage(m_buffer, m_slotStride * SLOT_COUNT, NULL, flags);
+        m_mappedData = (char *)glMapNamedBufferRange(m_buffer,
+                                                     0,
+                                                     m_slotStride * SLOT_COUNT,
+                                                     flags);
+
+        for (int i = 0; i < SLOT_COUNT; ++i) {
+            if (m_mappedData)
+                memcpy(m_mappedData + i * m_slotStride, heap, heapByteSize);
+
+            m_fences[i] = NULL;
+        }
+
+        bind();
+    }
+
+    ~CbtBufferStream()
+    {
+        for (int i = 0; i < SLOT_COUNT; ++i)
+            if (m_fences[i])
+                glDeleteSync(m_fences[i]);
+
+        // deleting the buffer implicitly unmaps it
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    bool isMapped() const { return m_mappedData != NULL; }
+    GLuint buffer() const { return m_buffer; }
+    int64_t heapByteSize() const { return m_heapByteSize; }
+    int64_t uploadByteCount() const { return m_uploadByteCount; }
+
+    // records blocks of the heap that changed since the last stage
+    void stage(const CbtDirtyBlocks &dirtyBlocks)
+    {
+        for (int i = 0; i < SLOT_COUNT; ++i)
+            m_missingBlocks[i].merge(dirtyBlocks);
+    }
+
+    // writes the blocks the next slot is missing, read from heap (the
+    // latest staged state), and binds it; returns false if the slot is
+    // still in use by the GPU and wait is false
+    bool flush(const char *heap, bool wait)
+    {
+        const int slot = (m_slot + 1) % SLOT_COUNT;
+        char *slotData = m_mappedData + slot * m_slotStride;
+        int64_t uploadByteCount = 0;
+
+        if (m_missingBlocks[m_slot].isEmpty())
+            return true;
+
+        if (!waitForSlot(slot, wait))
+            return false;
+
+        m_missingBlocks[slot].forEachRange([&](int64_t offset, int64_t size) {
+            memcpy(slotData + offset, heap + offset, size);
+            uploadByteCount+= size;
+        });
+        m_missingBlocks[slot].clear();
+        m_uploadByteCount = uploadByteCount;
+        m_slot = slot;
+        bind();
+
+        return true;
+    }
+
+    bool upload(const char *heap, const CbtDirtyBlocks &dirtyBlocks)
+    {
+        stage(dirtyBlocks);
+
+        return flush(heap, true);
+    }
+
+    // must be called once the commands that read the current slot are issued
+    void fence()
+    {
+        if (m_fences[m_slot])
+            glDeleteSync(m_fences[m_slot]);
+
+        m_fences[m_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void bind() const
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER,
+                          m_binding,
+                          m_buffer,
+                          m_slot * m_slotStride,
+                          m_heapByteSize);
+    }
+
+private:
+    bool waitForSlot(int slot, bool wait)
+    {
+        GLenum status;
+
+        if (!m_fences[slot])
+            return true;
+
+        do {
+            status = glClientWaitSync(m_fences[slot],
+                                      GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      wait ? 1000000 : 0);
+        } while (wait && status == GL_TIMEOUT_EXPIRED);
+
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+            return false;
+
+        glDeleteSync(m_fences[slot]);
+        m_fences[slot] = NULL;
+
+        return true;
+    }
+
+    GLuint m_binding;
+    int64_t m_heapByteSize;
+    int64_t m_slotStride;
+    int m_slot;
+    int64_t m_uploadByteCount;
+    GLuint m_buffer;
+    char *m_mappedData;
+    std::vector<CbtDirtyBlocks> m_missingBlocks;
+    GLsync m_fences[SLOT_COUNT];
+};
+
+/*******************************************************************************
+ * UploadHeapSparse -- Resets a GPU-owned CBT buffer from a CPU heap
+ *
+ * Buffers that the GPU subdivides in place cannot be streamed through a
+ * mapped ring. A freshly created heap, however, is almost entirely made of
+ * zeroes, so the buffer is cleared on the GPU and only the non-zero words
+ * of the heap are sent. The buffer must hold at least byteSize bytes and
+ * have been created with GL_DYNAMIC_STORAGE_BIT.
+ *
+ */
+inline void UploadHeapSparse(GLuint buffer, const char *heap, int64_t byteSize)
+{
+    const uint64_t *words = (const uint64_t *)heap;
+    const int64_t wordCount = byteSize / sizeof(uint64_t);
+    int64_t rangeBegin = -1;
+
+    glClearNamedBufferSubData(buffer, GL_R32UI, 0, byteSize,
+                              GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+
+    for (int64_t i = 0; i <= wordCount; ++i) {
+        bool isNonZero = (i < wordCount) && (words[i] != 0u);
+
+        if (isNonZero && rangeBegin < 0) {
+            rangeBegin = i;
+        } else if (!isNonZero && rangeBegin >= 0) {
+            glNamedBufferSubData(buffer,
+                                 rangeBegin * sizeof(uint64_t),
+                                 (i - rangeBegin) * sizeof(uint64_t),
+                                 &words[rangeBegin]);
+            rangeBegin = -1;
+        }
+    }
+}
+
+#endif // CBT_BUFFER_HPP
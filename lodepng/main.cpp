@@ -1,8 +1,10 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <algorithm>
 #include "lodepng.h"
 #include "simplex.h"
+#include "png_export.hpp"
 
 using namespace std;
 typedef unsigned int uint;
@@ -15,21 +17,23 @@ int* read_png(const string path, uint& width, uint& height) {
     }
     return data;
 }
+/* 16-bit grayscale, generated and deflated in parallel groups of rows and
+ * streamed to disk (see terrain/png_export.hpp); build with
+ *      g++ -O3 -pthread -I../terrain main.cpp lodepng.cpp \
+ *          ../terrain/png_export.cpp ../terrain/heightmap_generator.cpp -lz
+ */
 void write_png(const string path, const uint width, const uint height) {
     printf("write");
-    u_char* img = new u_char[3*width*height];
-    for(uint i=0; i<width*height; i++) {
-        float t;
-        t = Simplex::fBm(i, 32, 0.99f, 0.98f)*255;
-        //printf("%i\n",i);
-        const int color = t;
-        img[3*i  ] = (color>>16)&255;
-        img[3*i+1] = (color>> 8)&255;
-        img[3*i+2] =  color     &255;
-    }
-    //printf("%i\n",i);
-    lodepng::encode(path, img, width, height, LCT_RGB);
-    delete[] img;
+    ThreadPool pool;
+    PngHeightmapWriter writer(pool);
+
+    writer.write(path, width, height, [width](int y, uint16_t *row) {
+        for(uint x=0; x<width; x++) {
+            float t = Simplex::fBm((float)(x + width*y), 32, 0.99f, 0.98f);
+
+            row[x] = (uint16_t)(std::min(std::max(t*0.5f + 0.5f, 0.0f), 1.0f)*65535);
+        }
+    });
 }
 
 int main(){
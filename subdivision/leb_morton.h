@@ -0,0 +1,431 @@
+/* leb_morton.h - Morton-ordered leaf traversal for the LEB library
+
+   This is a small extension of libcbt / libleb that visits the leaves of a
+   CBT in an order that matches the memory layout of a heightmap, rather
+   than in handle order. The triangle centroid of each leaf is decoded with
+   fixed-point arithmetic directly from the node ID bits, quantized to the
+   heightmap resolution, and turned into a key: tiles of 2^log2TileSize
+   texels are numbered in row-major order and texels are Z-ordered inside
+   each tile. Hence:
+      log2TileSize == 0              -> row-major order
+      log2TileSize == log2Resolution -> Morton (Z) order
+      anything in between            -> tiled layout
+
+   Do this:
+      #define LEB_MORTON_IMPLEMENTATION
+   before you include this file in *one* C or C++ file to create the
+   implementation. The implementation relies on the internals of cbt.h, so
+   it must live in the same file that defines CBT_IMPLEMENTATION.
+
+   INTERFACING
+
+   define LEB_MORTON_ASSERT(x) to avoid using assert.h.
+*/
+
+#ifndef LEB_MORTON_INCLUDE_LEB_MORTON_H
+#define LEB_MORTON_INCLUDE_LEB_MORTON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef LEB_MORTON_STATIC
+#define LEBMDEF static
+#else
+#define LEBMDEF extern
+#endif
+
+// fixed-point precision of the decoded centroids
+#define LEB_MORTON_FIXED_POINT_BITS 30
+
+// data structures
+typedef struct leb_MortonTraversal leb_MortonTraversal;
+
+// create / destroy traversal
+LEBMDEF leb_MortonTraversal *
+leb_CreateMortonTraversal(int64_t log2Resolution, int64_t log2TileSize);
+LEBMDEF void leb_ReleaseMortonTraversal(leb_MortonTraversal *traversal);
+
+// O(depth) queries
+LEBMDEF void leb_DecodeNodeCentroid       (const cbt_Node node, uint32_t centroid[2]);
+LEBMDEF void leb_DecodeNodeCentroid_Square(const cbt_Node node, uint32_t centroid[2]);
+LEBMDEF uint64_t leb_MortonKey(const leb_MortonTraversal *traversal,
+                               const uint32_t centroid[2]);
+
+// sorting
+LEBMDEF void leb_MortonSort       (leb_MortonTraversal *traversal,
+                                   const cbt_Tree *cbt);
+LEBMDEF void leb_MortonSort_Square(leb_MortonTraversal *traversal,
+                                   const cbt_Tree *cbt);
+LEBMDEF int64_t leb_MortonNodeCount(const leb_MortonTraversal *traversal);
+LEBMDEF cbt_Node leb_MortonNode(const leb_MortonTraversal *traversal,
+                                int64_t mortonID);
+
+// update routine (Morton-ordered equivalent of the cbt_Update loop; the
+// sum reduction is left to the caller)
+LEBMDEF void leb_MortonApply(const leb_MortonTraversal *traversal,
+                             cbt_Tree *cbt,
+                             cbt_UpdateCallback updater,
+                             const void *userData);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+//
+//
+//// end header file ///////////////////////////////////////////////////////////
+#endif // LEB_MORTON_INCLUDE_LEB_MORTON_H
+
+#ifdef LEB_MORTON_IMPLEMENTATION
+
+#ifndef CBT_IMPLEMENTATION
+#   error leb_morton.h must be implemented next to CBT_IMPLEMENTATION
+#endif
+
+#ifndef LEB_MORTON_ASSERT
+#    include <assert.h>
+#    define LEB_MORTON_ASSERT(x) assert(x)
+#endif
+
+#ifndef _OPENMP
+#   define LEB_MORTON_PARALLEL_FOR
+#else
+#   if defined(_WIN32)
+#       define LEB_MORTON_PARALLEL_FOR __pragma("omp parallel for schedule(static)")
+#   else
+#       define LEB_MORTON_PARALLEL_FOR _Pragma("omp parallel for schedule(static)")
+#   endif
+#endif
+
+struct leb_MortonTraversal {
+    int64_t log2Resolution, log2TileSize;
+    int64_t nodeCount, capacity;
+    uint64_t *keys, *keysTmp;
+    cbt_Node *nodes, *nodesTmp;
+};
+
+
+/*******************************************************************************
+ * SpreadBits -- Inserts a zero bit between each of the 32 bits of the input
+ *
+ */
+static uint64_t leb__SpreadBits(uint64_t x)
+{
+    x&= 0x00000000FFFFFFFFULL;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x <<  8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x <<  2)) & 0x3333333333333333ULL;
+    x = (x | (x <<  1)) & 0x5555555555555555ULL;
+
+    return x;
+}
+
+
+/*******************************************************************************
+ * Select -- Branchless select between two fixed-point vertices
+ *
+ * The mask is either all zeroes (returns a) or all ones (returns b).
+ *
+ */
+static void
+leb__Select(const uint32_t a[2], const uint32_t b[2], uint32_t mask, uint32_t out[2])
+{
+    out[0] = (a[0] & ~mask) | (b[0] & mask);
+    out[1] = (a[1] & ~mask) | (b[1] & mask);
+}
+
+
+/*******************************************************************************
+ * SplitVertices -- Fixed-point equivalent of leb__SplittingMatrix
+ *
+ */
+static void leb__SplitVertices(uint32_t v[3][2], uint64_t bitValue)
+{
+    uint32_t mask = 0u - (uint32_t)bitValue;
+    uint32_t tmp[3][2];
+
+    leb__Select(v[0], v[1], mask, tmp[0]);
+    tmp[1][0] = (v[0][0] + v[2][0]) >> 1;
+    tmp[1][1] = (v[0][1] + v[2][1]) >> 1;
+    leb__Select(v[1], v[2], mask, tmp[2]);
+    memcpy(v, tmp, sizeof(tmp));
+}
+
+
+/*******************************************************************************
+ * Centroid -- Returns the centroid of fixed-point vertices
+ *
+ */
+static void leb__Centroid(const uint32_t v[3][2], uint32_t centroid[2])
+{
+    centroid[0] = (uint32_t)(((uint64_t)v[0][0] + v[1][0] + v[2][0]) / 3u);
+    centroid[1] = (uint32_t)(((uint64_t)v[0][1] + v[1][1] + v[2][1]) / 3u);
+}
+
+
+/*******************************************************************************
+ * DecodeNodeCentroid -- Computes the centroid of a node from its ID bits
+ *
+ * This mirrors leb_DecodeNodeAttributeArray for the unit face vertices
+ * {(0, 1), (0, 0), (1, 0)} but only relies on selects and shifts, so it
+ * is much cheaper than the matrix products. The winding matrix is skipped
+ * since it does not affect the centroid. The output is expressed in
+ * fixed-point with LEB_MORTON_FIXED_POINT_BITS bits of precision.
+ *
+ */
+LEBMDEF void leb_DecodeNodeCentroid(const cbt_Node node, uint32_t centroid[2])
+{
+    const uint32_t one = 1u << LEB_MORTON_FIXED_POINT_BITS;
+    uint32_t v[3][2] = {{0u, one}, {0u, 0u}, {one, 0u}};
+
+    for (int64_t bitID = node.depth - 1; bitID >= 0; --bitID) {
+        leb__SplitVertices(v, (node.id >> bitID) & 1u);
+    }
+
+    leb__Centroid(v, centroid);
+}
+
+LEBMDEF void
+leb_DecodeNodeCentroid_Square(const cbt_Node node, uint32_t centroid[2])
+{
+    const uint32_t one = 1u << LEB_MORTON_FIXED_POINT_BITS;
+    uint32_t v[3][2] = {{0u, one}, {0u, 0u}, {one, 0u}};
+    int64_t bitID = node.depth > 0 ? node.depth - 1 : 0;
+    uint32_t mask = 0u - (uint32_t)((node.id >> bitID) & 1u);
+    uint32_t diagonal[2] = {v[0][0] + v[2][0], v[0][1] + v[2][1]};
+    uint32_t tmp[3][2];
+
+    // fixed-point equivalent of leb__SquareMatrix
+    leb__Select(v[0], v[2], mask, tmp[0]);
+    leb__Select(v[1], diagonal, mask, tmp[1]);
+    leb__Select(v[2], v[0], mask, tmp[2]);
+    memcpy(v, tmp, sizeof(tmp));
+
+    for (bitID = node.depth - 2; bitID >= 0; --bitID) {
+        leb__SplitVertices(v, (node.id >> bitID) & 1u);
+    }
+
+    leb__Centroid(v, centroid);
+}
+
+
+/*******************************************************************************
+ * MortonKey -- Computes the traversal key of a fixed-point centroid
+ *
+ * The key is the row-major index of the tile that contains the centroid,
+ * followed by the Z-order index of the centroid's texel within that tile.
+ *
+ */
+LEBMDEF uint64_t
+leb_MortonKey(const leb_MortonTraversal *traversal, const uint32_t centroid[2])
+{
+    const int64_t r = traversal->log2Resolution;
+    const int64_t t = traversal->log2TileSize;
+    const uint32_t texelMax = (1u << r) - 1u;
+    const uint32_t tileMask = (1u << t) - 1u;
+    uint32_t x = centroid[0] >> (LEB_MORTON_FIXED_POINT_BITS - r);
+    uint32_t y = centroid[1] >> (LEB_MORTON_FIXED_POINT_BITS - r);
+    uint64_t tileID;
+
+    x = x > texelMax ? texelMax : x;
+    y = y > texelMax ? texelMax : y;
+    tileID = ((uint64_t)(y >> t) << (r - t)) | (uint64_t)(x >> t);
+
+    return (tileID << (2 * t))
+         | leb__SpreadBits(x & tileMask)
+         | (leb__SpreadBits(y & tileMask) << 1);
+}
+
+
+/*******************************************************************************
+ * Create -- Allocates a traversal for a given heightmap layout
+ *
+ */
+LEBMDEF leb_MortonTraversal *
+leb_CreateMortonTraversal(int64_t log2Resolution, int64_t log2TileSize)
+{
+    leb_MortonTraversal *traversal;
+
+    LEB_MORTON_ASSERT(log2Resolution >= 0);
+    LEB_MORTON_ASSERT(log2Resolution <= LEB_MORTON_FIXED_POINT_BITS);
+    LEB_MORTON_ASSERT(log2TileSize >= 0 && log2TileSize <= log2Resolution);
+
+    traversal = (leb_MortonTraversal *)CBT_MALLOC(sizeof(*traversal));
+    traversal->log2Resolution = log2Resolution;
+    traversal->log2TileSize = log2TileSize;
+    traversal->nodeCount = 0;
+    traversal->capacity = 0;
+    traversal->keys = traversal->keysTmp = NULL;
+    traversal->nodes = traversal->nodesTmp = NULL;
+
+    return traversal;
+}
+
+
+/*******************************************************************************
+ * Release -- Releases a traversal
+ *
+ */
+LEBMDEF void leb_ReleaseMortonTraversal(leb_MortonTraversal *traversal)
+{
+    CBT_FREE(traversal->keys);
+    CBT_FREE(traversal->keysTmp);
+    CBT_FREE(traversal->nodes);
+    CBT_FREE(traversal->nodesTmp);
+    CBT_FREE(traversal);
+}
+
+
+/*******************************************************************************
+ * Reserve -- Grows the scratch buffers of the traversal
+ *
+ */
+static void leb__MortonReserve(leb_MortonTraversal *traversal, int64_t nodeCount)
+{
+    if (nodeCount > traversal->capacity) {
+        int64_t capacity = nodeCount + (nodeCount >> 1);
+
+        CBT_FREE(traversal->keys);
+        CBT_FREE(traversal->keysTmp);
+        CBT_FREE(traversal->nodes);
+        CBT_FREE(traversal->nodesTmp);
+        traversal->keys     = (uint64_t *)CBT_MALLOC(sizeof(uint64_t) * capacity);
+        traversal->keysTmp  = (uint64_t *)CBT_MALLOC(sizeof(uint64_t) * capacity);
+        traversal->nodes    = (cbt_Node *)CBT_MALLOC(sizeof(cbt_Node) * capacity);
+        traversal->nodesTmp = (cbt_Node *)CBT_MALLOC(sizeof(cbt_Node) * capacity);
+        traversal->capacity = capacity;
+    }
+}
+
+
+/*******************************************************************************
+ * RadixSort -- Sorts the decoded nodes by key
+ *
+ * LSD radix sort over 8-bit digits; only the bits actually used by the
+ * keys are processed.
+ *
+ */
+static void leb__MortonRadixSort(leb_MortonTraversal *traversal)
+{
+    const int64_t keyBitCount = 2 * traversal->log2Resolution;
+    const int64_t nodeCount = traversal->nodeCount;
+
+    for (int64_t shift = 0; shift < keyBitCount; shift+= 8) {
+        int64_t histogram[256] = {0};
+        int64_t offset = 0;
+        uint64_t *keys = traversal->keys;
+        cbt_Node *nodes = traversal->nodes;
+
+        for (int64_t i = 0; i < nodeCount; ++i) {
+            ++histogram[(keys[i] >> shift) & 0xFF];
+        }
+
+        for (int64_t i = 0; i < 256; ++i) {
+            int64_t count = histogram[i];
+
+            histogram[i] = offset;
+            offset+= count;
+        }
+
+        for (int64_t i = 0; i < nodeCount; ++i) {
+            int64_t j = histogram[(keys[i] >> shift) & 0xFF]++;
+
+            traversal->keysTmp[j] = keys[i];
+            traversal->nodesTmp[j] = nodes[i];
+        }
+
+        traversal->keys = traversal->keysTmp;
+        traversal->keysTmp = keys;
+        traversal->nodes = traversal->nodesTmp;
+        traversal->nodesTmp = nodes;
+    }
+}
+
+
+/*******************************************************************************
+ * Sort -- Decodes all the leaves of the CBT and sorts them by key
+ *
+ */
+static void
+leb__MortonSort(
+    leb_MortonTraversal *traversal,
+    const cbt_Tree *cbt,
+    void (*decodeCentroid)(const cbt_Node, uint32_t[2])
+) {
+    const int64_t nodeCount = cbt_NodeCount(cbt);
+
+    leb__MortonReserve(traversal, nodeCount);
+    traversal->nodeCount = nodeCount;
+
+LEB_MORTON_PARALLEL_FOR
+    for (int64_t handle = 0; handle < nodeCount; ++handle) {
+        cbt_Node node = cbt_DecodeNode(cbt, handle);
+        uint32_t centroid[2];
+
+        (*decodeCentroid)(node, centroid);
+        traversal->nodes[handle] = node;
+        traversal->keys[handle] = leb_MortonKey(traversal, centroid);
+    }
+
+    leb__MortonRadixSort(traversal);
+}
+
+LEBMDEF void
+leb_MortonSort(leb_MortonTraversal *traversal, const cbt_Tree *cbt)
+{
+    leb__MortonSort(traversal, cbt, &leb_DecodeNodeCentroid);
+}
+
+LEBMDEF void
+leb_MortonSort_Square(leb_MortonTraversal *traversal, const cbt_Tree *cbt)
+{
+    leb__MortonSort(traversal, cbt, &leb_DecodeNodeCentroid_Square);
+}
+
+
+/*******************************************************************************
+ * O(1) Queries -- Access the sorted leaves
+ *
+ */
+LEBMDEF int64_t leb_MortonNodeCount(const leb_MortonTraversal *traversal)
+{
+    return traversal->nodeCount;
+}
+
+LEBMDEF cbt_Node
+leb_MortonNode(const leb_MortonTraversal *traversal, int64_t mortonID)
+{
+    LEB_MORTON_ASSERT(mortonID >= 0 && mortonID < traversal->nodeCount);
+
+    return traversal->nodes[mortonID];
+}
+
+
+/*******************************************************************************
+ * Apply -- Invokes a callback on each sorted node in parallel, in key order
+ *
+ * The sorted leaves are distributed in contiguous chunks (static schedule)
+ * so that each thread works on a compact set of heightmap tiles. The sum
+ * reduction is left to the caller.
+ *
+ */
+LEBMDEF void
+leb_MortonApply(
+    const leb_MortonTraversal *traversal,
+    cbt_Tree *cbt,
+    cbt_UpdateCallback updater,
+    const void *userData
+) {
+    const int64_t nodeCount = traversal->nodeCount;
+
+LEB_MORTON_PARALLEL_FOR
+    for (int64_t mortonID = 0; mortonID < nodeCount; ++mortonID) {
+        updater(cbt, traversal->nodes[mortonID], userData);
+    }
+}
+
+#undef LEB_MORTON_PARALLEL_FOR
+
+#endif // LEB_MORTON_IMPLEMENTATION
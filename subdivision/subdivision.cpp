@@ -1,6 +1,13 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
@@ -15,9 +22,15 @@
 #define LEB_IMPLEMENTATION
 #include "leb.h"
 
+#define LEB_MORTON_IMPLEMENTATION
+#include "leb_morton.h"
+
 #define DJ_OPENGL_IMPLEMENTATION
 #include "dj_opengl.h"
 
+#include "cbt_buffer.hpp"
+#include "target_set.hpp"
+
 #define CBT_INIT_MAX_DEPTH 1
 
 #ifndef PATH_TO_SRC_DIRECTORY
@@ -40,23 +53,32 @@ struct Window {
 
 #define CBT_MAX_DEPTH 20
 enum {MODE_TRIANGLE, MODE_SQUARE};
-enum {BACKEND_CPU, BACKEND_GPU};
+enum {BACKEND_CPU, BACKEND_GPU, BACKEND_CPU_ASYNC};
+enum {TRAVERSAL_HANDLE, TRAVERSAL_MORTON};
 struct LongestEdgeBisection {
     cbt_Tree *cbt;
+    leb_MortonTraversal *morton;
+    TargetSet targets; // CPU backends only
     struct {
         int mode;
         int backend;
+        int traversal;
         struct {
             float x, y;
         } target;
+        int targetCount;
     } params;
     int32_t triangleCount;
 } g_leb = {
     cbt_CreateAtDepth(CBT_MAX_DEPTH, CBT_INIT_MAX_DEPTH),
+    leb_CreateMortonTraversal(10, 6), // 1024^2 texels in 64^2 tiles
+    TargetSet(),
     {
         MODE_TRIANGLE,
         BACKEND_GPU,
-        {0.49951f, 0.41204f}
+        TRAVERSAL_HANDLE,
+        {0.49951f, 0.41204f},
+        1
     },
     0
 };
@@ -106,12 +128,16 @@ struct OpenGL {
     GLuint buffers[BUFFER_COUNT];
     GLuint queries[QUERY_COUNT];
     djg_clock *clocks[CLOCK_COUNT];
+    CbtBufferStream *cbtStream; // CPU backends only
+    CbtDirtyBlocks *cbtDirtyBlocks; // written by the CPU backend since the last upload
 } g_gl = {
     {0},
     {0},
     {0},
     {0},
-    {NULL}
+    {NULL},
+    NULL,
+    NULL
 };
 
 #define PATH_TO_SHADER_DIRECTORY PATH_TO_SRC_DIRECTORY "subdivision/shaders/"
@@ -346,23 +372,64 @@ bool LoadTriangleCountBuffer()
     return glGetError() == GL_NO_ERROR;
 }
 
+// uploads the blocks the CPU backend wrote since the last upload
+bool UploadCbtBuffer()
+{
+    g_gl.cbtStream->upload(cbt_GetHeap(g_leb.cbt), *g_gl.cbtDirtyBlocks);
+    g_gl.cbtDirtyBlocks->clear();
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+// the GPU backend subdivides the buffer in place, while the CPU backends
+// stream their heap through a persistently mapped ring (see cbt_buffer.hpp)
 bool LoadCbtBuffer()
 {
     GLuint *buffer = &g_gl.buffers[BUFFER_CBT];
 
-    if (glIsBuffer(*buffer))
+    if (g_leb.params.backend == BACKEND_GPU) {
+        delete g_gl.cbtStream;
+        delete g_gl.cbtDirtyBlocks;
+        g_gl.cbtStream = NULL;
+        g_gl.cbtDirtyBlocks = NULL;
+
+        if (glIsBuffer(*buffer))
+            glDeleteBuffers(1, buffer);
+
+        glGenBuffers(1, buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER,
+                        cbt_HeapByteSize(g_leb.cbt),
+                        cbt_GetHeap(g_leb.cbt),
+                        0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BUFFER_CBT, *buffer);
+
+        return glGetError() == GL_NO_ERROR;
+    }
+
+    if (glIsBuffer(*buffer)) {
         glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
 
-    glGenBuffers(1, buffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffer);
-    glBufferStorage(GL_SHADER_STORAGE_BUFFER,
-                    cbt_HeapByteSize(g_leb.cbt),
-                    cbt_GetHeap(g_leb.cbt),
-                    0);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BUFFER_CBT, *buffer);
+    if (!g_gl.cbtStream
+        || g_gl.cbtStream->heapByteSize() != cbt_HeapByteSize(g_leb.cbt)) {
+        delete g_gl.cbtStream;
+        delete g_gl.cbtDirtyBlocks;
+        g_gl.cbtStream = new CbtBufferStream(BUFFER_CBT,
+                                             cbt_HeapByteSize(g_leb.cbt),
+                                             cbt_GetHeap(g_leb.cbt));
+        g_gl.cbtDirtyBlocks = new CbtDirtyBlocks(cbt_HeapByteSize(g_leb.cbt));
+
+        if (!g_gl.cbtStream->isMapped())
+            return false;
+    }
 
-    return glGetError() == GL_NO_ERROR;
+    // the heap was reset: every block may differ from the streamed ones
+    g_gl.cbtDirtyBlocks->markAll();
+
+    return UploadCbtBuffer();
 }
 
 bool LoadCbtDispatcherBuffer()
@@ -497,6 +564,10 @@ bool Load()
 
 void Release()
 {
+    delete g_gl.cbtStream;
+    delete g_gl.cbtDirtyBlocks;
+    g_gl.cbtStream = NULL;
+    g_gl.cbtDirtyBlocks = NULL;
     glDeleteBuffers(BUFFER_COUNT, g_gl.buffers);
     glDeleteVertexArrays(VERTEXARRAY_COUNT, g_gl.vertexarrays);
 
@@ -587,28 +658,156 @@ void ReleaseGui()
     ImGui::DestroyContext();
 }
 
-float Wedge(const float *a, const float *b)
+// snapshot of the parameters read by the CPU subdivision callbacks
+struct CpuSubdivisionParams {
+    int mode;
+    int traversal;
+    const TargetSet *targets;
+    CbtDirtyBlocks *dirtyBlocks; // may be NULL
+};
+
+CpuSubdivisionParams CurrentCpuSubdivisionParams()
 {
-    return a[0] * b[1] - a[1] * b[0];
+    CpuSubdivisionParams params = {
+        g_leb.params.mode,
+        g_leb.params.traversal,
+        &g_leb.targets,
+        g_gl.cbtDirtyBlocks
+    };
+
+    return params;
 }
 
-bool IsInside(const float faceVertices[][3])
+// the GUI target refines down to the maximum depth; the other targets are
+// agents moving along Lissajous curves, each with its own depth
+void UpdateTargets(int frameID)
 {
-    float target[2] = {g_leb.params.target.x, g_leb.params.target.y};
-    float v1[2] = {faceVertices[0][0], faceVertices[1][0]};
-    float v2[2] = {faceVertices[0][1], faceVertices[1][1]};
-    float v3[2] = {faceVertices[0][2], faceVertices[1][2]};
-    float x1[2] = {v2[0] - v1[0], v2[1] - v1[1]};
-    float x2[2] = {v3[0] - v2[0], v3[1] - v2[1]};
-    float x3[2] = {v1[0] - v3[0], v1[1] - v3[1]};
-    float y1[2] = {target[0] - v1[0], target[1] - v1[1]};
-    float y2[2] = {target[0] - v2[0], target[1] - v2[1]};
-    float y3[2] = {target[0] - v3[0], target[1] - v3[1]};
-    float w1 = Wedge(x1, y1);
-    float w2 = Wedge(x2, y2);
-    float w3 = Wedge(x3, y3);
+    const int maxDepth = cbt_MaxDepth(g_leb.cbt);
+    const float t = (float)frameID / 60.0f;
+    const float center = g_leb.params.mode == MODE_TRIANGLE ? 0.3f : 0.5f;
+    const float radius = g_leb.params.mode == MODE_TRIANGLE ? 0.15f : 0.45f;
+
+    g_leb.targets.clear();
+    g_leb.targets.push(g_leb.params.target.x, g_leb.params.target.y, maxDepth);
+
+    for (int i = 1; i < g_leb.params.targetCount; ++i) {
+        const float phase = 2.399963f * (float)i; // golden angle
+        const float speed = 0.2f + 0.05f * (float)(i % 5);
+        const int depth = std::max(maxDepth - 2 * (i % 4), 1);
+
+        g_leb.targets.push(center + radius * sinf(3.0f * speed * t + phase),
+                           center + radius * sinf(2.0f * speed * t + 1.7f * phase),
+                           depth);
+    }
 
-    return (w1 >= 0.0f) && (w2 >= 0.0f) && (w3 >= 0.0f);
+    g_leb.targets.build();
+}
+
+// The tree of the previous frame is always the starting point of the next
+// one. Splits only add nodes and merges only remove them, so a pass that
+// leaves the node count untouched did nothing; once a split and a merge
+// pass in a row were idle and the targets did not move, the tree has
+// converged and the passes can be skipped altogether.
+struct SubdivisionHistory {
+    uint32_t targetVersion;
+    int64_t nodeCount;
+    int idlePassCount;
+} g_history = {0u, -1, 0};
+
+void HistoryReset(SubdivisionHistory *history)
+{
+    history->nodeCount = -1;
+    history->idlePassCount = 0;
+}
+
+bool HistoryIsConverged(SubdivisionHistory *history, const TargetSet *targets)
+{
+    if (history->targetVersion != targets->version()) {
+        history->targetVersion = targets->version();
+        history->idlePassCount = 0;
+    }
+
+    return history->idlePassCount >= 2;
+}
+
+void HistoryRecordPass(SubdivisionHistory *history, const cbt_Tree *cbt)
+{
+    const int64_t nodeCount = cbt_NodeCount(cbt);
+
+    if (nodeCount == history->nodeCount)
+        ++history->idlePassCount;
+    else
+        history->idlePassCount = 0;
+
+    history->nodeCount = nodeCount;
+}
+
+// The callbacks record the heap blocks their splits and merges write, so
+// that uploads copy only those. Setting a bitfield bit also changes the
+// sum-reduction counters of all its ancestors, which the next reduction
+// rewrites.
+void MarkBitFieldWrite(const cbt_Tree *cbt, const cbt_Node node, CbtDirtyBlocks *dirtyBlocks)
+{
+    const int64_t maxDepth = cbt_MaxDepth(cbt);
+    const uint64_t leafID = node.id << (maxDepth - node.depth);
+
+    dirtyBlocks->markBits(cbt__NodeBitID_BitField(cbt, node), 1);
+
+    for (int64_t depth = 0; depth < maxDepth; ++depth) {
+        const cbt_Node ancestor = cbt_CreateNode(leafID >> (maxDepth - depth), depth);
+
+        dirtyBlocks->markBits(cbt__NodeBitID(cbt, ancestor),
+                              cbt__NodeBitSize(cbt, ancestor));
+    }
+}
+
+// cbt_SplitNode(node) sets the bit of the right child of node
+void MarkSplit(const cbt_Tree *cbt, const cbt_Node node, CbtDirtyBlocks *dirtyBlocks)
+{
+    if (!cbt_IsCeilNode(cbt, node))
+        MarkBitFieldWrite(cbt, cbt_RightChildNode_Fast(node), dirtyBlocks);
+}
+
+// walks the same chain of nodes as leb_SplitNode(_Square), which only
+// depends on the node IDs
+void MarkLebSplit(const cbt_Tree *cbt, const cbt_Node node, int mode, CbtDirtyBlocks *dirtyBlocks)
+{
+    const uint64_t minNodeID = 1u;
+    cbt_Node nodeIterator = node;
+
+    if (cbt_IsCeilNode(cbt, node))
+        return;
+
+    MarkSplit(cbt, nodeIterator, dirtyBlocks);
+    nodeIterator = mode == MODE_TRIANGLE ? leb__EdgeNeighbor(nodeIterator)
+                                         : leb__EdgeNeighbor_Square(nodeIterator);
+
+    while (nodeIterator.id > minNodeID) {
+        MarkSplit(cbt, nodeIterator, dirtyBlocks);
+        nodeIterator = cbt_ParentNode_Fast(nodeIterator);
+
+        if (mode == MODE_TRIANGLE || nodeIterator.id > minNodeID) {
+            MarkSplit(cbt, nodeIterator, dirtyBlocks);
+            nodeIterator = mode == MODE_TRIANGLE ? leb__EdgeNeighbor(nodeIterator)
+                                                 : leb__EdgeNeighbor_Square(nodeIterator);
+        }
+    }
+}
+
+// leb_MergeNode(_Square) clears the bit of the right sibling of node, if
+// the diamond parent is stored
+void
+MarkLebMerge(
+    cbt_Tree *cbt,
+    const cbt_Node node,
+    const leb_DiamondParent diamondParent,
+    int mode,
+    CbtDirtyBlocks *dirtyBlocks
+) {
+    const int64_t minDepth = mode == MODE_TRIANGLE ? 0 : 1;
+
+    if (node.depth > minDepth && leb__HasDiamondParent(cbt, diamondParent))
+        MarkBitFieldWrite(cbt, cbt_RightSiblingNode_Fast(node), dirtyBlocks);
 }
 
 void
@@ -617,22 +816,28 @@ UpdateSubdivisionCpuCallback_Split(
     const cbt_Node node,
     const void *userData
 ) {
-    (void)userData;
+    const CpuSubdivisionParams *params = (const CpuSubdivisionParams *)userData;
     float faceVertices[][3] = {
         {0.0f, 0.0f, 1.0f},
         {1.0f, 0.0f, 0.0f}
     };
 
-    if (g_leb.params.mode == MODE_TRIANGLE) {
+    if (params->mode == MODE_TRIANGLE) {
         leb_DecodeNodeAttributeArray(node, 2, faceVertices);
 
-        if (IsInside(faceVertices)) {
+        if (params->targets->refines(faceVertices, node.depth)) {
+            if (params->dirtyBlocks)
+                MarkLebSplit(cbt, node, MODE_TRIANGLE, params->dirtyBlocks);
+
             leb_SplitNode(cbt, node);
         }
     } else {
         leb_DecodeNodeAttributeArray_Square(node, 2, faceVertices);
 
-        if (IsInside(faceVertices)) {
+        if (params->targets->refines(faceVertices, node.depth)) {
+            if (params->dirtyBlocks)
+                MarkLebSplit(cbt, node, MODE_SQUARE, params->dirtyBlocks);
+
             leb_SplitNode_Square(cbt, node);
         }
     }
@@ -644,7 +849,7 @@ UpdateSubdivisionCpuCallback_Merge(
     const cbt_Node node,
     const void *userData
 ) {
-    (void)userData;
+    const CpuSubdivisionParams *params = (const CpuSubdivisionParams *)userData;
     float baseFaceVertices[][3] = {
         {0.0f, 0.0f, 1.0f},
         {1.0f, 0.0f, 0.0f}
@@ -654,13 +859,17 @@ UpdateSubdivisionCpuCallback_Merge(
         {1.0f, 0.0f, 0.0f}
     };
 
-    if (g_leb.params.mode == MODE_TRIANGLE) {
+    if (params->mode == MODE_TRIANGLE) {
         leb_DiamondParent diamondParent = leb_DecodeDiamondParent(node);
 
         leb_DecodeNodeAttributeArray(diamondParent.base, 2, baseFaceVertices);
         leb_DecodeNodeAttributeArray(diamondParent.top, 2, topFaceVertices);
 
-        if (!IsInside(baseFaceVertices) && !IsInside(topFaceVertices)) {
+        if (!params->targets->refines(baseFaceVertices, diamondParent.base.depth)
+            && !params->targets->refines(topFaceVertices, diamondParent.top.depth)) {
+            if (params->dirtyBlocks)
+                MarkLebMerge(cbt, node, diamondParent, MODE_TRIANGLE, params->dirtyBlocks);
+
             leb_MergeNode(cbt, node, diamondParent);
         }
     } else {
@@ -669,27 +878,282 @@ UpdateSubdivisionCpuCallback_Merge(
         leb_DecodeNodeAttributeArray_Square(diamondParent.base, 2, baseFaceVertices);
         leb_DecodeNodeAttributeArray_Square(diamondParent.top, 2, topFaceVertices);
 
-        if (!IsInside(baseFaceVertices) && !IsInside(topFaceVertices)) {
+        if (!params->targets->refines(baseFaceVertices, diamondParent.base.depth)
+            && !params->targets->refines(topFaceVertices, diamondParent.top.depth)) {
+            if (params->dirtyBlocks)
+                MarkLebMerge(cbt, node, diamondParent, MODE_SQUARE, params->dirtyBlocks);
+
             leb_MergeNode_Square(cbt, node, diamondParent);
         }
     }
 }
 
+void
+UpdateSubdivisionCpu(
+    cbt_Tree *cbt,
+    leb_MortonTraversal *morton,
+    const CpuSubdivisionParams *params,
+    cbt_UpdateCallback updater
+) {
+    if (params->traversal == TRAVERSAL_HANDLE) {
+        const int64_t nodeCount = cbt_NodeCount(cbt);
+
+#pragma omp parallel for
+        for (int64_t handle = 0; handle < nodeCount; ++handle) {
+            updater(cbt, cbt_DecodeNode(cbt, handle), params);
+        }
+    } else {
+        if (params->mode == MODE_TRIANGLE) {
+            leb_MortonSort(morton, cbt);
+        } else {
+            leb_MortonSort_Square(morton, cbt);
+        }
+
+        leb_MortonApply(morton, cbt, updater, params);
+    }
+}
+
+void UpdateSubdivisionCpu(cbt_UpdateCallback updater)
+{
+    const CpuSubdivisionParams params = CurrentCpuSubdivisionParams();
+
+    UpdateSubdivisionCpu(g_leb.cbt, g_leb.morton, &params, updater);
+}
+
+void ReductionCpu(cbt_Tree *cbt)
+{
+    cbt__ComputeSumReduction(cbt);
+}
+
+// -----------------------------------------------------------------------------
+// Asynchronous CPU backend
+//
+// A worker thread refines its own copy of the CBT against the latest targets
+// and publishes each completed heap through a lock-free triple buffer,
+// along with the blocks it wrote since the last heap the render thread
+// picked up. The render thread picks up the newest heap (if any) and stages
+// these blocks into the CBT buffer stream, which only writes them. Neither
+// thread ever blocks on the other, and the render thread defers the write
+// rather than stall if the GPU is still reading the free slot.
+
+#define MAILBOX_FRESH_BIT 4
+struct HeapMailbox {
+    std::vector<char> heaps[3];
+    std::vector<CbtDirtyBlocks> dirtyBlocks; // one per heap
+    std::atomic<int> middle; // index of the shared slot | MAILBOX_FRESH_BIT
+    int back;                // owned by the worker
+    int front;               // owned by the render thread
+};
+
+void MailboxInit(HeapMailbox *mailbox, const char *heap, int64_t byteSize)
+{
+    for (int i = 0; i < 3; ++i)
+        mailbox->heaps[i].assign(heap, heap + byteSize);
+
+    mailbox->dirtyBlocks.assign(3, CbtDirtyBlocks(byteSize));
+
+    mailbox->back = 0;
+    mailbox->middle.store(1);
+    mailbox->front = 2;
+}
+
+// pendingBlocks holds the blocks written since the last heap that was
+// fetched, and is reset once the heap it was published with is fetched
+void
+MailboxPublish(
+    HeapMailbox *mailbox,
+    const char *heap,
+    int64_t byteSize,
+    CbtDirtyBlocks *pendingBlocks,
+    CbtDirtyBlocks *iterationBlocks
+) {
+    int previous;
+
+    pendingBlocks->merge(*iterationBlocks);
+    memcpy(mailbox->heaps[mailbox->back].data(), heap, byteSize);
+    mailbox->dirtyBlocks[mailbox->back] = *pendingBlocks;
+    previous = mailbox->middle.exchange(mailbox->back | MAILBOX_FRESH_BIT);
+    mailbox->back = previous & ~MAILBOX_FRESH_BIT;
+
+    // the previous heap was fetched: the next one only needs this iteration
+    if (!(previous & MAILBOX_FRESH_BIT))
+        *pendingBlocks = *iterationBlocks;
+
+    iterationBlocks->clear();
+}
+
+const char *MailboxFetch(HeapMailbox *mailbox, const CbtDirtyBlocks **dirtyBlocks)
+{
+    if (!(mailbox->middle.load() & MAILBOX_FRESH_BIT))
+        return NULL;
+
+    mailbox->front = mailbox->middle.exchange(mailbox->front)
+                   & ~MAILBOX_FRESH_BIT;
+    *dirtyBlocks = &mailbox->dirtyBlocks[mailbox->front];
+
+    return mailbox->heaps[mailbox->front].data();
+}
+
+const char *MailboxFront(const HeapMailbox *mailbox)
+{
+    return mailbox->heaps[mailbox->front].data();
+}
+
+struct AsyncSubdivision {
+    std::thread worker;
+    std::atomic<bool> isRunning;
+    std::mutex targetMutex;
+    TargetSet targets;                  // guarded by targetMutex
+    std::atomic<double> iterationTime;  // in ms
+    HeapMailbox mailbox;
+    double uploadTime;                  // in ms
+} g_async;
+
+void AsyncSubdivisionWorker(cbt_Tree *cbt, CpuSubdivisionParams params)
+{
+    leb_MortonTraversal *morton = leb_CreateMortonTraversal(10, 6);
+    SubdivisionHistory history = {0u, -1, 0};
+    TargetSet targets;
+    CbtDirtyBlocks pendingBlocks(cbt_HeapByteSize(cbt));
+    CbtDirtyBlocks iterationBlocks(cbt_HeapByteSize(cbt));
+
+    params.targets = &targets;
+    params.dirtyBlocks = &iterationBlocks;
+
+    while (g_async.isRunning.load()) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> dt;
+
+        {
+            std::lock_guard<std::mutex> lock(g_async.targetMutex);
+
+            if (targets.version() != g_async.targets.version())
+                targets = g_async.targets;
+        }
+
+        if (HistoryIsConverged(&history, &targets)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        UpdateSubdivisionCpu(cbt, morton, &params, &UpdateSubdivisionCpuCallback_Split);
+        ReductionCpu(cbt);
+        HistoryRecordPass(&history, cbt);
+        UpdateSubdivisionCpu(cbt, morton, &params, &UpdateSubdivisionCpuCallback_Merge);
+        ReductionCpu(cbt);
+        HistoryRecordPass(&history, cbt);
+        MailboxPublish(&g_async.mailbox,
+                       cbt_GetHeap(cbt),
+                       cbt_HeapByteSize(cbt),
+                       &pendingBlocks,
+                       &iterationBlocks);
+
+        dt = std::chrono::steady_clock::now() - start;
+        g_async.iterationTime.store(dt.count());
+    }
+
+    leb_ReleaseMortonTraversal(morton);
+    cbt_Release(cbt);
+}
+
+bool StartAsyncSubdivision()
+{
+    const CpuSubdivisionParams params = CurrentCpuSubdivisionParams();
+    cbt_Tree *cbt;
+
+    if (!LoadCbtBuffer())
+        return false;
+
+    cbt = cbt_Create(cbt_MaxDepth(g_leb.cbt));
+    cbt_SetHeap(cbt, cbt_GetHeap(g_leb.cbt));
+    MailboxInit(&g_async.mailbox, cbt_GetHeap(cbt), cbt_HeapByteSize(cbt));
+    g_async.targets = *params.targets;
+    g_async.iterationTime.store(0.0);
+    g_async.uploadTime = 0.0;
+    g_async.isRunning.store(true);
+    g_async.worker = std::thread(&AsyncSubdivisionWorker, cbt, params);
+
+    return true;
+}
+
+void StopAsyncSubdivision()
+{
+    if (!g_async.worker.joinable())
+        return;
+
+    g_async.isRunning.store(false);
+    g_async.worker.join();
+}
+
+void PushAsyncTargets()
+{
+    std::lock_guard<std::mutex> lock(g_async.targetMutex);
+
+    if (g_async.targets.version() != g_leb.targets.version())
+        g_async.targets = g_leb.targets;
+}
+
+void UploadAsyncSubdivision()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> dt;
+    const CbtDirtyBlocks *dirtyBlocks = NULL;
+
+    // a deferred flush resumes from the last fetched heap
+    if (MailboxFetch(&g_async.mailbox, &dirtyBlocks))
+        g_gl.cbtStream->stage(*dirtyBlocks);
+
+    if (g_gl.cbtStream->flush(MailboxFront(&g_async.mailbox), false)) {
+        dt = std::chrono::steady_clock::now() - start;
+        g_async.uploadTime = dt.count();
+    }
+}
+
+// restarts the subdivision from scratch with the current parameters
+void ResetSubdivision()
+{
+    StopAsyncSubdivision();
+    cbt_ResetToDepth(g_leb.cbt, CBT_INIT_MAX_DEPTH);
+    HistoryReset(&g_history);
+
+    if (g_leb.params.backend == BACKEND_CPU_ASYNC)
+        StartAsyncSubdivision();
+    else
+        LoadCbtBuffer();
+}
+
 void UpdateSubdivision()
 {
     static int pingPong = 0;
+    static int frameID = 0;
+
+    UpdateTargets(frameID++);
 
     if (g_leb.params.backend == BACKEND_CPU) {
+        if (HistoryIsConverged(&g_history, &g_leb.targets)) {
+            pingPong = 1 - pingPong;
+
+            return;
+        }
 
         djgc_start(g_gl.clocks[CLOCK_SUBDIVISION_SPLIT + pingPong]);
         if (pingPong == 0) {
-            cbt_Update(g_leb.cbt, &UpdateSubdivisionCpuCallback_Split, NULL);
+            UpdateSubdivisionCpu(&UpdateSubdivisionCpuCallback_Split);
         } else {
-            cbt_Update(g_leb.cbt, &UpdateSubdivisionCpuCallback_Merge, NULL);
+            UpdateSubdivisionCpu(&UpdateSubdivisionCpuCallback_Merge);
         }
         djgc_stop(g_gl.clocks[CLOCK_SUBDIVISION_SPLIT + pingPong]);
 
-        LoadCbtBuffer();
+        djgc_start(g_gl.clocks[CLOCK_SUM_REDUCTION]);
+        ReductionCpu(g_leb.cbt);
+        djgc_stop(g_gl.clocks[CLOCK_SUM_REDUCTION]);
+        HistoryRecordPass(&g_history, g_leb.cbt);
+
+        UploadCbtBuffer();
+
+    } else if (g_leb.params.backend == BACKEND_CPU_ASYNC) {
+        PushAsyncTargets();
+        UploadAsyncSubdivision();
 
     } else {
         djgc_start(g_gl.clocks[CLOCK_DISPATCHER]);
@@ -710,15 +1174,22 @@ void UpdateSubdivision()
 
 void DrawTarget()
 {
-    // target helper
+    const GLint loc =
+        glGetUniformLocation(g_gl.programs[PROGRAM_TARGET], "u_Target");
+
+    // target helpers (the GPU backend only refines around the GUI target)
     glUseProgram(g_gl.programs[PROGRAM_TARGET]);
-    glUniform2f(
-        glGetUniformLocation(g_gl.programs[PROGRAM_TARGET], "u_Target"),
-        g_leb.params.target.x, g_leb.params.target.y
-    );
     glPointSize(11.f);
     glBindVertexArray(g_gl.vertexarrays[VERTEXARRAY_EMPTY]);
+    if (g_leb.params.backend == BACKEND_GPU) {
+        glUniform2f(loc, g_leb.params.target.x, g_leb.params.target.y);
         glDrawArrays(GL_POINTS, 0, 1);
+    } else {
+        for (int64_t i = 0; i < g_leb.targets.size(); ++i) {
+            glUniform2f(loc, g_leb.targets[i].x, g_leb.targets[i].y);
+            glDrawArrays(GL_POINTS, 0, 1);
+        }
+    }
     glBindVertexArray(0);
     glUseProgram(0);
 }
@@ -765,6 +1236,9 @@ void DrawLeb()
     glUseProgram(0);
     glDisable(GL_CULL_FACE);
 
+    if (g_gl.cbtStream)
+        g_gl.cbtStream->fence();
+
     RetrieveNodeCount();
 }
 
@@ -786,31 +1260,39 @@ void DrawGui()
     ImGui::Begin("Window");
     {
         const char* eModes[] = {"Triangle", "Square"};
-        const char* eBackends[] = {"CPU", "GPU"};
+        const char* eBackends[] = {"CPU", "GPU", "CPU (Async)"};
+        const char* eTraversals[] = {"Handle", "Morton"};
         int32_t cbtByteSize = cbt_HeapByteSize(g_leb.cbt);
         int32_t maxDepth = cbt_MaxDepth(g_leb.cbt);
         double cpuDt, gpuDt;
 
         if (ImGui::Combo("Mode", &g_leb.params.mode, &eModes[0], 2)) {
-            cbt_ResetToDepth(g_leb.cbt, CBT_INIT_MAX_DEPTH);
-            LoadCbtBuffer();
+            ResetSubdivision();
             LoadPrograms();
         }
-        if (ImGui::Combo("Backend", &g_leb.params.backend, &eBackends[0], 2)) {
-            cbt_ResetToDepth(g_leb.cbt, CBT_INIT_MAX_DEPTH);
-            LoadCbtBuffer();
+        if (ImGui::Combo("Backend", &g_leb.params.backend, &eBackends[0], 3)) {
+            ResetSubdivision();
+        }
+        if (g_leb.params.backend != BACKEND_GPU) {
+            if (ImGui::Combo("Traversal", &g_leb.params.traversal, &eTraversals[0], 2)
+                && g_leb.params.backend == BACKEND_CPU_ASYNC) {
+                ResetSubdivision();
+            }
         }
         ImGui::SliderFloat("TargetX", &g_leb.params.target.x, -0.1, 1.1);
         ImGui::SliderFloat("TargetY", &g_leb.params.target.y, -0.1, 1.1);
+        if (g_leb.params.backend != BACKEND_GPU) {
+            ImGui::SliderInt("Targets", &g_leb.params.targetCount, 1, 256);
+        }
         if (ImGui::SliderInt("MaxDepth", &maxDepth, 6, 30)) {
+            StopAsyncSubdivision();
             cbt_Release(g_leb.cbt);
             g_leb.cbt = cbt_CreateAtDepth(maxDepth, CBT_INIT_MAX_DEPTH);
-            LoadCbtBuffer();
+            ResetSubdivision();
             LoadPrograms();
         }
         if (ImGui::Button("Reset")) {
-            cbt_ResetToDepth(g_leb.cbt, CBT_INIT_MAX_DEPTH);
-            LoadCbtBuffer();
+            ResetSubdivision();
         }
         ImGui::Separator();
         ImGui::Text("Nodes: %i", g_leb.triangleCount);
@@ -823,6 +1305,12 @@ void DrawGui()
             ImGui::Text("Subdivision (Split): %.3f", cpuDt * 1e3);
             djgc_ticks(g_gl.clocks[CLOCK_SUBDIVISION_MERGE], &cpuDt, &gpuDt);
             ImGui::Text("Subdivision (Merge): %.3f", cpuDt * 1e3);
+            djgc_ticks(g_gl.clocks[CLOCK_SUM_REDUCTION], &cpuDt, &gpuDt);
+            ImGui::Text("SumReduction:        %.3f", cpuDt * 1e3);
+        } else if (g_leb.params.backend == BACKEND_CPU_ASYNC) {
+            ImGui::Text("Worker Iteration:    %.3f", g_async.iterationTime.load());
+            ImGui::Text("Upload:              %.3f (%li B)",
+                        g_async.uploadTime, (long)g_gl.cbtStream->uploadByteCount());
         } else {
             djgc_ticks(g_gl.clocks[CLOCK_DISPATCHER], &cpuDt, &gpuDt);
             ImGui::Text("Dispatcher  :        %.3f (CPU) %.3f (GPU)", cpuDt * 1e3, gpuDt * 1e3);
@@ -849,13 +1337,319 @@ void resizeCallback(GLFWwindow* window, int width, int height)
 }
 
 
+enum {
+    BENCH_PHASE_SPLIT,
+    BENCH_PHASE_MERGE,
+    BENCH_PHASE_REDUCTION,
+    BENCH_PHASE_UPLOAD,
+    BENCH_PHASE_DRAW,
+
+    BENCH_PHASE_COUNT
+};
+struct BenchFrame {
+    float target[2];
+    double timings[BENCH_PHASE_COUNT]; // in ms, negative if not measured
+    int64_t nodeCount;
+};
+struct Bench {
+    bool enabled;
+    bool useGL;
+    int frameCount;
+    const char *output;
+    std::vector<BenchFrame> frames;
+} g_bench = {
+    false,
+    false,
+    500,
+    NULL,
+    std::vector<BenchFrame>()
+};
+
+// scripted target trajectory: a Lissajous curve that stays inside the
+// refined domain (the lower-left half of the unit square in triangle mode)
+void BenchTarget(int frameID, float target[2])
+{
+    const float t = 6.283185307f * (float)frameID / (float)g_bench.frameCount;
+    const float center = g_leb.params.mode == MODE_TRIANGLE ? 0.3f : 0.5f;
+    const float radius = g_leb.params.mode == MODE_TRIANGLE ? 0.15f : 0.45f;
+
+    target[0] = center + radius * sinf(3.0f * t);
+    target[1] = center + radius * sinf(2.0f * t + 0.5f);
+}
+
+double BenchElapsedMs(const std::chrono::steady_clock::time_point &start)
+{
+    std::chrono::duration<double, std::milli> dt =
+        std::chrono::steady_clock::now() - start;
+
+    return dt.count();
+}
+
+int64_t BenchNodeCount()
+{
+    if (g_leb.params.backend == BACKEND_CPU)
+        return cbt_NodeCount(g_leb.cbt);
+
+    uint32_t nodeCount = 0;
+
+    LebDispatcherKernel();
+    glGetNamedBufferSubData(g_gl.buffers[BUFFER_LEB_DISPATCHER],
+                            sizeof(uint32_t),
+                            sizeof(uint32_t),
+                            &nodeCount);
+
+    return nodeCount;
+}
+
+// each frame runs a split and a merge pass; GL phases are timed up to
+// completion with glFinish so that all timings are wall-clock
+void BenchFrameUpdate(int frameID, BenchFrame *frame)
+{
+    const bool cpu = (g_leb.params.backend == BACKEND_CPU);
+    std::chrono::steady_clock::time_point start;
+
+    g_leb.params.target.x = frame->target[0];
+    g_leb.params.target.y = frame->target[1];
+    UpdateTargets(frameID);
+    frame->timings[BENCH_PHASE_REDUCTION] = 0.0;
+
+    for (int pingPong = 0; pingPong < 2; ++pingPong) {
+        start = std::chrono::steady_clock::now();
+        if (cpu) {
+            UpdateSubdivisionCpu(pingPong == 0 ? &UpdateSubdivisionCpuCallback_Split
+                                               : &UpdateSubdivisionCpuCallback_Merge);
+        } else {
+            DispatcherKernel();
+            SubdivisionKernel(pingPong);
+            glFinish();
+        }
+        frame->timings[BENCH_PHASE_SPLIT + pingPong] = BenchElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        if (cpu) {
+            ReductionCpu(g_leb.cbt);
+        } else {
+            ReductionKernel();
+            glFinish();
+        }
+        frame->timings[BENCH_PHASE_REDUCTION]+= BenchElapsedMs(start);
+    }
+
+    frame->timings[BENCH_PHASE_UPLOAD] = -1.0;
+    if (cpu && g_bench.useGL) {
+        start = std::chrono::steady_clock::now();
+        UploadCbtBuffer();
+        glFinish();
+        frame->timings[BENCH_PHASE_UPLOAD] = BenchElapsedMs(start);
+    }
+
+    frame->timings[BENCH_PHASE_DRAW] = -1.0;
+    if (g_bench.useGL) {
+        start = std::chrono::steady_clock::now();
+        Draw();
+        glFinish();
+        frame->timings[BENCH_PHASE_DRAW] = BenchElapsedMs(start);
+    }
+
+    frame->nodeCount = BenchNodeCount();
+}
+
+void BenchWriteTiming(FILE *pf, double timing, const char *unmeasured)
+{
+    if (timing < 0.0)
+        fprintf(pf, "%s", unmeasured);
+    else
+        fprintf(pf, "%.6f", timing);
+}
+
+void BenchWriteCsv(FILE *pf)
+{
+    fprintf(pf, "frame,target_x,target_y,split_ms,merge_ms,reduction_ms,upload_ms,draw_ms,node_count\n");
+    for (size_t i = 0; i < g_bench.frames.size(); ++i) {
+        const BenchFrame &frame = g_bench.frames[i];
+
+        fprintf(pf, "%i,%f,%f", (int)i, frame.target[0], frame.target[1]);
+        for (int j = 0; j < BENCH_PHASE_COUNT; ++j) {
+            fprintf(pf, ",");
+            BenchWriteTiming(pf, frame.timings[j], "");
+        }
+        fprintf(pf, ",%li\n", (long)frame.nodeCount);
+    }
+}
+
+void BenchWriteJson(FILE *pf)
+{
+    const char *phaseNames[] = {"split_ms", "merge_ms", "reduction_ms", "upload_ms", "draw_ms"};
+
+    fprintf(pf, "{\n");
+    fprintf(pf, "  \"mode\": \"%s\",\n", g_leb.params.mode == MODE_TRIANGLE ? "triangle" : "square");
+    fprintf(pf, "  \"backend\": \"%s\",\n", g_leb.params.backend == BACKEND_CPU ? "cpu" : "gpu");
+    fprintf(pf, "  \"traversal\": \"%s\",\n", g_leb.params.traversal == TRAVERSAL_HANDLE ? "handle" : "morton");
+    fprintf(pf, "  \"max_depth\": %li,\n", (long)cbt_MaxDepth(g_leb.cbt));
+    fprintf(pf, "  \"gl\": %s,\n", g_bench.useGL ? "true" : "false");
+    fprintf(pf, "  \"frames\": [\n");
+    for (size_t i = 0; i < g_bench.frames.size(); ++i) {
+        const BenchFrame &frame = g_bench.frames[i];
+
+        fprintf(pf, "    {\"frame\": %i, \"target\": [%f, %f]", (int)i, frame.target[0], frame.target[1]);
+        for (int j = 0; j < BENCH_PHASE_COUNT; ++j) {
+            fprintf(pf, ", \"%s\": ", phaseNames[j]);
+            BenchWriteTiming(pf, frame.timings[j], "null");
+        }
+        fprintf(pf, ", \"node_count\": %li}%s\n",
+                (long)frame.nodeCount,
+                i + 1 < g_bench.frames.size() ? "," : "");
+    }
+    fprintf(pf, "  ]\n");
+    fprintf(pf, "}\n");
+}
+
+bool BenchWrite()
+{
+    const char *output = g_bench.output;
+    size_t length = output ? strlen(output) : 0;
+    bool json = length >= 5 && !strcmp(output + length - 5, ".json");
+    FILE *pf = output ? fopen(output, "w") : stdout;
+
+    if (!pf) {
+        LOG("=> Failure: could not open %s <=", output);
+
+        return false;
+    }
+
+    if (json)
+        BenchWriteJson(pf);
+    else
+        BenchWriteCsv(pf);
+
+    if (pf != stdout)
+        fclose(pf);
+
+    return true;
+}
+
+bool RunBench()
+{
+    double averages[BENCH_PHASE_COUNT] = {0.0};
+    const char *phaseNames[] = {"Split", "Merge", "Reduction", "Upload", "Draw"};
+
+    LOG("Running {Benchmark} (%i frames)", g_bench.frameCount);
+    cbt_ResetToDepth(g_leb.cbt, CBT_INIT_MAX_DEPTH);
+    if (g_bench.useGL)
+        LoadCbtBuffer();
+
+    g_bench.frames.resize(g_bench.frameCount);
+    for (int i = 0; i < g_bench.frameCount; ++i) {
+        BenchFrame *frame = &g_bench.frames[i];
+
+        BenchTarget(i, frame->target);
+        BenchFrameUpdate(i, frame);
+
+        for (int j = 0; j < BENCH_PHASE_COUNT; ++j)
+            averages[j]+= frame->timings[j] / g_bench.frameCount;
+    }
+
+    for (int j = 0; j < BENCH_PHASE_COUNT; ++j) {
+        if (averages[j] >= 0.0) {
+            LOG("-- %-10s %.3f ms", phaseNames[j], averages[j]);
+        }
+    }
+
+    return BenchWrite();
+}
+
+void Usage(const char *app)
+{
+    printf("%s -- Longest Edge Bisection Demo\n", app);
+    printf("usage: %s [--bench] [options]\n", app);
+    printf("  --bench                  run a scripted benchmark and exit\n");
+    printf("  --frames N               number of benchmark frames (default %i)\n", g_bench.frameCount);
+    printf("  --backend cpu|gpu        subdivision backend\n");
+    printf("  --mode triangle|square   subdivision mode\n");
+    printf("  --traversal handle|morton  CPU leaf traversal order\n");
+    printf("  --depth N                CBT max depth (6..30)\n");
+    printf("  --targets N              number of moving targets (CPU backend)\n");
+    printf("  --gl                     also time uploads and draws with the CPU backend\n");
+    printf("  --output file            write results to file (.json for JSON, CSV otherwise)\n");
+}
+
+bool ParseArguments(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+
+        if (!strcmp(arg, "--bench")) {
+            g_bench.enabled = true;
+        } else if (!strcmp(arg, "--gl")) {
+            g_bench.useGL = true;
+        } else if (!strcmp(arg, "--frames") && atoi(value) > 0) {
+            g_bench.frameCount = atoi(value);
+            ++i;
+        } else if (!strcmp(arg, "--output") && value[0] != '\0') {
+            g_bench.output = value;
+            ++i;
+        } else if (!strcmp(arg, "--backend") && !strcmp(value, "cpu")) {
+            g_leb.params.backend = BACKEND_CPU;
+            ++i;
+        } else if (!strcmp(arg, "--backend") && !strcmp(value, "gpu")) {
+            g_leb.params.backend = BACKEND_GPU;
+            ++i;
+        } else if (!strcmp(arg, "--mode") && !strcmp(value, "triangle")) {
+            g_leb.params.mode = MODE_TRIANGLE;
+            ++i;
+        } else if (!strcmp(arg, "--mode") && !strcmp(value, "square")) {
+            g_leb.params.mode = MODE_SQUARE;
+            ++i;
+        } else if (!strcmp(arg, "--traversal") && !strcmp(value, "handle")) {
+            g_leb.params.traversal = TRAVERSAL_HANDLE;
+            ++i;
+        } else if (!strcmp(arg, "--traversal") && !strcmp(value, "morton")) {
+            g_leb.params.traversal = TRAVERSAL_MORTON;
+            ++i;
+        } else if (!strcmp(arg, "--targets") && atoi(value) > 0) {
+            g_leb.params.targetCount = atoi(value);
+            ++i;
+        } else if (!strcmp(arg, "--depth") && atoi(value) >= 6 && atoi(value) <= 30) {
+            cbt_Release(g_leb.cbt);
+            g_leb.cbt = cbt_CreateAtDepth(atoi(value), CBT_INIT_MAX_DEPTH);
+            ++i;
+        } else {
+            Usage(argv[0]);
+
+            return false;
+        }
+    }
+
+    // the GPU backend cannot run without a GL context
+    if (g_leb.params.backend == BACKEND_GPU)
+        g_bench.useGL = true;
+
+    return true;
+}
+
+
 int main(int argc, char **argv)
 {
+    if (!ParseArguments(argc, argv))
+        return -1;
+
+    // the CPU benchmark runs without any GL context
+    if (g_bench.enabled && !g_bench.useGL) {
+        bool success = RunBench();
+
+        cbt_Release(g_leb.cbt);
+        leb_ReleaseMortonTraversal(g_leb.morton);
+
+        return success ? 0 : -1;
+    }
+
     LOG("Loading {OpenGL Window}");
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, g_window.glversion.major);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, g_window.glversion.minor);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, g_bench.enabled ? GLFW_FALSE : GLFW_TRUE);
 #ifndef NDEBUG
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
@@ -891,6 +1685,18 @@ int main(int argc, char **argv)
 
         return -1;
     }
+
+    if (g_bench.enabled) {
+        bool success = RunBench();
+
+        Release();
+        cbt_Release(g_leb.cbt);
+        leb_ReleaseMortonTraversal(g_leb.morton);
+        glfwTerminate();
+
+        return success ? 0 : -1;
+    }
+
     InitGui();
 
     while (!glfwWindowShouldClose(g_window.handle)) {
@@ -901,8 +1707,10 @@ int main(int argc, char **argv)
         glfwSwapBuffers(g_window.handle);
     }
 
+    StopAsyncSubdivision();
     Release();
     cbt_Release(g_leb.cbt);
+    leb_ReleaseMortonTraversal(g_leb.morton);
     ReleaseGui();
     glfwTerminate();
 
@@ -0,0 +1,191 @@
+#ifndef TARGET_SET_HPP
+#define TARGET_SET_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+/*******************************************************************************
+ * TargetSet -- Batch of refinement targets with a uniform-grid index
+ *
+ * Each target is a point of the unit square together with the CBT depth
+ * that the leaves containing it should reach. The targets are bucketed
+ * into a uniform grid stored in compressed rows (one offset per cell into
+ * a single index array), and each cell remembers the deepest target it
+ * holds. A leaf then only tests the targets of the cells overlapped by its
+ * bounding box, and skips whole cells whose targets are too shallow to
+ * refine it any further. Targets outside the unit square are clamped to
+ * the border cells so that the exact point-in-triangle test still decides.
+ *
+ * Usage:
+ *      targets.clear();
+ *      targets.push(x, y, depth); ...
+ *      targets.build();            // bumps version() if anything moved
+ *      if (targets.refines(faceVertices, node.depth)) split(node);
+ *
+ */
+class TargetSet {
+public:
+    enum {MAX_CELL_COUNT = 64};
+    struct Target {
+        float x, y;
+        int depth;
+    };
+
+    TargetSet(): m_cellCount(0), m_version(0) {}
+
+    void clear() { m_targets.clear(); }
+    void push(float x, float y, int depth)
+    {
+        Target target = {x, y, depth};
+
+        m_targets.push_back(target);
+    }
+
+    int64_t size() const { return (int64_t)m_indexedTargets.size(); }
+    const Target &operator[](int64_t targetID) const
+    {
+        return m_indexedTargets[targetID];
+    }
+
+    // incremented each time build() indexes a different batch of targets
+    uint32_t version() const { return m_version; }
+
+    // indexes the pushed targets; a no-op if they match the indexed ones
+    void build()
+    {
+        const int targetCount = (int)m_targets.size();
+        int cellCount = 1;
+
+        if (isIndexed())
+            return;
+
+        // roughly two targets per cell
+        while (cellCount < MAX_CELL_COUNT && 2 * cellCount * cellCount < targetCount)
+            cellCount*= 2;
+
+        m_indexedTargets = m_targets;
+        m_cellCount = cellCount;
+        m_cellOffsets.assign(cellCount * cellCount + 1, 0);
+        m_cellMaxDepths.assign(cellCount * cellCount, 0);
+        m_cellTargets.resize(targetCount);
+
+        for (int i = 0; i < targetCount; ++i) {
+            const Target &target = m_targets[i];
+            const int cellID = cellIndex(cellCoordinate(target.x),
+                                         cellCoordinate(target.y));
+
+            ++m_cellOffsets[cellID + 1];
+            if (m_cellMaxDepths[cellID] < target.depth)
+                m_cellMaxDepths[cellID] = target.depth;
+        }
+
+        for (int i = 0; i < cellCount * cellCount; ++i)
+            m_cellOffsets[i + 1]+= m_cellOffsets[i];
+
+        {
+            std::vector<int32_t> cursors(m_cellOffsets.begin(), m_cellOffsets.end() - 1);
+
+            for (int i = 0; i < targetCount; ++i) {
+                const Target &target = m_targets[i];
+                const int cellID = cellIndex(cellCoordinate(target.x),
+                                             cellCoordinate(target.y));
+
+                m_cellTargets[cursors[cellID]++] = i;
+            }
+        }
+
+        ++m_version;
+    }
+
+    // returns true if a target deeper than depth lies inside the triangle
+    bool refines(const float faceVertices[][3], int depth) const
+    {
+        float xMin = faceVertices[0][0], xMax = faceVertices[0][0];
+        float yMin = faceVertices[1][0], yMax = faceVertices[1][0];
+
+        if (m_indexedTargets.empty())
+            return false;
+
+        for (int i = 1; i < 3; ++i) {
+            xMin = fminf(xMin, faceVertices[0][i]);
+            xMax = fmaxf(xMax, faceVertices[0][i]);
+            yMin = fminf(yMin, faceVertices[1][i]);
+            yMax = fmaxf(yMax, faceVertices[1][i]);
+        }
+
+        for (int y = cellCoordinate(yMin); y <= cellCoordinate(yMax); ++y)
+        for (int x = cellCoordinate(xMin); x <= cellCoordinate(xMax); ++x) {
+            const int cellID = cellIndex(x, y);
+
+            if (m_cellMaxDepths[cellID] <= depth)
+                continue;
+
+            for (int i = m_cellOffsets[cellID]; i < m_cellOffsets[cellID + 1]; ++i) {
+                const Target &target = m_indexedTargets[m_cellTargets[i]];
+
+                if (target.depth > depth
+                    && isInside(faceVertices, target.x, target.y)) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+private:
+    bool isIndexed() const
+    {
+        if (m_cellCount == 0 || m_targets.size() != m_indexedTargets.size())
+            return false;
+
+        for (size_t i = 0; i < m_targets.size(); ++i) {
+            const Target &a = m_targets[i], &b = m_indexedTargets[i];
+
+            if (a.x != b.x || a.y != b.y || a.depth != b.depth)
+                return false;
+        }
+
+        return true;
+    }
+
+    int cellCoordinate(float x) const
+    {
+        const float cell = floorf(x * (float)m_cellCount);
+
+        if (!(cell >= 0.0f)) return 0; // also catches NaNs
+        if (cell >= (float)m_cellCount) return m_cellCount - 1;
+
+        return (int)cell;
+    }
+
+    int cellIndex(int x, int y) const { return x + m_cellCount * y; }
+
+    static float wedge(float ax, float ay, float bx, float by)
+    {
+        return ax * by - ay * bx;
+    }
+
+    // same convention as the GPU subdivision kernels (counter-clockwise)
+    static bool isInside(const float faceVertices[][3], float x, float y)
+    {
+        const float *vx = faceVertices[0], *vy = faceVertices[1];
+        const float w1 = wedge(vx[1] - vx[0], vy[1] - vy[0], x - vx[0], y - vy[0]);
+        const float w2 = wedge(vx[2] - vx[1], vy[2] - vy[1], x - vx[1], y - vy[1]);
+        const float w3 = wedge(vx[0] - vx[2], vy[0] - vy[2], x - vx[2], y - vy[2]);
+
+        return (w1 >= 0.0f) && (w2 >= 0.0f) && (w3 >= 0.0f);
+    }
+
+    std::vector<Target> m_targets;
+    std::vector<Target> m_indexedTargets;
+    std::vector<int32_t> m_cellOffsets;   // cellCount^2 + 1 entries
+    std::vector<int32_t> m_cellTargets;   // target IDs, sorted by cell
+    std::vector<int32_t> m_cellMaxDepths;
+    int m_cellCount;
+    uint32_t m_version;
+};
+
+#endif // TARGET_SET_HPP
@@ -1,6 +1,8 @@
 #include "OpenSimplexNoise.h"
+#include "simplex.h"
 
 #include <cmath>
+#include <cstring>
 namespace OpenSimplexNoise
 {
   using namespace std;
@@ -47,6 +49,7 @@ namespace OpenSimplexNoise
                      3, -1, -1, -1,      1, -3, -1, -1,      1, -1, -3, -1,      1, -1, -1, -3,
                     -3, -1, -1, -1,     -1, -3, -1, -1,     -1, -1, -3, -1,     -1, -1, -1, -3, }
   {
+    initBatchTables();
   }
 
   Noise::Noise(int64_t seed)
@@ -72,6 +75,7 @@ namespace OpenSimplexNoise
       m_permGradIndex3d[i] = static_cast<short>((m_perm[i] % (m_gradients3d.size() / 3)) * 3);
       source[r] = source[i];
     }
+    initBatchTables();
   }
 
   double Noise::eval(double x,  double y) const
@@ -2539,4 +2543,354 @@ namespace OpenSimplexNoise
       + m_gradients4d[index + 3] * dw;
   }
 
-}
\ No newline at end of file
+  namespace
+  {
+    typedef Simplex::details::SimdBatch Simd;
+
+    //Lattice vertices, relative to the super-cell origin, that can be within
+    //the radius of the kernel of a point whose coordinates relative to that
+    //origin are sorted in decreasing order. For any other point, the offsets
+    //are permuted the same way as its coordinates. Every point is in the
+    //range of at most 4, 8 and 12 of these; the others get a zero attenuation.
+    const int VERTEX_COUNT_2D = 6;
+    const int VERTEX_COUNT_3D = 16;
+    const int VERTEX_COUNT_4D = 38;
+    const signed char s_vertices2d[VERTEX_COUNT_2D][2] = {
+      {0, 0}, {0, 1}, {1, -1}, {1, 0}, {1, 1}, {2, 0},
+    };
+    const signed char s_vertices3d[VERTEX_COUNT_3D][3] = {
+      {0, 0, 0}, {0, 0, 1}, {0, 1, -1}, {0, 1, 0}, {0, 1, 1}, {1, -1, 0}, {1, 0, -1}, {1, 0, 0},
+      {1, 0, 1}, {1, 1, -1}, {1, 1, 0}, {1, 1, 1}, {1, 2, 0}, {2, 0, 0}, {2, 0, 1}, {2, 1, 0},
+    };
+    const signed char s_vertices4d[VERTEX_COUNT_4D][4] = {
+      {0, 0, 0, 0}, {0, 0, 0, 1}, {0, 0, 1, -1}, {0, 0, 1, 0}, {0, 0, 1, 1}, {0, 1, -1, 0},
+      {0, 1, 0, -1}, {0, 1, 0, 0}, {0, 1, 0, 1}, {0, 1, 1, -1}, {0, 1, 1, 0}, {0, 1, 1, 1},
+      {1, -1, 0, 0}, {1, 0, -1, 0}, {1, 0, 0, -1}, {1, 0, 0, 0}, {1, 0, 0, 1}, {1, 0, 1, -1},
+      {1, 0, 1, 0}, {1, 0, 1, 1}, {1, 1, -1, 0}, {1, 1, 0, -1}, {1, 1, 0, 0}, {1, 1, 0, 1},
+      {1, 1, 1, -1}, {1, 1, 1, 0}, {1, 1, 1, 1}, {1, 1, 2, 0}, {1, 2, 0, 0}, {1, 2, 0, 1},
+      {1, 2, 1, 0}, {2, 0, 0, 0}, {2, 0, 0, 1}, {2, 0, 1, 0}, {2, 0, 1, 1}, {2, 1, 0, 0},
+      {2, 1, 0, 1}, {2, 1, 1, 0},
+    };
+
+    //Gradient dot offset for the last hash of extrapolate, from the bits of
+    //the hash instead of the gradient arrays (divided by the norm later).
+    //m_gradients2d[h & 0x0E]: (5, 2), swapped by bit 1, signs in bits 2 and 3.
+    template<typename S>
+    typename S::F extrapolateBatch(typename S::I hash, const typename S::F (&d)[2])
+    {
+      using Simplex::details::hasBits;
+      const typename S::M swap = hasBits<S>(hash, 2, 2);
+      typename S::F gx = S::select(swap, S::set1(2.0f), S::set1(5.0f));
+      typename S::F gy = S::select(swap, S::set1(5.0f), S::set1(2.0f));
+      gx = S::select(hasBits<S>(hash, 4, 4), S::neg(gx), gx);
+      gy = S::select(hasBits<S>(hash, 8, 8), S::neg(gy), gy);
+      return S::add(S::mul(gx, d[0]), S::mul(gy, d[1]));
+    }
+
+    //The hash is the code of the gradient (see m_permGradCode3d): the axis
+    //of the 11 in bits 3 and 4, and the octant in bits 0 to 2 (x is negative
+    //when bit 0 is clear, y and z when bits 1 and 2 are set).
+    template<typename S>
+    typename S::F extrapolateBatch(typename S::I hash, const typename S::F (&d)[3])
+    {
+      using Simplex::details::hasBits;
+      typename S::F value = S::set1(0.0f);
+      for (int i = 0; i < 3; i++)
+      {
+        typename S::F g = S::select(hasBits<S>(hash, 0x18, i << 3), S::set1(11.0f), S::set1(4.0f));
+        g = S::select(hasBits<S>(hash, 1 << i, i == 0 ? 0 : 1 << i), S::neg(g), g);
+        value = S::add(value, S::mul(g, d[i]));
+      }
+      return value;
+    }
+
+    //m_gradients4d[h & 0xFC]: the 3 on the axis of bits 2 and 3, the signs
+    //of the axes in bits 4 to 7.
+    template<typename S>
+    typename S::F extrapolateBatch(typename S::I hash, const typename S::F (&d)[4])
+    {
+      using Simplex::details::hasBits;
+      typename S::F value = S::set1(0.0f);
+      for (int i = 0; i < 4; i++)
+      {
+        typename S::F g = S::select(hasBits<S>(hash, 0x0C, i << 2), S::set1(3.0f), S::set1(1.0f));
+        g = S::select(hasBits<S>(hash, 0x10 << i, 0x10 << i), S::neg(g), g);
+        value = S::add(value, S::mul(g, d[i]));
+      }
+      return value;
+    }
+
+    //Noise of a batch of D-dimensional points. Instead of branching on the
+    //region of each point, the rank of its coordinates in the super-cell
+    //permutes a fixed list of candidate vertices, and each candidate is
+    //evaluated with masks and gathers for the hash, unless no point of the
+    //batch is in its range. permLast, if not NULL, replaces the permutation
+    //in the last lookup of the hash, like m_permGradIndex3d.
+    template<typename S, int D>
+    typename S::F evalBatch(const uint8_t* perm, const uint8_t* permLast,
+                            const signed char (*vertices)[D], int vertexCount,
+                            float stretch, float squish, float norm, const typename S::F p[D])
+    {
+      typedef typename S::F F;
+      typedef typename S::I I;
+      typedef typename S::M M;
+
+      //Place input coordinates on the grid and find the super-cell origin.
+      F stretchOffset = p[0];
+      for (int i = 1; i < D; i++)
+      {
+        stretchOffset = S::add(stretchOffset, p[i]);
+      }
+      stretchOffset = S::mul(stretchOffset, S::set1(stretch));
+
+      I sb[D];
+      F ins[D];
+      for (int i = 0; i < D; i++)
+      {
+        const F s = S::add(p[i], stretchOffset);
+        sb[i] = Simplex::details::fastFloorBatch<S>(s);
+        ins[i] = S::sub(s, S::toFloat(sb[i]));
+      }
+
+      //Rank of each coordinate relative to the origin, in decreasing order.
+      I rank[D];
+      for (int i = 0; i < D; i++)
+      {
+        rank[i] = S::set1i(0);
+      }
+      for (int i = 0; i < D; i++)
+      {
+        for (int j = i + 1; j < D; j++)
+        {
+          const M before = S::greaterEqual(ins[i], ins[j]);
+          rank[j] = S::addi(rank[j], S::maskToInt(before));
+          rank[i] = S::addi(rank[i], S::maskToInt(S::notm(before)));
+        }
+      }
+      M hasRank[D][D];
+      for (int i = 0; i < D; i++)
+      {
+        for (int r = 0; r < D; r++)
+        {
+          hasRank[i][r] = S::equal(rank[i], S::set1i(r));
+        }
+      }
+
+      F value = S::set1(0.0f);
+      for (int v = 0; v < vertexCount; v++)
+      {
+        const signed char* vertex = vertices[v];
+        F d[D];
+        I lattice[D];
+        F sum = S::set1(0.0f);
+
+        //Offset of the vertex along axis i: the one of the rank of i.
+        for (int i = 0; i < D; i++)
+        {
+          F offset = S::set1(vertex[0]);
+          for (int r = 1; r < D; r++)
+          {
+            if (vertex[r] != vertex[0])
+            {
+              offset = S::select(hasRank[i][r], S::set1(vertex[r]), offset);
+            }
+          }
+          d[i] = S::sub(ins[i], offset);
+          sum = S::add(sum, d[i]);
+          lattice[i] = S::andi(S::addi(sb[i], S::toInt(offset)), S::set1i(0xFF));
+        }
+
+        //Squish the offset to the point back and attenuate.
+        F attn = S::set1(2.0f);
+        sum = S::mul(sum, S::set1(squish));
+        for (int i = 0; i < D; i++)
+        {
+          d[i] = S::add(d[i], sum);
+          attn = S::sub(attn, S::mul(d[i], d[i]));
+        }
+
+        //Most candidates are out of range of the whole batch when the
+        //points are close together, as along a row of a heightmap.
+        if (!S::anym(S::greater(attn, S::set1(0.0f))))
+        {
+          continue;
+        }
+
+        //Same hash as extrapolate, with the permutation stored twice.
+        I hash = S::gather(perm, lattice[0]);
+        for (int i = 1; i < D; i++)
+        {
+          const uint8_t* table = i == D - 1 && permLast ? permLast : perm;
+          hash = S::gather(table, S::addi(hash, lattice[i]));
+        }
+
+        value = S::add(value, Simplex::details::cornerBatch<S>(attn, extrapolateBatch<S>(hash, d)));
+      }
+
+      return S::mul(value, S::set1(1.0f / norm));
+    }
+
+    //Sums the octaves of a batch of D-dimensional positions given as
+    //separate coordinate arrays; the last incomplete batch is zero-padded.
+    template<typename S, int D>
+    void fBmBatch(const uint8_t* perm, const uint8_t* permLast,
+                  const signed char (*vertices)[D], int vertexCount,
+                  float stretch, float squish, float norm, const float* const coords[D], float* out,
+                  size_t count, int octaves, float lacunarity, float gain, float amplitude)
+    {
+      typedef typename S::F F;
+
+      for (size_t i = 0; i < count; i += S::WIDTH)
+      {
+        const size_t n = count - i < (size_t)S::WIDTH ? count - i : (size_t)S::WIDTH;
+        float padded[D][S::WIDTH];
+        float result[S::WIDTH];
+        F p[D];
+
+        for (int d = 0; d < D; d++)
+        {
+          if (n == (size_t)S::WIDTH)
+          {
+            p[d] = S::load(coords[d] + i);
+          }
+          else
+          {
+            memset(padded[d], 0, sizeof(padded[d]));
+            memcpy(padded[d], coords[d] + i, n * sizeof(float));
+            p[d] = S::load(padded[d]);
+          }
+        }
+
+        F sum = S::set1(0.0f);
+        float freq = 1.0f;
+        float amp = amplitude;
+        for (int o = 0; o < octaves; o++)
+        {
+          F q[D];
+          for (int d = 0; d < D; d++)
+          {
+            q[d] = S::mul(p[d], S::set1(freq));
+          }
+          const F noise = evalBatch<S, D>(perm, permLast, vertices, vertexCount, stretch, squish, norm, q);
+          sum = S::add(sum, S::mul(noise, S::set1(amp)));
+          freq *= lacunarity;
+          amp *= gain;
+        }
+
+        if (n == (size_t)S::WIDTH)
+        {
+          S::store(out + i, sum);
+        }
+        else
+        {
+          S::store(result, sum);
+          memcpy(out + i, result, n * sizeof(float));
+        }
+      }
+    }
+  }
+
+  void Noise::initBatchTables()
+  {
+    for (int i = 0; i < 256; i++)
+    {
+      m_permBatch[i] = m_permBatch[i + 256] = static_cast<uint8_t>(m_perm[i]);
+    }
+    for (int i = 512; i < 512 + 4; i++)
+    {
+      m_permBatch[i] = 0;
+    }
+
+    //Same as m_permGradIndex3d, as the code read by extrapolateBatch: the
+    //gradients come in groups of 3 with the same octant.
+    for (int i = 0; i < 512; i++)
+    {
+      const int index = m_perm[i & 0xFF] % (m_gradients3d.size() / 3);
+      m_permGradCode3d[i] = static_cast<uint8_t>(index / 3 | (index % 3) << 3);
+    }
+    for (int i = 512; i < 512 + 4; i++)
+    {
+      m_permGradCode3d[i] = 0;
+    }
+  }
+
+  void Noise::eval2(const float* xs, const float* ys, float* out, size_t n) const
+  {
+    fBm2(xs, ys, out, n, 1, 1.0f, 1.0f, 1.0f);
+  }
+
+  void Noise::eval3(const float* xs, const float* ys, const float* zs, float* out, size_t n) const
+  {
+    fBm3(xs, ys, zs, out, n, 1, 1.0f, 1.0f, 1.0f);
+  }
+
+  void Noise::eval4(const float* xs, const float* ys, const float* zs, const float* ws, float* out, size_t n) const
+  {
+    //The 38 candidate vertices only pay off with 16 lanes; with 8, the
+    //gathers cost more than the branches of eval.
+    if (Simd::WIDTH < 16)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        out[i] = static_cast<float>(eval(xs[i], ys[i], zs[i], ws[i]));
+      }
+      return;
+    }
+
+    const float* coords[4] = { xs, ys, zs, ws };
+    fBmBatch<Simd, 4>(m_permBatch.data(), NULL, s_vertices4d, VERTEX_COUNT_4D,
+                      static_cast<float>(m_stretch4d), static_cast<float>(m_squish4d),
+                      static_cast<float>(m_norm4d), coords, out, n, 1, 1.0f, 1.0f, 1.0f);
+  }
+
+  void Noise::fBm2(const float* xs, const float* ys, float* out, size_t n,
+                   int octaves, float lacunarity, float gain, float amplitude) const
+  {
+    //Without SIMD, the candidate vertices cost more than the branches.
+    if (Simd::WIDTH == 1)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        double sum = 0, freq = 1, amp = amplitude;
+        for (int o = 0; o < octaves; o++)
+        {
+          sum += amp * eval(xs[i] * freq, ys[i] * freq);
+          freq *= lacunarity;
+          amp *= gain;
+        }
+        out[i] = static_cast<float>(sum);
+      }
+      return;
+    }
+
+    const float* coords[2] = { xs, ys };
+    fBmBatch<Simd, 2>(m_permBatch.data(), NULL, s_vertices2d, VERTEX_COUNT_2D,
+                      static_cast<float>(m_stretch2d), static_cast<float>(m_squish2d),
+                      static_cast<float>(m_norm2d), coords, out, n, octaves, lacunarity, gain, amplitude);
+  }
+
+  void Noise::fBm3(const float* xs, const float* ys, const float* zs, float* out, size_t n,
+                   int octaves, float lacunarity, float gain, float amplitude) const
+  {
+    if (Simd::WIDTH == 1)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        double sum = 0, freq = 1, amp = amplitude;
+        for (int o = 0; o < octaves; o++)
+        {
+          sum += amp * eval(xs[i] * freq, ys[i] * freq, zs[i] * freq);
+          freq *= lacunarity;
+          amp *= gain;
+        }
+        out[i] = static_cast<float>(sum);
+      }
+      return;
+    }
+
+    const float* coords[3] = { xs, ys, zs };
+    fBmBatch<Simd, 3>(m_permBatch.data(), m_permGradCode3d.data(), s_vertices3d, VERTEX_COUNT_3D,
+                      static_cast<float>(m_stretch3d), static_cast<float>(m_squish3d),
+                      static_cast<float>(m_norm3d), coords, out, n, octaves, lacunarity, gain, amplitude);
+  }
+}
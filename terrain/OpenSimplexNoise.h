@@ -6,6 +6,7 @@
 */
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include <array>
@@ -22,6 +23,20 @@ namespace OpenSimplexNoise
     double eval(double x, double y, double z) const;
     //4D Open Simplex Noise.
     double eval(double x, double y, double z, double w) const;
+
+    //Batch versions of eval, in float and SIMD: out[i] is eval(xs[i], ys[i], ...)
+    //up to float rounding.
+    void eval2(const float* xs, const float* ys, float* out, size_t n) const;
+    void eval3(const float* xs, const float* ys, const float* zs, float* out, size_t n) const;
+    void eval4(const float* xs, const float* ys, const float* zs, const float* ws, float* out, size_t n) const;
+
+    //Fractal sums of the batch noise: out[i] is the sum over the octaves of
+    //a * eval(f * p[i]), f starting at 1 and a at amplitude (0.5, as in
+    //Simplex::fBm), scaled by lacunarity and gain at each octave.
+    void fBm2(const float* xs, const float* ys, float* out, size_t n,
+              int octaves = 4, float lacunarity = 2.0f, float gain = 0.5f, float amplitude = 0.5f) const;
+    void fBm3(const float* xs, const float* ys, const float* zs, float* out, size_t n,
+              int octaves = 4, float lacunarity = 2.0f, float gain = 0.5f, float amplitude = 0.5f) const;
   private:
     const double m_stretch2d;
     const double m_squish2d;
@@ -41,6 +56,14 @@ namespace OpenSimplexNoise
     std::array<char, 16> m_gradients2d;
     std::array<char, 72> m_gradients3d;
     std::array<char, 256> m_gradients4d;
+
+    //Tables of the batch functions, m_perm and m_permGradIndex3d (as a
+    //gradient code) repeated twice, plus the padding read by the 32-bit
+    //gathers.
+    std::array<uint8_t, 512 + 4> m_permBatch;
+    std::array<uint8_t, 512 + 4> m_permGradCode3d;
+
+    void initBatchTables();
     double extrapolate(int xsb, int ysb, double dx, double dy) const;
     double extrapolate(int xsb, int ysb, int zsb, double dx, double dy, double dz) const;
     double extrapolate(int xsb, int ysb, int zsb, int wsb, double dx, double dy, double dz, double dw) const;
@@ -3,81 +3,105 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <time.h>
+#include <sys/mman.h>
 #include "simplex.h"
+#include "heightmap_generator.hpp"
 #include <glm/glm.hpp>
 
+// The texels live in a single anonymous mapping: the OS only commits the
+// pages that are written, so a 50000 x 50000 grid costs its row pointers
+// until it is filled. Rows start on GRID_ALIGNMENT byte boundaries, and
+// mat[i] is a view of row i in the mapping.
+#define GRID_ALIGNMENT 64
+
 typedef struct {
     int width;
     int height;
-    unsigned char ** mat;
+    unsigned char ** mat;   // row views
+    unsigned char * data;   // stride * height texels
+    size_t stride;          // bytes between two rows
 } grid_t;
 
-grid_t * create_grid(int width, int height) {
+inline grid_t * create_grid(int width, int height) {
     grid_t * grid = new grid_t;
     grid->width = width;
     grid->height = height;
+    grid->stride = ((size_t)width + GRID_ALIGNMENT - 1) & ~(size_t)(GRID_ALIGNMENT - 1);
+    grid->data = NULL;
+
+    void * data = mmap(NULL, grid->stride * height, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) {
+        delete grid;
+        return NULL;
+    }
+    grid->data = (unsigned char *)data;
+
     grid->mat = new unsigned char*[height];
     int i = 0;
     for(; i < height; i++){
-        grid->mat[i] = new unsigned char[width];
+        grid->mat[i] = grid->data + grid->stride * i;
     }
     return grid;
 }
 
-grid_t * clone_grid(grid_t * grid) {
+// Rows are copied in parallel on the generator, a tile of rows per task
+inline grid_t * clone_grid(grid_t * grid, HeightmapGenerator& generator) {
     grid_t * clone = create_grid(grid->width, grid->height);
-    int i = 0;
-    for(; i < clone->height; i++){
-        int j = 0;
-        for(; j < clone->width; j++){
-            clone->mat[i][j] = grid->mat[i][j];
-        }
-    }
+    if (!clone)
+        return NULL;
+
+    generator.generate(1, clone->height, [grid, clone](int, int y0, int, int y1) {
+        memcpy(clone->mat[y0], grid->mat[y0], clone->stride * (y1 - y0));
+    });
     return clone;
 }
 
-bool init_rand(grid_t * grid) {
+// Texels are generated in parallel on the generator, one tile per task
+inline bool init_rand(grid_t * grid, HeightmapGenerator& generator) {
     bool v = false;
-    int i = 0;
-    for(; i < grid->height; i++) {
-        int j = 0;
-        for(; j < grid->width; j++) {
-            //grid->mat[i][j] = rand_2();
-            int octaves = 8;
-            float gain = 0.08f;
-            float lacunarity = 0.08f;
-            glm::vec2 pos = glm::vec2(i,j);
+    generator.generate(grid->width, grid->height, [grid](int x0, int y0, int x1, int y1) {
+        int i = y0;
+        for(; i < y1; i++) {
+            int j = x0;
+            for(; j < x1; j++) {
+                //grid->mat[i][j] = rand_2();
+                int octaves = 8;
+                float gain = 0.08f;
+                float lacunarity = 0.08f;
+                glm::vec2 pos = glm::vec2(i,j);
 
-            //float n = Simplex::iqMatfBm(pos, octaves, glm::mat2(2.3f, -1.5f, 1.5f, 2.3f), gain);
-            float n = Simplex::iqfBm(pos, octaves, lacunarity, gain)*0.5f;
+                //float n = Simplex::iqMatfBm(pos, octaves, glm::mat2(2.3f, -1.5f, 1.5f, 2.3f), gain);
+                float n = Simplex::iqfBm(pos, octaves, lacunarity, gain)*0.5f;
 
-            //octaves += 3;
-            //gain += 0.5f;
-            //lacunarity += 0.03f;
-            //float m = Simplex::iqfBm(pos, octaves, lacunarity, gain);
-            //printf("N: %f, ", n);
-            //n += Simplex::ridgedMF(pos, 1.0f, octaves, 2.0f, gain+0.1f);
-            //printf("N: %f, ", n);
-            //n += Simplex::worleyfBm(pos, octaves, 2.0f, gain + 0.2f);
-            //printf("N: %f \n", n);
-            //glm::normalize(n);
-            //grid->mat[i][j] = ((n*1.25+m*0.75)/2)*255;
-            grid->mat[i][j] = n*255;
+                //octaves += 3;
+                //gain += 0.5f;
+                //lacunarity += 0.03f;
+                //float m = Simplex::iqfBm(pos, octaves, lacunarity, gain);
+                //printf("N: %f, ", n);
+                //n += Simplex::ridgedMF(pos, 1.0f, octaves, 2.0f, gain+0.1f);
+                //printf("N: %f, ", n);
+                //n += Simplex::worleyfBm(pos, octaves, 2.0f, gain + 0.2f);
+                //printf("N: %f \n", n);
+                //glm::normalize(n);
+                //grid->mat[i][j] = ((n*1.25+m*0.75)/2)*255;
+                grid->mat[i][j] = n*255;
+            }
         }
-    }
+    });
     v = true;
     return v;
 }
 
 
-void free_grid(grid_t * grid) {
-    int i = 0;
-    for(; i < grid->height; i++) {
-        free(grid->mat[i]);
-    }
-    free(grid->mat);
+// Releases the mapping, the row views and the grid itself
+inline void free_grid(grid_t * grid) {
+    munmap(grid->data, grid->stride * grid->height);
+    delete[] grid->mat;
+    delete grid;
 }
 
 #endif // GRID_H
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "height_clipmap.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+// storage coordinate of a texel coordinate, for negative ones too
+static int wrap(int x) {
+    return x & (HeightClipmap::SIZE - 1);
+}
+
+HeightClipmap::HeightClipmap(ThreadPool &pool):
+    m_generation(0),
+    m_pool(pool)
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "the window size must be a power of 2");
+
+    for (int i = 0; i < LEVEL_COUNT; ++i) {
+        m_levels[i].x = m_levels[i].y = 0;
+        m_levels[i].nextX = m_levels[i].nextY = 0;
+        m_levels[i].isValid = m_levels[i].isPending = false;
+        m_levels[i].heights.assign((size_t)SIZE * SIZE, 0.0f);
+    }
+}
+
+// the pool outlives the clipmap: the passes in flight write its levels
+HeightClipmap::~HeightClipmap() {
+    reset(RowKernel());
+}
+
+void HeightClipmap::reset(const RowKernel &kernel) {
+    // the rows of the passes in flight are skipped, so they end quickly
+    ++m_generation;
+    for (int i = 0; i < LEVEL_COUNT; ++i) {
+        m_pool.wait(m_levels[i].group);
+        m_levels[i].isValid = m_levels[i].isPending = false;
+        m_levels[i].regions.clear();
+    }
+
+    m_kernel = kernel;
+    m_uploads.clear();
+}
+
+// queues the texels [x0, x1) x [y0, y1) of level, which span at most SIZE
+// texels per axis and so wrap around the buffer at most once per axis
+void HeightClipmap::generate(int level, int x0, int y0, int x1, int y1,
+                             std::vector<ThreadPool::Task> &tasks) {
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    const int sx0 = wrap(x0), sy0 = wrap(y0);
+    const int columns[2] = {std::min(x1 - x0, SIZE - sx0), x1 - x0 - std::min(x1 - x0, SIZE - sx0)};
+    const int rows[2] = {std::min(y1 - y0, SIZE - sy0), y1 - y0 - std::min(y1 - y0, SIZE - sy0)};
+    const RowKernel kernel = m_kernel;
+    const std::atomic<int> *current = &m_generation;
+    const int generation = m_generation.load();
+    float *heights = m_levels[level].heights.data();
+
+    for (int j = 0; j < 2; ++j)
+    for (int i = 0; i < 2; ++i) {
+        if (columns[i] == 0 || rows[j] == 0)
+            continue;
+
+        const Region region = {level, i ? 0 : sx0, j ? 0 : sy0, columns[i], rows[j]};
+        const int x = i ? x0 + columns[0] : x0;
+        const int y = j ? y0 + rows[0] : y0;
+
+        m_levels[level].regions.push_back(region);
+        for (int band = 0; band < region.height; band+= ROWS_PER_TASK) {
+            const int count = std::min((int)ROWS_PER_TASK, region.height - band);
+
+            tasks.push_back([kernel, current, generation, heights, region, x, y, band, count] {
+                for (int k = band; k < band + count && current->load() == generation; ++k)
+                    kernel(region.level, x, y + k, region.width,
+                           &heights[region.x + (size_t)SIZE * (region.y + k)]);
+            });
+        }
+    }
+}
+
+bool HeightClipmap::update(double x, double y) {
+    m_uploads.clear();
+    if (!m_kernel)
+        return false;
+
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        const double scale = 1.0 / (double)(1 << level);
+        const int nx = (int)floor(x * scale) - SIZE / 2;
+        const int ny = (int)floor(y * scale) - SIZE / 2;
+        Level &window = m_levels[level];
+        std::vector<ThreadPool::Task> tasks;
+
+        if (window.isPending) {
+            if (!window.group.isDone())
+                continue;
+
+            // the owner uploads the strips before the next pass starts
+            m_uploads.insert(m_uploads.end(), window.regions.begin(), window.regions.end());
+            window.regions.clear();
+            window.x = window.nextX;
+            window.y = window.nextY;
+            window.isValid = true;
+            window.isPending = false;
+            continue;
+        }
+
+        if (window.isValid && nx == window.x && ny == window.y)
+            continue;
+
+        if (!window.isValid || abs(nx - window.x) >= SIZE || abs(ny - window.y) >= SIZE) {
+            generate(level, nx, ny, nx + SIZE, ny + SIZE, tasks);
+        } else {
+            // rows entering the window, over its whole width
+            if (ny > window.y)
+                generate(level, nx, window.y + SIZE, nx + SIZE, ny + SIZE, tasks);
+            else
+                generate(level, nx, ny, nx + SIZE, window.y, tasks);
+
+            // columns entering the window, over the rows it kept
+            const int y0 = std::max(ny, window.y);
+            const int y1 = std::min(ny, window.y) + SIZE;
+
+            if (nx > window.x)
+                generate(level, window.x + SIZE, y0, nx + SIZE, y1, tasks);
+            else
+                generate(level, nx, y0, window.x, y1, tasks);
+        }
+
+        window.nextX = nx;
+        window.nextY = ny;
+        window.isPending = true;
+        m_pool.submit(tasks, window.group);
+    }
+
+    return !m_uploads.empty();
+}
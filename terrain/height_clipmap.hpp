@@ -0,0 +1,99 @@
+#ifndef HEIGHT_CLIPMAP_HPP
+#define HEIGHT_CLIPMAP_HPP
+
+#include "heightmap_generator.hpp"
+
+/*******************************************************************************
+ * HeightClipmap -- Nested camera-centred heightmap levels updated toroidally
+ *
+ * Each of the LEVEL_COUNT levels is a SIZE x SIZE window of heights centred
+ * on the camera. The texels of level L are 2^L texels of level 0 apart, so
+ * each level covers twice the extent of the previous one for the same
+ * memory, and the resolution falls off with the distance to the camera.
+ *
+ * Texel (x, y) of a level is stored at (x mod SIZE, y mod SIZE) of its
+ * buffer. When the camera moves, a window keeps the texels it still covers
+ * where they are and only the strips it newly exposes are generated, by a
+ * kernel run row by row on the shared thread pool; a texture array sampled
+ * with a repeating wrap mode reads the same layout without any remapping.
+ *
+ * The strips are generated in the background, one pass per level at a
+ * time, so update() never waits for the workers. A level keeps its window
+ * until its pass is done; update() then publishes the new window with the
+ * strips of the pass, and starts the next pass of that level on the
+ * following call, so the workers never write texels that are still to be
+ * uploaded. The fine levels, which have the fewest texels to generate,
+ * follow the camera first, and the shader falls back on a coarser level
+ * outside a window in the meantime.
+ *
+ * The owner calls update() once per frame and uploads the regions returned
+ * by uploads(), rectangles of the level buffers in storage coordinates,
+ * along with the windows.
+ *
+ * Usage:
+ *      clipmap.reset(kernel);                  // and whenever the heights change
+ *      each frame:
+ *          clipmap.update(cameraX, cameraY);
+ *          for (const Region &r : clipmap.uploads()) upload(r, clipmap.heights(r.level));
+ *
+ */
+class HeightClipmap {
+public:
+    enum {
+        SIZE = 256,
+        LEVEL_COUNT = 6,
+        ROWS_PER_TASK = 16
+    };
+    // a rectangle of a level buffer, in storage texels
+    struct Region {
+        int level;
+        int x, y, width, height;
+    };
+    // fills the heights of the texels [x0, x0 + count) of row y of level
+    typedef std::function<void(int level, int x0, int y, int count, float *heights)> RowKernel;
+
+    explicit HeightClipmap(ThreadPool &pool);
+    ~HeightClipmap();
+
+    // invalidates every level and drops the passes in flight: the next
+    // update() starts regenerating them all
+    void reset(const RowKernel &kernel);
+    // publishes the levels whose pass is done and starts a pass that centres
+    // the others on (x, y), in texels of level 0; returns true when any
+    // texel changed
+    bool update(double x, double y);
+
+    // regions published by the last update; their texels are left
+    // untouched until the next one
+    const std::vector<Region> &uploads() const { return m_uploads; }
+    // SIZE x SIZE heights of level, row major, in storage order
+    const float *heights(int level) const { return m_levels[level].heights.data(); }
+    // first texel of the published window of level, in texels of that level
+    int windowX(int level) const { return m_levels[level].x; }
+    int windowY(int level) const { return m_levels[level].y; }
+    // false until the first pass of level after a reset is published
+    bool isValid(int level) const { return m_levels[level].isValid; }
+
+private:
+    struct Level {
+        int x, y;               // published window
+        bool isValid;
+        std::vector<float> heights;
+        // pass in flight
+        int nextX, nextY;
+        bool isPending;
+        std::vector<Region> regions;
+        ThreadPool::Group group;
+    };
+
+    void generate(int level, int x0, int y0, int x1, int y1,
+                  std::vector<ThreadPool::Task> &tasks);
+
+    RowKernel m_kernel;
+    Level m_levels[LEVEL_COUNT];
+    std::vector<Region> m_uploads;
+    std::atomic<int> m_generation;
+    ThreadPool &m_pool;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "height_pyramid.hpp"
+#include <algorithm>
+#include <math.h>
+
+void HeightPyramid::resize(int width, int height) {
+    m_levels.resize(1);
+    m_levels[0].width = width;
+    m_levels[0].height = height;
+    m_levels[0].mean.resize((size_t)width * height);
+}
+
+void HeightPyramid::build(HeightmapGenerator &generator) {
+    m_levels.resize(1);
+
+    while (m_levels.back().width > 1 || m_levels.back().height > 1) {
+        Level next;
+
+        next.width = std::max(m_levels.back().width >> 1, 1);
+        next.height = std::max(m_levels.back().height >> 1, 1);
+
+        const size_t texelCount = (size_t)next.width * next.height;
+
+        next.mean.resize(texelCount);
+        next.meanSq.resize(texelCount);
+        next.min.resize(texelCount);
+        next.max.resize(texelCount);
+        m_levels.push_back(std::move(next));
+
+        const int level = (int)m_levels.size() - 1;
+
+        generator.generate(m_levels[level].width, m_levels[level].height,
+                           [this, level](int x0, int y0, int x1, int y1) {
+                               buildLevel(level, x0, y0, x1, y1);
+                           });
+    }
+}
+
+// footprint [first, last) in the finer level of texel i of the coarser one
+static void footprint(int i, int size, int fineSize, int *first, int *last) {
+    *first = std::min(2 * i, fineSize - 1);
+    *last = (i == size - 1) ? fineSize : 2 * i + 2;
+}
+
+void HeightPyramid::buildLevel(int level, int x0, int y0, int x1, int y1) {
+    const Level &fine = m_levels[level - 1];
+    Level &coarse = m_levels[level];
+    const bool isBase = (level == 1);
+    const int n = x1 - x0;
+    // texels with a 2 texel wide footprint take the vectorized path
+    const int xFast = std::min(x1, (fine.width & 1) ? coarse.width - 1 : coarse.width);
+    std::vector<float> sum(n), sumSq(n), minimum(n), maximum(n);
+
+    for (int j = y0; j < y1; ++j) {
+        int r0, r1;
+
+        footprint(j, coarse.height, fine.height, &r0, &r1);
+        std::fill(sum.begin(), sum.end(), 0.0f);
+        std::fill(sumSq.begin(), sumSq.end(), 0.0f);
+        std::fill(minimum.begin(), minimum.end(), INFINITY);
+        std::fill(maximum.begin(), maximum.end(), -INFINITY);
+
+        for (int r = r0; r < r1; ++r) {
+            const size_t row = (size_t)fine.width * r;
+            const float *m = &fine.mean[row];
+
+            if (isBase) {
+                for (int i = x0; i < xFast; ++i) {
+                    const float a = m[2 * i], b = m[2 * i + 1];
+                    const float lo = a < b ? a : b, hi = a < b ? b : a;
+
+                    sum[i - x0] += a + b;
+                    sumSq[i - x0] += a * a + b * b;
+                    minimum[i - x0] = lo < minimum[i - x0] ? lo : minimum[i - x0];
+                    maximum[i - x0] = hi > maximum[i - x0] ? hi : maximum[i - x0];
+                }
+            } else {
+                const float *q = &fine.meanSq[row];
+                const float *lo = &fine.min[row], *hi = &fine.max[row];
+
+                for (int i = x0; i < xFast; ++i) {
+                    const float a = lo[2 * i] < lo[2 * i + 1] ? lo[2 * i] : lo[2 * i + 1];
+                    const float b = hi[2 * i] > hi[2 * i + 1] ? hi[2 * i] : hi[2 * i + 1];
+
+                    sum[i - x0] += m[2 * i] + m[2 * i + 1];
+                    sumSq[i - x0] += q[2 * i] + q[2 * i + 1];
+                    minimum[i - x0] = a < minimum[i - x0] ? a : minimum[i - x0];
+                    maximum[i - x0] = b > maximum[i - x0] ? b : maximum[i - x0];
+                }
+            }
+
+            // last column of an odd level (or a 1 texel wide one)
+            for (int i = std::max(x0, xFast); i < x1; ++i) {
+                int c0, c1;
+
+                footprint(i, coarse.width, fine.width, &c0, &c1);
+                for (int c = c0; c < c1; ++c) {
+                    const float a = m[c];
+                    const float lo = isBase ? a : fine.min[row + c];
+                    const float hi = isBase ? a : fine.max[row + c];
+
+                    sum[i - x0] += a;
+                    sumSq[i - x0] += isBase ? a * a : fine.meanSq[row + c];
+                    minimum[i - x0] = std::min(minimum[i - x0], lo);
+                    maximum[i - x0] = std::max(maximum[i - x0], hi);
+                }
+            }
+        }
+
+        const size_t row = (size_t)coarse.width * j + x0;
+        const float rowCount = (float)(r1 - r0);
+
+        for (int i = x0; i < x1; ++i) {
+            int c0, c1;
+
+            footprint(i, coarse.width, fine.width, &c0, &c1);
+
+            const float weight = 1.0f / (rowCount * (float)(c1 - c0));
+
+            coarse.mean[row + i - x0] = sum[i - x0] * weight;
+            coarse.meanSq[row + i - x0] = sumSq[i - x0] * weight;
+            coarse.min[row + i - x0] = minimum[i - x0];
+            coarse.max[row + i - x0] = maximum[i - x0];
+        }
+    }
+}
+
+HeightPyramid::Texel HeightPyramid::texel(int level, int i, int j) const {
+    const Level &l = m_levels[level];
+    const size_t id = (size_t)i + (size_t)l.width * j;
+    Texel texel;
+
+    texel.mean = l.mean[id];
+    if (level == 0) {
+        texel.meanSq = texel.mean * texel.mean;
+        texel.min = texel.max = texel.mean;
+    } else {
+        texel.meanSq = l.meanSq[id];
+        texel.min = l.min[id];
+        texel.max = l.max[id];
+    }
+
+    return texel;
+}
+
+HeightRange HeightPyramid::range(float u0, float v0, float u1, float v1) const {
+    HeightRange range;
+
+    if (m_levels.empty())
+        return range;
+
+    const float extent = std::max((u1 - u0) * width(), (v1 - v0) * height());
+    int level = extent > 1.0f ? (int)ceilf(log2f(extent)) : 0;
+
+    level = std::min(std::max(level, 0), levelCount() - 1);
+
+    // every texel that bilinear filtering can blend in the rectangle
+    const Level &l = m_levels[level];
+    const int i0 = std::min(std::max((int)floorf(u0 * l.width - 0.5f), 0), l.width - 1);
+    const int i1 = std::min(std::max((int)floorf(u1 * l.width - 0.5f) + 1, 0), l.width - 1);
+    const int j0 = std::min(std::max((int)floorf(v0 * l.height - 0.5f), 0), l.height - 1);
+    const int j1 = std::min(std::max((int)floorf(v1 * l.height - 0.5f) + 1, 0), l.height - 1);
+
+    for (int j = j0; j <= j1; ++j)
+    for (int i = i0; i <= i1; ++i) {
+        const Texel t = texel(level, i, j);
+
+        range.min = std::min(range.min, t.min);
+        range.max = std::max(range.max, t.max);
+    }
+
+    return range;
+}
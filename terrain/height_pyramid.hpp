@@ -0,0 +1,65 @@
+#ifndef HEIGHT_PYRAMID_HPP
+#define HEIGHT_PYRAMID_HPP
+
+#include "heightmap_generator.hpp"
+
+/*******************************************************************************
+ * HeightPyramid -- Mip pyramid of a heightmap with its moments and bounds
+ *
+ * Each texel of level l > 0 covers a 2x2 footprint of level l - 1 (3 texels
+ * wide along an axis whose size is odd, so nothing is dropped) and stores
+ * the mean and the mean of the squares of the heights, which is what the
+ * RG16 mips of the displacement map hold, plus their min and max. The
+ * level sizes are those of a GL mip chain: max(1, size >> l).
+ *
+ * Level 0 only stores the heights: its mean of squares is h², and its min
+ * and max are h. Each level is built by a HeightmapGenerator pass, in row
+ * loops that the compiler vectorizes.
+ *
+ * Usage:
+ *      pyramid.resize(w, h);
+ *      ... write the heights into pyramid.baseHeights() ...
+ *      pyramid.build(generator);
+ *      float v = pyramid.texel(level, i, j).variance();
+ *      HeightRange r = pyramid.range(u0, v0, u1, v1);
+ *
+ */
+class HeightPyramid {
+public:
+    struct Texel {
+        float mean, meanSq;
+        float min, max;
+
+        float variance() const { return meanSq - mean * mean; }
+    };
+    struct Level {
+        int width, height;
+        std::vector<float> mean;
+        std::vector<float> meanSq, min, max; // empty at level 0
+    };
+
+    HeightPyramid() {}
+
+    // allocates level 0; the other levels are allocated by build()
+    void resize(int width, int height);
+    float *baseHeights() { return m_levels[0].mean.data(); }
+    void build(HeightmapGenerator &generator);
+
+    int levelCount() const { return (int)m_levels.size(); }
+    const Level &level(int level) const { return m_levels[level]; }
+    int width() const { return m_levels.empty() ? 0 : m_levels[0].width; }
+    int height() const { return m_levels.empty() ? 0 : m_levels[0].height; }
+
+    Texel texel(int level, int i, int j) const;
+    // conservative bounds of the bilinearly filtered heights over
+    // [u0, u1] x [v0, v1], in texture coordinates; read from the level at
+    // which the rectangle spans at most a texel or so
+    HeightRange range(float u0, float v0, float u1, float v1) const;
+
+private:
+    void buildLevel(int level, int x0, int y0, int x1, int y1);
+
+    std::vector<Level> m_levels;
+};
+
+#endif
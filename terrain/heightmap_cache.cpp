@@ -0,0 +1,167 @@
+#include "heightmap_cache.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+enum {PAGE_SIZE = 4096};
+
+// file layout: header, level table, then the levels and the normal map,
+// each starting on a page boundary
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t levelCount;
+    uint64_t key;
+    uint64_t normalOffset;
+    uint64_t fileSize;
+    float heightMin, heightMax;
+};
+struct FileLevel {
+    int32_t width, height;
+    uint64_t offset;
+};
+
+static const char s_magic[8] = {'T', 'C', 'C', 'H', 'M', 'A', 'P', '\0'};
+
+static uint64_t pageAlign(uint64_t offset) {
+    return (offset + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+}
+
+static uint64_t levelByteSize(int width, int height) {
+    return (uint64_t)width * height * 2 * sizeof(uint16_t);
+}
+
+HeightmapCache::HeightmapCache(const std::string &directory):
+    m_directory(directory)
+{}
+
+uint64_t HeightmapCache::hash(const void *data, size_t size, uint64_t hash) {
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash^= bytes[i];
+        hash*= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+std::string HeightmapCache::path(uint64_t key) const {
+    char name[32];
+
+    snprintf(name, sizeof(name), "%016llx.hmap", (unsigned long long)key);
+
+    return m_directory + name;
+}
+
+bool HeightmapCache::load(uint64_t key, Entry &entry) {
+    if (!m_file.open(path(key)))
+        return false;
+
+    const uint8_t *data = m_file.data();
+    const size_t size = m_file.size();
+    FileHeader header;
+
+    if (size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, s_magic, sizeof(s_magic)) != 0
+        || header.version != VERSION || header.key != key
+        || header.fileSize != size || header.levelCount == 0
+        || sizeof(header) + header.levelCount * sizeof(FileLevel) > size) {
+        m_file.close();
+        return false;
+    }
+
+    entry.levels.resize(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        FileLevel level;
+
+        memcpy(&level, data + sizeof(header) + i * sizeof(FileLevel), sizeof(level));
+        if (level.width <= 0 || level.height <= 0
+            || level.offset + levelByteSize(level.width, level.height) > size) {
+            m_file.close();
+            return false;
+        }
+
+        entry.levels[i].width = level.width;
+        entry.levels[i].height = level.height;
+        entry.levels[i].texels = (const uint16_t *)(data + level.offset);
+    }
+
+    if (header.normalOffset + (uint64_t)entry.levels[0].width * entry.levels[0].height * 2 > size) {
+        m_file.close();
+        return false;
+    }
+    entry.normals = data + header.normalOffset;
+    entry.heightMin = header.heightMin;
+    entry.heightMax = header.heightMax;
+
+    return true;
+}
+
+bool HeightmapCache::store(uint64_t key, const std::vector<Level> &levels,
+                           const uint8_t *normals, float heightMin, float heightMax) {
+    const std::string filePath = path(key);
+    const std::string tmpPath = filePath + ".tmp";
+    std::vector<FileLevel> table(levels.size());
+    const std::vector<uint8_t> padding(PAGE_SIZE, 0);
+    FileHeader header;
+    uint64_t offset;
+    FILE *file;
+    bool success;
+
+    if (levels.empty())
+        return false;
+
+    mkdir(m_directory.c_str(), 0755);
+
+    offset = pageAlign(sizeof(header) + levels.size() * sizeof(FileLevel));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        table[i].width = levels[i].width;
+        table[i].height = levels[i].height;
+        table[i].offset = offset;
+        offset = pageAlign(offset + levelByteSize(levels[i].width, levels[i].height));
+    }
+
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = VERSION;
+    header.levelCount = (uint32_t)levels.size();
+    header.key = key;
+    header.normalOffset = offset;
+    header.fileSize = offset + (uint64_t)levels[0].width * levels[0].height * 2;
+    header.heightMin = heightMin;
+    header.heightMax = heightMax;
+
+    file = fopen(tmpPath.c_str(), "wb");
+    if (!file)
+        return false;
+
+    success = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(table.data(), sizeof(FileLevel), table.size(), file) == table.size();
+    offset = sizeof(header) + table.size() * sizeof(FileLevel);
+
+    for (size_t i = 0; i < levels.size() && success; ++i) {
+        const size_t byteSize = (size_t)levelByteSize(levels[i].width, levels[i].height);
+
+        success = fwrite(padding.data(), 1, table[i].offset - offset, file) == table[i].offset - offset
+               && fwrite(levels[i].texels, 1, byteSize, file) == byteSize;
+        offset = table[i].offset + byteSize;
+    }
+
+    if (success) {
+        const size_t byteSize = (size_t)levels[0].width * levels[0].height * 2;
+
+        success = fwrite(padding.data(), 1, header.normalOffset - offset, file) == header.normalOffset - offset
+               && fwrite(normals, 1, byteSize, file) == byteSize;
+    }
+
+    success = (fclose(file) == 0) && success;
+    if (success)
+        success = (rename(tmpPath.c_str(), filePath.c_str()) == 0);
+    if (!success)
+        remove(tmpPath.c_str());
+
+    return success;
+}
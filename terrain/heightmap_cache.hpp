@@ -0,0 +1,61 @@
+#ifndef HEIGHTMAP_CACHE_HPP
+#define HEIGHTMAP_CACHE_HPP
+
+#include "mapped_file.hpp"
+#include <vector>
+
+/*******************************************************************************
+ * HeightmapCache -- Content-addressed disk cache of displacement maps
+ *
+ * An entry holds what the terrain uploads for a heightmap: the RG16 (h, h²)
+ * displacement map with its whole mip chain, the octahedral RG8 normal map
+ * (see NormalMap), and the
+ * range of the heights that were normalized into the displacement map. Its
+ * file name is a 64-bit key that the caller hashes from everything that
+ * determines the texels (generation parameters, generator version,
+ * resolution), so an entry never needs to be invalidated: a different
+ * input simply is a different file.
+ *
+ * Files are written to a temporary name and renamed, so a crash never
+ * leaves a truncated entry behind. The sections start on page boundaries
+ * and load() memory-maps the file, so a hit costs the page faults of the
+ * upload and nothing else; the pointers of an Entry stay valid until the
+ * next load() or until the cache is destroyed.
+ *
+ * Usage:
+ *      uint64_t key = HeightmapCache::hash(&param, sizeof(param), ...);
+ *      if (cache.load(key, entry)) upload(entry);
+ *      else { generate(); cache.store(key, levels, normals, min, max); }
+ *
+ */
+class HeightmapCache {
+public:
+    enum {VERSION = 3};
+    struct Level {
+        int width, height;
+        const uint16_t *texels; // RG16, row major
+    };
+    struct Entry {
+        std::vector<Level> levels;
+        const uint8_t *normals; // RG8 of level 0
+        float heightMin, heightMax;
+    };
+
+    explicit HeightmapCache(const std::string &directory);
+
+    // FNV-1a; chain calls by passing the previous hash
+    static uint64_t hash(const void *data, size_t size,
+                         uint64_t hash = 0xcbf29ce484222325ULL);
+
+    bool load(uint64_t key, Entry &entry);
+    bool store(uint64_t key, const std::vector<Level> &levels, const uint8_t *normals,
+               float heightMin, float heightMax);
+
+    std::string path(uint64_t key) const;
+
+private:
+    std::string m_directory;
+    MappedFile m_file;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "heightmap_generator.hpp"
+#include <algorithm>
+#include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+ThreadPool::ThreadPool(int threadCount):
+    m_queuedCount(0),
+    m_nextWorker(0),
+    m_isRunning(true)
+{
+    if (threadCount <= 0)
+        threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+
+    for (int i = 0; i < threadCount; ++i)
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+
+    for (int i = 0; i < threadCount; ++i)
+        m_threads.push_back(std::thread(&ThreadPool::run, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_isRunning = false;
+    }
+    m_wakeup.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); ++i)
+        m_threads[i].join();
+}
+
+void ThreadPool::submit(const std::vector<Task> &tasks, Group &group) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        group.m_pendingCount+= (int64_t)tasks.size();
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            Worker &worker = *m_workers[m_nextWorker];
+            std::lock_guard<std::mutex> workerLock(worker.mutex);
+            Entry entry = {tasks[i], &group};
+
+            worker.tasks.push_back(std::move(entry));
+            m_nextWorker = (m_nextWorker + 1) % (int)m_workers.size();
+        }
+
+        m_queuedCount+= (int64_t)tasks.size();
+    }
+    m_wakeup.notify_all();
+}
+
+void ThreadPool::wait(Group &group) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_done.wait(lock, [&group] { return group.isDone(); });
+}
+
+bool ThreadPool::waitFor(Group &group, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    return m_done.wait_for(lock, timeout, [&group] { return group.isDone(); });
+}
+
+// pops from the back of the worker's own deque, or steals from the front
+// of another one, starting with its neighbour
+bool ThreadPool::pop(int workerID, Entry &entry) {
+    const int workerCount = (int)m_workers.size();
+
+    for (int i = 0; i < workerCount; ++i) {
+        Worker &worker = *m_workers[(workerID + i) % workerCount];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+
+        if (worker.tasks.empty())
+            continue;
+
+        if (i == 0) {
+            entry = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            entry = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        --m_queuedCount;
+
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::run(int workerID) {
+    Entry entry;
+
+    for (;;) {
+        if (pop(workerID, entry)) {
+            entry.task();
+            entry.task = Task();
+
+            // the group may be destroyed as soon as its count reaches 0
+            if (--entry.group->m_pendingCount == 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                m_done.notify_all();
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_wakeup.wait(lock, [this] {
+                return !m_isRunning || m_queuedCount.load() > 0;
+            });
+
+            if (!m_isRunning)
+                return;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+HeightmapGenerator::HeightmapGenerator(ThreadPool &pool):
+    m_pool(pool),
+    m_tileCount(0),
+    m_completedTileCount(0)
+{}
+
+float HeightmapGenerator::progress() const {
+    const int64_t tileCount = m_tileCount.load();
+
+    if (tileCount == 0)
+        return 1.0f;
+
+    return (float)m_completedTileCount.load() / (float)tileCount;
+}
+
+void HeightmapGenerator::generate(int width, int height,
+                                  const TileKernel &kernel,
+                                  const ProgressCallback &progressCallback) {
+    const int tileCountX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tileCountY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    std::vector<ThreadPool::Task> tasks;
+
+    m_completedTileCount.store(0);
+    m_tileCount.store((int64_t)tileCountX * tileCountY);
+    tasks.reserve(tileCountX * tileCountY);
+
+    for (int ty = 0; ty < tileCountY; ++ty)
+    for (int tx = 0; tx < tileCountX; ++tx) {
+        const int x0 = tx * TILE_SIZE, x1 = std::min(x0 + TILE_SIZE, width);
+        const int y0 = ty * TILE_SIZE, y1 = std::min(y0 + TILE_SIZE, height);
+
+        tasks.push_back([this, &kernel, x0, y0, x1, y1] {
+            kernel(x0, y0, x1, y1);
+            ++m_completedTileCount;
+        });
+    }
+
+    m_pool.submit(tasks, m_group);
+
+    if (progressCallback) {
+        while (!m_pool.waitFor(m_group, std::chrono::milliseconds(100)))
+            progressCallback(progress());
+
+        progressCallback(1.0f);
+    } else {
+        m_pool.wait(m_group);
+    }
+}
+
+HeightRange::HeightRange():
+    min(INFINITY),
+    max(-INFINITY)
+{}
+
+void HeightRange::extend(const float *heights, int count) {
+    int i = 0;
+
+#if defined(__SSE__)
+    if (count >= 4) {
+        __m128 minimum = _mm_set1_ps(min), maximum = _mm_set1_ps(max);
+        float lanes[8];
+
+        for (; i + 4 <= count; i+= 4) {
+            const __m128 x = _mm_loadu_ps(&heights[i]);
+
+            minimum = _mm_min_ps(minimum, x);
+            maximum = _mm_max_ps(maximum, x);
+        }
+
+        _mm_storeu_ps(&lanes[0], minimum);
+        _mm_storeu_ps(&lanes[4], maximum);
+        for (int j = 0; j < 4; ++j) {
+            min = std::min(min, lanes[j]);
+            max = std::max(max, lanes[4 + j]);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        min = std::min(min, heights[i]);
+        max = std::max(max, heights[i]);
+    }
+}
+
+void HeightRange::extend(const HeightRange &range) {
+    min = std::min(min, range.min);
+    max = std::max(max, range.max);
+}
+
+HeightRangeReducer::HeightRangeReducer(int width, int height):
+    m_tileCountX((width + HeightmapGenerator::TILE_SIZE - 1) / HeightmapGenerator::TILE_SIZE),
+    m_partials((size_t)m_tileCountX
+               * ((height + HeightmapGenerator::TILE_SIZE - 1) / HeightmapGenerator::TILE_SIZE))
+{}
+
+void HeightRangeReducer::reduce(const float *heights, int width,
+                                int x0, int y0, int x1, int y1) {
+    HeightRange &partial = m_partials[(size_t)(y0 / HeightmapGenerator::TILE_SIZE) * m_tileCountX
+                                      + x0 / HeightmapGenerator::TILE_SIZE];
+
+    for (int j = y0; j < y1; ++j)
+        partial.extend(&heights[x0 + (size_t)width * j], x1 - x0);
+}
+
+void HeightRangeReducer::reduce(int x0, int y0, const HeightRange &range) {
+    m_partials[(size_t)(y0 / HeightmapGenerator::TILE_SIZE) * m_tileCountX
+               + x0 / HeightmapGenerator::TILE_SIZE].extend(range);
+}
+
+HeightRange HeightRangeReducer::range() const {
+    HeightRange range;
+
+    for (size_t i = 0; i < m_partials.size(); ++i)
+        range.extend(m_partials[i]);
+
+    return range;
+}
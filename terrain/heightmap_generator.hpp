@@ -0,0 +1,157 @@
+#ifndef HEIGHTMAP_GENERATOR_HPP
+#define HEIGHTMAP_GENERATOR_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*******************************************************************************
+ * ThreadPool -- Persistent workers with per-worker queues and work stealing
+ *
+ * Each worker owns a deque: it pops its own tasks from the back and, once
+ * it runs dry, steals from the front of the other workers' deques. Idle
+ * workers sleep until new tasks are submitted. A thread count of 0 sizes
+ * the pool to std::thread::hardware_concurrency().
+ *
+ * The application runs a single pool that its generators share. Each owner
+ * submits its tasks with its own Group and waits on that group only, so it
+ * never waits for the tasks of the others. Tasks must not wait on the pool.
+ *
+ * Usage:
+ *      ThreadPool::Group group;
+ *      pool.submit(tasks, group);
+ *      pool.wait(group);                   // or poll group.isDone()
+ *
+ */
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+    class Group {
+    public:
+        Group(): m_pendingCount(0) {}
+        bool isDone() const { return m_pendingCount.load() == 0; }
+
+    private:
+        friend class ThreadPool;
+        std::atomic<int64_t> m_pendingCount;
+    };
+
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    int threadCount() const { return (int)m_threads.size(); }
+
+    // tasks are dealt round-robin to the workers
+    void submit(const std::vector<Task> &tasks, Group &group);
+    // blocks until every task submitted with group has run
+    void wait(Group &group);
+    // same as wait() but gives up after timeout; returns true when done
+    bool waitFor(Group &group, std::chrono::milliseconds timeout);
+
+private:
+    struct Entry {
+        Task task;
+        Group *group;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Entry> tasks;
+    };
+
+    void run(int workerID);
+    bool pop(int workerID, Entry &entry);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_done;
+    std::atomic<int64_t> m_queuedCount;
+    int m_nextWorker;
+    bool m_isRunning;
+};
+
+/*******************************************************************************
+ * HeightmapGenerator -- Fills a row-major float heightmap tile by tile
+ *
+ * The map is cut into TILE_SIZE x TILE_SIZE tiles (the last row and column
+ * of tiles may be smaller, so any resolution works), and each tile is a
+ * task of the thread pool. The kernel receives the texel range
+ * [x0, x1) x [y0, y1) and writes into the caller's array, so the output
+ * has the same layout as the zf_arr array filled by gerarAltura. While the
+ * workers run, the calling thread reports progress in [0, 1]. Generators
+ * that share a pool may run at the same time.
+ *
+ */
+class HeightmapGenerator {
+public:
+    enum {TILE_SIZE = 64};
+    typedef std::function<void(int x0, int y0, int x1, int y1)> TileKernel;
+    typedef std::function<void(float progress)> ProgressCallback;
+
+    explicit HeightmapGenerator(ThreadPool &pool);
+
+    void generate(int width, int height,
+                  const TileKernel &kernel,
+                  const ProgressCallback &progressCallback = ProgressCallback());
+
+    int threadCount() const { return m_pool.threadCount(); }
+    float progress() const;
+
+private:
+    ThreadPool &m_pool;
+    ThreadPool::Group m_group;
+    std::atomic<int64_t> m_tileCount;
+    std::atomic<int64_t> m_completedTileCount;
+};
+
+/*******************************************************************************
+ * HeightRange -- Min/max of a heightmap, reduced tile by tile
+ *
+ * The reduction is meant to run inside the HeightmapGenerator pass that
+ * writes the heights, while the tile is still in cache: the reducer keeps
+ * one partial range per tile, so the kernels never synchronize, and range()
+ * merges the partials once the pass is over.
+ *
+ * Usage:
+ *      HeightRangeReducer reducer(w, h);
+ *      generator.generate(w, h, [&](int x0, int y0, int x1, int y1) {
+ *          ... write the tile into heights ...
+ *          reducer.reduce(heights, w, x0, y0, x1, y1);
+ *      });
+ *      HeightRange range = reducer.range();
+ *
+ */
+struct HeightRange {
+    float min, max;
+
+    HeightRange();
+    void extend(const float *heights, int count);
+    void extend(const HeightRange &range);
+    bool isEmpty() const { return !(min <= max); }
+};
+
+class HeightRangeReducer {
+public:
+    HeightRangeReducer(int width, int height);
+
+    // reduces the tile [x0, x1) x [y0, y1) of a row-major map of the given
+    // width; (x0, y0) must be the origin of a HeightmapGenerator tile
+    void reduce(const float *heights, int width, int x0, int y0, int x1, int y1);
+    // same, for kernels that do not keep the heights of the tile
+    void reduce(int x0, int y0, const HeightRange &range);
+    HeightRange range() const;
+
+private:
+    int m_tileCountX;
+    std::vector<HeightRange> m_partials;
+};
+
+#endif
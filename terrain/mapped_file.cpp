@@ -0,0 +1,46 @@
+#include "mapped_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile():
+    m_data(NULL),
+    m_size(0)
+{}
+
+bool MappedFile::open(const std::string &path) {
+    struct stat info;
+    int fd;
+
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping keeps the file alive
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = (const uint8_t *)data;
+    m_size = (size_t)info.st_size;
+
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) {
+        munmap((void *)m_data, m_size);
+        m_data = NULL;
+        m_size = 0;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/*******************************************************************************
+ * MappedFile -- Read-only memory mapping of a whole file
+ *
+ * The pages are read by the OS on first access, so opening a file costs
+ * nothing but the mmap call, and the data can be handed directly to GL
+ * uploads or CPU queries. The mapping is released by close() or by the
+ * destructor; pointers into it are invalid afterwards.
+ *
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile() { close(); }
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return m_data != NULL; }
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const uint8_t *m_data;
+    size_t m_size;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "noise_layer_cache.hpp"
+
+bool NoiseLayerCache::Key::operator==(const Key &key) const {
+    return seed == key.seed
+        && basis == key.basis
+        && octave == key.octave
+        && width == key.width
+        && height == key.height
+        && wavelength == key.wavelength
+        && lacunarity == key.lacunarity
+        && sampleSize == key.sampleSize;
+}
+
+NoiseLayerCache::NoiseLayerCache(int64_t byteBudget):
+    m_byteBudget(byteBudget),
+    m_generation(0)
+{}
+
+int64_t NoiseLayerCache::layerByteSize(int width, int height) {
+    return (int64_t)width * height * 3 * sizeof(float);
+}
+
+int64_t NoiseLayerCache::byteSize() const {
+    int64_t byteSize = 0;
+
+    for (size_t i = 0; i < m_layers.size(); ++i)
+        byteSize+= layerByteSize(m_layers[i]->key.width, m_layers[i]->key.height);
+
+    return byteSize;
+}
+
+const NoiseLayerCache::Layer *NoiseLayerCache::find(const Key &key) {
+    for (size_t i = 0; i < m_layers.size(); ++i) {
+        if (m_layers[i]->key == key) {
+            m_layers[i]->lastUse = m_generation;
+
+            return m_layers[i].get();
+        }
+    }
+
+    return NULL;
+}
+
+NoiseLayerCache::Layer *NoiseLayerCache::insert(const Key &key) {
+    const int64_t byteSize = layerByteSize(key.width, key.height);
+    int64_t cachedByteSize = this->byteSize();
+
+    // evict the least recently used layers that the current generation
+    // does not need
+    while (cachedByteSize + byteSize > m_byteBudget) {
+        int oldest = -1;
+
+        for (int i = 0; i < (int)m_layers.size(); ++i) {
+            const Layer &layer = *m_layers[i];
+
+            if (layer.lastUse != m_generation
+                && (oldest < 0 || layer.lastUse < m_layers[oldest]->lastUse)) {
+                oldest = i;
+            }
+        }
+
+        if (oldest < 0)
+            return NULL;
+
+        cachedByteSize-= layerByteSize(m_layers[oldest]->key.width,
+                                       m_layers[oldest]->key.height);
+        m_layers.erase(m_layers.begin() + oldest);
+    }
+
+    {
+        std::unique_ptr<Layer> layer(new Layer());
+        const size_t texelCount = (size_t)key.width * key.height;
+
+        layer->key = key;
+        layer->values.resize(texelCount);
+        layer->dx.resize(texelCount);
+        layer->dy.resize(texelCount);
+        layer->lastUse = m_generation;
+        m_layers.push_back(std::move(layer));
+    }
+
+    return m_layers.back().get();
+}
+
+void NoiseLayerCache::remove(const Layer *layer) {
+    for (size_t i = 0; i < m_layers.size(); ++i) {
+        if (m_layers[i].get() == layer) {
+            m_layers.erase(m_layers.begin() + i);
+
+            return;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef NOISE_LAYER_CACHE_HPP
+#define NOISE_LAYER_CACHE_HPP
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/*******************************************************************************
+ * NoiseLayerCache -- Keeps the octaves of an fBm heightmap between edits
+ *
+ * A layer holds one octave of noise sampled over the whole map: its value
+ * and its partial derivatives along the two map axes. Layers are keyed by
+ * everything that moves the samples (seed, noise basis, wavelength,
+ * lacunarity, sample spacing, octave index and resolution), so changing
+ * the gain, the valley exponent or the octave count only recombines layers
+ * that are already there, and only the octaves that are new get sampled.
+ *
+ * The cache holds at most byteBudget bytes. Layers that were not used
+ * since the last call to beginGeneration() are evicted first, the least
+ * recently used one first; layers used by the current generation are never
+ * evicted, so insert() returns NULL when they alone fill the budget.
+ *
+ * Usage:
+ *      cache.beginGeneration();
+ *      for each octave:
+ *          layer = cache.find(key);
+ *          if (!layer) layer = cache.insert(key); ... fill it ...
+ *      ... combine the layers ...
+ *
+ */
+class NoiseLayerCache {
+public:
+    enum {DEFAULT_BYTE_BUDGET = 256 << 20};
+    struct Key {
+        uint32_t seed;
+        int basis;      // Simplex::NoiseContext::Basis
+        int octave;
+        int width, height;
+        float wavelength;
+        float lacunarity;
+        float sampleSize;
+
+        bool operator==(const Key &key) const;
+    };
+    struct Layer {
+        Key key;
+        std::vector<float> values;
+        std::vector<float> dx, dy; // derivatives along the map axes
+        uint32_t lastUse;
+    };
+
+    explicit NoiseLayerCache(int64_t byteBudget = DEFAULT_BYTE_BUDGET);
+
+    // layers used from now on are kept until the next call
+    void beginGeneration() { ++m_generation; }
+
+    // returns the cached layer, or NULL if it has to be sampled
+    const Layer *find(const Key &key);
+    // allocates an empty layer for key, evicting older layers if needed;
+    // returns NULL if it does not fit in the budget
+    Layer *insert(const Key &key);
+    // drops a layer, e.g., one that was inserted but will not be filled
+    void remove(const Layer *layer);
+
+    void clear() { m_layers.clear(); }
+    int64_t byteSize() const;
+    int64_t byteBudget() const { return m_byteBudget; }
+    int layerCount() const { return (int)m_layers.size(); }
+
+    static int64_t layerByteSize(int width, int height);
+
+private:
+    std::vector<std::unique_ptr<Layer>> m_layers;
+    int64_t m_byteBudget;
+    uint32_t m_generation;
+};
+
+#endif
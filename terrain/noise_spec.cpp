@@ -0,0 +1,164 @@
+#include "noise_spec.hpp"
+#include "simplex.h"
+#include <algorithm>
+#include <string.h>
+
+// Every constant is written with the 9 digits that round-trip to its float,
+// so that the C++ and GLSL compilers read the same value.
+namespace {
+    using namespace Simplex::details;
+    typedef SimdBatch Simd;
+
+    const float F2 = 0.366025418f;              // (sqrt(3) - 1) / 2
+    const float G2 = 0.211324871f;              // (3 - sqrt(3)) / 6
+    const float G2_MINUS_1 = -0.788675129f;     // G2 - 1
+    const float TWO_G2_MINUS_1 = -0.577350259f; // 2 * G2 - 1
+    const float FALLOFF_MIN = 9.53674316e-07f;  // 2^-20
+    const float FLUSH_MIN = 7.88860905e-31f;    // 2^-100
+    const float SQRT2 = 1.41421354f;
+
+    // log2(1 + u) = u * q(u) for u in [sqrt(1/2) - 1, sqrt(2) - 1]
+    const float LOG2_COEFFICIENTS[9] = {
+        1.44269502f, -0.721347451f, 0.480910748f, -0.360693276f, 0.287903249f,
+        -0.239169881f, 0.216078222f, -0.205861881f, 0.123109683f
+    };
+    // 2^f for f in [0, 1]
+    const float EXP2_COEFFICIENTS[7] = {
+        1.0f, 0.693146944f, 0.240230456f, 0.0554806292f, 0.00968418643f,
+        0.00123913318f, 0.000218657849f
+    };
+
+    float flush(float x) {
+        return (x > FLUSH_MIN || x < -FLUSH_MIN) ? x : 0.0f;
+    }
+
+    template<typename S>
+    typename S::F specFlushBatch(typename S::F x) {
+        const typename S::M keep = S::orm(S::greater(x, S::set1(FLUSH_MIN)),
+                                          S::greater(S::set1(-FLUSH_MIN), x));
+
+        return S::select(keep, x, S::set1(0.0f));
+    }
+
+    // t^4 * grad(hash, x, y), with t = 0.5 - x^2 - y^2, if t > 2^-20
+    template<typename S>
+    typename S::F specCornerBatch(typename S::I hash, typename S::F x, typename S::F y) {
+        typedef typename S::F F;
+        F t = S::sub(S::sub(S::set1(0.5f), S::mul(x, x)), S::mul(y, y));
+
+        t = S::select(S::greater(t, S::set1(FALLOFF_MIN)), t, S::set1(0.0f));
+        t = S::mul(t, t);
+        t = S::mul(t, t);
+        return specFlushBatch<S>(S::mul(t, gradBatch<S>(hash, x, y)));
+    }
+
+    template<typename S>
+    typename S::F specNoiseBatch(const IntegerHash<S> &hash, typename S::F x, typename S::F y) {
+        typedef typename S::F F;
+        typedef typename S::I I;
+
+        // skew, find the cell and unskew its origin
+        const F s  = S::mul(S::add(x, y), S::set1(F2));
+        const I i  = fastFloorBatch<S>(S::add(x, s));
+        const I j  = fastFloorBatch<S>(S::add(y, s));
+        const F t  = S::mul(S::toFloat(S::addi(i, j)), S::set1(G2));
+        const F x0 = S::sub(x, S::sub(S::toFloat(i), t));
+        const F y0 = S::sub(y, S::sub(S::toFloat(j), t));
+
+        // middle corner: (1,0) in the lower triangle, (0,1) in the upper one
+        const typename S::M lower = S::greater(x0, y0);
+        const F x1 = S::add(x0, S::select(lower, S::set1(G2_MINUS_1), S::set1(G2)));
+        const F y1 = S::add(y0, S::select(lower, S::set1(G2), S::set1(G2_MINUS_1)));
+        const F x2 = S::add(x0, S::set1(TWO_G2_MINUS_1));
+        const F y2 = S::add(y0, S::set1(TWO_G2_MINUS_1));
+
+        const I one = S::set1i(1);
+        const I i1  = S::maskToInt(lower);
+        const I j1  = S::subi(one, i1);
+        const F n0  = specCornerBatch<S>(hash(i, j), x0, y0);
+        const F n1  = specCornerBatch<S>(hash(S::addi(i, i1), S::addi(j, j1)), x1, y1);
+        const F n2  = specCornerBatch<S>(hash(S::addi(i, one), S::addi(j, one)), x2, y2);
+
+        return S::mul(S::set1(40.0f), S::add(S::add(n0, n1), n2));
+    }
+
+    // pow(x, e) = exp2(e * log2(x)) for x >= 0, with x = m * 2^k, m in
+    // [sqrt(1/2), sqrt(2)), and e * log2(x) = n + f, f in [0, 1]
+    float specPow(float x, float e) {
+        uint32_t bits;
+        float m, scale;
+
+        if (!(x > FLUSH_MIN))
+            return 0.0f;
+
+        memcpy(&bits, &x, sizeof(bits));
+        int k = (int)(bits >> 23) - 127;
+        bits = (bits & 0x7fffff) | 0x3f800000;
+        memcpy(&m, &bits, sizeof(m));
+        if (m > SQRT2) {
+            m = m * 0.5f;
+            k = k + 1;
+        }
+
+        const float u = m - 1.0f;
+        float q = LOG2_COEFFICIENTS[8];
+
+        for (int i = 7; i >= 0; --i)
+            q = q * u + LOG2_COEFFICIENTS[i];
+
+        const float y = e * ((float)k + u * q);
+        int n = y > 0.0f ? (int)y : (int)y - 1;
+        const float f = y - (float)n;
+        float p = EXP2_COEFFICIENTS[6];
+
+        for (int i = 5; i >= 0; --i)
+            p = p * f + EXP2_COEFFICIENTS[i];
+
+        if (n < -126)
+            return 0.0f;
+        n = std::min(n, 127);
+        bits = (uint32_t)(n + 127) << 23;
+        memcpy(&scale, &bits, sizeof(scale));
+
+        return scale * p;
+    }
+}
+
+void NoiseSpec::heights(const Params &params, int x0, int y, int count, float *heights) {
+    typedef Simd::F F;
+    const IntegerHash<Simd> hash(params.seed);
+    const F py = Simd::set1((float)y * params.frequency);
+    float xs[Simd::WIDTH], sums[Simd::WIDTH];
+
+    for (int first = 0; first < count; first+= Simd::WIDTH) {
+        const int n = std::min((int)Simd::WIDTH, count - first);
+        float f = 1.0f, a = 0.5f;
+        F sum = Simd::set1(0.0f);
+
+        // the lanes past the end of the row repeat its last texel
+        for (int i = 0; i < Simd::WIDTH; ++i)
+            xs[i] = (float)(x0 + first + std::min(i, n - 1)) * params.frequency;
+
+        const F px = Simd::load(xs);
+
+        for (int octave = 0; octave < params.octaves; ++octave) {
+            const F noise = specNoiseBatch<Simd>(hash, Simd::mul(px, Simd::set1(f)),
+                                                 Simd::mul(py, Simd::set1(f)));
+
+            sum = specFlushBatch<Simd>(Simd::add(sum, specFlushBatch<Simd>(Simd::mul(Simd::set1(a), noise))));
+            f = f * params.lacunarity;
+            a = flush(a * params.gain);
+        }
+
+        Simd::store(sums, sum);
+        for (int i = 0; i < n; ++i)
+            heights[first + i] = specPow(sums[i] < 0.0f ? -sums[i] : sums[i], params.elevation);
+    }
+}
+
+float NoiseSpec::height(const Params &params, int x, int y) {
+    float h;
+
+    heights(params, x, y, 1, &h);
+    return h;
+}
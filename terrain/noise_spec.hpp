@@ -0,0 +1,54 @@
+#ifndef NOISE_SPEC_HPP
+#define NOISE_SPEC_HPP
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * NoiseSpec -- Heightmap noise with the same bits on the CPU and the GPU
+ *
+ * The height of texel (x, y) is defined operation by operation, and
+ * NoiseSpec.glsl implements the same definition. Only operations that
+ * are exactly rounded on both sides are used: additions, subtractions,
+ * multiplications, comparisons, integer arithmetic and int <-> float
+ * conversions. Nothing is divided, and nothing is fused: this file is
+ * built with -ffp-contract=off and the shader variables are precise.
+ * Values that could become denormal are flushed to zero explicitly, so
+ * the result does not depend on the denormal mode of the device.
+ *
+ * The noise is 2D simplex noise (SimplexNoise1234) whose corners are
+ * hashed with the integer hash of Simplex::NoiseContext::INTEGER_HASH:
+ *
+ *      p      = (float(x) * frequency, float(y) * frequency)
+ *      sum    = flush(sum + flush(a * noise(p * f)))   for each octave,
+ *      f     *= lacunarity, a = flush(a * gain)        from f = 1, a = 0.5
+ *      height = pow(|sum|, elevation)
+ *
+ * flush() zeroes magnitudes below 2^-100, a corner only contributes when
+ * its falloff is above 2^-20, and pow() is evaluated as exp2(e * log2(x))
+ * with fixed polynomials (about 1e-7 relative error). The code is the
+ * specification: see noise_spec.cpp for the exact order of the operations.
+ *
+ * Usage:
+ *      NoiseSpec::Params params = {seed, octaves, 1.0f / wavelength, ...};
+ *      NoiseSpec::heights(params, x0, y, count, row);
+ *
+ */
+class NoiseSpec {
+public:
+    enum {VERSION = 1};
+    struct Params {
+        uint32_t seed;
+        int octaves;
+        float frequency;    // 1 / wavelength, computed once by the caller
+        float lacunarity;
+        float gain;
+        float elevation;
+    };
+
+    // heights of the texels (x0 + i, y), i < count
+    static void heights(const Params &params, int x0, int y, int count, float *heights);
+    // height of a single texel
+    static float height(const Params &params, int x, int y);
+};
+
+#endif
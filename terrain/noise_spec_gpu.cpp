@@ -0,0 +1,83 @@
+#include "noise_spec_gpu.hpp"
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+static bool readFile(const std::string &path, std::string *text) {
+    std::ifstream file(path.c_str());
+    std::stringstream buffer;
+
+    if (!file.is_open())
+        return false;
+
+    buffer << file.rdbuf();
+    *text = buffer.str();
+    return true;
+}
+
+NoiseSpecGpu::NoiseSpecGpu():
+    m_buffer(0),
+    m_bufferSize(0)
+{}
+
+std::string NoiseSpecGpu::source(const std::string &shaderDirectory) {
+    std::string spec, generation;
+
+    if (!readFile(shaderDirectory + "NoiseSpec.glsl", &spec)
+        || !readFile(shaderDirectory + "HeightmapGeneration.glsl", &generation))
+        return std::string();
+
+    return "#version 450 core\n" + spec + "\n" + generation;
+}
+
+bool NoiseSpecGpu::generate(GLuint program, const NoiseSpec::Params &params,
+                            int x0, int y0, int x1, int y1, float *heights, int stride) {
+    const int w = x1 - x0, h = y1 - y0;
+    const GLsizeiptr byteSize = (GLsizeiptr)w * h * sizeof(float);
+
+    if (!glIsProgram(program))
+        return false;
+
+    if (m_bufferSize < byteSize) {
+        if (glIsBuffer(m_buffer))
+            glDeleteBuffers(1, &m_buffer);
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, byteSize, NULL, GL_DYNAMIC_COPY);
+        m_bufferSize = byteSize;
+    }
+
+    glUseProgram(program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffer);
+    glUniform2i(glGetUniformLocation(program, "tileOrigin"), x0, y0);
+    glUniform2i(glGetUniformLocation(program, "tileSize"), w, h);
+    glUniform1i(glGetUniformLocation(program, "seed"), (GLint)params.seed);
+    glUniform1i(glGetUniformLocation(program, "octaves"), params.octaves);
+    glUniform1f(glGetUniformLocation(program, "frequency"), params.frequency);
+    glUniform1f(glGetUniformLocation(program, "lacunarity"), params.lacunarity);
+    glUniform1f(glGetUniformLocation(program, "gain"), params.gain);
+    glUniform1f(glGetUniformLocation(program, "elevation"), params.elevation);
+    glDispatchCompute((w + 15) / 16, (h + 15) / 16, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    const float *texels = (const float *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, byteSize,
+                                                          GL_MAP_READ_BIT);
+
+    if (texels) {
+        for (int j = 0; j < h; ++j)
+            memcpy(&heights[(size_t)stride * j], &texels[(size_t)w * j], w * sizeof(float));
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glUseProgram(0);
+
+    return texels != NULL && glGetError() == GL_NO_ERROR;
+}
+
+void NoiseSpecGpu::release() {
+    if (glIsBuffer(m_buffer))
+        glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+    m_bufferSize = 0;
+}
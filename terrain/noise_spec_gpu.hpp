@@ -0,0 +1,42 @@
+#ifndef NOISE_SPEC_GPU_HPP
+#define NOISE_SPEC_GPU_HPP
+
+#include "glad/glad.h"
+#include "noise_spec.hpp"
+#include <string>
+
+/*******************************************************************************
+ * NoiseSpecGpu -- Generates NoiseSpec heights with HeightmapGeneration.glsl
+ *
+ * source() assembles the compute shader: the #version line, NoiseSpec.glsl
+ * and HeightmapGeneration.glsl. generate() runs the program over one tile
+ * of the map and reads the heights back into the caller's array, so a tile
+ * can be generated by either backend (see TileScheduler). The storage
+ * buffer is kept between tiles. Needs a current OpenGL 4.3 context.
+ *
+ * Usage:
+ *      glShaderSource(shader, NoiseSpecGpu::source(shaderDir)) ... link ...
+ *      NoiseSpecGpu gpu;
+ *      gpu.generate(program, params, x0, y0, x1, y1, &heights[x0 + w * y0], w);
+ *      gpu.release();
+ *
+ */
+class NoiseSpecGpu {
+public:
+    NoiseSpecGpu();
+
+    // shaderDirectory ends with a '/'; returns an empty string on failure
+    static std::string source(const std::string &shaderDirectory);
+
+    // writes the heights of the texels [x0, x1) x [y0, y1) of the map, row
+    // by row, rows stride floats apart
+    bool generate(GLuint program, const NoiseSpec::Params &params,
+                  int x0, int y0, int x1, int y1, float *heights, int stride);
+    void release();
+
+private:
+    GLuint m_buffer;
+    GLsizeiptr m_bufferSize;
+};
+
+#endif
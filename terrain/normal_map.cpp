@@ -0,0 +1,142 @@
+#include "normal_map.hpp"
+#include "simplex.h"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+    using namespace Simplex::details;
+
+    // [-1, 1] -> [0, 255], rounded
+    uint8_t quantize(float x) {
+        return (uint8_t)std::min(std::max(x * 127.5f + 128.0f, 0.0f), 255.0f);
+    }
+
+    float unquantize(uint8_t x) {
+        return (float)x / 127.5f - 1.0f;
+    }
+
+    template<typename S>
+    typename S::F absBatch(typename S::F x) {
+        return S::max(x, S::neg(x));
+    }
+
+    template<typename S>
+    void encodeSlopesBatch(const float *sx, const float *sy, int count, uint8_t *rg) {
+        typedef typename S::F F;
+        float xs[S::WIDTH], ys[S::WIDTH], us[S::WIDTH], vs[S::WIDTH];
+
+        for (int first = 0; first < count; first+= S::WIDTH) {
+            const int n = std::min((int)S::WIDTH, count - first);
+
+            // the lanes past the end of the row repeat its last texel
+            for (int i = 0; i < S::WIDTH; ++i) {
+                xs[i] = sx[first + std::min(i, n - 1)];
+                ys[i] = sy[first + std::min(i, n - 1)];
+            }
+
+            // |n.z| = 1 >= 0: no fold
+            const F x = S::load(xs);
+            const F y = S::load(ys);
+            const F norm = S::add(S::add(absBatch<S>(x), absBatch<S>(y)), S::set1(1.0f));
+            const F scale = S::div(S::set1(-127.5f), norm);
+
+            S::store(us, S::add(S::mul(x, scale), S::set1(128.0f)));
+            S::store(vs, S::add(S::mul(y, scale), S::set1(128.0f)));
+            for (int i = 0; i < n; ++i) {
+                rg[2 * (first + i)    ] = (uint8_t)us[i];
+                rg[2 * (first + i) + 1] = (uint8_t)vs[i];
+            }
+        }
+    }
+}
+
+void NormalMap::encodeSlopes(const float *sx, const float *sy, int count, uint8_t *rg) {
+    encodeSlopesBatch<SimdBatch>(sx, sy, count, rg);
+}
+
+void NormalMap::encode(float x, float y, float z, uint8_t *rg) {
+    const float norm = fabsf(x) + fabsf(y) + fabsf(z);
+    float u = norm > 0.0f ? x / norm : 0.0f;
+    float v = norm > 0.0f ? y / norm : 0.0f;
+
+    if (z < 0.0f) {
+        const float fu = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        const float fv = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+
+        u = fu;
+        v = fv;
+    }
+
+    rg[0] = quantize(u);
+    rg[1] = quantize(v);
+}
+
+void NormalMap::decode(const uint8_t *rg, float *normal) {
+    const float u = unquantize(rg[0]);
+    const float v = unquantize(rg[1]);
+    float x = u, y = v, z = 1.0f - fabsf(u) - fabsf(v);
+
+    if (z < 0.0f) {
+        x = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    const float norm = 1.0f / sqrtf(x * x + y * y + z * z);
+
+    normal[0] = x * norm;
+    normal[1] = y * norm;
+    normal[2] = z * norm;
+}
+
+void NormalMap::reduce(const uint8_t *fine, int fineWidth, int fineHeight,
+                       uint8_t *coarse, int width, int height,
+                       int x0, int y0, int x1, int y1) {
+    for (int j = y0; j < y1; ++j)
+    for (int i = x0; i < x1; ++i) {
+        const int c0 = std::min(2 * i, fineWidth - 1);
+        const int c1 = (i == width - 1) ? fineWidth : 2 * i + 2;
+        const int r0 = std::min(2 * j, fineHeight - 1);
+        const int r1 = (j == height - 1) ? fineHeight : 2 * j + 2;
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+
+        for (int r = r0; r < r1; ++r)
+        for (int c = c0; c < c1; ++c) {
+            float normal[3];
+
+            decode(&fine[2 * (c + (size_t)fineWidth * r)], normal);
+            sum[0]+= normal[0];
+            sum[1]+= normal[1];
+            sum[2]+= normal[2];
+        }
+
+        encode(sum[0], sum[1], sum[2], &coarse[2 * (i + (size_t)width * j)]);
+    }
+}
+
+std::vector<std::vector<uint8_t>> NormalMap::buildMips(const uint8_t *rg, int width, int height,
+                                                       int levelCount, HeightmapGenerator &generator) {
+    std::vector<std::vector<uint8_t>> mips;
+    const uint8_t *fine = rg;
+    int fineWidth = width, fineHeight = height;
+
+    // the levels are read by the next one: no reallocation
+    mips.reserve(std::max(levelCount - 1, 0));
+    for (int level = 1; level < levelCount; ++level) {
+        const int w = std::max(fineWidth >> 1, 1);
+        const int h = std::max(fineHeight >> 1, 1);
+
+        mips.push_back(std::vector<uint8_t>((size_t)w * h * 2));
+
+        uint8_t *coarse = mips.back().data();
+
+        generator.generate(w, h, [=](int x0, int y0, int x1, int y1) {
+            reduce(fine, fineWidth, fineHeight, coarse, w, h, x0, y0, x1, y1);
+        });
+
+        fine = coarse;
+        fineWidth = w;
+        fineHeight = h;
+    }
+
+    return mips;
+}
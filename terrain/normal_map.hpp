@@ -0,0 +1,50 @@
+#ifndef NORMAL_MAP_HPP
+#define NORMAL_MAP_HPP
+
+#include "heightmap_generator.hpp"
+#include <stdint.h>
+
+/*******************************************************************************
+ * NormalMap -- Octahedral RG8 normal maps and their mip chain
+ *
+ * A normal n is stored as its octahedral projection
+ *
+ *      p = n.xy / (|n.x| + |n.y| + |n.z|),
+ *
+ * folded onto the outer triangles when n.z < 0, with p mapped from [-1, 1]
+ * to RG8: 2 bytes per texel instead of 3. The projection ignores the length
+ * of n, so the normal (-sx, -sy, 1) of a slope is encoded without being
+ * normalized: encodeSlopes() is a division per component, run on the SIMD
+ * batches of the noise kernels. DecodeOctahedralNormal() in
+ * TerrainRenderCommon.glsl is the inverse.
+ *
+ * Averaging codes is not averaging normals, so the mips are built on the
+ * CPU: the unit normals of the footprint of a texel (the footprints of
+ * HeightPyramid) are summed and the sum is encoded, which renormalizes it.
+ *
+ * Usage:
+ *      NormalMap::encodeSlopes(sx, sy, count, &rg[2 * first]);    // row by row
+ *      std::vector<std::vector<uint8_t>> mips = NormalMap::buildMips(rg, w, h, levelCount, generator);
+ *
+ */
+class NormalMap {
+public:
+    // codes of the normals (-sx[i], -sy[i], 1), i < count
+    static void encodeSlopes(const float *sx, const float *sy, int count, uint8_t *rg);
+    // code of the direction (x, y, z), which needs not be normalized
+    static void encode(float x, float y, float z, uint8_t *rg);
+    // unit normal of a code
+    static void decode(const uint8_t *rg, float *normal);
+
+    // texels [x0, x1) x [y0, y1) of the level of width x height that
+    // follows the level of fineWidth x fineHeight
+    static void reduce(const uint8_t *fine, int fineWidth, int fineHeight,
+                       uint8_t *coarse, int width, int height,
+                       int x0, int y0, int x1, int y1);
+    // levels 1 to levelCount - 1 of the mip chain of rg, level l being
+    // max(width >> l, 1) x max(height >> l, 1)
+    static std::vector<std::vector<uint8_t>> buildMips(const uint8_t *rg, int width, int height,
+                                                       int levelCount, HeightmapGenerator &generator);
+};
+
+#endif
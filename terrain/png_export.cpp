@@ -0,0 +1,233 @@
+#include "png_export.hpp"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+// one deflated group of rows
+struct RowGroup {
+    std::vector<uint8_t> data;
+    uLong adler;
+    size_t byteSize;    // before compression
+    bool isValid;
+};
+
+static void writeUint32(uint8_t *bytes, uint32_t x) {
+    bytes[0] = (uint8_t)(x >> 24);
+    bytes[1] = (uint8_t)(x >> 16);
+    bytes[2] = (uint8_t)(x >>  8);
+    bytes[3] = (uint8_t)(x      );
+}
+
+static bool writeChunk(FILE *file, const char *type, const uint8_t *data, size_t size) {
+    uint8_t header[8], footer[4];
+    uLong crc = crc32(0, (const Bytef *)type, 4);
+
+    writeUint32(header, (uint32_t)size);
+    memcpy(&header[4], type, 4);
+    if (size > 0)
+        crc = crc32(crc, data, (uInt)size);
+    writeUint32(footer, (uint32_t)crc);
+
+    return fwrite(header, 1, 8, file) == 8
+        && (size == 0 || fwrite(data, 1, size, file) == size)
+        && fwrite(footer, 1, 4, file) == 4;
+}
+
+static uint8_t paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return (uint8_t)a;
+
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+static uint64_t filterCost(const uint8_t *x, size_t size) {
+    uint64_t cost = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        cost+= (uint64_t)abs((int8_t)x[i]);
+
+    return cost;
+}
+
+// writes the filter type and the filtered bytes of row into out; without
+// the previous row, only the filters that do not read it are tried
+static void filterRow(const uint8_t *row, const uint8_t *prev, size_t size,
+                      std::vector<uint8_t> *candidates, uint8_t *out) {
+    const size_t bpp = 2;
+    const int filterCount = prev ? 5 : 2;
+    uint64_t bestCost = ~(uint64_t)0;
+    int best = 0;
+
+    // one loop per filter, so that each one vectorizes
+    for (size_t i = 0; i < size; ++i)
+        candidates[0][i] = row[i];
+    for (size_t i = 0; i < size; ++i)
+        candidates[1][i] = (uint8_t)(row[i] - (i >= bpp ? row[i - bpp] : 0));
+
+    if (prev) {
+        for (size_t i = 0; i < size; ++i)
+            candidates[2][i] = (uint8_t)(row[i] - prev[i]);
+        for (size_t i = 0; i < size; ++i)
+            candidates[3][i] = (uint8_t)(row[i] - (((i >= bpp ? row[i - bpp] : 0) + prev[i]) >> 1));
+        for (size_t i = 0; i < bpp; ++i)
+            candidates[4][i] = (uint8_t)(row[i] - prev[i]);
+        for (size_t i = bpp; i < size; ++i)
+            candidates[4][i] = (uint8_t)(row[i] - paeth(row[i - bpp], prev[i], prev[i - bpp]));
+    }
+
+    for (int filter = 0; filter < filterCount; ++filter) {
+        const uint64_t cost = filterCost(candidates[filter].data(), size);
+
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = filter;
+        }
+    }
+
+    out[0] = (uint8_t)best;
+    memcpy(&out[1], candidates[best].data(), size);
+}
+
+static void deflateGroup(int width, int y0, int y1, bool isLast, int level,
+                         const PngHeightmapWriter::RowKernel &kernel, RowGroup &group) {
+    const size_t rowSize = (size_t)width * 2;
+    std::vector<uint16_t> samples(width);
+    std::vector<uint8_t> row(rowSize), prev(rowSize);
+    std::vector<uint8_t> filtered((rowSize + 1) * (y1 - y0));
+    std::vector<uint8_t> candidates[5];
+    z_stream stream;
+
+    for (int i = 0; i < 5; ++i)
+        candidates[i].resize(rowSize);
+
+    for (int y = y0; y < y1; ++y) {
+        kernel(y, samples.data());
+
+        // PNG samples are big-endian
+        for (int x = 0; x < width; ++x) {
+            row[2 * x    ] = (uint8_t)(samples[x] >> 8);
+            row[2 * x + 1] = (uint8_t)(samples[x]     );
+        }
+
+        filterRow(row.data(), y > y0 ? prev.data() : NULL, rowSize, candidates,
+                  &filtered[(rowSize + 1) * (y - y0)]);
+        std::swap(row, prev);
+    }
+
+    group.byteSize = filtered.size();
+    group.adler = adler32(adler32(0, NULL, 0), filtered.data(), (uInt)filtered.size());
+    group.isValid = false;
+
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return;
+
+    group.data.resize(deflateBound(&stream, (uLong)filtered.size()) + 16);
+    stream.next_in = filtered.data();
+    stream.avail_in = (uInt)filtered.size();
+    stream.next_out = group.data.data();
+    stream.avail_out = (uInt)group.data.size();
+
+    // the last group closes the deflate stream, the others end on a byte
+    // boundary so that the next group can be appended
+    for (;;) {
+        const int status = deflate(&stream, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+
+        if (status == Z_STREAM_ERROR)
+            break;
+        if (isLast ? status == Z_STREAM_END : (stream.avail_in == 0 && stream.avail_out > 0)) {
+            group.isValid = true;
+            break;
+        }
+        if (stream.avail_out == 0) {
+            const size_t size = group.data.size();
+
+            group.data.resize(2 * size);
+            stream.next_out = &group.data[size];
+            stream.avail_out = (uInt)size;
+        }
+    }
+
+    group.data.resize(stream.total_out);
+    deflateEnd(&stream);
+}
+
+PngHeightmapWriter::PngHeightmapWriter(ThreadPool &pool):
+    m_pool(pool)
+{}
+
+bool PngHeightmapWriter::write(const std::string &path, int width, int height,
+                               const RowKernel &kernel, int level) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    // deflate, 32K window, default compression (CMF * 256 + FLG is a multiple of 31)
+    static const uint8_t zlibHeader[2] = {0x78, 0x9c};
+    const int groupCount = (height + ROWS_PER_GROUP - 1) / ROWS_PER_GROUP;
+    const int batchSize = m_pool.threadCount() * GROUPS_PER_THREAD;
+    std::vector<RowGroup> groups(batchSize);
+    uLong adler = adler32(0, NULL, 0);
+    uint8_t header[13], footer[4];
+    FILE *file;
+    bool success;
+
+    if (width <= 0 || height <= 0)
+        return false;
+
+    file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    // 16-bit grayscale, no interlacing
+    writeUint32(&header[0], (uint32_t)width);
+    writeUint32(&header[4], (uint32_t)height);
+    header[8] = 16;
+    header[9] = 0;
+    header[10] = header[11] = header[12] = 0;
+
+    success = fwrite(signature, 1, 8, file) == 8
+           && writeChunk(file, "IHDR", header, sizeof(header))
+           && writeChunk(file, "IDAT", zlibHeader, sizeof(zlibHeader));
+
+    for (int first = 0; first < groupCount && success; first+= batchSize) {
+        const int last = std::min(first + batchSize, groupCount);
+        std::vector<ThreadPool::Task> tasks;
+
+        for (int g = first; g < last; ++g) {
+            RowGroup *group = &groups[g - first];
+
+            tasks.push_back([=, &kernel] {
+                const int y0 = g * ROWS_PER_GROUP;
+                const int y1 = std::min(y0 + ROWS_PER_GROUP, height);
+
+                deflateGroup(width, y0, y1, g == groupCount - 1, level, kernel, *group);
+            });
+        }
+
+        m_pool.submit(tasks, m_group);
+        m_pool.wait(m_group);
+
+        // the groups go to disk in order, so the batch can be reused
+        for (int g = first; g < last && success; ++g) {
+            const RowGroup &group = groups[g - first];
+
+            success = group.isValid
+                   && writeChunk(file, "IDAT", group.data.data(), group.data.size());
+            adler = adler32_combine(adler, group.adler, (z_off_t)group.byteSize);
+        }
+    }
+
+    writeUint32(footer, (uint32_t)adler);
+    success = success
+           && writeChunk(file, "IDAT", footer, sizeof(footer))
+           && writeChunk(file, "IEND", NULL, 0);
+
+    success = (fclose(file) == 0) && success;
+    if (!success)
+        remove(path.c_str());
+
+    return success;
+}
@@ -0,0 +1,45 @@
+#ifndef PNG_EXPORT_HPP
+#define PNG_EXPORT_HPP
+
+#include "heightmap_generator.hpp"
+#include <string>
+
+/*******************************************************************************
+ * PngHeightmapWriter -- Streams a 16-bit grayscale PNG, row groups in parallel
+ *
+ * The image is cut into groups of ROWS_PER_GROUP rows. For each group, a
+ * task of the thread pool asks the kernel for the samples of its rows,
+ * filters them (per row, the PNG filter with the smallest sum of absolute
+ * values; the first row of a group only uses filters that do not read the
+ * previous row, so groups are independent) and deflates them with its own
+ * zlib stream. The streams end on a byte boundary (Z_SYNC_FLUSH), so
+ * concatenating them in order gives a valid zlib stream, whose Adler-32 is
+ * combined from those of the groups.
+ *
+ * Groups are processed in batches of a few per thread and written to disk
+ * as IDAT chunks in order, so memory stays bounded whatever the image size.
+ *
+ * Usage:
+ *      PngHeightmapWriter writer(pool);
+ *      writer.write("map.png", w, h, [](int y, uint16_t *row) { ... });
+ *
+ */
+class PngHeightmapWriter {
+public:
+    enum {ROWS_PER_GROUP = 64, GROUPS_PER_THREAD = 2};
+    // writes the width samples of row y
+    typedef std::function<void(int y, uint16_t *row)> RowKernel;
+
+    explicit PngHeightmapWriter(ThreadPool &pool);
+
+    // level is the zlib compression level; 1 is about 3x faster than the
+    // zlib default (6), for files about 5% larger
+    bool write(const std::string &path, int width, int height,
+               const RowKernel &kernel, int level = 1);
+
+private:
+    ThreadPool &m_pool;
+    ThreadPool::Group m_group;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "progressive_heightmap.hpp"
+#include <algorithm>
+
+static void resizeLevel(ProgressiveHeightmap::Level &level,
+                        int width, int height, int stride) {
+    level.stride = stride;
+    level.width = (width + stride - 1) / stride;
+    level.height = (height + stride - 1) / stride;
+    level.heights.resize((size_t)level.width * level.height);
+    level.gradients.resize((size_t)level.width * level.height * 2);
+}
+
+ProgressiveHeightmap::ProgressiveHeightmap(ThreadPool &pool):
+    m_generator(pool),
+    m_isCancelled(false),
+    m_isPassDone(false),
+    m_hasNextPass(false),
+    m_width(0),
+    m_height(0)
+{
+    m_level.width = m_level.height = 0;
+    m_level.stride = 1;
+}
+
+void ProgressiveHeightmap::start(int width, int height, const LevelKernel &kernel,
+                                 const LevelFinisher &finisher) {
+    int stride = 1;
+
+    cancel();
+    m_kernel = kernel;
+    m_finisher = finisher;
+    m_width = width;
+    m_height = height;
+
+    while (std::max(width, height) / (2 * stride) >= BASE_SIZE)
+        stride*= 2;
+
+    resizeLevel(m_level, width, height, stride);
+    {
+        HeightRangeReducer reducer(m_level.width, m_level.height);
+
+        m_generator.generate(m_level.width, m_level.height,
+                             [this, &reducer](int x0, int y0, int x1, int y1) {
+                                 m_kernel(m_level, x0, y0, x1, y1, false);
+                                 reducer.reduce(m_level.heights.data(), m_level.width,
+                                                x0, y0, x1, y1);
+                             });
+        m_level.range = reducer.range();
+    }
+    if (m_finisher)
+        m_finisher(m_level, m_generator);
+
+    m_hasNextPass = stride > 1;
+}
+
+bool ProgressiveHeightmap::poll() {
+    if (!m_thread.joinable()) {
+        if (m_hasNextPass) {
+            m_hasNextPass = false;
+            launch();
+        }
+
+        return false;
+    }
+
+    if (!m_isPassDone.load())
+        return false;
+
+    m_thread.join();
+    std::swap(m_level, m_nextLevel);
+    m_hasNextPass = m_level.stride > 1;
+
+    return true;
+}
+
+void ProgressiveHeightmap::cancel() {
+    m_hasNextPass = false;
+    if (m_thread.joinable()) {
+        m_isCancelled = true;
+        m_thread.join();
+        m_isCancelled = false;
+    }
+}
+
+void ProgressiveHeightmap::launch() {
+    resizeLevel(m_nextLevel, m_width, m_height, m_level.stride / 2);
+    m_isPassDone = false;
+    m_thread = std::thread(&ProgressiveHeightmap::refine, this);
+}
+
+// runs on the background thread; m_level is only read while it runs
+void ProgressiveHeightmap::refine() {
+    HeightRangeReducer reducer(m_nextLevel.width, m_nextLevel.height);
+
+    m_generator.generate(m_nextLevel.width, m_nextLevel.height,
+                         [this, &reducer](int x0, int y0, int x1, int y1) {
+        if (m_isCancelled.load())
+            return;
+
+        // the coarser samples land on the even texels
+        for (int j = y0 + (y0 & 1); j < y1; j+= 2)
+        for (int i = x0 + (x0 & 1); i < x1; i+= 2) {
+            const size_t fine = (size_t)i + (size_t)m_nextLevel.width * j;
+            const size_t coarse = (size_t)(i / 2) + (size_t)m_level.width * (j / 2);
+
+            m_nextLevel.heights[fine] = m_level.heights[coarse];
+            m_nextLevel.gradients[2 * fine    ] = 0.5f * m_level.gradients[2 * coarse    ];
+            m_nextLevel.gradients[2 * fine + 1] = 0.5f * m_level.gradients[2 * coarse + 1];
+        }
+
+        m_kernel(m_nextLevel, x0, y0, x1, y1, true);
+        reducer.reduce(m_nextLevel.heights.data(), m_nextLevel.width, x0, y0, x1, y1);
+    });
+
+    m_nextLevel.range = reducer.range();
+    if (m_finisher && !m_isCancelled.load())
+        m_finisher(m_nextLevel, m_generator);
+    m_isPassDone = true;
+}
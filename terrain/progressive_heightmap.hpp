@@ -0,0 +1,82 @@
+#ifndef PROGRESSIVE_HEIGHTMAP_HPP
+#define PROGRESSIVE_HEIGHTMAP_HPP
+
+#include "heightmap_generator.hpp"
+
+/*******************************************************************************
+ * ProgressiveHeightmap -- Coarse-to-fine heightmap generation in the background
+ *
+ * start() synchronously builds a coarse level of the map: one texel every
+ * stride texels of the full map, with the stride chosen so that the level
+ * is about BASE_SIZE texels wide. Each following pass runs on a background
+ * thread and halves the stride, which doubles the resolution. The samples
+ * of the previous level fall exactly on the texels of the new level with
+ * even coordinates, so they are copied and the kernel only evaluates the
+ * other three quarters. The owner calls poll() once per frame, and uploads
+ * level() each time it returns true; the last level has a stride of 1.
+ *
+ * Gradients are stored per level texel, so the copied ones are halved. The
+ * min/max of each level is reduced by the same pass, tile by tile.
+ *
+ * The optional finisher runs once a level is complete, on the thread that
+ * built it (the caller of start() for the coarsest level), and prepares
+ * what the owner needs from the level, e.g. its textures, so the owner
+ * only uploads them. The next pass only starts on the poll() after a level
+ * is published: until then, the owner may read what the finisher wrote.
+ *
+ * Usage:
+ *      progressive.start(w, h, kernel, finisher);     upload(prepared);
+ *      each frame: if (progressive.poll()) upload(prepared);   // then keep polling
+ *
+ */
+class ProgressiveHeightmap {
+public:
+    enum {BASE_SIZE = 128};
+    struct Level {
+        int width, height;
+        int stride;                     // in texels of the full map
+        std::vector<float> heights;     // row major
+        std::vector<float> gradients;   // (dh/di, dh/dj) per texel
+        HeightRange range;              // of heights, reduced with the pass
+    };
+    // fills the texels of level in [x0, x1) x [y0, y1); if skipEven is set,
+    // the texels whose coordinates are both even are already filled
+    typedef std::function<void(Level &level, int x0, int y0, int x1, int y1,
+                               bool skipEven)> LevelKernel;
+    // prepares the owner's data of a complete level; generator is the one
+    // that built it, idle while the finisher runs
+    typedef std::function<void(const Level &level, HeightmapGenerator &generator)> LevelFinisher;
+
+    explicit ProgressiveHeightmap(ThreadPool &pool);
+    ~ProgressiveHeightmap() { cancel(); }
+
+    // cancels any pass in flight and builds (and finishes) the coarsest level
+    void start(int width, int height, const LevelKernel &kernel,
+               const LevelFinisher &finisher = LevelFinisher());
+    // returns true when a finer level has been published; otherwise starts
+    // the next pass if none is running
+    bool poll();
+    // stops refining; level() keeps the last published level
+    void cancel();
+
+    const Level &level() const { return m_level; }
+    bool isRefining() const { return m_thread.joinable() || m_hasNextPass; }
+    float progress() const { return m_generator.progress(); }
+
+private:
+    void launch();
+    void refine();
+
+    HeightmapGenerator m_generator;
+    LevelKernel m_kernel;
+    LevelFinisher m_finisher;
+    Level m_level;      // published
+    Level m_nextLevel;  // being refined
+    std::thread m_thread;
+    std::atomic<bool> m_isCancelled;
+    std::atomic<bool> m_isPassDone;
+    bool m_hasNextPass; // the next poll() starts a pass
+    int m_width, m_height;
+};
+
+#endif
@@ -0,0 +1,159 @@
+// Heightmap noise with the same bits on the CPU and the GPU: this file and
+// noise_spec.cpp implement the same definition (see noise_spec.hpp), and
+// any change must be made in both. Every float variable is precise, so the
+// compiler neither fuses nor reorders the operations, nothing is divided,
+// and the values that could become denormal are flushed explicitly.
+
+const float NOISE_SPEC_F2 = 0.366025418;              // (sqrt(3) - 1) / 2
+const float NOISE_SPEC_G2 = 0.211324871;              // (3 - sqrt(3)) / 6
+const float NOISE_SPEC_G2_MINUS_1 = -0.788675129;     // G2 - 1
+const float NOISE_SPEC_TWO_G2_MINUS_1 = -0.577350259; // 2 * G2 - 1
+const float NOISE_SPEC_FALLOFF_MIN = 9.53674316e-07;  // 2^-20
+const float NOISE_SPEC_FLUSH_MIN = 7.88860905e-31;    // 2^-100
+const float NOISE_SPEC_SQRT2 = 1.41421354;
+
+// log2(1 + u) = u * q(u) for u in [sqrt(1/2) - 1, sqrt(2) - 1]
+const float NOISE_SPEC_LOG2[9] = float[9](
+    1.44269502, -0.721347451, 0.480910748, -0.360693276, 0.287903249,
+    -0.239169881, 0.216078222, -0.205861881, 0.123109683
+);
+// 2^f for f in [0, 1]
+const float NOISE_SPEC_EXP2[7] = float[7](
+    1.0, 0.693146944, 0.240230456, 0.0554806292, 0.00968418643,
+    0.00123913318, 0.000218657849
+);
+
+float noiseSpecFlush(precise float x)
+{
+    return (x > NOISE_SPEC_FLUSH_MIN || x < -NOISE_SPEC_FLUSH_MIN) ? x : 0.0;
+}
+
+// same as FASTFLOOR
+int noiseSpecFloor(precise float x)
+{
+    return x > 0.0 ? int(x) : int(x) - 1;
+}
+
+// Simplex::details::IntegerHash
+int noiseSpecHash(uint seed, int i, int j)
+{
+    uint h = seed * 0x9e3779b9u ^ (uint(i) * 0x8da6b343u ^ uint(j) * 0xd8163841u);
+
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return int(h & 0xffu);
+}
+
+// Simplex::grad, 8 directions
+float noiseSpecGrad(int hash, precise float x, precise float y)
+{
+    int h = hash & 7;
+    precise float u = h < 4 ? x : y;
+    precise float v = (h < 4 ? y : x) * 2.0;
+
+    u = (h & 1) != 0 ? -u : u;
+    v = (h & 2) != 0 ? -v : v;
+    precise float g = u + v;
+    return g;
+}
+
+// t^4 * grad(hash, x, y), with t = 0.5 - x^2 - y^2, if t > 2^-20
+float noiseSpecCorner(int hash, precise float x, precise float y)
+{
+    precise float t = 0.5 - x * x - y * y;
+
+    t = t > NOISE_SPEC_FALLOFF_MIN ? t : 0.0;
+    t = t * t;
+    t = t * t;
+    precise float n = t * noiseSpecGrad(hash, x, y);
+    return noiseSpecFlush(n);
+}
+
+float noiseSpecNoise(uint seed, precise float x, precise float y)
+{
+    // skew, find the cell and unskew its origin
+    precise float s = (x + y) * NOISE_SPEC_F2;
+    int i = noiseSpecFloor(x + s);
+    int j = noiseSpecFloor(y + s);
+    precise float t = float(i + j) * NOISE_SPEC_G2;
+    precise float x0 = x - (float(i) - t);
+    precise float y0 = y - (float(j) - t);
+
+    // middle corner: (1,0) in the lower triangle, (0,1) in the upper one
+    bool lower = x0 > y0;
+    precise float x1 = x0 + (lower ? NOISE_SPEC_G2_MINUS_1 : NOISE_SPEC_G2);
+    precise float y1 = y0 + (lower ? NOISE_SPEC_G2 : NOISE_SPEC_G2_MINUS_1);
+    precise float x2 = x0 + NOISE_SPEC_TWO_G2_MINUS_1;
+    precise float y2 = y0 + NOISE_SPEC_TWO_G2_MINUS_1;
+    int i1 = lower ? 1 : 0;
+
+    precise float n0 = noiseSpecCorner(noiseSpecHash(seed, i, j), x0, y0);
+    precise float n1 = noiseSpecCorner(noiseSpecHash(seed, i + i1, j + 1 - i1), x1, y1);
+    precise float n2 = noiseSpecCorner(noiseSpecHash(seed, i + 1, j + 1), x2, y2);
+    precise float n = 40.0 * ((n0 + n1) + n2);
+    return n;
+}
+
+// pow(x, e) = exp2(e * log2(x)) for x >= 0, with x = m * 2^k, m in
+// [sqrt(1/2), sqrt(2)), and e * log2(x) = n + f, f in [0, 1]
+float noiseSpecPow(precise float x, precise float e)
+{
+    if (!(x > NOISE_SPEC_FLUSH_MIN))
+        return 0.0;
+
+    uint bits = floatBitsToUint(x);
+    int k = int(bits >> 23) - 127;
+    precise float m = uintBitsToFloat((bits & 0x7fffffu) | 0x3f800000u);
+
+    if (m > NOISE_SPEC_SQRT2) {
+        m = m * 0.5;
+        k = k + 1;
+    }
+
+    precise float u = m - 1.0;
+    precise float q = NOISE_SPEC_LOG2[8];
+
+    for (int i = 7; i >= 0; --i)
+        q = q * u + NOISE_SPEC_LOG2[i];
+
+    precise float y = e * (float(k) + u * q);
+    int n = noiseSpecFloor(y);
+    precise float f = y - float(n);
+    precise float p = NOISE_SPEC_EXP2[6];
+
+    for (int i = 5; i >= 0; --i)
+        p = p * f + NOISE_SPEC_EXP2[i];
+
+    if (n < -126)
+        return 0.0;
+    n = min(n, 127);
+    precise float h = uintBitsToFloat(uint(n + 127) << 23) * p;
+    return h;
+}
+
+// height of texel (x, y); frequency is 1 / wavelength
+float noiseSpecHeight(uint seed, int octaves, precise float frequency,
+                      precise float lacunarity, precise float gain,
+                      precise float elevation, int x, int y)
+{
+    precise float px = float(x) * frequency;
+    precise float py = float(y) * frequency;
+    precise float sum = 0.0;
+    precise float f = 1.0;
+    precise float a = 0.5;
+
+    for (int octave = 0; octave < octaves; ++octave) {
+        precise float qx = px * f;
+        precise float qy = py * f;
+        precise float term = a * noiseSpecNoise(seed, qx, qy);
+
+        sum = noiseSpecFlush(sum + noiseSpecFlush(term));
+        f = f * lacunarity;
+        a = noiseSpecFlush(a * gain);
+    }
+
+    return noiseSpecPow(abs(sum), elevation);
+}
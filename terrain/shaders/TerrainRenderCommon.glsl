@@ -34,6 +34,14 @@ uniform float u_NoiseH1;
 uniform float u_NoiseH2;
 uniform float u_NoiseH3;
 
+#if FLAG_SPLAT
+// fBm of the colour blends baked over the displacement map (SplatMap):
+// channel k is ffbm(worldPos / u_NoiseHk), band-limited to the texels; the
+// scales under u_SplatMinScale are not baked and keep the ffbm per fragment
+layout(binding = TEXTURE_BINDING_SPLAT) uniform sampler2D u_SplatSampler;
+uniform float u_SplatMinScale;
+#endif
+
 // Não usa, mas seria para definir se as derivadas analíticas das normais serão utilizadas em booleano
 uniform int u_DerivativeNormals;
 uniform int u_ApplyTextureNormals;
@@ -49,6 +57,193 @@ uniform float u_DmapFactor;
 uniform float u_MinLodVariance;
 #endif
 
+#if FLAG_STREAMING
+/*******************************************************************************
+ * Streamed Terrain -- Camera-centred heightmap tiles (see TileStreamer)
+ *
+ * The LEB square covers u_StreamCamera.z texels of level 0. Level L has a
+ * window of STREAM_RING_SIZE^2 tiles whose first texel, relative to the
+ * corner of the square and in texels of level L, is u_StreamLevels[L].xy.
+ * The page table gives the layer of u_StreamHeightSampler holding each tile
+ * of the windows, or -1 while it is being generated. A tile stores
+ * STREAM_TILE_SIZE + 1 texels per side, so it is filtered on its own.
+ */
+layout(std140, binding = BUFFER_BINDING_TERRAIN_STREAMING)
+uniform StreamingVariables {
+    vec4 u_StreamLevels[STREAM_LEVEL_COUNT];
+    vec4 u_StreamCamera;    // xy: camera, z: texels per unit, w: height / width
+};
+layout(binding = TEXTURE_BINDING_STREAM_HEIGHTS) uniform sampler2DArray u_StreamHeightSampler;
+layout(binding = TEXTURE_BINDING_STREAM_PAGES) uniform isampler2DArray u_StreamPageSampler;
+
+bool StreamedHeightAtLevel(int level, vec2 texel0, out float height)
+{
+    vec2 texel = texel0 * exp2(-float(level)) - u_StreamLevels[level].xy;
+    ivec2 tile = ivec2(floor(texel / float(STREAM_TILE_SIZE)));
+
+    if (any(lessThan(tile, ivec2(0))) || any(greaterThanEqual(tile, ivec2(STREAM_RING_SIZE))))
+        return false;
+
+    int slot = texelFetch(u_StreamPageSampler, ivec3(tile, level), 0).r;
+
+    if (slot < 0)
+        return false;
+
+    vec2 uv = (texel - vec2(tile * STREAM_TILE_SIZE) + 0.5) / float(STREAM_TILE_SIZE + 1);
+
+    height = textureLod(u_StreamHeightSampler, vec3(uv, float(slot)), 0.0).r;
+    return true;
+}
+
+// the height of the finest resident level from level up
+float StreamedHeightFromLevel(int level, vec2 texel0)
+{
+    float height = 0.0;
+
+    for (int i = level; i < STREAM_LEVEL_COUNT; ++i)
+        if (StreamedHeightAtLevel(i, texel0, height))
+            break;
+
+    return height;
+}
+
+// the finest level whose window surrounds texel0 by half a tile; blend is
+// the weight of the next level, which rises over the outer quarter
+int StreamedLevel(vec2 texel0, out float blend)
+{
+    vec2 d = abs(texel0 - u_StreamCamera.xy);
+    float radius = max(max(d.x, d.y), 1.0) / float((STREAM_RING_SIZE / 2 - 1) * STREAM_TILE_SIZE);
+    int level = clamp(int(ceil(log2(radius))), 0, STREAM_LEVEL_COUNT - 1);
+
+    blend = level < STREAM_LEVEL_COUNT - 1 ? smoothstep(0.75, 1.0, radius * exp2(-float(level))) : 0.0;
+
+    return level;
+}
+
+float StreamedHeight(vec2 texCoord)
+{
+    vec2 texel0 = texCoord * u_StreamCamera.z;
+    float blend;
+    int level = StreamedLevel(texel0, blend);
+    float height = StreamedHeightFromLevel(level, texel0);
+
+    if (blend > 0.0)
+        height = mix(height, StreamedHeightFromLevel(level + 1, texel0), blend);
+
+    return height;
+}
+
+// central differences one texel of the level apart
+vec3 StreamedNormal(vec2 texCoord)
+{
+    float blend;
+    int level = StreamedLevel(texCoord * u_StreamCamera.z, blend);
+    float filterSize = exp2(float(level)) / u_StreamCamera.z;
+    float sx = StreamedHeight(texCoord + vec2(filterSize, 0.0))
+             - StreamedHeight(texCoord - vec2(filterSize, 0.0));
+    float sy = StreamedHeight(texCoord + vec2(0.0, filterSize))
+             - StreamedHeight(texCoord - vec2(0.0, filterSize));
+    float slopeFactor = u_StreamCamera.w * u_DmapFactor * 0.5 / filterSize;
+
+    return normalize(vec3(slopeFactor * vec2(-sx, -sy), 1.0));
+}
+#endif
+
+#if FLAG_CLIPMAP
+/*******************************************************************************
+ * Height Clipmap -- Nested camera-centred heightmap levels (see HeightClipmap)
+ *
+ * Level L has a window of CLIPMAP_SIZE^2 texels whose first texel, in texels
+ * of level L, is u_ClipmapLevels[L].xy; a texture unit spans
+ * u_ClipmapScale.x texels of level 0. Texel t of a level is stored at
+ * t mod CLIPMAP_SIZE of its layer, so the sampler repeats. Outside the
+ * windows, the heights come from the displacement map.
+ */
+layout(std140, binding = BUFFER_BINDING_TERRAIN_CLIPMAP)
+uniform ClipmapVariables {
+    vec4 u_ClipmapLevels[CLIPMAP_LEVEL_COUNT];  // xy: first texel, z: 1 once generated
+    vec4 u_ClipmapScale;    // x: texels of level 0 per unit, y: level of depth 0
+};
+layout(binding = TEXTURE_BINDING_CLIPMAP) uniform sampler2DArray u_ClipmapSampler;
+
+// the texel of level under texCoord, exact on the texels of the level
+vec2 ClipmapTexel(int level, vec2 texCoord)
+{
+    return texCoord * ldexp(u_ClipmapScale.x, -level);
+}
+
+bool ClipmapContains(int level, vec2 texel)
+{
+    vec2 t = texel - u_ClipmapLevels[level].xy;
+
+    return u_ClipmapLevels[level].z > 0.0
+        && all(greaterThanEqual(t, vec2(0.0)))
+        && all(lessThanEqual(t, vec2(CLIPMAP_SIZE - 1)));
+}
+
+float ClipmapSample(int level, vec2 texel)
+{
+    vec2 wrapped = texel - float(CLIPMAP_SIZE) * floor(texel / float(CLIPMAP_SIZE));
+    vec2 uv = (wrapped + 0.5) / float(CLIPMAP_SIZE);
+
+    return textureLod(u_ClipmapSampler, vec3(uv, float(level)), 0.0).r;
+}
+
+// the height of the first level from level up whose window holds texCoord
+float ClipmapHeightFromLevel(int level, vec2 texCoord)
+{
+    for (int i = level; i < CLIPMAP_LEVEL_COUNT; ++i) {
+        vec2 texel = ClipmapTexel(i, texCoord);
+
+        if (ClipmapContains(i, texel))
+            return ClipmapSample(i, texel);
+    }
+
+    return textureLod(u_DmapSampler, texCoord, 0.0).r;
+}
+
+// The vertices of a node of the given depth sit on a grid of 2^-floor(depth/2)
+// units, so they are texels of every level up to u_ClipmapScale.y -
+// floor(depth/2). Sampling the coarsest of them reads a texel exactly, and
+// the finer levels hold the same value there: two nodes that share a vertex
+// agree on its height whatever their depths, and the mesh has no cracks.
+float ClipmapHeight(vec2 texCoord, int depth)
+{
+    int level = clamp(int(u_ClipmapScale.y) - depth / 2, 0, CLIPMAP_LEVEL_COUNT - 1);
+
+    return ClipmapHeightFromLevel(level, texCoord);
+}
+
+// the finest height at texCoord, for the vertices below the nodes
+float ClipmapHeight(vec2 texCoord)
+{
+    return ClipmapHeightFromLevel(0, texCoord);
+}
+
+// central differences one texel of the finest level holding texCoord apart,
+// with the slope per texture unit scaled by slopeScale as in the callers'
+// own normals; returns false outside the windows
+bool ClipmapNormal(vec2 texCoord, float slopeScale, out vec3 normal)
+{
+    int level = 0;
+
+    while (level < CLIPMAP_LEVEL_COUNT && !ClipmapContains(level, ClipmapTexel(level, texCoord)))
+        ++level;
+    if (level == CLIPMAP_LEVEL_COUNT)
+        return false;
+
+    float filterSize = ldexp(1.0, level) / u_ClipmapScale.x;
+    float sx = ClipmapHeightFromLevel(level, texCoord + vec2(filterSize, 0.0))
+             - ClipmapHeightFromLevel(level, texCoord - vec2(filterSize, 0.0));
+    float sy = ClipmapHeightFromLevel(level, texCoord + vec2(0.0, filterSize))
+             - ClipmapHeightFromLevel(level, texCoord - vec2(0.0, filterSize));
+
+    normal = normalize(vec3(slopeScale * u_DmapFactor * 0.5 / filterSize * vec2(-sx, -sy), 1.0));
+
+    return true;
+}
+#endif
+
 /*******************************************************************************
  * DecodeTriangleVertices -- Decodes the triangle vertices in local space
  *
@@ -65,9 +260,19 @@ vec4[3] DecodeTriangleVertices(in const cbt_Node node)
 
 #if FLAG_DISPLACE
 
+#if FLAG_STREAMING
+    p1.z = u_DmapFactor * StreamedHeight(p1.xy);
+    p2.z = u_DmapFactor * StreamedHeight(p2.xy);
+    p3.z = u_DmapFactor * StreamedHeight(p3.xy);
+#elif FLAG_CLIPMAP
+    p1.z = u_DmapFactor * ClipmapHeight(p1.xy, node.depth);
+    p2.z = u_DmapFactor * ClipmapHeight(p2.xy, node.depth);
+    p3.z = u_DmapFactor * ClipmapHeight(p3.xy, node.depth);
+#else
     p1.z = u_DmapFactor * texture(u_DmapSampler, p1.xy).r;
     p2.z = u_DmapFactor * texture(u_DmapSampler, p2.xy).r;
     p3.z = u_DmapFactor * texture(u_DmapSampler, p3.xy).r;    
+#endif
 
 #endif
 
@@ -203,6 +408,10 @@ float TriangleLevelOfDetail(in const vec4[3] patchVertices)
  */
 bool DisplacementVarianceTest(in const vec4[3] patchVertices)
 {
+#if FLAG_STREAMING
+    // the streamed tiles have no (h, h^2) mipmaps
+    return true;
+#endif
 #define P0 patchVertices[0].xy
 #define P1 patchVertices[1].xy
 #define P2 patchVertices[2].xy
@@ -719,7 +928,11 @@ VertexAttribute TessellateTriangle(
     vec2 texCoord = BarycentricInterpolation(texCoords, tessCoord);
     vec4 position = vec4(texCoord, 0, 1);
 
-#if FLAG_DISPLACE
+#if FLAG_STREAMING
+    position.z = u_DmapFactor * StreamedHeight(texCoord);
+#elif FLAG_CLIPMAP
+    position.z = u_DmapFactor * ClipmapHeight(texCoord);
+#elif FLAG_DISPLACE
     position.z = u_DmapFactor * textureLod(u_DmapSampler, texCoord, 0.0).r;
     
 #endif
@@ -885,14 +1098,34 @@ vec4 fbmd(vec2 x )
 	return vec4( aa, normalize( vec3(-d.x,-d.y,1.0) ) );
 }
 
+// inverse of the octahedral projection of NormalMap (normal_map.hpp):
+// p in [-1, 1]^2, folded onto the outer triangles when n.z < 0
+vec3 DecodeOctahedralNormal(vec2 p)
+{
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+
+    return normalize(n);
+}
+
 vec3 GetNormalFromMap(vec2 texCoord) {
-    vec3 normalMap = texture(u_SmapSampler, texCoord).rgb;
-    
-    // Converter de volta para o espaço [-1,1]
-    normalMap = normalMap/0.5 +0.5f;
+#if FLAG_STREAMING
+    // the normal map belongs to the fixed heightmap
+    return StreamedNormal(texCoord);
+#elif FLAG_CLIPMAP
+    vec3 clipmapNormal;
+
+    if (ClipmapNormal(texCoord, 1.0, clipmapNormal))
+        return clipmapNormal;
+#endif
+    // Converter de volta para o espaço [-1,1] e desfazer a projeção octaédrica
+    vec3 normalMap = DecodeOctahedralNormal(texture(u_SmapSampler, texCoord).rg * 2.0 - 1.0);
     
-    // Garantir que a normal esteja normalizada
-    return normalize(normalMap);
+    // A normal foi gerada para u_DmapFactor = 1: reaplica a escala atual
+    // da altura e garante que a normal esteja normalizada
+    return normalize(vec3(normalMap.xy * u_DmapFactor, normalMap.z));
 }
 /*******************************************************************************
  * ShadeFragment -- Fragement shading routine
@@ -921,6 +1154,9 @@ vec4 ShadeFragment(vec2 texCoord, vec3 worldPos, vec3 vNormal)
     
     // compute the slope from the dmap directly
     else{
+#if FLAG_STREAMING
+        n = StreamedNormal(texCoord);
+#else
         float filterSize = 1.0f / float(textureSize(u_DmapSampler, 0).x);
         float sx0 = textureLod(u_DmapSampler, texCoord - vec2(filterSize, 0.0), 0.0).r;
         float sx1 = textureLod(u_DmapSampler, texCoord + vec2(filterSize, 0.0), 0.0).r;
@@ -930,6 +1166,13 @@ vec4 ShadeFragment(vec2 texCoord, vec3 worldPos, vec3 vNormal)
         float sy = sy1 - sy0;
 
         n = normalize(vec3(u_DmapFactor * 0.03 / filterSize * 0.5f * vec2(-sx, -sy), 1));
+#if FLAG_CLIPMAP
+        vec3 clipmapNormal;
+
+        if (ClipmapNormal(texCoord, 0.03, clipmapNormal))
+            n = clipmapNormal;
+#endif
+#endif
     }
 #else
     n = vec3(0, 0, 1);
@@ -960,10 +1203,19 @@ vec4 ShadeFragment(vec2 texCoord, vec3 worldPos, vec3 vNormal)
     vec3 peakColor = height0;
 
     // Uso do fBm para atribuir cor e definição de mistura de cores para suavizar transições entre alturas
+#if FLAG_SPLAT
+    // pré-calculado na CPU: uma leitura no lugar de quatro fBm
+    vec4 splat = texture(u_SplatSampler, texCoord);
+    float noisePeak = u_NoiseH3 < u_SplatMinScale ? ffbm(worldPos * 1.f / u_NoiseH3) : splat.w;
+    float noiseRock = u_NoiseH2 < u_SplatMinScale ? ffbm(worldPos * 1.f / u_NoiseH2) : splat.z;
+    float noiseSand = u_NoiseH1 < u_SplatMinScale ? ffbm(worldPos * 1.f / u_NoiseH1) : splat.y;
+    float noiseWater = u_NoiseH0 < u_SplatMinScale ? ffbm(worldPos * 1.f / u_NoiseH0) : splat.x;
+#else
     float noisePeak = ffbm(worldPos * 1.f / u_NoiseH3);
     float noiseRock = ffbm(worldPos * 1.f / u_NoiseH2);
     float noiseSand = ffbm(worldPos * 1.f / u_NoiseH1);
     float noiseWater = ffbm(worldPos * 1.f / u_NoiseH0);
+#endif
     vec3 snowColor = mix(height0, height1, noisePeak);
     vec3 rockColor = mix(height1, height2, noiseRock);
     vec3 sandColor = mix(height2, height3, noiseSand);
@@ -30,6 +30,10 @@
 #include <random>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 #include <glm/geometric.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -117,6 +121,71 @@ inline float fBm( const glm::vec2 &v, uint8_t octaves = 4, float lacunarity = 2.
 inline float fBm( const glm::vec3 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f );
 //! Returns a 4D simplex noise fractal brownian motion sum
 inline float fBm( const glm::vec4 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f );
+
+//! Batch 2D simplex noise: out[i] = noise( vec2( x[i], y[i] ) ), 16/8 texels at a time with AVX-512/AVX2
+inline void noise( const float *x, const float *y, float *out, size_t count );
+//! Batch 3D simplex noise: out[i] = noise( vec3( x[i], y[i], z[i] ) )
+inline void noise( const float *x, const float *y, const float *z, float *out, size_t count );
+//! Same as above, and also writes the exact partial derivatives of each noise value
+inline void noise( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count );
+//! Batch 2D fractal brownian motion sum, vectorized across the positions with the octave loop inside
+inline void fBm( const float *x, const float *y, float *out, size_t count, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f );
+//! Batch 3D fractal brownian motion sum, vectorized across the positions with the octave loop inside
+inline void fBm( const float *x, const float *y, const float *z, float *out, size_t count, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f );
+//! Same as above, and also writes the exact partial derivatives of each sum. Unlike dfBm, these include the frequency of each octave and come from the same gradients as noise()
+inline void fBm( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f );
+//! Returns the number of positions processed at once by the batch functions (16, 8 or 1)
+inline int batchWidth();
+
+//! Declarative blend of fractal sums that share their octaves. Each octave evaluates the 3D simplex
+//! lattice once, and every layer takes the channel it needs from it (value, ridged value, derivatives,
+//! gradients rotated around y) with its own gain; the result is the weighted sum of the layers.
+//! Usage:
+//!	NoiseRecipe recipe( 8, 2.0f );
+//!	recipe.addIq( 0.5f ).addRidged( 1.0f, 0.6f ).addFlow( 0.25f, 0.5f, 0.8f );
+//!	context.fBm( recipe, x, y, z, out, count );
+struct NoiseRecipe {
+	enum { MAX_LAYERS = 4 };
+	enum LayerType {
+		FBM,	//!< amplitude * noise, as fBm
+		RIDGED,	//!< ridged multi-fractal with param as the ridge offset, as ridgedMF
+		IQ,		//!< noise divided by 1 + |sum of the gradients of the octaves so far|^2. Close to iqfBm, not equal: iqfBm accumulates d.y into both dx and dy and damps with the d.z of the current octave only
+		FLOW	//!< noise with the lattice gradients rotated by param radians around y. Not flowNoise, which rotates its own grad3u/grad3v pairs
+	};
+	struct Layer {
+		LayerType	type;
+		float		weight;
+		float		gain;
+		float		param;
+	};
+	
+	NoiseRecipe( uint8_t octaves = 4, float lacunarity = 2.0f )
+		: octaves( octaves ), lacunarity( lacunarity ), layerCount( 0 ) {}
+	
+	NoiseRecipe &addFbm( float weight, float gain = 0.5f ) { return add( FBM, weight, gain, 0.0f ); }
+	NoiseRecipe &addRidged( float weight, float gain = 0.5f, float ridgeOffset = 1.0f ) { return add( RIDGED, weight, gain, ridgeOffset ); }
+	NoiseRecipe &addIq( float weight, float gain = 0.5f ) { return add( IQ, weight, gain, 0.0f ); }
+	NoiseRecipe &addFlow( float weight, float gain, float angle ) { return add( FLOW, weight, gain, angle ); }
+	//! Layers past MAX_LAYERS are ignored
+	NoiseRecipe &add( LayerType type, float weight, float gain, float param )
+	{
+		if( layerCount < MAX_LAYERS ) {
+			Layer layer = { type, weight, gain, param };
+			layers[layerCount++] = layer;
+		}
+		return *this;
+	}
+	
+	uint8_t	octaves;
+	float	lacunarity;
+	int		layerCount;
+	Layer	layers[MAX_LAYERS];
+};
+
+//! Batch 3D blend of the layers of a recipe: out[i] = sum of weight * layer at ( x[i], y[i], z[i] ), with
+//! one lattice evaluation per octave whatever the number of layers. If layers is not NULL, the sum of
+//! layer k (before its weight) is also written to layers[k] when that pointer is not NULL
+inline void fBm( const NoiseRecipe &recipe, const float *x, const float *y, const float *z, float *out, size_t count, float *const *layers = NULL );
 	
 //! Returns a 2D simplex cellular/worley noise fractal brownian motion sum
 inline float worleyfBm( const glm::vec2 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f );
@@ -153,7 +222,8 @@ inline float iqfBm( const glm::vec3 &v, uint8_t octaves = 4, float lacunarity =
 //! Returns the 2D simplex noise fractal brownian motion sum variation by Iñigo Quilez that use a mat2 to transform each octave
 inline float iqMatfBm( const glm::vec2 &v, uint8_t octaves = 4, const glm::mat2 &mat = glm::mat2( 1.6, -1.2, 1.2, 1.6 ), float gain = 0.5f );
 
-//! Seeds the permutation table with new random values
+//! Seeds the permutation table of the context shared by the free functions with new random values.
+//! Not thread-safe: use one NoiseContext per seed to generate concurrently
 inline void seed( uint32_t s );
 	
 // implementation
@@ -177,6 +247,11 @@ namespace details {
 	 * This array is accessed a *lot* by the noise functions.
 	 * A vector-valued noise over 3D accesses it 96 times, and a
 	 * float-valued 4D noise 64 times. We want this to fit in the cache!
+	 *
+	 * The batch functions fetch it with 32-bit gathers, which read three
+	 * bytes past the indexed one; the trailing zeroes keep those in bounds.
+	 *
+	 * Each NoiseContext works on its own copy, so this one is never modified.
 	 */
 #ifdef SIMPLEX_INTEGER_LUTS
 	typedef uint8_t LutType;
@@ -184,7 +259,7 @@ namespace details {
 	typedef unsigned char LutType;
 #endif
 	
-	static LutType perm[512] = {151,160,137,91,90,15,
+	static const LutType perm[512 + 4] = {151,160,137,91,90,15,
 		131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
 		190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
 		88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
@@ -406,6 +481,112 @@ namespace details {
 	}
 }
 
+//! Simplex noise generator owning its own permutation table. The free functions
+//! above all go through a default context; create one context per seed to
+//! generate several differently seeded terrains, or tiles, at the same time.
+//! The noise functions never modify the context, so a single instance may be
+//! shared by any number of threads as long as nobody reseeds it meanwhile.
+class NoiseContext {
+public:
+	//! How the batch functions (noise and fBm on float arrays) hash the lattice corners. The other
+	//! functions always use the permutation table
+	enum Basis {
+		PERMUTATION,	//!< seeded permutation table, same values as the scalar functions
+		INTEGER_HASH	//!< seeded integer hash of the corners: no table lookups, and no period
+	};
+	
+	//! Uses the default permutation table
+	inline NoiseContext();
+	//! Uses the permutation table that seed( s ) would produce, or the integer hash seeded with s
+	inline explicit NoiseContext( uint32_t s, Basis basis = PERMUTATION );
+	
+	//! Same as the free functions of the same name
+	inline float noise( float x ) const;
+	inline float noise( const glm::vec2 &v ) const;
+	inline float noise( const glm::vec3 &v ) const;
+	inline float noise( const glm::vec4 &v ) const;
+	
+	inline float ridgedNoise( float x ) const;
+	inline float ridgedNoise( const glm::vec2 &v ) const;
+	inline float ridgedNoise( const glm::vec3 &v ) const;
+	inline float ridgedNoise( const glm::vec4 &v ) const;
+	
+	inline glm::vec2 dnoise( float x ) const;
+	inline glm::vec3 dnoise( const glm::vec2 &v ) const;
+	inline glm::vec4 dnoise( const glm::vec3 &v ) const;
+	inline vec5	dnoise( const glm::vec4 &v ) const;
+	
+	inline float worleyNoise( const glm::vec2 &v ) const;
+	inline float worleyNoise( const glm::vec3 &v ) const;
+	inline float worleyNoise( const glm::vec2 &v, float falloff ) const;
+	inline float worleyNoise( const glm::vec3 &v, float falloff ) const;
+	
+	inline float flowNoise( const glm::vec2 &v, float angle ) const;
+	inline float flowNoise( const glm::vec3 &v, float angle ) const;
+	
+	inline glm::vec3 dFlowNoise( const glm::vec2 &v, float angle ) const;
+	inline glm::vec4 dFlowNoise( const glm::vec3 &v, float angle ) const;
+	
+	inline glm::vec2 curlNoise( const glm::vec2 &v ) const;
+	inline glm::vec2 curlNoise( const glm::vec2 &v, float t ) const;
+	inline glm::vec2 curlNoise( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain ) const;
+	inline glm::vec3 curlNoise( const glm::vec3 &v ) const;
+	inline glm::vec3 curlNoise( const glm::vec3 &v, float t ) const;
+	inline glm::vec3 curlNoise( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain ) const;
+	
+	inline glm::vec2 curl( const glm::vec2 &v, const std::function<float(const glm::vec2&)> &potential, float delta = 1e-4f ) const;
+	inline glm::vec3 curl( const glm::vec3 &v, const std::function<glm::vec3(const glm::vec3&)> &potential, float delta = 1e-4f ) const;
+	
+	inline float fBm( float x, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float fBm( const glm::vec2 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float fBm( const glm::vec3 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float fBm( const glm::vec4 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	
+	inline void noise( const float *x, const float *y, float *out, size_t count ) const;
+	inline void noise( const float *x, const float *y, const float *z, float *out, size_t count ) const;
+	inline void noise( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count ) const;
+	inline void fBm( const float *x, const float *y, float *out, size_t count, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline void fBm( const float *x, const float *y, const float *z, float *out, size_t count, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline void fBm( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline void fBm( const NoiseRecipe &recipe, const float *x, const float *y, const float *z, float *out, size_t count, float *const *layers = NULL ) const;
+	inline static int batchWidth();
+	
+	inline float worleyfBm( const glm::vec2 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float worleyfBm( const glm::vec3 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float worleyfBm( const glm::vec2 &v, float falloff, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float worleyfBm( const glm::vec3 &v, float falloff, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	
+	inline glm::vec2 dfBm( float x, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline glm::vec3 dfBm( const glm::vec2 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline glm::vec4 dfBm( const glm::vec3 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline vec5	dfBm( const glm::vec4 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	
+	inline float ridgedMF( float x, float ridgeOffset = 1.0f, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float ridgedMF( const glm::vec2 &v, float ridgeOffset = 1.0f, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float ridgedMF( const glm::vec3 &v, float ridgeOffset = 1.0f, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float ridgedMF( const glm::vec4 &v, float ridgeOffset = 1.0f, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	
+	inline float iqfBm( const glm::vec2 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float iqfBm( const glm::vec3 &v, uint8_t octaves = 4, float lacunarity = 2.0f, float gain = 0.5f ) const;
+	inline float iqMatfBm( const glm::vec2 &v, uint8_t octaves = 4, const glm::mat2 &mat = glm::mat2( 1.6, -1.2, 1.2, 1.6 ), float gain = 0.5f ) const;
+	
+	//! Reshuffles the permutation table from s and reseeds the integer hash; deterministic for a given seed
+	inline void seed( uint32_t s );
+	
+private:
+	template<typename T> float fBm_t( const T &input, uint8_t octaves, float lacunarity, float gain ) const;
+	template<typename T> float worleyfBm_t( const T &input, uint8_t octaves, float lacunarity, float gain ) const;
+	template<typename T> float worleyfBm_t( const T &input, float falloff, uint8_t octaves, float lacunarity, float gain ) const;
+	template<typename T> float ridgedNoise_t( const T &input ) const;
+	template<typename T> float ridgedMF_t( const T &input, float ridgeOffset, uint8_t octaves, float lacunarity, float gain ) const;
+	inline void fBmBatch( int dim, const float *const coords[3], float *out, float *const *gradients,
+						  size_t count, uint8_t octaves, float lacunarity, float gain, float amplitude ) const;
+	
+	details::LutType m_perm[512 + 4];
+	Basis		m_basis;
+	uint32_t	m_seed;
+};
+
 /* Skewing factors for 2D simplex grid:
  * F2 = 0.5*(sqrt(3.0)-1.0)
  * G2 = (3.0-Math.sqrt(3.0))/6.0
@@ -422,7 +603,7 @@ namespace details {
 #define F4 0.309016994f // F4 = (Math.sqrt(5.0)-1.0)/4.0
 #define G4 0.138196601f // G4 = (5.0-Math.sqrt(5.0))/20.0
 
-float noise(float x)
+float NoiseContext::noise(float x) const
 {
 	
 	int i0 = FASTFLOOR(x);
@@ -435,12 +616,12 @@ float noise(float x)
 	float t0 = 1.0f - x0*x0;
 	//  if(t0 < 0.0f) t0 = 0.0f;
 	t0 *= t0;
-	n0 = t0 * t0 * details::grad(details::perm[i0 & 0xff], x0);
+	n0 = t0 * t0 * details::grad(m_perm[i0 & 0xff], x0);
 	
 	float t1 = 1.0f - x1*x1;
 	//  if(t1 < 0.0f) t1 = 0.0f;
 	t1 *= t1;
-	n1 = t1 * t1 * details::grad(details::perm[i1 & 0xff], x1);
+	n1 = t1 * t1 * details::grad(m_perm[i1 & 0xff], x1);
 	// The maximum value of this noise is 8*(3/4)^4 = 2.53125
 	// A factor of 0.395 would scale to fit exactly within [-1,1], but
 	// we want to match PRMan's 1D noise, so we scale it down some more.
@@ -449,7 +630,7 @@ float noise(float x)
 }
 
 // 2D simplex noise
-float noise( const glm::vec2 &v )
+float NoiseContext::noise( const glm::vec2 &v ) const
 {
 	float n0, n1, n2; // Noise contributions from the three corners
 	
@@ -481,7 +662,7 @@ float noise( const glm::vec2 &v )
 	float x2 = x0 - 1.0f + 2.0f * G2; // Offsets for last corner in (x,y) unskewed coords
 	float y2 = y0 - 1.0f + 2.0f * G2;
 	
-	// Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds
+	// Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	
@@ -490,21 +671,21 @@ float noise( const glm::vec2 &v )
 	if(t0 < 0.0f) n0 = 0.0f;
 	else {
 		t0 *= t0;
-		n0 = t0 * t0 * details::grad(details::perm[ii+details::perm[jj]], x0, y0);
+		n0 = t0 * t0 * details::grad(m_perm[ii+m_perm[jj]], x0, y0);
 	}
 	
 	float t1 = 0.5f - x1*x1-y1*y1;
 	if(t1 < 0.0f) n1 = 0.0f;
 	else {
 		t1 *= t1;
-		n1 = t1 * t1 * details::grad(details::perm[ii+i1+details::perm[jj+j1]], x1, y1);
+		n1 = t1 * t1 * details::grad(m_perm[ii+i1+m_perm[jj+j1]], x1, y1);
 	}
 	
 	float t2 = 0.5f - x2*x2-y2*y2;
 	if(t2 < 0.0f) n2 = 0.0f;
 	else {
 		t2 *= t2;
-		n2 = t2 * t2 * details::grad(details::perm[ii+1+details::perm[jj+1]], x2, y2);
+		n2 = t2 * t2 * details::grad(m_perm[ii+1+m_perm[jj+1]], x2, y2);
 	}
 	
 	// Add contributions from each corner to get the final noise value.
@@ -513,7 +694,7 @@ float noise( const glm::vec2 &v )
 }
 
 // 3D simplex noise
-float noise( const glm::vec3 &v )
+float NoiseContext::noise( const glm::vec3 &v ) const
 {
 	float n0, n1, n2, n3; // Noise contributions from the four corners
 	
@@ -567,7 +748,7 @@ float noise( const glm::vec3 &v )
 	float y3 = y0 - 1.0f + 3.0f*G3;
 	float z3 = z0 - 1.0f + 3.0f*G3;
 	
-	// Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds
+	// Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	int kk = k & 0xff;
@@ -577,28 +758,28 @@ float noise( const glm::vec3 &v )
 	if(t0 < 0.0f) n0 = 0.0f;
 	else {
 		t0 *= t0;
-		n0 = t0 * t0 * details::grad(details::perm[ii+details::perm[jj+details::perm[kk]]], x0, y0, z0);
+		n0 = t0 * t0 * details::grad(m_perm[ii+m_perm[jj+m_perm[kk]]], x0, y0, z0);
 	}
 	
 	float t1 = 0.6f - x1*x1 - y1*y1 - z1*z1;
 	if(t1 < 0.0f) n1 = 0.0f;
 	else {
 		t1 *= t1;
-		n1 = t1 * t1 * details::grad(details::perm[ii+i1+details::perm[jj+j1+details::perm[kk+k1]]], x1, y1, z1);
+		n1 = t1 * t1 * details::grad(m_perm[ii+i1+m_perm[jj+j1+m_perm[kk+k1]]], x1, y1, z1);
 	}
 	
 	float t2 = 0.6f - x2*x2 - y2*y2 - z2*z2;
 	if(t2 < 0.0f) n2 = 0.0f;
 	else {
 		t2 *= t2;
-		n2 = t2 * t2 * details::grad(details::perm[ii+i2+details::perm[jj+j2+details::perm[kk+k2]]], x2, y2, z2);
+		n2 = t2 * t2 * details::grad(m_perm[ii+i2+m_perm[jj+j2+m_perm[kk+k2]]], x2, y2, z2);
 	}
 	
 	float t3 = 0.6f - x3*x3 - y3*y3 - z3*z3;
 	if(t3<0.0f) n3 = 0.0f;
 	else {
 		t3 *= t3;
-		n3 = t3 * t3 * details::grad(details::perm[ii+1+details::perm[jj+1+details::perm[kk+1]]], x3, y3, z3);
+		n3 = t3 * t3 * details::grad(m_perm[ii+1+m_perm[jj+1+m_perm[kk+1]]], x3, y3, z3);
 	}
 	
 	// Add contributions from each corner to get the final noise value.
@@ -620,7 +801,7 @@ namespace details {
 }
 
 // 4D simplex noise
-float noise( const glm::vec4 &v )
+float NoiseContext::noise( const glm::vec4 &v ) const
 {
 	float n0, n1, n2, n3, n4; // Noise contributions from the five corners
 	
@@ -704,7 +885,7 @@ float noise( const glm::vec4 &v )
 	float z4 = z0 - 1.0f + 4.0f*G4;
 	float w4 = w0 - 1.0f + 4.0f*G4;
 	
-	// Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds
+	// Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	int kk = k & 0xff;
@@ -715,42 +896,42 @@ float noise( const glm::vec4 &v )
 	if(t0 < 0.0f) n0 = 0.0f;
 	else {
 		t0 *= t0;
-		n0 = t0 * t0 * details::grad(details::perm[ii+details::perm[jj+details::perm[kk+details::perm[ll]]]], x0, y0, z0, w0);
+		n0 = t0 * t0 * details::grad(m_perm[ii+m_perm[jj+m_perm[kk+m_perm[ll]]]], x0, y0, z0, w0);
 	}
 	
 	float t1 = 0.6f - x1*x1 - y1*y1 - z1*z1 - w1*w1;
 	if(t1 < 0.0f) n1 = 0.0f;
 	else {
 		t1 *= t1;
-		n1 = t1 * t1 * details::grad(details::perm[ii+i1+details::perm[jj+j1+details::perm[kk+k1+details::perm[ll+l1]]]], x1, y1, z1, w1);
+		n1 = t1 * t1 * details::grad(m_perm[ii+i1+m_perm[jj+j1+m_perm[kk+k1+m_perm[ll+l1]]]], x1, y1, z1, w1);
 	}
 	
 	float t2 = 0.6f - x2*x2 - y2*y2 - z2*z2 - w2*w2;
 	if(t2 < 0.0f) n2 = 0.0f;
 	else {
 		t2 *= t2;
-		n2 = t2 * t2 * details::grad(details::perm[ii+i2+details::perm[jj+j2+details::perm[kk+k2+details::perm[ll+l2]]]], x2, y2, z2, w2);
+		n2 = t2 * t2 * details::grad(m_perm[ii+i2+m_perm[jj+j2+m_perm[kk+k2+m_perm[ll+l2]]]], x2, y2, z2, w2);
 	}
 	
 	float t3 = 0.6f - x3*x3 - y3*y3 - z3*z3 - w3*w3;
 	if(t3 < 0.0f) n3 = 0.0f;
 	else {
 		t3 *= t3;
-		n3 = t3 * t3 * details::grad(details::perm[ii+i3+details::perm[jj+j3+details::perm[kk+k3+details::perm[ll+l3]]]], x3, y3, z3, w3);
+		n3 = t3 * t3 * details::grad(m_perm[ii+i3+m_perm[jj+j3+m_perm[kk+k3+m_perm[ll+l3]]]], x3, y3, z3, w3);
 	}
 	
 	float t4 = 0.6f - x4*x4 - y4*y4 - z4*z4 - w4*w4;
 	if(t4 < 0.0f) n4 = 0.0f;
 	else {
 		t4 *= t4;
-		n4 = t4 * t4 * details::grad(details::perm[ii+1+details::perm[jj+1+details::perm[kk+1+details::perm[ll+1]]]], x4, y4, z4, w4);
+		n4 = t4 * t4 * details::grad(m_perm[ii+1+m_perm[jj+1+m_perm[kk+1+m_perm[ll+1]]]], x4, y4, z4, w4);
 	}
 	
 	// Sum up and scale the result to cover the range [-1,1]
 	return 27.0f * (n0 + n1 + n2 + n3 + n4); // TODO: The scale factor is preliminary!
 }
 
-glm::vec2 dnoise( float x )
+glm::vec2 NoiseContext::dnoise( float x ) const
 {
 	int i0 = FASTFLOOR(x);
 	int i1 = i0 + 1;
@@ -766,7 +947,7 @@ glm::vec2 dnoise( float x )
 	//  if(t0 < 0.0f) t0 = 0.0f; // Never happens for 1D: x0<=1 always
 	t20 = t0 * t0;
 	t40 = t20 * t20;
-	details::grad1(details::perm[i0 & 0xff], &gx0);
+	details::grad1(m_perm[i0 & 0xff], &gx0);
 	n0 = t40 * gx0 * x0;
 	
 	float x21 = x1*x1;
@@ -774,7 +955,7 @@ glm::vec2 dnoise( float x )
 	//  if(t1 < 0.0f) t1 = 0.0f; // Never happens for 1D: |x1|<=1 always
 	t21 = t1 * t1;
 	t41 = t21 * t21;
-	details::grad1(details::perm[i1 & 0xff], &gx1);
+	details::grad1(m_perm[i1 & 0xff], &gx1);
 	n1 = t41 * gx1 * x1;
 	
 	/* Compute derivative according to:
@@ -797,7 +978,7 @@ glm::vec2 dnoise( float x )
 #endif
 }
 
-glm::vec3 dnoise( const glm::vec2 &v )
+glm::vec3 NoiseContext::dnoise( const glm::vec2 &v ) const
 {
 	float n0, n1, n2; // Noise contributions from the three corners
 	
@@ -829,7 +1010,7 @@ glm::vec3 dnoise( const glm::vec2 &v )
 	float x2 = x0 - 1.0f + 2.0f * G2; // Offsets for last corner in (x,y) unskewed coords
 	float y2 = y0 - 1.0f + 2.0f * G2;
 	
-	// Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds
+	// Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	
@@ -840,7 +1021,7 @@ glm::vec3 dnoise( const glm::vec2 &v )
 	float t20, t40;
 	if( t0 < 0.0f ) t40 = t20 = t0 = n0 = gx0 = gy0 = 0.0f; /* No influence */
 	else {
-		details::grad2( details::perm[ii + details::perm[jj]], &gx0, &gy0 );
+		details::grad2( m_perm[ii + m_perm[jj]], &gx0, &gy0 );
 		t20 = t0 * t0;
 		t40 = t20 * t20;
 		n0 = t40 * ( gx0 * x0 + gy0 * y0 );
@@ -850,7 +1031,7 @@ glm::vec3 dnoise( const glm::vec2 &v )
 	float t21, t41;
 	if( t1 < 0.0f ) t21 = t41 = t1 = n1 = gx1 = gy1 = 0.0f; /* No influence */
 	else {
-		details::grad2( details::perm[ii + i1 + details::perm[jj + j1]], &gx1, &gy1 );
+		details::grad2( m_perm[ii + i1 + m_perm[jj + j1]], &gx1, &gy1 );
 		t21 = t1 * t1;
 		t41 = t21 * t21;
 		n1 = t41 * ( gx1 * x1 + gy1 * y1 );
@@ -860,7 +1041,7 @@ glm::vec3 dnoise( const glm::vec2 &v )
 	float t22, t42;
 	if( t2 < 0.0f ) t42 = t22 = t2 = n2 = gx2 = gy2 = 0.0f; /* No influence */
 	else {
-		details::grad2( details::perm[ii + 1 + details::perm[jj + 1]], &gx2, &gy2 );
+		details::grad2( m_perm[ii + 1 + m_perm[jj + 1]], &gx2, &gy2 );
 		t22 = t2 * t2;
 		t42 = t22 * t22;
 		n2 = t42 * ( gx2 * x2 + gy2 * y2 );
@@ -902,7 +1083,7 @@ glm::vec3 dnoise( const glm::vec2 &v )
 }
 
 
-glm::vec4 dnoise( const glm::vec3 &v )
+glm::vec4 NoiseContext::dnoise( const glm::vec3 &v ) const
 {
 	float n0, n1, n2, n3; /* Noise contributions from the four simplex corners */
 	float noise;          /* Return value */
@@ -959,7 +1140,7 @@ glm::vec4 dnoise( const glm::vec3 &v )
 	float y3 = y0 - 1.0f + 3.0f * G3;
 	float z3 = z0 - 1.0f + 3.0f * G3;
 	
-	/* Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds */
+	/* Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds */
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	int kk = k & 0xff;
@@ -969,7 +1150,7 @@ glm::vec4 dnoise( const glm::vec3 &v )
 	float t20, t40;
 	if(t0 < 0.0f) n0 = t0 = t20 = t40 = gx0 = gy0 = gz0 = 0.0f;
 	else {
-		details::grad3( details::perm[ii + details::perm[jj + details::perm[kk]]], &gx0, &gy0, &gz0 );
+		details::grad3( m_perm[ii + m_perm[jj + m_perm[kk]]], &gx0, &gy0, &gz0 );
 		t20 = t0 * t0;
 		t40 = t20 * t20;
 		n0 = t40 * ( gx0 * x0 + gy0 * y0 + gz0 * z0 );
@@ -979,7 +1160,7 @@ glm::vec4 dnoise( const glm::vec3 &v )
 	float t21, t41;
 	if(t1 < 0.0f) n1 = t1 = t21 = t41 = gx1 = gy1 = gz1 = 0.0f;
 	else {
-		details::grad3( details::perm[ii + i1 + details::perm[jj + j1 + details::perm[kk + k1]]], &gx1, &gy1, &gz1 );
+		details::grad3( m_perm[ii + i1 + m_perm[jj + j1 + m_perm[kk + k1]]], &gx1, &gy1, &gz1 );
 		t21 = t1 * t1;
 		t41 = t21 * t21;
 		n1 = t41 * ( gx1 * x1 + gy1 * y1 + gz1 * z1 );
@@ -989,7 +1170,7 @@ glm::vec4 dnoise( const glm::vec3 &v )
 	float t22, t42;
 	if(t2 < 0.0f) n2 = t2 = t22 = t42 = gx2 = gy2 = gz2 = 0.0f;
 	else {
-		details::grad3( details::perm[ii + i2 + details::perm[jj + j2 + details::perm[kk + k2]]], &gx2, &gy2, &gz2 );
+		details::grad3( m_perm[ii + i2 + m_perm[jj + j2 + m_perm[kk + k2]]], &gx2, &gy2, &gz2 );
 		t22 = t2 * t2;
 		t42 = t22 * t22;
 		n2 = t42 * ( gx2 * x2 + gy2 * y2 + gz2 * z2 );
@@ -999,7 +1180,7 @@ glm::vec4 dnoise( const glm::vec3 &v )
 	float t23, t43;
 	if(t3 < 0.0f) n3 = t3 = t23 = t43 = gx3 = gy3 = gz3 = 0.0f;
 	else {
-		details::grad3( details::perm[ii + 1 + details::perm[jj + 1 + details::perm[kk + 1]]], &gx3, &gy3, &gz3 );
+		details::grad3( m_perm[ii + 1 + m_perm[jj + 1 + m_perm[kk + 1]]], &gx3, &gy3, &gz3 );
 		t23 = t3 * t3;
 		t43 = t23 * t23;
 		n3 = t43 * ( gx3 * x3 + gy3 * y3 + gz3 * z3 );
@@ -1058,7 +1239,7 @@ glm::vec4 dnoise( const glm::vec3 &v )
 	return glm::vec4( noise, dnoise_dx, dnoise_dy, dnoise_dz );
 }
 
-vec5 dnoise( const glm::vec4 &v )
+vec5 NoiseContext::dnoise( const glm::vec4 &v ) const
 {
 	float n0, n1, n2, n3, n4; // Noise contributions from the five corners
 	float noise; // Return value
@@ -1147,7 +1328,7 @@ vec5 dnoise( const glm::vec4 &v )
 	float z4 = z0 - 1.0f + 4.0f * G4;
 	float w4 = w0 - 1.0f + 4.0f * G4;
 	
-	// Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds
+	// Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	int kk = k & 0xff;
@@ -1159,7 +1340,7 @@ vec5 dnoise( const glm::vec4 &v )
 	else {
 		t20 = t0 * t0;
 		t40 = t20 * t20;
-		details::grad4(details::perm[ii+details::perm[jj+details::perm[kk+details::perm[ll]]]], &gx0, &gy0, &gz0, &gw0);
+		details::grad4(m_perm[ii+m_perm[jj+m_perm[kk+m_perm[ll]]]], &gx0, &gy0, &gz0, &gw0);
 		n0 = t40 * ( gx0 * x0 + gy0 * y0 + gz0 * z0 + gw0 * w0 );
 	}
 	
@@ -1168,7 +1349,7 @@ vec5 dnoise( const glm::vec4 &v )
 	else {
 		t21 = t1 * t1;
 		t41 = t21 * t21;
-		details::grad4(details::perm[ii+i1+details::perm[jj+j1+details::perm[kk+k1+details::perm[ll+l1]]]], &gx1, &gy1, &gz1, &gw1);
+		details::grad4(m_perm[ii+i1+m_perm[jj+j1+m_perm[kk+k1+m_perm[ll+l1]]]], &gx1, &gy1, &gz1, &gw1);
 		n1 = t41 * ( gx1 * x1 + gy1 * y1 + gz1 * z1 + gw1 * w1 );
 	}
 	
@@ -1177,7 +1358,7 @@ vec5 dnoise( const glm::vec4 &v )
 	else {
 		t22 = t2 * t2;
 		t42 = t22 * t22;
-		details::grad4(details::perm[ii+i2+details::perm[jj+j2+details::perm[kk+k2+details::perm[ll+l2]]]], &gx2, &gy2, &gz2, &gw2);
+		details::grad4(m_perm[ii+i2+m_perm[jj+j2+m_perm[kk+k2+m_perm[ll+l2]]]], &gx2, &gy2, &gz2, &gw2);
 		n2 = t42 * ( gx2 * x2 + gy2 * y2 + gz2 * z2 + gw2 * w2 );
 	}
 	
@@ -1186,7 +1367,7 @@ vec5 dnoise( const glm::vec4 &v )
 	else {
 		t23 = t3 * t3;
 		t43 = t23 * t23;
-		details::grad4(details::perm[ii+i3+details::perm[jj+j3+details::perm[kk+k3+details::perm[ll+l3]]]], &gx3, &gy3, &gz3, &gw3);
+		details::grad4(m_perm[ii+i3+m_perm[jj+j3+m_perm[kk+k3+m_perm[ll+l3]]]], &gx3, &gy3, &gz3, &gw3);
 		n3 = t43 * ( gx3 * x3 + gy3 * y3 + gz3 * z3 + gw3 * w3 );
 	}
 	
@@ -1195,7 +1376,7 @@ vec5 dnoise( const glm::vec4 &v )
 	else {
 		t24 = t4 * t4;
 		t44 = t24 * t24;
-		details::grad4(details::perm[ii+1+details::perm[jj+1+details::perm[kk+1+details::perm[ll+1]]]], &gx4, &gy4, &gz4, &gw4);
+		details::grad4(m_perm[ii+1+m_perm[jj+1+m_perm[kk+1+m_perm[ll+1]]]], &gx4, &gy4, &gz4, &gw4);
 		n4 = t44 * ( gx4 * x4 + gy4 * y4 + gz4 * z4 + gw4 * w4 );
 	}
 	
@@ -1269,7 +1450,7 @@ vec5 dnoise( const glm::vec4 &v )
 }
 	
 	
-float worleyNoise( const glm::vec2 &v )
+float NoiseContext::worleyNoise( const glm::vec2 &v ) const
 {
 	glm::vec2 p = glm::floor( v );
 	glm::vec2 f = glm::fract( v );
@@ -1278,14 +1459,14 @@ float worleyNoise( const glm::vec2 &v )
 	for( int j=-1; j<=1; j++ ) {
 		for( int i=-1; i<=1; i++ ) {
 			glm::vec2 b = glm::vec2( i, j );
-			glm::vec2  r = b - f + ( Simplex::noise( p + b ) * 0.5f + 0.5f );
+			glm::vec2  r = b - f + ( noise( p + b ) * 0.5f + 0.5f );
 			float d = glm::dot( r, r );
 			res = glm::min( res, d );
 		}
 	}
 	return sqrt( res );
 }
-float worleyNoise( const glm::vec3 &v )
+float NoiseContext::worleyNoise( const glm::vec3 &v ) const
 {
 	glm::vec3 p = glm::floor( v );
 	glm::vec3 f = glm::fract( v );
@@ -1295,7 +1476,7 @@ float worleyNoise( const glm::vec3 &v )
 		for( int j=-1; j<=1; j++ ) {
 			for( int i=-1; i<=1; i++ ) {
 				glm::vec3 b = glm::vec3( i, j, k );
-				glm::vec3 r = b - f + ( Simplex::noise( p + b ) * 0.5f + 0.5f );
+				glm::vec3 r = b - f + ( noise( p + b ) * 0.5f + 0.5f );
 				float d = glm::dot( r, r );
 				res = glm::min( res, d );
 			}
@@ -1303,7 +1484,7 @@ float worleyNoise( const glm::vec3 &v )
 	}
 	return sqrt( res );
 }
-float worleyNoise( const glm::vec2 &v, float falloff )
+float NoiseContext::worleyNoise( const glm::vec2 &v, float falloff ) const
 {
 	glm::vec2 p = glm::floor( v );
 	glm::vec2 f = glm::fract( v );
@@ -1312,14 +1493,14 @@ float worleyNoise( const glm::vec2 &v, float falloff )
 	for( int j=-1; j<=1; j++ ) {
 		for( int i=-1; i<=1; i++ ) {
 			glm::vec2 b = glm::vec2( i, j );
-			glm::vec2 r = b - f + ( Simplex::noise( p + b ) * 0.5f + 0.5f );
+			glm::vec2 r = b - f + ( noise( p + b ) * 0.5f + 0.5f );
 			float d = glm::length( r );
 			res += glm::exp( -falloff*d );
 		}
 	}
 	return -( 1.0f / falloff ) * glm::log( res );
 }
-float worleyNoise( const glm::vec3 &v, float falloff )
+float NoiseContext::worleyNoise( const glm::vec3 &v, float falloff ) const
 {
 	glm::vec3 p = glm::floor( v );
 	glm::vec3 f = glm::fract( v );
@@ -1329,7 +1510,7 @@ float worleyNoise( const glm::vec3 &v, float falloff )
 		for( int j=-1; j<=1; j++ ) {
 			for( int i=-1; i<=1; i++ ) {
 				glm::vec3 b = glm::vec3( i, j, k );
-				glm::vec3 r = b - f + ( Simplex::noise( p + b ) * 0.5f + 0.5f );
+				glm::vec3 r = b - f + ( noise( p + b ) * 0.5f + 0.5f );
 				float d = glm::length( r );
 				res += glm::exp( -falloff*d );
 			}
@@ -1338,7 +1519,7 @@ float worleyNoise( const glm::vec3 &v, float falloff )
 	return -( 1.0f / falloff ) * glm::log( res );
 }
 	
-float flowNoise( const glm::vec2 &v, float angle )
+float NoiseContext::flowNoise( const glm::vec2 &v, float angle ) const
 {
 	float n0, n1, n2; /* Noise contributions from the three simplex corners */
 	float gx0, gy0, gx1, gy1, gx2, gy2; /* Gradients at simplex corners */
@@ -1373,7 +1554,7 @@ float flowNoise( const glm::vec2 &v, float angle )
 	float x2 = x0 - 1.0f + 2.0f * G2; /* Offsets for last corner in (x,y) unskewed coords */
 	float y2 = y0 - 1.0f + 2.0f * G2;
 	
-	/* Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds */
+	/* Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds */
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	
@@ -1382,7 +1563,7 @@ float flowNoise( const glm::vec2 &v, float angle )
 	float t20, t40;
 	if( t0 < 0.0f ) t40 = t20 = t0 = n0 = gx0 = gy0 = 0.0f; /* No influence */
 	else {
-		details::gradrot2( details::perm[ii + details::perm[jj]], sin_t, cos_t, &gx0, &gy0 );
+		details::gradrot2( m_perm[ii + m_perm[jj]], sin_t, cos_t, &gx0, &gy0 );
 		t20 = t0 * t0;
 		t40 = t20 * t20;
 		n0 = t40 * details::graddotp2( gx0, gy0, x0, y0 );
@@ -1392,7 +1573,7 @@ float flowNoise( const glm::vec2 &v, float angle )
 	float t21, t41;
 	if( t1 < 0.0f ) t21 = t41 = t1 = n1 = gx1 = gy1 = 0.0f; /* No influence */
 	else {
-		details::gradrot2( details::perm[ii + i1 + details::perm[jj + j1]], sin_t, cos_t, &gx1, &gy1 );
+		details::gradrot2( m_perm[ii + i1 + m_perm[jj + j1]], sin_t, cos_t, &gx1, &gy1 );
 		t21 = t1 * t1;
 		t41 = t21 * t21;
 		n1 = t41 * details::graddotp2( gx1, gy1, x1, y1 );
@@ -1402,7 +1583,7 @@ float flowNoise( const glm::vec2 &v, float angle )
 	float t22, t42;
 	if( t2 < 0.0f ) t42 = t22 = t2 = n2 = gx2 = gy2 = 0.0f; /* No influence */
 	else {
-		details::gradrot2( details::perm[ii + 1 + details::perm[jj + 1]], sin_t, cos_t, &gx2, &gy2 );
+		details::gradrot2( m_perm[ii + 1 + m_perm[jj + 1]], sin_t, cos_t, &gx2, &gy2 );
 		t22 = t2 * t2;
 		t42 = t22 * t22;
 		n2 = t42 * details::graddotp2( gx2, gy2, x2, y2 );
@@ -1412,7 +1593,7 @@ float flowNoise( const glm::vec2 &v, float angle )
 	 * The result is scaled to return values in the interval [-1,1]. */
 	return 40.0f * ( n0 + n1 + n2 );
 }
-float flowNoise( const glm::vec3 &v, float angle )
+float NoiseContext::flowNoise( const glm::vec3 &v, float angle ) const
 {
 	float n0, n1, n2, n3; /* Noise contributions from the four simplex corners */
 	float gx0, gy0, gz0, gx1, gy1, gz1; /* Gradients at simplex corners */
@@ -1471,7 +1652,7 @@ float flowNoise( const glm::vec3 &v, float angle )
 	float y3 = y0 - 1.0f + 3.0f * G3;
 	float z3 = z0 - 1.0f + 3.0f * G3;
 	
-	/* Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds */
+	/* Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds */
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	int kk = k & 0xff;
@@ -1481,7 +1662,7 @@ float flowNoise( const glm::vec3 &v, float angle )
 	float t20, t40;
 	if(t0 < 0.0f) n0 = t0 = t20 = t40 = gx0 = gy0 = gz0 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + details::perm[jj + details::perm[kk]]], sin_t, cos_t, &gx0, &gy0, &gz0 );
+		details::gradrot3( m_perm[ii + m_perm[jj + m_perm[kk]]], sin_t, cos_t, &gx0, &gy0, &gz0 );
 		t20 = t0 * t0;
 		t40 = t20 * t20;
 		n0 = t40 * details::graddotp3( gx0, gy0, gz0, x0, y0, z0 );
@@ -1491,7 +1672,7 @@ float flowNoise( const glm::vec3 &v, float angle )
 	float t21, t41;
 	if(t1 < 0.0f) n1 = t1 = t21 = t41 = gx1 = gy1 = gz1 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + i1 + details::perm[jj + j1 + details::perm[kk + k1]]], sin_t, cos_t, &gx1, &gy1, &gz1 );
+		details::gradrot3( m_perm[ii + i1 + m_perm[jj + j1 + m_perm[kk + k1]]], sin_t, cos_t, &gx1, &gy1, &gz1 );
 		t21 = t1 * t1;
 		t41 = t21 * t21;
 		n1 = t41 * details::graddotp3( gx1, gy1, gz1, x1, y1, z1 );
@@ -1501,7 +1682,7 @@ float flowNoise( const glm::vec3 &v, float angle )
 	float t22, t42;
 	if(t2 < 0.0f) n2 = t2 = t22 = t42 = gx2 = gy2 = gz2 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + i2 + details::perm[jj + j2 + details::perm[kk + k2]]], sin_t, cos_t, &gx2, &gy2, &gz2 );
+		details::gradrot3( m_perm[ii + i2 + m_perm[jj + j2 + m_perm[kk + k2]]], sin_t, cos_t, &gx2, &gy2, &gz2 );
 		t22 = t2 * t2;
 		t42 = t22 * t22;
 		n2 = t42 * details::graddotp3( gx2, gy2, gz2, x2, y2, z2 );
@@ -1511,7 +1692,7 @@ float flowNoise( const glm::vec3 &v, float angle )
 	float t23, t43;
 	if(t3 < 0.0f) n3 = t3 = t23 = t43 = gx3 = gy3 = gz3 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + 1 + details::perm[jj + 1 + details::perm[kk + 1]]], sin_t, cos_t, &gx3, &gy3, &gz3 );
+		details::gradrot3( m_perm[ii + 1 + m_perm[jj + 1 + m_perm[kk + 1]]], sin_t, cos_t, &gx3, &gy3, &gz3 );
 		t23 = t3 * t3;
 		t43 = t23 * t23;
 		n3 = t43 * details::graddotp3( gx3, gy3, gz3, x3, y3, z3 );
@@ -1521,7 +1702,7 @@ float flowNoise( const glm::vec3 &v, float angle )
 	 * The result is scaled to return values in the range [-1,1] */
 	return 28.0f * (n0 + n1 + n2 + n3);
 }
-glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
+glm::vec3 NoiseContext::dFlowNoise( const glm::vec2 &v, float angle ) const
 {
 	
 	float n0, n1, n2; /* Noise contributions from the three simplex corners */
@@ -1557,7 +1738,7 @@ glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
 	float x2 = x0 - 1.0f + 2.0f * G2; /* Offsets for last corner in (x,y) unskewed coords */
 	float y2 = y0 - 1.0f + 2.0f * G2;
 	
-	/* Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds */
+	/* Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds */
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	
@@ -1566,7 +1747,7 @@ glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
 	float t20, t40;
 	if( t0 < 0.0f ) t40 = t20 = t0 = n0 = gx0 = gy0 = 0.0f; /* No influence */
 	else {
-		details::gradrot2( details::perm[ii + details::perm[jj]], sin_t, cos_t, &gx0, &gy0 );
+		details::gradrot2( m_perm[ii + m_perm[jj]], sin_t, cos_t, &gx0, &gy0 );
 		t20 = t0 * t0;
 		t40 = t20 * t20;
 		n0 = t40 * details::graddotp2( gx0, gy0, x0, y0 );
@@ -1576,7 +1757,7 @@ glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
 	float t21, t41;
 	if( t1 < 0.0f ) t21 = t41 = t1 = n1 = gx1 = gy1 = 0.0f; /* No influence */
 	else {
-		details::gradrot2( details::perm[ii + i1 + details::perm[jj + j1]], sin_t, cos_t, &gx1, &gy1 );
+		details::gradrot2( m_perm[ii + i1 + m_perm[jj + j1]], sin_t, cos_t, &gx1, &gy1 );
 		t21 = t1 * t1;
 		t41 = t21 * t21;
 		n1 = t41 * details::graddotp2( gx1, gy1, x1, y1 );
@@ -1586,7 +1767,7 @@ glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
 	float t22, t42;
 	if( t2 < 0.0f ) t42 = t22 = t2 = n2 = gx2 = gy2 = 0.0f; /* No influence */
 	else {
-		details::gradrot2( details::perm[ii + 1 + details::perm[jj + 1]], sin_t, cos_t, &gx2, &gy2 );
+		details::gradrot2( m_perm[ii + 1 + m_perm[jj + 1]], sin_t, cos_t, &gx2, &gy2 );
 		t22 = t2 * t2;
 		t42 = t22 * t22;
 		n2 = t42 * details::graddotp2( gx2, gy2, x2, y2 );
@@ -1627,7 +1808,7 @@ glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
 	
 	return glm::vec3( noise, dnoise_dx, dnoise_dy );
 }
-glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
+glm::vec4 NoiseContext::dFlowNoise( const glm::vec3 &v, float angle ) const
 {
 	float n0, n1, n2, n3; /* Noise contributions from the four simplex corners */
 	float noise;          /* Return value */
@@ -1687,7 +1868,7 @@ glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
 	float y3 = y0 - 1.0f + 3.0f * G3;
 	float z3 = z0 - 1.0f + 3.0f * G3;
 	
-	/* Wrap the integer indices at 256, to avoid indexing details::perm[] out of bounds */
+	/* Wrap the integer indices at 256, to avoid indexing m_perm[] out of bounds */
 	int ii = i & 0xff;
 	int jj = j & 0xff;
 	int kk = k & 0xff;
@@ -1697,7 +1878,7 @@ glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
 	float t20, t40;
 	if(t0 < 0.0f) n0 = t0 = t20 = t40 = gx0 = gy0 = gz0 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + details::perm[jj + details::perm[kk]]], sin_t, cos_t, &gx0, &gy0, &gz0 );
+		details::gradrot3( m_perm[ii + m_perm[jj + m_perm[kk]]], sin_t, cos_t, &gx0, &gy0, &gz0 );
 		t20 = t0 * t0;
 		t40 = t20 * t20;
 		n0 = t40 * details::graddotp3( gx0, gy0, gz0, x0, y0, z0 );
@@ -1707,7 +1888,7 @@ glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
 	float t21, t41;
 	if(t1 < 0.0f) n1 = t1 = t21 = t41 = gx1 = gy1 = gz1 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + i1 + details::perm[jj + j1 + details::perm[kk + k1]]], sin_t, cos_t, &gx1, &gy1, &gz1 );
+		details::gradrot3( m_perm[ii + i1 + m_perm[jj + j1 + m_perm[kk + k1]]], sin_t, cos_t, &gx1, &gy1, &gz1 );
 		t21 = t1 * t1;
 		t41 = t21 * t21;
 		n1 = t41 * details::graddotp3( gx1, gy1, gz1, x1, y1, z1 );
@@ -1717,7 +1898,7 @@ glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
 	float t22, t42;
 	if(t2 < 0.0f) n2 = t2 = t22 = t42 = gx2 = gy2 = gz2 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + i2 + details::perm[jj + j2 + details::perm[kk + k2]]], sin_t, cos_t, &gx2, &gy2, &gz2 );
+		details::gradrot3( m_perm[ii + i2 + m_perm[jj + j2 + m_perm[kk + k2]]], sin_t, cos_t, &gx2, &gy2, &gz2 );
 		t22 = t2 * t2;
 		t42 = t22 * t22;
 		n2 = t42 * details::graddotp3( gx2, gy2, gz2, x2, y2, z2 );
@@ -1727,7 +1908,7 @@ glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
 	float t23, t43;
 	if(t3 < 0.0f) n3 = t3 = t23 = t43 = gx3 = gy3 = gz3 = 0.0f;
 	else {
-		details::gradrot3( details::perm[ii + 1 + details::perm[jj + 1 + details::perm[kk + 1]]], sin_t, cos_t, &gx3, &gy3, &gz3 );
+		details::gradrot3( m_perm[ii + 1 + m_perm[jj + 1 + m_perm[kk + 1]]], sin_t, cos_t, &gx3, &gy3, &gz3 );
 		t23 = t3 * t3;
 		t43 = t23 * t23;
 		n3 = t43 * details::graddotp3( gx3, gy3, gz3, x3, y3, z3 );
@@ -1785,36 +1966,36 @@ glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
 	return glm::vec4( noise, dnoise_dx, dnoise_dy, dnoise_dz );
 }
 
-glm::vec2 curlNoise( const glm::vec2 &v )
+glm::vec2 NoiseContext::curlNoise( const glm::vec2 &v ) const
 {
 	const glm::vec3 derivative = dnoise( v );
 	return glm::vec2( derivative.z, -derivative.y );
 }
-glm::vec2 curlNoise( const glm::vec2 &v, float t )
+glm::vec2 NoiseContext::curlNoise( const glm::vec2 &v, float t ) const
 {
 	const glm::vec3 derivative = dFlowNoise( v, t );
 	return glm::vec2( derivative.z, -derivative.y );
 }
-glm::vec2 curlNoise( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+glm::vec2 NoiseContext::curlNoise( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	const glm::vec3 derivative = dfBm( v, octaves, lacunarity, gain );
 	return glm::vec2( derivative.z, -derivative.y );
 }
-glm::vec3 curlNoise( const glm::vec3 &v )
+glm::vec3 NoiseContext::curlNoise( const glm::vec3 &v ) const
 {
 	const glm::vec4 derivX = dnoise( v );
 	const glm::vec4 derivY = dnoise( v + glm::vec3( 123.456f, 789.012f, 345.678f ) );
 	const glm::vec4 derivZ = dnoise( v + glm::vec3( 901.234f, 567.891f, 234.567f ) );
 	return glm::vec3( derivZ.z - derivY.w, derivX.w - derivZ.y, derivY.y - derivX.z );
 }
-glm::vec3 curlNoise( const glm::vec3 &v, float t )
+glm::vec3 NoiseContext::curlNoise( const glm::vec3 &v, float t ) const
 {
 	const glm::vec4 derivX = dFlowNoise( v, t );
 	const glm::vec4 derivY = dFlowNoise( v + glm::vec3( 123.456f, 789.012f, 345.678f ), t );
 	const glm::vec4 derivZ = dFlowNoise( v + glm::vec3( 901.234f, 567.891f, 234.567f ), t );
 	return glm::vec3( derivZ.z - derivY.w, derivX.w - derivZ.y, derivY.y - derivX.z );
 }
-glm::vec3 curlNoise( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+glm::vec3 NoiseContext::curlNoise( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	const glm::vec4 derivX = dfBm( v, octaves, lacunarity, gain );
 	const glm::vec4 derivY = dfBm( v + glm::vec3( 123.456f, 789.012f, 345.678f ), octaves, lacunarity, gain );
@@ -1822,14 +2003,14 @@ glm::vec3 curlNoise( const glm::vec3 &v, uint8_t octaves, float lacunarity, floa
 	return glm::vec3( derivZ.z - derivY.w, derivX.w - derivZ.y, derivY.y - derivX.z );
 }
 
-glm::vec2 curl( const glm::vec2 &v, const std::function<float(const glm::vec2&)> &potential, float delta )
+glm::vec2 NoiseContext::curl( const glm::vec2 &v, const std::function<float(const glm::vec2&)> &potential, float delta ) const
 {
 	const glm::vec2 deltaX = glm::vec2( delta, 0.0f );
 	const glm::vec2 deltaY = glm::vec2( 0.0f, delta );
 	return glm::vec2( -( potential( v + deltaY ) - potential( v - deltaY ) ),
 					 ( potential( v + deltaX ) - potential( v - deltaX ) ) ) / ( 2.0f * delta );
 }
-glm::vec3 curl( const glm::vec3 &v, const std::function<glm::vec3(const glm::vec3&)> &potential, float delta )
+glm::vec3 NoiseContext::curl( const glm::vec3 &v, const std::function<glm::vec3(const glm::vec3&)> &potential, float delta ) const
 {
 	const glm::vec3 deltaX = glm::vec3( delta, 0.0f, 0.0f );
 	const glm::vec3 deltaY = glm::vec3( 0.0f, delta, 0.0f );
@@ -1842,95 +2023,91 @@ glm::vec3 curl( const glm::vec3 &v, const std::function<glm::vec3(const glm::vec
 					  -( potential( v + deltaY ).x - potential( v - deltaY ).x ) ) ) / ( 2.0f * delta );
 }
 
-namespace details {
-	template<typename T>
-	float fBm_t( const T &input, uint8_t octaves, float lacunarity, float gain )
-	{
-		float sum   = 0.0f;
-		float freq  = 1.0f;
-		float amp   = 0.5f;
-		
-		for( uint8_t i = 0; i < octaves; i++ ){
-			float n     = noise( input * freq );
-			sum        += n*amp;
-			freq       *= lacunarity;
-			amp        *= gain;
-		}
-		
-		return sum;
+template<typename T>
+float NoiseContext::fBm_t( const T &input, uint8_t octaves, float lacunarity, float gain ) const
+{
+	float sum   = 0.0f;
+	float freq  = 1.0f;
+	float amp   = 0.5f;
+	
+	for( uint8_t i = 0; i < octaves; i++ ){
+		float n     = noise( input * freq );
+		sum        += n*amp;
+		freq       *= lacunarity;
+		amp        *= gain;
 	}
+	
+	return sum;
 }
 
-float fBm( float x, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::fBm( float x, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::fBm_t( x, octaves, lacunarity, gain );
+	return fBm_t( x, octaves, lacunarity, gain );
 }
-float fBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::fBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::fBm_t( v, octaves, lacunarity, gain );
+	return fBm_t( v, octaves, lacunarity, gain );
 }
-float fBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::fBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::fBm_t( v, octaves, lacunarity, gain );
+	return fBm_t( v, octaves, lacunarity, gain );
 }
-float fBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::fBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::fBm_t( v, octaves, lacunarity, gain );
+	return fBm_t( v, octaves, lacunarity, gain );
 }
 	
-namespace details {
-	template<typename T>
-	float worleyfBm_t( const T &input, uint8_t octaves, float lacunarity, float gain )
-	{
-		float sum   = 0.0f;
-		float freq  = 1.0f;
-		float amp   = 0.5f;
-		
-		for( uint8_t i = 0; i < octaves; i++ ){
-			float n     = worleyNoise( input * freq );
-			sum        += n*amp;
-			freq       *= lacunarity;
-			amp        *= gain;
-		}
-		
-		return sum;
+template<typename T>
+float NoiseContext::worleyfBm_t( const T &input, uint8_t octaves, float lacunarity, float gain ) const
+{
+	float sum   = 0.0f;
+	float freq  = 1.0f;
+	float amp   = 0.5f;
+	
+	for( uint8_t i = 0; i < octaves; i++ ){
+		float n     = worleyNoise( input * freq );
+		sum        += n*amp;
+		freq       *= lacunarity;
+		amp        *= gain;
 	}
-	template<typename T>
-	float worleyfBm_t( const T &input, float falloff, uint8_t octaves, float lacunarity, float gain )
-	{
-		float sum   = 0.0f;
-		float freq  = 1.0f;
-		float amp   = 0.5f;
-		
-		for( uint8_t i = 0; i < octaves; i++ ){
-			float n     = worleyNoise( input * freq, falloff );
-			sum        += n*amp;
-			freq       *= lacunarity;
-			amp        *= gain;
-		}
-		
-		return sum;
+	
+	return sum;
+}
+template<typename T>
+float NoiseContext::worleyfBm_t( const T &input, float falloff, uint8_t octaves, float lacunarity, float gain ) const
+{
+	float sum   = 0.0f;
+	float freq  = 1.0f;
+	float amp   = 0.5f;
+	
+	for( uint8_t i = 0; i < octaves; i++ ){
+		float n     = worleyNoise( input * freq, falloff );
+		sum        += n*amp;
+		freq       *= lacunarity;
+		amp        *= gain;
 	}
+	
+	return sum;
 }
 
-float worleyfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::worleyfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::worleyfBm_t( v, octaves, lacunarity, gain );
+	return worleyfBm_t( v, octaves, lacunarity, gain );
 }
-float worleyfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::worleyfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::worleyfBm_t( v, octaves, lacunarity, gain );
+	return worleyfBm_t( v, octaves, lacunarity, gain );
 }
-float worleyfBm( const glm::vec2 &v, float falloff, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::worleyfBm( const glm::vec2 &v, float falloff, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::worleyfBm_t( v, falloff, octaves, lacunarity, gain );
+	return worleyfBm_t( v, falloff, octaves, lacunarity, gain );
 }
-float worleyfBm( const glm::vec3 &v, float falloff, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::worleyfBm( const glm::vec3 &v, float falloff, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::worleyfBm_t( v, falloff, octaves, lacunarity, gain );
+	return worleyfBm_t( v, falloff, octaves, lacunarity, gain );
 }
 
-glm::vec2 dfBm( float x, uint8_t octaves, float lacunarity, float gain )
+glm::vec2 NoiseContext::dfBm( float x, uint8_t octaves, float lacunarity, float gain ) const
 {
 	glm::vec2 sum	= glm::vec2( 0.0f );
 	float freq		= 1.0f;
@@ -1945,7 +2122,7 @@ glm::vec2 dfBm( float x, uint8_t octaves, float lacunarity, float gain )
 	
 	return sum;
 }
-glm::vec3 dfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+glm::vec3 NoiseContext::dfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	glm::vec3 sum	= glm::vec3( 0.0f );
 	float freq		= 1.0f;
@@ -1960,7 +2137,7 @@ glm::vec3 dfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gai
 	
 	return sum;
 }
-glm::vec4 dfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+glm::vec4 NoiseContext::dfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	glm::vec4 sum	= glm::vec4( 0.0f );
 	float freq		= 1.0f;
@@ -1975,7 +2152,7 @@ glm::vec4 dfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gai
 	
 	return sum;
 }
-vec5 dfBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain )
+vec5 NoiseContext::dfBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	vec5 sum = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
 	float freq  = 1.0f;
@@ -1995,29 +2172,27 @@ vec5 dfBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain )
 	return sum;
 }
 
-namespace details {
-	template<typename T>
-	inline float ridgedNoise_t( const T &input )
-	{
-		return 1.0f - glm::abs( noise( input ) );
-	}
+template<typename T>
+float NoiseContext::ridgedNoise_t( const T &input ) const
+{
+	return 1.0f - glm::abs( noise( input ) );
 }
 
-float ridgedNoise( float x )
+float NoiseContext::ridgedNoise( float x ) const
 {
-	return details::ridgedNoise_t( x );
+	return ridgedNoise_t( x );
 }
-float ridgedNoise( const glm::vec2 &v )
+float NoiseContext::ridgedNoise( const glm::vec2 &v ) const
 {
-	return details::ridgedNoise_t( v );
+	return ridgedNoise_t( v );
 }
-float ridgedNoise( const glm::vec3 &v )
+float NoiseContext::ridgedNoise( const glm::vec3 &v ) const
 {
-	return details::ridgedNoise_t( v );
+	return ridgedNoise_t( v );
 }
-float ridgedNoise( const glm::vec4 &v )
+float NoiseContext::ridgedNoise( const glm::vec4 &v ) const
 {
-	return details::ridgedNoise_t( v );
+	return ridgedNoise_t( v );
 }
 
 
@@ -2027,45 +2202,45 @@ namespace details {
 		h = offset - glm::abs( h );
 		return h * h;
 	}
+}
+
+template<typename T>
+float NoiseContext::ridgedMF_t( const T &input, float ridgeOffset, uint8_t octaves, float lacunarity, float gain ) const
+{
+	float sum	= 0;
+	float freq	= 1.0;
+	float amp	= 0.5;
+	float prev	= 1.0;
 	
-	template<typename T>
-	float ridgedMF_t( const T &input, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
-	{
-		float sum	= 0;
-		float freq	= 1.0;
-		float amp	= 0.5;
-		float prev	= 1.0;
-		
-		for( uint8_t i = 0; i < octaves; i++ ){
-			float n	= ridge( noise( input * freq ), ridgeOffset );
-			sum		+= n*amp*prev;
-			prev	= n;
-			freq	*= lacunarity;
-			amp		*= gain;
-		}
-		return sum;
+	for( uint8_t i = 0; i < octaves; i++ ){
+		float n	= details::ridge( noise( input * freq ), ridgeOffset );
+		sum		+= n*amp*prev;
+		prev	= n;
+		freq	*= lacunarity;
+		amp		*= gain;
 	}
+	return sum;
 }
 
-float ridgedMF( float x, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::ridgedMF( float x, float ridgeOffset, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::ridgedMF_t( x, ridgeOffset, octaves, lacunarity, gain );
+	return ridgedMF_t( x, ridgeOffset, octaves, lacunarity, gain );
 }
-float ridgedMF( const glm::vec2 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::ridgedMF( const glm::vec2 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::ridgedMF_t( v, ridgeOffset, octaves, lacunarity, gain );
+	return ridgedMF_t( v, ridgeOffset, octaves, lacunarity, gain );
 }
-float ridgedMF( const glm::vec3 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::ridgedMF( const glm::vec3 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::ridgedMF_t( v, ridgeOffset, octaves, lacunarity, gain );
+	return ridgedMF_t( v, ridgeOffset, octaves, lacunarity, gain );
 }
-float ridgedMF( const glm::vec4 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::ridgedMF( const glm::vec4 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain ) const
 {
-	return details::ridgedMF_t( v, ridgeOffset, octaves, lacunarity, gain );
+	return ridgedMF_t( v, ridgeOffset, octaves, lacunarity, gain );
 }
 
 
-float iqfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::iqfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	float sum	= 0.0;
 	float amp	= 0.5;
@@ -2083,7 +2258,7 @@ float iqfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
 	
 	return sum;
 }
-float iqfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+float NoiseContext::iqfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain ) const
 {
 	float sum	= 0.0;
 	float amp	= 0.5;
@@ -2104,7 +2279,7 @@ float iqfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
 	return sum;
 }
 
-float iqMatfBm( const glm::vec2 &v, uint8_t octaves, const glm::mat2 &mat, float gain )
+float NoiseContext::iqMatfBm( const glm::vec2 &v, uint8_t octaves, const glm::mat2 &mat, float gain ) const
 {
 	float sum		= 0.0;
 	float amp		= 1.0;
@@ -2120,14 +2295,983 @@ float iqMatfBm( const glm::vec2 &v, uint8_t octaves, const glm::mat2 &mat, float
 	return sum;
 }
 
-void seed( uint32_t s ) {
-    std::random_device rd;
-    std::mt19937 gen( rd() );
-    gen.seed( s );
-    std::uniform_int_distribution<> distribution( 1, 255 );
-    for( size_t i = 0; i < 256; ++i ) {
-        details::perm[i] = details::perm[i + 256] = distribution( gen );
-    }
+namespace details {
+	/*
+	 * Batch kernels. The same code is instantiated for AVX-512 (16 lanes),
+	 * AVX2 (8 lanes) or plain scalars, depending on the instruction sets
+	 * enabled at compile time. Everything is branchless: FASTFLOOR becomes
+	 * a truncation plus a comparison, the simplex corners are selected with
+	 * masks, the permutation table is read with gathers and the
+	 * gradient-dot-residual products are computed from the hash bits exactly
+	 * as in grad(), so the results match the scalar functions up to float
+	 * rounding.
+	 */
+	struct SimdScalar {
+		enum { WIDTH = 1 };
+		typedef float F;
+		typedef int32_t I;
+		typedef bool M;
+		static F set1( float x ) { return x; }
+		static I set1i( int32_t x ) { return x; }
+		static F load( const float *p ) { return *p; }
+		static void store( float *p, F x ) { *p = x; }
+		static F add( F a, F b ) { return a + b; }
+		static F sub( F a, F b ) { return a - b; }
+		static F mul( F a, F b ) { return a * b; }
+		static F div( F a, F b ) { return a / b; }
+		static F max( F a, F b ) { return a > b ? a : b; }
+		static F neg( F a ) { return -a; }
+		static I toInt( F x ) { return (I)x; }
+		static F toFloat( I x ) { return (F)x; }
+		static I addi( I a, I b ) { return a + b; }
+		static I subi( I a, I b ) { return a - b; }
+		static I andi( I a, I b ) { return a & b; }
+		static I xori( I a, I b ) { return a ^ b; }
+		static I muli( I a, I b ) { return (I)( (uint32_t)a * (uint32_t)b ); }
+		template<int N> static I srli( I a ) { return (I)( (uint32_t)a >> N ); }
+		static M greater( F a, F b ) { return a > b; }
+		static M greaterEqual( F a, F b ) { return a >= b; }
+		static M equal( I a, I b ) { return a == b; }
+		static M andm( M a, M b ) { return a && b; }
+		static M orm( M a, M b ) { return a || b; }
+		static M notm( M a ) { return !a; }
+		static bool anym( M a ) { return a; }
+		static F select( M m, F a, F b ) { return m ? a : b; }
+		static F maskToOne( M m ) { return m ? 1.0f : 0.0f; }
+		static I maskToInt( M m ) { return m ? 1 : 0; }
+		static I gather( const LutType *lut, I index ) { return lut[index]; }
+	};
+	
+#if defined(__AVX2__)
+	struct SimdAvx2 {
+		enum { WIDTH = 8 };
+		typedef __m256 F;
+		typedef __m256i I;
+		typedef __m256 M;
+		static F set1( float x ) { return _mm256_set1_ps( x ); }
+		static I set1i( int32_t x ) { return _mm256_set1_epi32( x ); }
+		static F load( const float *p ) { return _mm256_loadu_ps( p ); }
+		static void store( float *p, F x ) { _mm256_storeu_ps( p, x ); }
+		static F add( F a, F b ) { return _mm256_add_ps( a, b ); }
+		static F sub( F a, F b ) { return _mm256_sub_ps( a, b ); }
+		static F mul( F a, F b ) { return _mm256_mul_ps( a, b ); }
+		static F div( F a, F b ) { return _mm256_div_ps( a, b ); }
+		static F max( F a, F b ) { return _mm256_max_ps( a, b ); }
+		static F neg( F a ) { return _mm256_xor_ps( a, _mm256_set1_ps( -0.0f ) ); }
+		static I toInt( F x ) { return _mm256_cvttps_epi32( x ); }
+		static F toFloat( I x ) { return _mm256_cvtepi32_ps( x ); }
+		static I addi( I a, I b ) { return _mm256_add_epi32( a, b ); }
+		static I subi( I a, I b ) { return _mm256_sub_epi32( a, b ); }
+		static I andi( I a, I b ) { return _mm256_and_si256( a, b ); }
+		static I xori( I a, I b ) { return _mm256_xor_si256( a, b ); }
+		static I muli( I a, I b ) { return _mm256_mullo_epi32( a, b ); }
+		template<int N> static I srli( I a ) { return _mm256_srli_epi32( a, N ); }
+		static M greater( F a, F b ) { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+		static M greaterEqual( F a, F b ) { return _mm256_cmp_ps( a, b, _CMP_GE_OQ ); }
+		static M equal( I a, I b ) { return _mm256_castsi256_ps( _mm256_cmpeq_epi32( a, b ) ); }
+		static M andm( M a, M b ) { return _mm256_and_ps( a, b ); }
+		static M orm( M a, M b ) { return _mm256_or_ps( a, b ); }
+		static M notm( M a ) { return _mm256_xor_ps( a, _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) ) ); }
+		static bool anym( M a ) { return _mm256_movemask_ps( a ) != 0; }
+		static F select( M m, F a, F b ) { return _mm256_blendv_ps( b, a, m ); }
+		static F maskToOne( M m ) { return _mm256_and_ps( m, _mm256_set1_ps( 1.0f ) ); }
+		static I maskToInt( M m ) { return _mm256_and_si256( _mm256_castps_si256( m ), _mm256_set1_epi32( 1 ) ); }
+		static I gather( const LutType *lut, I index ) {
+			return _mm256_and_si256( _mm256_i32gather_epi32( (const int *)lut, index, 1 ), _mm256_set1_epi32( 0xff ) );
+		}
+	};
+#endif
+	
+#if defined(__AVX512F__)
+	struct SimdAvx512 {
+		enum { WIDTH = 16 };
+		typedef __m512 F;
+		typedef __m512i I;
+		typedef __mmask16 M;
+		static F set1( float x ) { return _mm512_set1_ps( x ); }
+		static I set1i( int32_t x ) { return _mm512_set1_epi32( x ); }
+		static F load( const float *p ) { return _mm512_loadu_ps( p ); }
+		static void store( float *p, F x ) { _mm512_storeu_ps( p, x ); }
+		static F add( F a, F b ) { return _mm512_add_ps( a, b ); }
+		static F sub( F a, F b ) { return _mm512_sub_ps( a, b ); }
+		static F mul( F a, F b ) { return _mm512_mul_ps( a, b ); }
+		static F div( F a, F b ) { return _mm512_div_ps( a, b ); }
+		static F max( F a, F b ) { return _mm512_maskz_max_ps( 0xFFFF, a, b ); }
+		static F neg( F a ) { return _mm512_castsi512_ps( _mm512_xor_si512( _mm512_castps_si512( a ), _mm512_set1_epi32( (int32_t)0x80000000 ) ) ); }
+		// the masked forms avoid the uninitialized pass-through of the unmasked ones
+		static I toInt( F x ) { return _mm512_maskz_cvttps_epi32( 0xFFFF, x ); }
+		static F toFloat( I x ) { return _mm512_maskz_cvtepi32_ps( 0xFFFF, x ); }
+		static I addi( I a, I b ) { return _mm512_add_epi32( a, b ); }
+		static I subi( I a, I b ) { return _mm512_sub_epi32( a, b ); }
+		static I andi( I a, I b ) { return _mm512_and_si512( a, b ); }
+		static I xori( I a, I b ) { return _mm512_xor_si512( a, b ); }
+		static I muli( I a, I b ) { return _mm512_mullo_epi32( a, b ); }
+		// the unmasked form passes _mm512_undefined_epi32() as the merge source,
+		// which GCC reports as used uninitialized; a full mask emits the same vpsrld
+		template<int N> static I srli( I a ) { return _mm512_maskz_srli_epi32( (__mmask16)0xffff, a, N ); }
+		static M greater( F a, F b ) { return _mm512_cmp_ps_mask( a, b, _CMP_GT_OQ ); }
+		static M greaterEqual( F a, F b ) { return _mm512_cmp_ps_mask( a, b, _CMP_GE_OQ ); }
+		static M equal( I a, I b ) { return _mm512_cmpeq_epi32_mask( a, b ); }
+		static M andm( M a, M b ) { return (M)( a & b ); }
+		static M orm( M a, M b ) { return (M)( a | b ); }
+		static M notm( M a ) { return (M)~a; }
+		static bool anym( M a ) { return a != 0; }
+		static F select( M m, F a, F b ) { return _mm512_mask_blend_ps( m, b, a ); }
+		static F maskToOne( M m ) { return _mm512_maskz_mov_ps( m, _mm512_set1_ps( 1.0f ) ); }
+		static I maskToInt( M m ) { return _mm512_maskz_mov_epi32( m, _mm512_set1_epi32( 1 ) ); }
+		static I gather( const LutType *lut, I index ) {
+			const I gathered = _mm512_mask_i32gather_epi32( _mm512_setzero_si512(), 0xFFFF, index, (const void *)lut, 1 );
+			return _mm512_and_si512( gathered, _mm512_set1_epi32( 0xff ) );
+		}
+	};
+	typedef SimdAvx512 SimdBatch;
+#elif defined(__AVX2__)
+	typedef SimdAvx2 SimdBatch;
+#else
+	typedef SimdScalar SimdBatch;
+#endif
+	
+	// same as FASTFLOOR
+	template<typename S>
+	typename S::I fastFloorBatch( typename S::F x )
+	{
+		typename S::M positive = S::greater( x, S::set1( 0.0f ) );
+		return S::subi( S::toInt( x ), S::maskToInt( S::notm( positive ) ) );
+	}
+	
+	// Corner hashes of the batch kernels, in 0..255. PermutationHash reads
+	// the permutation table as the scalar functions do, so the lattice
+	// repeats every 256 cells and every lookup is a gather.
+	template<typename S>
+	struct PermutationHash {
+		typedef typename S::I I;
+		const LutType *perm;
+		
+		explicit PermutationHash( const LutType *perm ) : perm( perm ) {}
+		I wrap( I i ) const { return S::andi( i, S::set1i( 0xff ) ); }
+		I operator()( I i, I j ) const
+		{
+			return S::gather( perm, S::addi( wrap( i ), S::gather( perm, wrap( j ) ) ) );
+		}
+		I operator()( I i, I j, I k ) const
+		{
+			return S::gather( perm, S::addi( wrap( i ), S::gather( perm, S::addi( wrap( j ), S::gather( perm, wrap( k ) ) ) ) ) );
+		}
+	};
+	
+	// IntegerHash mixes the cell coordinates and the seed with multiplies
+	// and shifts (the lowbias32 finalizer): no table and no gather, a new
+	// seed costs nothing and the lattice does not repeat. latticeHash() in
+	// HeightmapGeneration.glsl computes the same values.
+	template<typename S>
+	struct IntegerHash {
+		typedef typename S::I I;
+		uint32_t seed;
+		
+		explicit IntegerHash( uint32_t s ) : seed( s * 0x9e3779b9u ) {}
+		I mix( I h ) const
+		{
+			h = S::xori( h, S::template srli<16>( h ) );
+			h = S::muli( h, S::set1i( 0x7feb352d ) );
+			h = S::xori( h, S::template srli<15>( h ) );
+			h = S::muli( h, S::set1i( (int32_t)0x846ca68bu ) );
+			h = S::xori( h, S::template srli<16>( h ) );
+			return S::andi( h, S::set1i( 0xff ) );
+		}
+		I operator()( I i, I j ) const
+		{
+			return mix( S::xori( S::set1i( (int32_t)seed ),
+			            S::xori( S::muli( i, S::set1i( (int32_t)0x8da6b343u ) ), S::muli( j, S::set1i( (int32_t)0xd8163841u ) ) ) ) );
+		}
+		I operator()( I i, I j, I k ) const
+		{
+			return mix( S::xori( S::xori( S::set1i( (int32_t)seed ), S::muli( k, S::set1i( (int32_t)0xcb1ab31fu ) ) ),
+			            S::xori( S::muli( i, S::set1i( (int32_t)0x8da6b343u ) ), S::muli( j, S::set1i( (int32_t)0xd8163841u ) ) ) ) );
+		}
+	};
+	
+	template<typename S>
+	typename S::M hasBits( typename S::I hash, int32_t bits, int32_t value )
+	{
+		return S::equal( S::andi( hash, S::set1i( bits ) ), S::set1i( value ) );
+	}
+	
+	// same as grad( int hash, float x, float y )
+	template<typename S>
+	typename S::F gradBatch( typename S::I hash, typename S::F x, typename S::F y )
+	{
+		typename S::M swap = hasBits<S>( hash, 4, 4 ); // h >= 4
+		typename S::F u = S::select( swap, y, x );
+		typename S::F v = S::mul( S::select( swap, x, y ), S::set1( 2.0f ) );
+		
+		u = S::select( hasBits<S>( hash, 1, 1 ), S::neg( u ), u );
+		v = S::select( hasBits<S>( hash, 2, 2 ), S::neg( v ), v );
+		return S::add( u, v );
+	}
+	
+	// same as grad( int hash, float x, float y, float z )
+	template<typename S>
+	typename S::F gradBatch( typename S::I hash, typename S::F x, typename S::F y, typename S::F z )
+	{
+		typename S::F u = S::select( hasBits<S>( hash, 8, 0 ), x, y );  // h < 8
+		typename S::F v = S::select( hasBits<S>( hash, 12, 0 ), y,      // h < 4
+						  S::select( hasBits<S>( hash, 13, 12 ), x, z ) ); // h == 12 || h == 14
+		
+		u = S::select( hasBits<S>( hash, 1, 1 ), S::neg( u ), u );
+		v = S::select( hasBits<S>( hash, 2, 2 ), S::neg( v ), v );
+		return S::add( u, v );
+	}
+	
+	// t^4 * grad for a corner, with t = max( r - |d|^2, 0 )
+	template<typename S>
+	typename S::F cornerBatch( typename S::F t, typename S::F g )
+	{
+		t = S::max( t, S::set1( 0.0f ) );
+		t = S::mul( t, t );
+		return S::mul( S::mul( t, t ), g );
+	}
+	
+	// adds the gradient of a corner contribution to dx, dy, dz:
+	// d( t^4 * grad ) = -8 t^3 grad * ( x, y, z ) + t^4 * ( gx, gy, gz ). The
+	// gradient vector of a hash is grad() evaluated on the unit axes.
+	template<typename S>
+	void cornerGradientBatch( typename S::I hash, typename S::F t, typename S::F g,
+							 typename S::F x, typename S::F y, typename S::F z, typename S::F d[3] )
+	{
+		typedef typename S::F F;
+		const F zero = S::set1( 0.0f );
+		const F one  = S::set1( 1.0f );
+		
+		t = S::max( t, zero );
+		const F t2 = S::mul( t, t );
+		const F t4 = S::mul( t2, t2 );
+		const F k  = S::mul( S::mul( S::mul( t2, t ), g ), S::set1( -8.0f ) );
+		d[0] = S::add( d[0], S::add( S::mul( k, x ), S::mul( t4, gradBatch<S>( hash, one, zero, zero ) ) ) );
+		d[1] = S::add( d[1], S::add( S::mul( k, y ), S::mul( t4, gradBatch<S>( hash, zero, one, zero ) ) ) );
+		d[2] = S::add( d[2], S::add( S::mul( k, z ), S::mul( t4, gradBatch<S>( hash, zero, zero, one ) ) ) );
+	}
+	
+	template<typename S, typename H>
+	typename S::F noiseBatch( const H &hash, typename S::F x, typename S::F y )
+	{
+		typedef typename S::F F;
+		typedef typename S::I I;
+		
+		// skew, find the cell and unskew its origin
+		const F s  = S::mul( S::add( x, y ), S::set1( F2 ) );
+		const I i  = fastFloorBatch<S>( S::add( x, s ) );
+		const I j  = fastFloorBatch<S>( S::add( y, s ) );
+		const F fi = S::toFloat( i );
+		const F fj = S::toFloat( j );
+		const F t  = S::mul( S::toFloat( S::addi( i, j ) ), S::set1( G2 ) );
+		const F x0 = S::sub( x, S::sub( fi, t ) );
+		const F y0 = S::sub( y, S::sub( fj, t ) );
+		
+		// middle corner: (1,0) in the lower triangle, (0,1) in the upper one
+		const typename S::M lower = S::greater( x0, y0 );
+		const F i1 = S::maskToOne( lower );
+		const F j1 = S::sub( S::set1( 1.0f ), i1 );
+		const F x1 = S::add( S::sub( x0, i1 ), S::set1( G2 ) );
+		const F y1 = S::add( S::sub( y0, j1 ), S::set1( G2 ) );
+		const F x2 = S::add( S::sub( x0, S::set1( 1.0f ) ), S::set1( 2.0f * G2 ) );
+		const F y2 = S::add( S::sub( y0, S::set1( 1.0f ) ), S::set1( 2.0f * G2 ) );
+		
+		// hash the corners
+		const I one = S::set1i( 1 );
+		const I ii1 = S::maskToInt( lower );
+		const I jj1 = S::subi( one, ii1 );
+		const I h0  = hash( i, j );
+		const I h1  = hash( S::addi( i, ii1 ), S::addi( j, jj1 ) );
+		const I h2  = hash( S::addi( i, one ), S::addi( j, one ) );
+		
+		// corner contributions
+		const F r  = S::set1( 0.5f );
+		const F n0 = cornerBatch<S>( S::sub( S::sub( r, S::mul( x0, x0 ) ), S::mul( y0, y0 ) ), gradBatch<S>( h0, x0, y0 ) );
+		const F n1 = cornerBatch<S>( S::sub( S::sub( r, S::mul( x1, x1 ) ), S::mul( y1, y1 ) ), gradBatch<S>( h1, x1, y1 ) );
+		const F n2 = cornerBatch<S>( S::sub( S::sub( r, S::mul( x2, x2 ) ), S::mul( y2, y2 ) ), gradBatch<S>( h2, x2, y2 ) );
+		
+		return S::mul( S::set1( 40.0f ), S::add( S::add( n0, n1 ), n2 ) );
+	}
+	
+	// also returns the exact gradient of the noise when gradient is not NULL
+	template<typename S, typename H>
+	typename S::F noiseBatch( const H &hash, typename S::F x, typename S::F y, typename S::F z,
+							 typename S::F *gradient = NULL )
+	{
+		typedef typename S::F F;
+		typedef typename S::I I;
+		typedef typename S::M M;
+		
+		// skew, find the cell and unskew its origin
+		const F s  = S::mul( S::add( S::add( x, y ), z ), S::set1( F3 ) );
+		const I i  = fastFloorBatch<S>( S::add( x, s ) );
+		const I j  = fastFloorBatch<S>( S::add( y, s ) );
+		const I k  = fastFloorBatch<S>( S::add( z, s ) );
+		const F fi = S::toFloat( i );
+		const F fj = S::toFloat( j );
+		const F fk = S::toFloat( k );
+		const F t  = S::mul( S::toFloat( S::addi( S::addi( i, j ), k ) ), S::set1( G3 ) );
+		const F x0 = S::sub( x, S::sub( fi, t ) );
+		const F y0 = S::sub( y, S::sub( fj, t ) );
+		const F z0 = S::sub( z, S::sub( fk, t ) );
+		
+		// the two middle corners of the tetrahedron, from the rank of x0, y0, z0
+		const M xy = S::greaterEqual( x0, y0 );
+		const M yz = S::greaterEqual( y0, z0 );
+		const M xz = S::greaterEqual( x0, z0 );
+		const M c1[3] = {
+			S::andm( xy, xz ),
+			S::andm( S::notm( xy ), yz ),
+			S::andm( S::notm( xz ), S::notm( yz ) )
+		};
+		const M c2[3] = {
+			S::orm( xy, xz ),
+			S::orm( S::notm( xy ), yz ),
+			S::orm( S::notm( xz ), S::notm( yz ) )
+		};
+		const F x1 = S::add( S::sub( x0, S::maskToOne( c1[0] ) ), S::set1( G3 ) );
+		const F y1 = S::add( S::sub( y0, S::maskToOne( c1[1] ) ), S::set1( G3 ) );
+		const F z1 = S::add( S::sub( z0, S::maskToOne( c1[2] ) ), S::set1( G3 ) );
+		const F x2 = S::add( S::sub( x0, S::maskToOne( c2[0] ) ), S::set1( 2.0f * G3 ) );
+		const F y2 = S::add( S::sub( y0, S::maskToOne( c2[1] ) ), S::set1( 2.0f * G3 ) );
+		const F z2 = S::add( S::sub( z0, S::maskToOne( c2[2] ) ), S::set1( 2.0f * G3 ) );
+		const F x3 = S::add( S::sub( x0, S::set1( 1.0f ) ), S::set1( 3.0f * G3 ) );
+		const F y3 = S::add( S::sub( y0, S::set1( 1.0f ) ), S::set1( 3.0f * G3 ) );
+		const F z3 = S::add( S::sub( z0, S::set1( 1.0f ) ), S::set1( 3.0f * G3 ) );
+		
+		// hash the corners
+		const I one = S::set1i( 1 );
+		const I i1  = S::addi( i, S::maskToInt( c1[0] ) );
+		const I j1  = S::addi( j, S::maskToInt( c1[1] ) );
+		const I k1  = S::addi( k, S::maskToInt( c1[2] ) );
+		const I i2  = S::addi( i, S::maskToInt( c2[0] ) );
+		const I j2  = S::addi( j, S::maskToInt( c2[1] ) );
+		const I k2  = S::addi( k, S::maskToInt( c2[2] ) );
+		const I h0  = hash( i, j, k );
+		const I h1  = hash( i1, j1, k1 );
+		const I h2  = hash( i2, j2, k2 );
+		const I h3  = hash( S::addi( i, one ), S::addi( j, one ), S::addi( k, one ) );
+		
+		// corner contributions
+		const F r  = S::set1( 0.6f );
+		const F t0 = S::sub( S::sub( S::sub( r, S::mul( x0, x0 ) ), S::mul( y0, y0 ) ), S::mul( z0, z0 ) );
+		const F t1 = S::sub( S::sub( S::sub( r, S::mul( x1, x1 ) ), S::mul( y1, y1 ) ), S::mul( z1, z1 ) );
+		const F t2 = S::sub( S::sub( S::sub( r, S::mul( x2, x2 ) ), S::mul( y2, y2 ) ), S::mul( z2, z2 ) );
+		const F t3 = S::sub( S::sub( S::sub( r, S::mul( x3, x3 ) ), S::mul( y3, y3 ) ), S::mul( z3, z3 ) );
+		const F g0 = gradBatch<S>( h0, x0, y0, z0 );
+		const F g1 = gradBatch<S>( h1, x1, y1, z1 );
+		const F g2 = gradBatch<S>( h2, x2, y2, z2 );
+		const F g3 = gradBatch<S>( h3, x3, y3, z3 );
+		const F n0 = cornerBatch<S>( t0, g0 );
+		const F n1 = cornerBatch<S>( t1, g1 );
+		const F n2 = cornerBatch<S>( t2, g2 );
+		const F n3 = cornerBatch<S>( t3, g3 );
+		
+		if( gradient ) {
+			gradient[0] = gradient[1] = gradient[2] = S::set1( 0.0f );
+			cornerGradientBatch<S>( h0, t0, g0, x0, y0, z0, gradient );
+			cornerGradientBatch<S>( h1, t1, g1, x1, y1, z1, gradient );
+			cornerGradientBatch<S>( h2, t2, g2, x2, y2, z2, gradient );
+			cornerGradientBatch<S>( h3, t3, g3, x3, y3, z3, gradient );
+			for( int d = 0; d < 3; ++d )
+				gradient[d] = S::mul( S::set1( 32.0f ), gradient[d] );
+		}
+		
+		return S::mul( S::set1( 32.0f ), S::add( S::add( S::add( n0, n1 ), n2 ), n3 ) );
+	}
+	
+	// the four corners of the simplex of a batch of 3D positions: offsets
+	// from the position, hashes and attenuations r - |offset|^2 (not clamped)
+	template<typename S>
+	struct SimplexCorners3 {
+		typename S::F x[4], y[4], z[4], t[4];
+		typename S::I hash[4];
+	};
+	
+	template<typename S, typename H>
+	void simplexCornersBatch( const H &hash, typename S::F x, typename S::F y, typename S::F z,
+							  SimplexCorners3<S> &c )
+	{
+		typedef typename S::F F;
+		typedef typename S::I I;
+		typedef typename S::M M;
+		
+		// skew, find the cell and unskew its origin
+		const F s  = S::mul( S::add( S::add( x, y ), z ), S::set1( F3 ) );
+		const I i  = fastFloorBatch<S>( S::add( x, s ) );
+		const I j  = fastFloorBatch<S>( S::add( y, s ) );
+		const I k  = fastFloorBatch<S>( S::add( z, s ) );
+		const F fi = S::toFloat( i );
+		const F fj = S::toFloat( j );
+		const F fk = S::toFloat( k );
+		const F t  = S::mul( S::toFloat( S::addi( S::addi( i, j ), k ) ), S::set1( G3 ) );
+		const F x0 = S::sub( x, S::sub( fi, t ) );
+		const F y0 = S::sub( y, S::sub( fj, t ) );
+		const F z0 = S::sub( z, S::sub( fk, t ) );
+		
+		// the two middle corners of the tetrahedron, from the rank of x0, y0, z0
+		const M xy = S::greaterEqual( x0, y0 );
+		const M yz = S::greaterEqual( y0, z0 );
+		const M xz = S::greaterEqual( x0, z0 );
+		const M c1[3] = {
+			S::andm( xy, xz ),
+			S::andm( S::notm( xy ), yz ),
+			S::andm( S::notm( xz ), S::notm( yz ) )
+		};
+		const M c2[3] = {
+			S::orm( xy, xz ),
+			S::orm( S::notm( xy ), yz ),
+			S::orm( S::notm( xz ), S::notm( yz ) )
+		};
+		c.x[0] = x0;
+		c.y[0] = y0;
+		c.z[0] = z0;
+		c.x[1] = S::add( S::sub( x0, S::maskToOne( c1[0] ) ), S::set1( G3 ) );
+		c.y[1] = S::add( S::sub( y0, S::maskToOne( c1[1] ) ), S::set1( G3 ) );
+		c.z[1] = S::add( S::sub( z0, S::maskToOne( c1[2] ) ), S::set1( G3 ) );
+		c.x[2] = S::add( S::sub( x0, S::maskToOne( c2[0] ) ), S::set1( 2.0f * G3 ) );
+		c.y[2] = S::add( S::sub( y0, S::maskToOne( c2[1] ) ), S::set1( 2.0f * G3 ) );
+		c.z[2] = S::add( S::sub( z0, S::maskToOne( c2[2] ) ), S::set1( 2.0f * G3 ) );
+		c.x[3] = S::add( S::sub( x0, S::set1( 1.0f ) ), S::set1( 3.0f * G3 ) );
+		c.y[3] = S::add( S::sub( y0, S::set1( 1.0f ) ), S::set1( 3.0f * G3 ) );
+		c.z[3] = S::add( S::sub( z0, S::set1( 1.0f ) ), S::set1( 3.0f * G3 ) );
+		
+		// hash the corners
+		const I one = S::set1i( 1 );
+		const I i1  = S::addi( i, S::maskToInt( c1[0] ) );
+		const I j1  = S::addi( j, S::maskToInt( c1[1] ) );
+		const I k1  = S::addi( k, S::maskToInt( c1[2] ) );
+		const I i2  = S::addi( i, S::maskToInt( c2[0] ) );
+		const I j2  = S::addi( j, S::maskToInt( c2[1] ) );
+		const I k2  = S::addi( k, S::maskToInt( c2[2] ) );
+		c.hash[0] = hash( i, j, k );
+		c.hash[1] = hash( i1, j1, k1 );
+		c.hash[2] = hash( i2, j2, k2 );
+		c.hash[3] = hash( S::addi( i, one ), S::addi( j, one ), S::addi( k, one ) );
+		
+		const F r = S::set1( 0.6f );
+		for( int n = 0; n < 4; ++n )
+			c.t[n] = S::sub( S::sub( S::sub( r, S::mul( c.x[n], c.x[n] ) ), S::mul( c.y[n], c.y[n] ) ), S::mul( c.z[n], c.z[n] ) );
+	}
+	
+	// Blends the layers of a recipe over a batch of 3D positions. The
+	// channels of each octave are accumulated over the corners of the same
+	// simplex: the value, its gradient (for the IQ layers) and, for the FLOW
+	// layers, the parts of the value that a rotation of the gradients around
+	// y mixes: with g' = ( c gx - s gz, gy, s gx + c gz ), g'.d is
+	// c ( g.d - gy dy ) + s ( gx dz - gz dx ) + gy dy.
+	template<typename S, typename H>
+	void recipeBatch( const H &hash, const NoiseRecipe &recipe, const float *const coords[3], float *out,
+					  float *const *layers, size_t count )
+	{
+		typedef typename S::F F;
+		const int layerCount = recipe.layerCount;
+		bool derivatives = false, flow = false;
+		float cosines[NoiseRecipe::MAX_LAYERS], sines[NoiseRecipe::MAX_LAYERS];
+		
+		for( int l = 0; l < layerCount; ++l ){
+			derivatives = derivatives || recipe.layers[l].type == NoiseRecipe::IQ;
+			flow = flow || recipe.layers[l].type == NoiseRecipe::FLOW;
+			cosines[l] = cosf( recipe.layers[l].param );
+			sines[l] = sinf( recipe.layers[l].param );
+		}
+		
+		for( size_t i = 0; i < count; i += S::WIDTH ){
+			const size_t n = count - i < (size_t)S::WIDTH ? count - i : (size_t)S::WIDTH;
+			float padded[3][S::WIDTH];
+			float result[S::WIDTH];
+			F p[3];
+			
+			for( int d = 0; d < 3; ++d ){
+				if( n == (size_t)S::WIDTH ) {
+					p[d] = S::load( coords[d] + i );
+				}
+				else {
+					memset( padded[d], 0, sizeof( padded[d] ) );
+					memcpy( padded[d], coords[d] + i, n * sizeof( float ) );
+					p[d] = S::load( padded[d] );
+				}
+			}
+			
+			const F zero = S::set1( 0.0f );
+			const F one = S::set1( 1.0f );
+			F sum[NoiseRecipe::MAX_LAYERS], prev[NoiseRecipe::MAX_LAYERS];
+			float amp[NoiseRecipe::MAX_LAYERS];
+			F gradientSum[3] = { zero, zero, zero };
+			float freq = 1.0f;
+			for( int l = 0; l < layerCount; ++l ){
+				sum[l] = zero;
+				prev[l] = one;
+				amp[l] = 0.5f;
+			}
+			
+			for( uint8_t o = 0; o < recipe.octaves; o++ ){
+				const F f = S::set1( freq );
+				SimplexCorners3<S> c;
+				simplexCornersBatch<S>( hash, S::mul( p[0], f ), S::mul( p[1], f ), S::mul( p[2], f ), c );
+				
+				F value = zero, valueY = zero, across = zero;
+				F gradient[3] = { zero, zero, zero };
+				for( int k = 0; k < 4; ++k ){
+					const F g  = gradBatch<S>( c.hash[k], c.x[k], c.y[k], c.z[k] );
+					const F t  = S::max( c.t[k], zero );
+					const F t2 = S::mul( t, t );
+					const F t4 = S::mul( t2, t2 );
+					value = S::add( value, S::mul( t4, g ) );
+					
+					if( derivatives ) {
+						const F w = S::mul( S::mul( S::mul( t2, t ), g ), S::set1( -8.0f ) );
+						gradient[0] = S::add( gradient[0], S::add( S::mul( w, c.x[k] ), S::mul( t4, gradBatch<S>( c.hash[k], one, zero, zero ) ) ) );
+						gradient[1] = S::add( gradient[1], S::add( S::mul( w, c.y[k] ), S::mul( t4, gradBatch<S>( c.hash[k], zero, one, zero ) ) ) );
+						gradient[2] = S::add( gradient[2], S::add( S::mul( w, c.z[k] ), S::mul( t4, gradBatch<S>( c.hash[k], zero, zero, one ) ) ) );
+					}
+					if( flow ) {
+						const F gx = gradBatch<S>( c.hash[k], one, zero, zero );
+						const F gy = gradBatch<S>( c.hash[k], zero, one, zero );
+						const F gz = gradBatch<S>( c.hash[k], zero, zero, one );
+						valueY = S::add( valueY, S::mul( t4, S::mul( gy, c.y[k] ) ) );
+						across = S::add( across, S::mul( t4, S::sub( S::mul( gx, c.z[k] ), S::mul( gz, c.x[k] ) ) ) );
+					}
+				}
+				
+				const F scale = S::set1( 32.0f );
+				value = S::mul( value, scale );
+				valueY = S::mul( valueY, scale );
+				across = S::mul( across, scale );
+				F damping = one;
+				if( derivatives ) {
+					for( int d = 0; d < 3; ++d ){
+						gradientSum[d] = S::add( gradientSum[d], S::mul( gradient[d], scale ) );
+						damping = S::add( damping, S::mul( gradientSum[d], gradientSum[d] ) );
+					}
+				}
+				
+				for( int l = 0; l < layerCount; ++l ){
+					const NoiseRecipe::Layer &layer = recipe.layers[l];
+					const F a = S::set1( amp[l] );
+					F v;
+					
+					switch( layer.type ) {
+						case NoiseRecipe::RIDGED:
+							// same as ridge()
+							v = S::sub( S::set1( layer.param ), S::max( value, S::neg( value ) ) );
+							v = S::mul( v, v );
+							sum[l] = S::add( sum[l], S::mul( S::mul( v, a ), prev[l] ) );
+							prev[l] = v;
+							break;
+						case NoiseRecipe::IQ:
+							sum[l] = S::add( sum[l], S::div( S::mul( a, value ), damping ) );
+							break;
+						case NoiseRecipe::FLOW:
+							v = S::add( S::mul( S::set1( cosines[l] ), S::sub( value, valueY ) ), S::mul( S::set1( sines[l] ), across ) );
+							sum[l] = S::add( sum[l], S::mul( a, S::add( v, valueY ) ) );
+							break;
+						default:
+							sum[l] = S::add( sum[l], S::mul( a, value ) );
+							break;
+					}
+					amp[l] *= layer.gain;
+				}
+				freq *= recipe.lacunarity;
+			}
+			
+			F blend = zero;
+			for( int l = 0; l < layerCount; ++l )
+				blend = S::add( blend, S::mul( sum[l], S::set1( recipe.layers[l].weight ) ) );
+			
+			if( n == (size_t)S::WIDTH ) {
+				S::store( out + i, blend );
+				for( int l = 0; layers && l < layerCount; ++l )
+					if( layers[l] )
+						S::store( layers[l] + i, sum[l] );
+			}
+			else {
+				S::store( result, blend );
+				memcpy( out + i, result, n * sizeof( float ) );
+				for( int l = 0; layers && l < layerCount; ++l ){
+					if( layers[l] ) {
+						S::store( result, sum[l] );
+						memcpy( layers[l] + i, result, n * sizeof( float ) );
+					}
+				}
+			}
+		}
+	}
+	
+	// Sums the octaves of a batch of dim-dimensional positions given as
+	// separate coordinate arrays; the last incomplete batch is zero-padded.
+	// When gradients is not NULL (3D only), the exact gradient of the sum is
+	// written to gradients[0..2].
+	template<typename S, typename H>
+	void fBmBatch( const H &hash, int dim, const float *const coords[3], float *out, float *const *gradients,
+				  size_t count, uint8_t octaves, float lacunarity, float gain, float amplitude )
+	{
+		typedef typename S::F F;
+		
+		for( size_t i = 0; i < count; i += S::WIDTH ){
+			const size_t n = count - i < (size_t)S::WIDTH ? count - i : (size_t)S::WIDTH;
+			float padded[3][S::WIDTH];
+			float result[S::WIDTH];
+			F p[3];
+			
+			for( int d = 0; d < dim; ++d ){
+				if( n == (size_t)S::WIDTH ) {
+					p[d] = S::load( coords[d] + i );
+				}
+				else {
+					memset( padded[d], 0, sizeof( padded[d] ) );
+					memcpy( padded[d], coords[d] + i, n * sizeof( float ) );
+					p[d] = S::load( padded[d] );
+				}
+			}
+			
+			F sum = S::set1( 0.0f );
+			F gradientSum[3] = { sum, sum, sum };
+			float freq = 1.0f;
+			float amp = amplitude;
+			for( uint8_t o = 0; o < octaves; o++ ){
+				const F f = S::set1( freq );
+				F gradient[3];
+				const F n = dim == 2
+						  ? noiseBatch<S>( hash, S::mul( p[0], f ), S::mul( p[1], f ) )
+						  : noiseBatch<S>( hash, S::mul( p[0], f ), S::mul( p[1], f ), S::mul( p[2], f ), gradients ? gradient : NULL );
+				sum   = S::add( sum, S::mul( n, S::set1( amp ) ) );
+				if( gradients ) {
+					for( int d = 0; d < 3; ++d )
+						gradientSum[d] = S::add( gradientSum[d], S::mul( gradient[d], S::set1( amp * freq ) ) );
+				}
+				freq *= lacunarity;
+				amp  *= gain;
+			}
+			
+			if( n == (size_t)S::WIDTH ) {
+				S::store( out + i, sum );
+				for( int d = 0; gradients && d < 3; ++d )
+					S::store( gradients[d] + i, gradientSum[d] );
+			}
+			else {
+				S::store( result, sum );
+				memcpy( out + i, result, n * sizeof( float ) );
+				for( int d = 0; gradients && d < 3; ++d ){
+					S::store( result, gradientSum[d] );
+					memcpy( gradients[d] + i, result, n * sizeof( float ) );
+				}
+			}
+		}
+	}
+}
+
+void NoiseContext::noise( const float *x, const float *y, float *out, size_t count ) const
+{
+	const float *coords[3] = { x, y, NULL };
+	fBmBatch( 2, coords, out, NULL, count, 1, 1.0f, 1.0f, 1.0f );
+}
+void NoiseContext::noise( const float *x, const float *y, const float *z, float *out, size_t count ) const
+{
+	const float *coords[3] = { x, y, z };
+	fBmBatch( 3, coords, out, NULL, count, 1, 1.0f, 1.0f, 1.0f );
+}
+void NoiseContext::noise( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count ) const
+{
+	const float *coords[3] = { x, y, z };
+	float *const gradients[3] = { dx, dy, dz };
+	fBmBatch( 3, coords, out, gradients, count, 1, 1.0f, 1.0f, 1.0f );
+}
+void NoiseContext::fBm( const float *x, const float *y, float *out, size_t count, uint8_t octaves, float lacunarity, float gain ) const
+{
+	const float *coords[3] = { x, y, NULL };
+	fBmBatch( 2, coords, out, NULL, count, octaves, lacunarity, gain, 0.5f );
+}
+void NoiseContext::fBm( const float *x, const float *y, const float *z, float *out, size_t count, uint8_t octaves, float lacunarity, float gain ) const
+{
+	const float *coords[3] = { x, y, z };
+	fBmBatch( 3, coords, out, NULL, count, octaves, lacunarity, gain, 0.5f );
+}
+void NoiseContext::fBm( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count, uint8_t octaves, float lacunarity, float gain ) const
+{
+	const float *coords[3] = { x, y, z };
+	float *const gradients[3] = { dx, dy, dz };
+	fBmBatch( 3, coords, out, gradients, count, octaves, lacunarity, gain, 0.5f );
+}
+void NoiseContext::fBm( const NoiseRecipe &recipe, const float *x, const float *y, const float *z, float *out, size_t count, float *const *layers ) const
+{
+	const float *coords[3] = { x, y, z };
+	if( m_basis == INTEGER_HASH )
+		details::recipeBatch<details::SimdBatch>( details::IntegerHash<details::SimdBatch>( m_seed ), recipe, coords, out, layers, count );
+	else
+		details::recipeBatch<details::SimdBatch>( details::PermutationHash<details::SimdBatch>( m_perm ), recipe, coords, out, layers, count );
+}
+int NoiseContext::batchWidth()
+{
+	return details::SimdBatch::WIDTH;
+}
+
+void NoiseContext::fBmBatch( int dim, const float *const coords[3], float *out, float *const *gradients,
+							 size_t count, uint8_t octaves, float lacunarity, float gain, float amplitude ) const
+{
+	if( m_basis == INTEGER_HASH )
+		details::fBmBatch<details::SimdBatch>( details::IntegerHash<details::SimdBatch>( m_seed ), dim, coords, out, gradients,
+											   count, octaves, lacunarity, gain, amplitude );
+	else
+		details::fBmBatch<details::SimdBatch>( details::PermutationHash<details::SimdBatch>( m_perm ), dim, coords, out, gradients,
+											   count, octaves, lacunarity, gain, amplitude );
+}
+
+NoiseContext::NoiseContext()
+	: m_basis( PERMUTATION ), m_seed( 0 )
+{
+	memcpy( m_perm, details::perm, sizeof( m_perm ) );
+}
+NoiseContext::NoiseContext( uint32_t s, Basis basis )
+	: m_basis( basis ), m_seed( s )
+{
+	memcpy( m_perm, details::perm, sizeof( m_perm ) );
+	seed( s );
+}
+
+void NoiseContext::seed( uint32_t s )
+{
+	m_seed = s;
+	std::mt19937 gen( s );
+	std::uniform_int_distribution<> distribution( 1, 255 );
+	for( size_t i = 0; i < 256; ++i ) {
+		m_perm[i] = m_perm[i + 256] = distribution( gen );
+	}
+}
+
+namespace details {
+	inline NoiseContext &defaultContext()
+	{
+		static NoiseContext context;
+		return context;
+	}
+}
+
+// free functions, using the default context
+
+float noise( float x )
+{
+	return details::defaultContext().noise( x );
+}
+float noise( const glm::vec2 &v )
+{
+	return details::defaultContext().noise( v );
+}
+float noise( const glm::vec3 &v )
+{
+	return details::defaultContext().noise( v );
+}
+float noise( const glm::vec4 &v )
+{
+	return details::defaultContext().noise( v );
+}
+float ridgedNoise( float x )
+{
+	return details::defaultContext().ridgedNoise( x );
+}
+float ridgedNoise( const glm::vec2 &v )
+{
+	return details::defaultContext().ridgedNoise( v );
+}
+float ridgedNoise( const glm::vec3 &v )
+{
+	return details::defaultContext().ridgedNoise( v );
+}
+float ridgedNoise( const glm::vec4 &v )
+{
+	return details::defaultContext().ridgedNoise( v );
+}
+glm::vec2 dnoise( float x )
+{
+	return details::defaultContext().dnoise( x );
+}
+glm::vec3 dnoise( const glm::vec2 &v )
+{
+	return details::defaultContext().dnoise( v );
+}
+glm::vec4 dnoise( const glm::vec3 &v )
+{
+	return details::defaultContext().dnoise( v );
+}
+vec5 dnoise( const glm::vec4 &v )
+{
+	return details::defaultContext().dnoise( v );
+}
+float worleyNoise( const glm::vec2 &v )
+{
+	return details::defaultContext().worleyNoise( v );
+}
+float worleyNoise( const glm::vec3 &v )
+{
+	return details::defaultContext().worleyNoise( v );
+}
+float worleyNoise( const glm::vec2 &v, float falloff )
+{
+	return details::defaultContext().worleyNoise( v, falloff );
+}
+float worleyNoise( const glm::vec3 &v, float falloff )
+{
+	return details::defaultContext().worleyNoise( v, falloff );
+}
+float flowNoise( const glm::vec2 &v, float angle )
+{
+	return details::defaultContext().flowNoise( v, angle );
+}
+float flowNoise( const glm::vec3 &v, float angle )
+{
+	return details::defaultContext().flowNoise( v, angle );
+}
+glm::vec3 dFlowNoise( const glm::vec2 &v, float angle )
+{
+	return details::defaultContext().dFlowNoise( v, angle );
+}
+glm::vec4 dFlowNoise( const glm::vec3 &v, float angle )
+{
+	return details::defaultContext().dFlowNoise( v, angle );
+}
+glm::vec2 curlNoise( const glm::vec2 &v )
+{
+	return details::defaultContext().curlNoise( v );
+}
+glm::vec2 curlNoise( const glm::vec2 &v, float t )
+{
+	return details::defaultContext().curlNoise( v, t );
+}
+glm::vec2 curlNoise( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().curlNoise( v, octaves, lacunarity, gain );
+}
+glm::vec3 curlNoise( const glm::vec3 &v )
+{
+	return details::defaultContext().curlNoise( v );
+}
+glm::vec3 curlNoise( const glm::vec3 &v, float t )
+{
+	return details::defaultContext().curlNoise( v, t );
+}
+glm::vec3 curlNoise( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().curlNoise( v, octaves, lacunarity, gain );
+}
+glm::vec2 curl( const glm::vec2 &v, const std::function<float(const glm::vec2&)> &potential, float delta )
+{
+	return details::defaultContext().curl( v, potential, delta );
+}
+glm::vec3 curl( const glm::vec3 &v, const std::function<glm::vec3(const glm::vec3&)> &potential, float delta )
+{
+	return details::defaultContext().curl( v, potential, delta );
+}
+float fBm( float x, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().fBm( x, octaves, lacunarity, gain );
+}
+float fBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().fBm( v, octaves, lacunarity, gain );
+}
+float fBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().fBm( v, octaves, lacunarity, gain );
+}
+float fBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().fBm( v, octaves, lacunarity, gain );
+}
+void noise( const float *x, const float *y, float *out, size_t count )
+{
+	details::defaultContext().noise( x, y, out, count );
+}
+void noise( const float *x, const float *y, const float *z, float *out, size_t count )
+{
+	details::defaultContext().noise( x, y, z, out, count );
+}
+void noise( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count )
+{
+	details::defaultContext().noise( x, y, z, out, dx, dy, dz, count );
+}
+void fBm( const float *x, const float *y, float *out, size_t count, uint8_t octaves, float lacunarity, float gain )
+{
+	details::defaultContext().fBm( x, y, out, count, octaves, lacunarity, gain );
+}
+void fBm( const float *x, const float *y, const float *z, float *out, size_t count, uint8_t octaves, float lacunarity, float gain )
+{
+	details::defaultContext().fBm( x, y, z, out, count, octaves, lacunarity, gain );
+}
+void fBm( const float *x, const float *y, const float *z, float *out, float *dx, float *dy, float *dz, size_t count, uint8_t octaves, float lacunarity, float gain )
+{
+	details::defaultContext().fBm( x, y, z, out, dx, dy, dz, count, octaves, lacunarity, gain );
+}
+void fBm( const NoiseRecipe &recipe, const float *x, const float *y, const float *z, float *out, size_t count, float *const *layers )
+{
+	details::defaultContext().fBm( recipe, x, y, z, out, count, layers );
+}
+int batchWidth()
+{
+	return NoiseContext::batchWidth();
+}
+float worleyfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().worleyfBm( v, octaves, lacunarity, gain );
+}
+float worleyfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().worleyfBm( v, octaves, lacunarity, gain );
+}
+float worleyfBm( const glm::vec2 &v, float falloff, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().worleyfBm( v, falloff, octaves, lacunarity, gain );
+}
+float worleyfBm( const glm::vec3 &v, float falloff, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().worleyfBm( v, falloff, octaves, lacunarity, gain );
+}
+glm::vec2 dfBm( float x, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().dfBm( x, octaves, lacunarity, gain );
+}
+glm::vec3 dfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().dfBm( v, octaves, lacunarity, gain );
+}
+glm::vec4 dfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().dfBm( v, octaves, lacunarity, gain );
+}
+vec5 dfBm( const glm::vec4 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().dfBm( v, octaves, lacunarity, gain );
+}
+float ridgedMF( float x, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().ridgedMF( x, ridgeOffset, octaves, lacunarity, gain );
+}
+float ridgedMF( const glm::vec2 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().ridgedMF( v, ridgeOffset, octaves, lacunarity, gain );
+}
+float ridgedMF( const glm::vec3 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().ridgedMF( v, ridgeOffset, octaves, lacunarity, gain );
+}
+float ridgedMF( const glm::vec4 &v, float ridgeOffset, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().ridgedMF( v, ridgeOffset, octaves, lacunarity, gain );
+}
+float iqfBm( const glm::vec2 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().iqfBm( v, octaves, lacunarity, gain );
+}
+float iqfBm( const glm::vec3 &v, uint8_t octaves, float lacunarity, float gain )
+{
+	return details::defaultContext().iqfBm( v, octaves, lacunarity, gain );
+}
+float iqMatfBm( const glm::vec2 &v, uint8_t octaves, const glm::mat2 &mat, float gain )
+{
+	return details::defaultContext().iqMatfBm( v, octaves, mat, gain );
+}
+void seed( uint32_t s )
+{
+	details::defaultContext().seed( s );
 }
 	
 #undef FASTFLOOR
@@ -0,0 +1,75 @@
+#include "splat_map.hpp"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+    float fract(float x) {
+        return x - floorf(x);
+    }
+
+    float hash(float n) {
+        return fract(sinf(n) * 1e4f);
+    }
+
+    float mix(float a, float b, float t) {
+        return a + (b - a) * t;
+    }
+
+    // fnoise() of the shader: value noise with a 1D hash of the lattice
+    float valueNoise(float x, float y, float z) {
+        const float ix = floorf(x), iy = floorf(y), iz = floorf(z);
+        const float fx = x - ix, fy = y - iy, fz = z - iz;
+        const float n = ix * 110.0f + iy * 241.0f + iz * 171.0f;
+        const float ux = fx * fx * (3.0f - 2.0f * fx);
+        const float uy = fy * fy * (3.0f - 2.0f * fy);
+        const float uz = fz * fz * (3.0f - 2.0f * fz);
+
+        return mix(mix(mix(hash(n                  ), hash(n + 110.0f                  ), ux),
+                       mix(hash(n + 241.0f         ), hash(n + 110.0f + 241.0f         ), ux), uy),
+                   mix(mix(hash(n + 171.0f         ), hash(n + 110.0f + 171.0f         ), ux),
+                       mix(hash(n + 241.0f + 171.0f), hash(n + 110.0f + 241.0f + 171.0f), ux), uy), uz);
+    }
+}
+
+float SplatMap::fbm(float x, float y, float z, float footprint) {
+    float v = 0.0f;
+    float amplitude = 0.5f;
+    float freq = 1.0f;
+
+    for (int i = 0; i < OCTAVE_COUNT; ++i) {
+        // 1 up to 1/4 cycle per texel, 0 from 1/2 on
+        const float weight = std::min(std::max(2.0f - 4.0f * freq * footprint, 0.0f), 1.0f);
+
+        // a faded octave is its mean, 1/2
+        if (weight == 0.0f)
+            v+= amplitude * 0.5f;
+        else if (weight == 1.0f)
+            v+= amplitude * valueNoise(x * freq, y * freq, z * freq);
+        else
+            v+= amplitude * mix(0.5f, valueNoise(x * freq, y * freq, z * freq), weight);
+        freq*= 1.95f;
+        amplitude*= 0.5f;
+    }
+
+    return v;
+}
+
+void SplatMap::bake(const float *positions, int count,
+                    const float scales[LAYER_COUNT], float texelSize, uint8_t *rgba) {
+    float rcp[LAYER_COUNT];
+
+    for (int k = 0; k < LAYER_COUNT; ++k)
+        rcp[k] = 1.0f / scales[k];
+
+    for (int i = 0; i < count; ++i) {
+        const float *p = &positions[3 * i];
+
+        for (int k = 0; k < LAYER_COUNT; ++k) {
+            const float v = isBaked(scales[k], texelSize)
+                          ? fbm(p[0] * rcp[k], p[1] * rcp[k], p[2] * rcp[k], texelSize * rcp[k])
+                          : 0.5f;
+
+            rgba[4 * i + k] = (uint8_t)std::min(std::max(v * 255.0f + 0.5f, 0.0f), 255.0f);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef SPLAT_MAP_HPP
+#define SPLAT_MAP_HPP
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * SplatMap -- Baked colour blend masks of the diffuse terrain shading
+ *
+ * The diffuse shading blends each height band between two colours with a
+ * fBm of the world position, one per band with its own scale. The fields
+ * only change with the heightmap, the height scale or the noise scales, so
+ * they are baked into an RGBA8 texture over the heightmap texels, channel k
+ * holding the field of scale k (u_NoiseHk), and the fragment shader reads
+ * them with a single fetch.
+ *
+ * fbm() is the ffbm() of TerrainRenderCommon.glsl, evaluated in float like
+ * the shader. The fields are blend weights, so the mips are plain averages.
+ *
+ * The texels point sample the fields, so the bake band-limits them: an
+ * octave fades to its mean between 1/4 and 1/2 cycle per texel, and the
+ * octaves past that cost nothing. A scale under MIN_TEXELS texels would
+ * keep little more than its mean; such a layer is left to the ffbm() of
+ * the shader (see isBaked()) and its channel is not computed.
+ *
+ * Usage:
+ *      SplatMap::bake(positions, count, scales, texelSize, &rgba[4 * first]);    // row by row
+ *
+ */
+class SplatMap {
+public:
+    enum {LAYER_COUNT = 4, OCTAVE_COUNT = 5, MIN_TEXELS = 4};
+
+    // ffbm(vec3(x, y, z)) of the shader, in [0, 1), without the octaves
+    // that are too fine for texels footprint apart (0 keeps them all)
+    static float fbm(float x, float y, float z, float footprint = 0.0f);
+    // true if the layer of the given scale is baked over texels texelSize
+    // apart, in world units
+    static bool isBaked(float scale, float texelSize) {
+        return scale >= MIN_TEXELS * texelSize;
+    }
+    // masks of count texels at the world positions xyz, texelSize apart:
+    // channel k of texel i is fbm(positions[i] / scales[k]), or 1/2 if the
+    // layer is not baked
+    static void bake(const float *positions, int count,
+                     const float scales[LAYER_COUNT], float texelSize, uint8_t *rgba);
+};
+
+#endif
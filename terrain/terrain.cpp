@@ -10,6 +10,20 @@
 #include "grid.h"
 #include "simplex.h"
 #include "erosion.hpp"
+#include "heightmap_generator.hpp"
+#include "noise_layer_cache.hpp"
+#include "progressive_heightmap.hpp"
+#include "height_pyramid.hpp"
+#include "heightmap_cache.hpp"
+#include "tiled_heightmap_file.hpp"
+#include "png_export.hpp"
+#include "noise_spec.hpp"
+#include "noise_spec_gpu.hpp"
+#include "tile_scheduler.hpp"
+#include "tile_streamer.hpp"
+#include "height_clipmap.hpp"
+#include "normal_map.hpp"
+#include "splat_map.hpp"
 #include "OpenSimplexNoise.h"
 #include <cstdio>
 #include <cstdlib>
@@ -46,7 +60,9 @@
 #define LEB_IMPLEMENTATION
 #include "leb.h"
 
-#define LOG(fmt, ...)  fprintf(stdout, fmt, ##__VA_ARGS__); fflush(stdout);
+#include "cbt_buffer.hpp"
+
+#define LOG(fmt, ...)  do { fprintf(stdout, fmt, ##__VA_ARGS__); fflush(stdout); } while (0)
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -69,6 +85,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #define SIZE_TERRAIN 50000
+// níveis do terreno infinito mais finos que o heightmap fixo
+#define STREAMING_DETAIL_LEVELS 8
 
 // -----------------------------------------------------------------------------
 // Framebuffer Manager
@@ -167,6 +185,9 @@ float noiseH3 = 117.f;
 float noiseH2 = 970.f;
 float noiseH1 = 3204.f;
 float noiseH0 = 10000.f;
+// escalas menores ficam com o fBm por fragmento; todas, até as primeiras
+// máscaras de cor ficarem prontas
+float escalaMinimaSplat = 1e30f;
 
 
 //Variaveis personalizaveis do FBM
@@ -178,6 +199,15 @@ int octaves = 16;
 float wavelength = 0.6f;
 float lacunarity = 1.84f;
 float gain = 0.5f;
+int heightmapSize = 1024;
+bool cpuGeneration = false; // fBm 3D na CPU, com cache de oitavas; senão, a NoiseSpec
+int heightmapBackend = TileScheduler::AUTOMATIC; // onde os ladrilhos da NoiseSpec são gerados
+bool progressiveGeneration = false; // publica um nível grosso e refina em segundo plano
+bool integerHash = false; // ruído com hash inteiro dos vértices em vez da tabela de permutação (só o caminho 3D da CPU)
+bool diskCache = true; // reaproveita heightmaps já gerados com os mesmos parâmetros
+int pngExportSize = 4096; // resolução do PNG de 16 bits exportado
+bool streamedTerrain = false; // terreno infinito: ladrilhos gerados ao redor da câmera
+bool clipmapTerrain = false; // detalhe extra da NoiseSpec perto da câmera, num clipmap
 
 
 // ------------------------------
@@ -217,8 +247,18 @@ struct TerrainManager {
     SIZE_TERRAIN
 };
 
-// Criação da grade para o terreno
-grid_t * grid = create_grid(g_terrain.dmap.width, g_terrain.dmap.height);
+// Criação da grade para o terreno; NULL se o mapeamento falhar
+grid_t * criarGrid(int largura, int altura) {
+    grid_t * grid = create_grid(largura, altura);
+
+    if (!grid) {
+        LOG("Erro ao reservar a grade de %ix%i\n", largura, altura);
+    }
+
+    return grid;
+}
+
+grid_t * grid = criarGrid(g_terrain.dmap.width, g_terrain.dmap.height);
 
 // -----------------------------------------------------------------------------
 // Application Manager
@@ -291,7 +331,7 @@ enum {
     CLOCK_COUNT
 };
 enum { FRAMEBUFFER_BACK, FRAMEBUFFER_SCENE, FRAMEBUFFER_COUNT };
-enum { STREAM_TERRAIN_VARIABLES, STREAM_COUNT };
+enum { STREAM_TERRAIN_VARIABLES, STREAM_TERRAIN_STREAMING, STREAM_TERRAIN_CLIPMAP, STREAM_COUNT };
 enum {
     VERTEXARRAY_EMPTY,
     VERTEXARRAY_SPHERE,
@@ -324,6 +364,10 @@ enum {
     TEXTURE_ATMOSPHERE_TRANSMITTANCE,
     TEXTURE_ROCK_DMAP,
     TEXTURE_ROCK_SMAP,
+    TEXTURE_STREAM_HEIGHTS,
+    TEXTURE_STREAM_PAGES,
+    TEXTURE_CLIPMAP,
+    TEXTURE_SPLAT,
 
     TEXTURE_COUNT
 };
@@ -374,6 +418,7 @@ enum {
     UNIFORM_TERRAIN_NOISEH1,
     UNIFORM_TERRAIN_NOISEH2,
     UNIFORM_TERRAIN_NOISEH3,
+    UNIFORM_TERRAIN_SPLAT_MIN_SCALE,
     UNIFORM_TERRAIN_DERIVATIVENORMALS,
     UNIFORM_TERRAIN_APPLYTEXTURENORMALS,
 
@@ -407,6 +452,7 @@ enum {
     UNIFORM_SPLIT_NOISEH1,
     UNIFORM_SPLIT_NOISEH2,
     UNIFORM_SPLIT_NOISEH3,
+    UNIFORM_SPLIT_SPLAT_MIN_SCALE,
     UNIFORM_SPLIT_DERIVATIVENORMALS,
     UNIFORM_SPLIT_TEXTURENORMALS,
     UNIFORM_SPLIT_CAMPOSITION,
@@ -439,6 +485,7 @@ enum {
     UNIFORM_MERGE_NOISEH1,
     UNIFORM_MERGE_NOISEH2,
     UNIFORM_MERGE_NOISEH3,
+    UNIFORM_MERGE_SPLAT_MIN_SCALE,
     UNIFORM_MERGE_DERIVATIVENORMALS,
     UNIFORM_MERGE_TEXTURENORMALS,
     UNIFORM_MERGE_CAMPOSITION,
@@ -471,6 +518,7 @@ enum {
     UNIFORM_RENDER_NOISEH1,
     UNIFORM_RENDER_NOISEH2,
     UNIFORM_RENDER_NOISEH3,
+    UNIFORM_RENDER_SPLAT_MIN_SCALE,
     UNIFORM_RENDER_DERIVATIVENORMALS,
     UNIFORM_RENDER_APPLYTEXTURENORMALS,
     UNIFORM_RENDER_CAMPOSITION,
@@ -651,6 +699,7 @@ void ConfigureTerrainProgram(GLuint glp, GLuint offset)
     glProgramUniform1f(glp, g_gl.uniforms[UNIFORM_TERRAIN_NOISEH1 + offset], noiseH1);
     glProgramUniform1f(glp, g_gl.uniforms[UNIFORM_TERRAIN_NOISEH2 + offset], noiseH2);
     glProgramUniform1f(glp, g_gl.uniforms[UNIFORM_TERRAIN_NOISEH3 + offset], noiseH3);
+    glProgramUniform1f(glp, g_gl.uniforms[UNIFORM_TERRAIN_SPLAT_MIN_SCALE + offset], escalaMinimaSplat);
     
     glProgramUniform3f(glp, g_gl.uniforms[UNIFORM_TERRAIN_COLORH0 + offset], color_backGround0[0],color_backGround0[1],color_backGround0[2]);
     glProgramUniform3f(glp, g_gl.uniforms[UNIFORM_TERRAIN_COLORH1 + offset], color_backGround1[0],color_backGround1[1],color_backGround1[2]);
@@ -860,6 +909,27 @@ bool LoadTerrainProgram(GLuint *glp, const char *flag, GLuint uniformOffset)
         djgp_push_string(djp, "#define FLAG_CULL 1\n");
     if (g_terrain.flags.wire)
         djgp_push_string(djp, "#define FLAG_WIRE 1\n");
+    if (streamedTerrain && g_terrain.flags.displace) {
+        djgp_push_string(djp, "#define FLAG_STREAMING 1\n");
+        djgp_push_string(djp, "#define BUFFER_BINDING_TERRAIN_STREAMING %i\n", STREAM_TERRAIN_STREAMING);
+        djgp_push_string(djp, "#define TEXTURE_BINDING_STREAM_HEIGHTS %i\n", TEXTURE_STREAM_HEIGHTS);
+        djgp_push_string(djp, "#define TEXTURE_BINDING_STREAM_PAGES %i\n", TEXTURE_STREAM_PAGES);
+        djgp_push_string(djp, "#define STREAM_TILE_SIZE %i\n", TileStreamer::TILE_SIZE);
+        djgp_push_string(djp, "#define STREAM_LEVEL_COUNT %i\n", TileStreamer::LEVEL_COUNT);
+        djgp_push_string(djp, "#define STREAM_RING_SIZE %i\n", TileStreamer::RING_SIZE);
+    } else if (clipmapTerrain && g_terrain.flags.displace) {
+        djgp_push_string(djp, "#define FLAG_CLIPMAP 1\n");
+        djgp_push_string(djp, "#define BUFFER_BINDING_TERRAIN_CLIPMAP %i\n", STREAM_TERRAIN_CLIPMAP);
+        djgp_push_string(djp, "#define TEXTURE_BINDING_CLIPMAP %i\n", TEXTURE_CLIPMAP);
+        djgp_push_string(djp, "#define CLIPMAP_SIZE %i\n", HeightClipmap::SIZE);
+        djgp_push_string(djp, "#define CLIPMAP_LEVEL_COUNT %i\n", HeightClipmap::LEVEL_COUNT);
+    }
+    // máscaras de cor pré-calculadas (assarSplat); o terreno infinito sai do
+    // mapa fixo e continua com o fBm por fragmento
+    if (!streamedTerrain && g_terrain.flags.displace) {
+        djgp_push_string(djp, "#define FLAG_SPLAT 1\n");
+        djgp_push_string(djp, "#define TEXTURE_BINDING_SPLAT %i\n", TEXTURE_SPLAT);
+    }
     djgp_push_file(djp, PATH_TO_SRC_DIRECTORY "./terrain/shaders/FrustumCulling.glsl");
     djgp_push_string(djp, "#define CBT_HEAP_BUFFER_BINDING %i\n", BUFFER_LEB);
     djgp_push_string(djp, "#define CBT_READ_ONLY\n");
@@ -932,6 +1002,8 @@ bool LoadTerrainProgram(GLuint *glp, const char *flag, GLuint uniformOffset)
         glGetUniformLocation(*glp, "u_NoiseH2");
     g_gl.uniforms[UNIFORM_TERRAIN_NOISEH3 + uniformOffset] =
         glGetUniformLocation(*glp, "u_NoiseH3");
+    g_gl.uniforms[UNIFORM_TERRAIN_SPLAT_MIN_SCALE + uniformOffset] =
+        glGetUniformLocation(*glp, "u_SplatMinScale");
     g_gl.uniforms[UNIFORM_TERRAIN_DERIVATIVENORMALS + uniformOffset] =
         glGetUniformLocation(*glp, "u_DerivativeNormals");
     g_gl.uniforms[UNIFORM_TERRAIN_APPLYTEXTURENORMALS + uniformOffset] =
@@ -1243,20 +1315,17 @@ bool LoadHeightmapGenerationProgram() {
     }
     LOG("Objeto de compute shader criado com sucesso (ID: %u)\n", computeShader);
 
-    // 2. Carregar código fonte
-    std::string filePath = std::string(PATH_TO_SRC_DIRECTORY) + "./terrain/shaders/HeightmapGeneration.glsl";
-    LOG("Tentando carregar shader de: %s\n", filePath.c_str());
+    // 2. Carregar código fonte (NoiseSpec.glsl + HeightmapGeneration.glsl)
+    std::string shaderDir = std::string(PATH_TO_SRC_DIRECTORY) + "./terrain/shaders/";
+    LOG("Tentando carregar shader de: %s\n", shaderDir.c_str());
     
-    std::ifstream shaderFile(filePath);
-    if (!shaderFile.is_open()) {
+    std::string shaderSource = NoiseSpecGpu::source(shaderDir);
+    if (shaderSource.empty()) {
         LOG("ERRO: Não foi possível abrir o arquivo do shader\n");
         glDeleteShader(computeShader);
         return false;
     }
 
-    std::stringstream buffer;
-    buffer << shaderFile.rdbuf();
-    std::string shaderSource = buffer.str();
     const char* sourcePtr = shaderSource.c_str();
     
     LOG("Código do shader carregado (%zu bytes)\n", shaderSource.size());
@@ -1362,16 +1431,13 @@ bool LoadHeightmapGenerationProgramManual()
     if (glIsProgram(*glp))
         glDeleteProgram(*glp);
     
-    // Carrega o conteúdo do arquivo shader
-    std::ifstream shaderFile(PATH_TO_SRC_DIRECTORY "./terrain/shaders/HeightmapGeneration.glsl");
-    if (!shaderFile) {
+    // Carrega o conteúdo dos arquivos shader
+    std::string shaderSource = NoiseSpecGpu::source(PATH_TO_SRC_DIRECTORY "./terrain/shaders/");
+    if (shaderSource.empty()) {
         LOG("Failed to open heightmap shader file\n");
         return false;
     }
     
-    std::stringstream buffer;
-    buffer << shaderFile.rdbuf();
-    std::string shaderSource = buffer.str();
     const char* sourcePtr = shaderSource.c_str();
     
     // Cria e compila o shader
@@ -1524,293 +1590,1607 @@ bool LoadSceneFramebufferTexture()
                                   g_framebuffer.h,
                                   g_framebuffer.msaa.fixed);
 
-        //LOG("Loading {Scene-MSAA-RGBA-Framebuffer-Texture}\n");
-        glActiveTexture(GL_TEXTURE0 + TEXTURE_CBUF);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, g_gl.textures[TEXTURE_CBUF]);
-        glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE,
-                                  samples,
-                                  GL_RGBA32F,
-                                  g_framebuffer.w,
-                                  g_framebuffer.h,
-                                  g_framebuffer.msaa.fixed);
-    } break;
+        //LOG("Loading {Scene-MSAA-RGBA-Framebuffer-Texture}\n");
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_CBUF);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, g_gl.textures[TEXTURE_CBUF]);
+        glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE,
+                                  samples,
+                                  GL_RGBA32F,
+                                  g_framebuffer.w,
+                                  g_framebuffer.h,
+                                  g_framebuffer.msaa.fixed);
+    } break;
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Load the Normal Texture Map
+ *
+ */
+
+template <typename T, typename I, typename O>
+int MapInRange(T x, I in_min, I in_max, O out_min, O out_max)
+{
+	if(x < in_min) x = in_min;
+	if(x > in_max) x = in_max;
+	return (int)((x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Funções para geração de altura e normalização do terreno
+////////////////////////////////////////////////////////////////////////////////
+
+// Parâmetros do fBm, copiados dos globais no início de cada geração: as
+// passadas em segundo plano não leem os globais que a GUI altera
+struct ParametrosFbm {
+    uint32_t seed;
+    int octaves;
+    float wavelength;
+    float lacunarity;
+    float gain;
+    float elevation;
+    float tamAmostra;   // distância entre dois texels do mapa completo
+    Simplex::NoiseContext::Basis base;
+};
+
+ParametrosFbm parametrosFbm() {
+    ParametrosFbm parametros = {
+        (uint32_t)seeds, octaves, wavelength, lacunarity, gain, elevation,
+        0.0001f * (float)scaleTER,
+        integerHash ? Simplex::NoiseContext::INTEGER_HASH : Simplex::NoiseContext::PERMUTATION
+    };
+
+    return parametros;
+}
+
+// Converte o valor do fBm na altura do terreno. Se escalaDerivada não for
+// nulo, recebe o fator que leva dfBm/dx (ou dfBm/dz) em dh/di (ou dh/dj),
+// para texels espaçados de passo texels do mapa completo
+static inline float alturaDoRuido(const ParametrosFbm& p, float ruido, int passo,
+                                  float *escalaDerivada) {
+    float h = glm::abs(ruido / (float)(p.wavelength));
+    // Aplica elevação do valor (potência)
+    const float potencia = pow(h, (float)(p.elevation));
+
+    // Regra da cadeia: d(wl * |n / wl|^e) / dn = e * |n / wl|^(e - 1) * sinal(n),
+    // e dn/di = wl * tamAmostra * passo * dfBm/dx (idem para j com z)
+    if (escalaDerivada) {
+        *escalaDerivada = 0.0f;
+
+        if (h > 0.0f) {
+            *escalaDerivada = (float)(p.elevation) * (potencia / h)
+                            * (ruido < 0.0f ? -1.0f : 1.0f)
+                            * (float)(p.wavelength) * p.tamAmostra * (float)passo / 1000000.0f;
+        }
+    }
+
+    // Nova altura a partir do ruído
+    h = potencia * (float)(p.wavelength);
+
+    // Trunca em 6 casas decimais
+    return (float)(h) / 1000000.0f;
+}
+
+// Cria-se os vetores de posição dos texels colunas[] da linha j, já
+// multiplicados pelo comprimento de onda. Note que a altura base (-2000.5)
+// entra como y. As coordenadas são as do mapa completo (i * passo), para que
+// todos os níveis amostrem exatamente os mesmos pontos
+static void posicoesLinha(const ParametrosFbm& p, const int *colunas, int n, int j, int passo,
+                          float *px, float *py, float *pz) {
+    for (int k = 0; k < n; k++) {
+        px[k] = p.wavelength * ((float)(colunas[k] * passo) * p.tamAmostra);
+        py[k] = p.wavelength * -2000.5f;
+        pz[k] = p.wavelength * ((float)(j * passo) * p.tamAmostra);
+    }
+}
+
+// Gerar altura utilizando ruído procedural sobre o bloco [x0, x1) x [y0, y1)
+// de um mapa de largura w, com um texel a cada passo texels do mapa completo.
+// O contexto de ruído só é lido, então vários blocos podem ser gerados em paralelo.
+// Se gradientes não for nulo, recebe as derivadas analíticas (dh/di, dh/dj) de
+// cada texel, calculadas junto com o fBm (sem reavaliar as oitavas).
+// Com pularPares, os texels de coordenadas pares (já preenchidos) são pulados
+void gerarAlturaTile(const Simplex::NoiseContext& ruido, const ParametrosFbm& p,
+                     int x0, int y0, int x1, int y1, int w, int passo, bool pularPares,
+                     float *zf_arr, float *gradientes) {
+    std::vector<float> px(x1 - x0), py(x1 - x0), pz(x1 - x0), noiseFBM(x1 - x0);
+    std::vector<float> dx, dy, dz;
+    std::vector<int> colunas;
+
+    if (gradientes) {
+        dx.resize(x1 - x0);
+        dy.resize(x1 - x0);
+        dz.resize(x1 - x0);
+    }
+
+    for (int j = y0; j < y1; j++) {
+        colunas.clear();
+        for (int i = x0; i < x1; i++)
+            if (!pularPares || (i & 1) || (j & 1))
+                colunas.push_back(i);
+
+        const int n = (int)colunas.size();
+
+        posicoesLinha(p, colunas.data(), n, j, passo, px.data(), py.data(), pz.data());
+
+        // Calcula-se o ruído fBm de toda a linha de uma vez (SIMD)
+        if (gradientes)
+            ruido.fBm(px.data(), py.data(), pz.data(), noiseFBM.data(),
+                      dx.data(), dy.data(), dz.data(), n,
+                      p.octaves, p.lacunarity, p.gain);
+        else
+            ruido.fBm(px.data(), py.data(), pz.data(), noiseFBM.data(), n,
+                      p.octaves, p.lacunarity, p.gain);
+
+        for (int k = 0; k < n; k++) {
+            const int texel = colunas[k] + w * j;
+            float escala;
+
+            // Salva no array de alturas
+            zf_arr[texel] = alturaDoRuido(p, noiseFBM[k], passo,
+                                          gradientes ? &escala : NULL);
+
+            if (gradientes) {
+                gradientes[2 * texel    ] = escala * dx[k];
+                gradientes[2 * texel + 1] = escala * dz[k];
+            }
+        }
+    }
+}
+
+// Gerar as alturas dos texels [x0, x1) da linha j em alturas[0 .. x1 - x0)
+void gerarAlturaLinha(const Simplex::NoiseContext& ruido, const ParametrosFbm& p,
+                      int x0, int x1, int j, float *alturas) {
+    const int n = x1 - x0;
+    std::vector<float> px(n), py(n), pz(n), noiseFBM(n);
+    std::vector<int> colunas(n);
+
+    for (int k = 0; k < n; k++)
+        colunas[k] = x0 + k;
+
+    posicoesLinha(p, colunas.data(), n, j, 1, px.data(), py.data(), pz.data());
+    ruido.fBm(px.data(), py.data(), pz.data(), noiseFBM.data(), n,
+              p.octaves, p.lacunarity, p.gain);
+
+    for (int k = 0; k < n; k++)
+        alturas[k] = alturaDoRuido(p, noiseFBM[k], 1, NULL);
+}
+
+void gerarAltura(int startH, int endH, int w, float tamAmostra, float *zf_arr) {
+    ParametrosFbm p = parametrosFbm();
+    const Simplex::NoiseContext ruido(p.seed, p.base);
+
+    p.tamAmostra = tamAmostra;
+    gerarAlturaTile(ruido, p, 0, startH, w, endH, w, 1, false, zf_arr, NULL);
+}
+
+// Amostrar uma oitava (com as suas derivadas) sobre o bloco [x0, x1) x [y0, y1)
+void gerarCamadaTile(const Simplex::NoiseContext& ruido, const ParametrosFbm& p,
+                     NoiseLayerCache::Layer& camada, int x0, int y0, int x1, int y1) {
+    const NoiseLayerCache::Key& key = camada.key;
+    const int n = x1 - x0;
+    std::vector<float> px(n), py(n), pz(n), dy(n);
+    std::vector<int> colunas(n);
+    float freq = 1.0f;
+
+    // mesma frequência que o fBm acumula, multiplicação a multiplicação
+    for (int k = 0; k < key.octave; k++)
+        freq *= key.lacunarity;
+
+    for (int i = 0; i < n; i++)
+        colunas[i] = x0 + i;
+
+    for (int j = y0; j < y1; j++) {
+        const int linha = x0 + key.width * j;
+
+        posicoesLinha(p, colunas.data(), n, j, 1, px.data(), py.data(), pz.data());
+        for (int i = 0; i < n; i++) {
+            px[i] *= freq;
+            py[i] *= freq;
+            pz[i] *= freq;
+        }
+
+        // o eixo j do mapa corresponde ao eixo z do ruído
+        ruido.noise(px.data(), py.data(), pz.data(), &camada.values[linha],
+                    &camada.dx[linha], dy.data(), &camada.dy[linha], n);
+    }
+}
+
+// Somar as oitavas em cache (como o fBm) e converter em alturas e gradientes
+void combinarCamadasTile(const ParametrosFbm& p,
+                         const std::vector<const NoiseLayerCache::Layer *>& camadas,
+                         int x0, int y0, int x1, int y1, int w,
+                         float *zf_arr, float *gradientes) {
+    const int n = x1 - x0;
+    std::vector<float> soma(n), dx(n), dz(n);
+
+    for (int j = y0; j < y1; j++) {
+        const int linha = x0 + w * j;
+        float freq = 1.0f, amp = 0.5f;
+
+        std::fill(soma.begin(), soma.end(), 0.0f);
+        std::fill(dx.begin(), dx.end(), 0.0f);
+        std::fill(dz.begin(), dz.end(), 0.0f);
+
+        // oitava por oitava, para que a linha inteira seja vetorizada
+        for (size_t k = 0; k < camadas.size(); k++) {
+            const float *valores = &camadas[k]->values[linha];
+            const float *derivadasX = &camadas[k]->dx[linha];
+            const float *derivadasY = &camadas[k]->dy[linha];
+
+            for (int i = 0; i < n; i++) {
+                soma[i] += valores[i] * amp;
+                dx[i] += derivadasX[i] * (amp * freq);
+                dz[i] += derivadasY[i] * (amp * freq);
+            }
+            freq *= p.lacunarity;
+            amp *= p.gain;
+        }
+
+        for (int i = 0; i < n; i++) {
+            float escala;
+
+            zf_arr[linha + i] = alturaDoRuido(p, soma[i], 1, gradientes ? &escala : NULL);
+
+            if (gradientes) {
+                gradientes[2 * (linha + i)    ] = escala * dx[i];
+                gradientes[2 * (linha + i) + 1] = escala * dz[i];
+            }
+        }
+    }
+}
+
+// Pool de threads compartilhado: as threads são criadas uma única vez, e
+// cada gerador espera só pelas suas tarefas
+ThreadPool& threadPool() {
+    static ThreadPool pool;
+
+    return pool;
+}
+
+HeightmapGenerator& heightmapGenerator() {
+    static HeightmapGenerator generator(threadPool());
+
+    return generator;
+}
+
+// Oitavas da última geração na CPU, reaproveitadas entre edições da GUI
+NoiseLayerCache& noiseLayerCache() {
+    static NoiseLayerCache cache;
+
+    return cache;
+}
+
+// Pirâmide (h, h², min, max) do último heightmap enviado: as mipmaps do dmap
+// e as consultas de LOD, culling e colisão na CPU
+HeightPyramid& heightPyramid() {
+    static HeightPyramid pyramid;
+
+    return pyramid;
+}
+
+// Geração progressiva (do nível grosso ao fino) em segundo plano
+ProgressiveHeightmap& progressiveHeightmap() {
+    static ProgressiveHeightmap progressive(threadPool());
+
+    return progressive;
+}
+
+// Gerar o mapa de alturas inteiro na CPU, no mesmo layout de zf_arr, e
+// opcionalmente os gradientes analíticos (2 floats por texel).
+// As oitavas ficam em cache: mudar o gain, o valley ou o número de oitavas só
+// recombina as camadas, e só as oitavas que faltam são amostradas.
+// Retorna o intervalo das alturas, reduzido bloco a bloco durante a geração
+HeightRange gerarAlturaCpu(int w, int h, float *zf_arr, float *gradientes) {
+    const ParametrosFbm p = parametrosFbm();
+    HeightmapGenerator& generator = heightmapGenerator();
+    NoiseLayerCache& cache = noiseLayerCache();
+    HeightRangeReducer intervalo(w, h);
+    // Cada geração tem a sua própria tabela de permutação (nada é global)
+    const Simplex::NoiseContext ruido(p.seed, p.base);
+    std::vector<const NoiseLayerCache::Layer *> camadas;
+    std::vector<NoiseLayerCache::Layer *> novasCamadas;
+    // se nem todas as oitavas cabem, não vale a pena descartar as que estão lá
+    bool usarCache = NoiseLayerCache::layerByteSize(w, h) * p.octaves <= cache.byteBudget();
+
+    cache.beginGeneration();
+    for (int k = 0; k < p.octaves && usarCache; k++) {
+        NoiseLayerCache::Key key = {p.seed, p.base, k, w, h, p.wavelength, p.lacunarity, p.tamAmostra};
+        const NoiseLayerCache::Layer *camada = cache.find(key);
+
+        if (!camada) {
+            NoiseLayerCache::Layer *novaCamada = cache.insert(key);
+
+            usarCache = (novaCamada != NULL);
+            if (novaCamada)
+                novasCamadas.push_back(novaCamada);
+            camada = novaCamada;
+        }
+
+        camadas.push_back(camada);
+    }
+
+    // Sem memória para todas as oitavas: gera diretamente, sem cache
+    if (!usarCache) {
+        for (size_t k = 0; k < novasCamadas.size(); k++)
+            cache.remove(novasCamadas[k]);
+
+        LOG("Gerando heightmap %ix%i na CPU (%i threads)\n", w, h, generator.threadCount());
+        generator.generate(w, h,
+            [&ruido, &p, &intervalo, w, zf_arr, gradientes](int x0, int y0, int x1, int y1) {
+                gerarAlturaTile(ruido, p, x0, y0, x1, y1, w, 1, false, zf_arr, gradientes);
+                intervalo.reduce(zf_arr, w, x0, y0, x1, y1);
+            },
+            [](float progress) {
+                LOG("-- %3i%%\n", (int)(progress * 100.0f));
+            });
+
+        return intervalo.range();
+    }
+
+    if (!novasCamadas.empty()) {
+        LOG("Amostrando %i de %i oitavas %ix%i na CPU (%i threads)\n",
+            (int)novasCamadas.size(), p.octaves, w, h, generator.threadCount());
+        generator.generate(w, h,
+            [&ruido, &p, &novasCamadas](int x0, int y0, int x1, int y1) {
+                for (size_t k = 0; k < novasCamadas.size(); k++)
+                    gerarCamadaTile(ruido, p, *novasCamadas[k], x0, y0, x1, y1);
+            },
+            [](float progress) {
+                LOG("-- %3i%%\n", (int)(progress * 100.0f));
+            });
+    }
+
+    generator.generate(w, h,
+        [&p, &camadas, &intervalo, w, zf_arr, gradientes](int x0, int y0, int x1, int y1) {
+            combinarCamadasTile(p, camadas, x0, y0, x1, y1, w, zf_arr, gradientes);
+            intervalo.reduce(zf_arr, w, x0, y0, x1, y1);
+        });
+
+    return intervalo.range();
+}
+
+// Construir a pirâmide de (h, h²) na CPU e empacotar os níveis 1 a mipcnt - 1
+// como as mipmaps explícitas (RG16) do dmap, no lugar do glGenerateMipmap do driver
+static std::vector<std::vector<uint16_t>> empacotarMipmapsAlturas(HeightPyramid& pyramid,
+                                                                  int mipcnt,
+                                                                  HeightmapGenerator& generator) {
+    std::vector<std::vector<uint16_t>> mipmaps;
+
+    pyramid.build(generator);
+
+    for (int nivel = 1; nivel < std::min(mipcnt, pyramid.levelCount()); ++nivel) {
+        const HeightPyramid::Level& level = pyramid.level(nivel);
+        const int w = level.width;
+
+        mipmaps.push_back(std::vector<uint16_t>((size_t)level.width * level.height * 2));
+
+        std::vector<uint16_t>& texels = mipmaps.back();
+
+        generator.generate(level.width, level.height,
+            [&](int x0, int y0, int x1, int y1) {
+                for (int j = y0; j < y1; ++j) {
+                    for (int i = x0; i < x1; ++i) {
+                        texels[2 * (i + w * j)    ] = (uint16_t)(level.mean[i + w * j] * ((1 << 16) - 1));
+                        texels[2 * (i + w * j) + 1] = (uint16_t)(level.meanSq[i + w * j] * ((1 << 16) - 1));
+                    }
+                }
+            });
+    }
+
+    return mipmaps;
+}
+
+// Criar a textura de deslocamento (RG16) com todos os níveis já prontos
+static void carregarTexturaAlturas(int dmapID, const std::vector<HeightmapCache::Level>& niveis) {
+    glActiveTexture(GL_TEXTURE0 + dmapID);
+    if (glIsTexture(g_gl.textures[dmapID]))
+        glDeleteTextures(1, &g_gl.textures[dmapID]);
+
+    glGenTextures(1, &g_gl.textures[dmapID]);
+    glActiveTexture(GL_TEXTURE0 + dmapID);
+    glBindTexture(GL_TEXTURE_2D, g_gl.textures[dmapID]);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)niveis.size(), GL_RG16, niveis[0].width, niveis[0].height);
+    for (size_t nivel = 0; nivel < niveis.size(); ++nivel) {
+        glTexSubImage2D(GL_TEXTURE_2D, (GLint)nivel, 0, 0, niveis[nivel].width, niveis[nivel].height,
+                        GL_RG, GL_UNSIGNED_SHORT, niveis[nivel].texels);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Criar a textura de normais (RG8 em octaedro) com o nível 0 e as mipmaps.
+// As mipmaps são reduzidas e renormalizadas na CPU (NormalMap::buildMips): a
+// média dos códigos que o glGenerateMipmap faria não é a média das normais
+static void carregarNormais(int smapID, const unsigned char *normais,
+                            const std::vector<std::vector<uint8_t>>& mipmaps, int w, int h) {
+    const int mipcnt = 1 + (int)mipmaps.size();
+
+    glActiveTexture(GL_TEXTURE0 + smapID);
+    if (glIsTexture(g_gl.textures[smapID]))
+        glDeleteTextures(1, &g_gl.textures[smapID]);
+
+    glGenTextures(1, &g_gl.textures[smapID]);
+    glActiveTexture(GL_TEXTURE0 + smapID);
+    glBindTexture(GL_TEXTURE_2D, g_gl.textures[smapID]);
+    glTexStorage2D(GL_TEXTURE_2D, mipcnt, GL_RG8, w, h);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RG, GL_UNSIGNED_BYTE, normais);
+    for (int nivel = 1; nivel < mipcnt; ++nivel) {
+        glTexSubImage2D(GL_TEXTURE_2D, nivel, 0, 0, std::max(w >> nivel, 1), std::max(h >> nivel, 1),
+                        GL_RG, GL_UNSIGNED_BYTE, mipmaps[nivel - 1].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Cache em disco dos heightmaps enviados, indexado pelos parâmetros de geração
+HeightmapCache& heightmapCache() {
+    static HeightmapCache cache(PATH_TO_SRC_DIRECTORY "heightmap_cache/");
+
+    return cache;
+}
+
+// Versão do gerador: incrementar sempre que o ruído ou o empacotamento mudar,
+// para que as entradas antigas do cache em disco deixem de ser encontradas
+#define VERSAO_GERADOR 2
+
+// Chave do cache em disco: tudo o que determina os texels enviados. A
+// NoiseSpec dá as mesmas alturas em qualquer backend, então o backend não entra
+uint64_t chaveCacheAlturas(bool naCpu) {
+    const int versao = VERSAO_GERADOR;
+    const int versaoEspec = naCpu ? 0 : NoiseSpec::VERSION;
+    uint64_t chave = HeightmapCache::hash(&versao, sizeof(versao));
+
+    chave = HeightmapCache::hash(&naCpu, sizeof(naCpu), chave);
+    chave = HeightmapCache::hash(&versaoEspec, sizeof(versaoEspec), chave);
+    chave = HeightmapCache::hash(&heightmapSize, sizeof(heightmapSize), chave);
+    chave = HeightmapCache::hash(&seeds, sizeof(seeds), chave);
+    // a NoiseSpec sempre usa a sua própria tabela de permutação
+    if (naCpu)
+        chave = HeightmapCache::hash(&integerHash, sizeof(integerHash), chave);
+    chave = HeightmapCache::hash(&scaleTER, sizeof(scaleTER), chave);
+    chave = HeightmapCache::hash(&octaves, sizeof(octaves), chave);
+    chave = HeightmapCache::hash(&wavelength, sizeof(wavelength), chave);
+    chave = HeightmapCache::hash(&lacunarity, sizeof(lacunarity), chave);
+    chave = HeightmapCache::hash(&gain, sizeof(gain), chave);
+    chave = HeightmapCache::hash(&elevation, sizeof(elevation), chave);
+
+    return chave;
+}
+
+// Intervalo das alturas da NoiseSpec normalizadas no dmap atual, com o qual o
+// clipmap normaliza o seu detalhe; vazio se o dmap não veio da NoiseSpec
+HeightRange intervaloEspec;
+
+// Enviar um heightmap do cache em disco: os níveis vêm direto do mmap
+bool carregarAlturasDoCache(int dmapID, int smapID, uint64_t chave)
+{
+    double lastTime = glfwGetTime();
+    HeightmapCache::Entry entrada;
+
+    if (!heightmapCache().load(chave, entrada))
+        return false;
+
+    const HeightmapCache::Level& base = entrada.levels[0];
+    HeightPyramid& pyramid = heightPyramid();
+    const int w = base.width;
+
+    carregarNormais(smapID, entrada.normals,
+                    NormalMap::buildMips(entrada.normals, base.width, base.height,
+                                         djgt__mipcnt(base.width, base.height, 1), heightmapGenerator()),
+                    base.width, base.height);
+    carregarTexturaAlturas(dmapID, entrada.levels);
+
+    // a chave separa as entradas da CPU, que não são da NoiseSpec
+    if (!cpuGeneration) {
+        intervaloEspec.min = entrada.heightMin;
+        intervaloEspec.max = entrada.heightMax;
+    }
+
+    // A pirâmide da CPU é reconstruída a partir das alturas de 16 bits
+    pyramid.resize(base.width, base.height);
+    heightmapGenerator().generate(base.width, base.height,
+        [&](int x0, int y0, int x1, int y1) {
+            for (int j = y0; j < y1; ++j)
+                for (int i = x0; i < x1; ++i)
+                    pyramid.baseHeights()[i + w * j] =
+                        (float)base.texels[2 * (i + w * j)] / (float)((1 << 16) - 1);
+        });
+    pyramid.build(heightmapGenerator());
+
+    LOG("Heightmap %016llx carregado do cache em disco\n", (unsigned long long)chave);
+    std::cout << "Tempo de carregamento do cache: " << glfwGetTime() - lastTime << " segundos" << std::endl;
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// Texturas de um heightmap prontas para envio: o dmap (h, h²) em RG16 e as
+// normais em RG8, cada um com o nível 0 e as mipmaps, e a pirâmide da CPU
+// que os acompanha. Preparadas por prepararAlturas, em qualquer thread
+struct AlturasPreparadas {
+    HeightPyramid pyramid;
+    std::vector<uint16_t> dmap;
+    std::vector<std::vector<uint16_t>> mipsDmap;
+    std::vector<uint8_t> normais;
+    std::vector<std::vector<uint8_t>> mipsNormais;
+    HeightRange intervalo;
+    int w, h;
+
+    // níveis do dmap, no formato do cache em disco
+    std::vector<HeightmapCache::Level> niveis() const {
+        std::vector<HeightmapCache::Level> niveis(1 + mipsDmap.size());
+
+        niveis[0].width = w;
+        niveis[0].height = h;
+        niveis[0].texels = dmap.data();
+        for (size_t nivel = 1; nivel < niveis.size(); ++nivel) {
+            niveis[nivel].width = pyramid.level((int)nivel).width;
+            niveis[nivel].height = pyramid.level((int)nivel).height;
+            niveis[nivel].texels = mipsDmap[nivel - 1].data();
+        }
+
+        return niveis;
+    }
+};
+
+// Normalizar as alturas e preparar as texturas de deslocamento e normais, só
+// na CPU: a pirâmide, as normais e as mipmaps de ambos. O intervalo (min/max)
+// já vem reduzido da passada que gerou as alturas. Sem gradientes (geração na
+// GPU), as derivadas vêm de diferenças centrais
+static void prepararAlturas(const float *heights, const float *gradientes,
+                            const HeightRange& intervalo, int w, int h,
+                            HeightmapGenerator& generator, AlturasPreparadas& alturas)
+{
+    const int mipcnt = djgt__mipcnt(w, h, 1);
+    const float min = intervalo.min;
+    const float max = intervalo.max;
+    HeightPyramid& pyramid = alturas.pyramid;
+    const float escala = (max > min) ? 1.0f / (max - min) : 0.0f;
+    // derivada por texel -> derivada da altura normalizada por unidade de textura
+    const float escalaX = (float)w * escala;
+    const float escalaY = (float)h * escala;
+    std::vector<uint16_t>& dmap = alturas.dmap;
+    std::vector<uint8_t>& smap = alturas.normais;
+
+    alturas.w = w;
+    alturas.h = h;
+    alturas.intervalo = intervalo;
+    dmap.resize((size_t)w * h * 2);
+    smap.resize((size_t)w * h * 2);
+    pyramid.resize(w, h);
+
+    // Uma única passada paralela escreve (h, h²), a altura normalizada da base
+    // da pirâmide e a normal de cada texel, linha a linha, em laços que o
+    // compilador vetoriza
+    generator.generate(w, h,
+        [&, escala, escalaX, escalaY](int x0, int y0, int x1, int y1) {
+            const int n = x1 - x0;
+            std::vector<float> sx(n), sy(n);
+
+            for (int j = y0; j < y1; ++j) {
+                const float *linha = &heights[x0 + w * j];
+                uint16_t *texels = &dmap[2 * (x0 + w * j)];
+                float *base = &pyramid.baseHeights()[x0 + w * j];
+
+                for (int i = 0; i < n; ++i) {
+                    const float h_value = (linha[i] - min) * escala;
+
+                    base[i] = h_value;
+                    texels[2 * i    ] = (uint16_t)(h_value * ((1 << 16) - 1));
+                    texels[2 * i + 1] = (uint16_t)(h_value * h_value * ((1 << 16) - 1));
+                }
+
+                if (gradientes) {
+                    const float *derivadas = &gradientes[2 * (x0 + w * j)];
+
+                    for (int i = 0; i < n; ++i) {
+                        sx[i] = derivadas[2 * i    ] * escalaX;
+                        sy[i] = derivadas[2 * i + 1] * escalaY;
+                    }
+                } else {
+                    const int jb = std::max(j - 1, 0), jt = std::min(j + 1, h - 1);
+
+                    for (int i = x0; i < x1; ++i) {
+                        const int il = std::max(i - 1, 0), ir = std::min(i + 1, w - 1);
+
+                        sx[i - x0] = (heights[ir + w * j] - heights[il + w * j])
+                                   / (float)std::max(ir - il, 1) * escalaX;
+                        sy[i - x0] = (heights[i + w * jt] - heights[i + w * jb])
+                                   / (float)std::max(jt - jb, 1) * escalaY;
+                    }
+                }
+
+                // normais da superfície com u_DmapFactor = 1, a partir da
+                // inclinação por unidade de textura; o shader reaplica a
+                // escala atual ao decodificá-las
+                NormalMap::encodeSlopes(sx.data(), sy.data(), n, &smap[2 * (x0 + w * j)]);
+            }
+        });
+
+    alturas.mipsDmap = empacotarMipmapsAlturas(pyramid, mipcnt, generator);
+    alturas.mipsNormais = NormalMap::buildMips(smap.data(), w, h, mipcnt, generator);
+}
+
+// Gravar as texturas preparadas no cache em disco
+static void gravarAlturasNoCache(uint64_t chave, const AlturasPreparadas& alturas) {
+    if (!heightmapCache().store(chave, alturas.niveis(), alturas.normais.data(),
+                                alturas.intervalo.min, alturas.intervalo.max)) {
+        LOG("Erro ao gravar o heightmap no cache em disco\n");
+    }
+}
+
+// Normalizar as alturas e carregar as texturas de deslocamento e normais.
+// Se chaveCache não for 0, as texturas também são gravadas no cache em disco
+bool carregarAlturas(int dmapID, int smapID, const float *heights,
+                     const float *gradientes, const HeightRange& intervalo, int w, int h,
+                     uint64_t chaveCache)
+{
+    double nowNormal = glfwGetTime();
+    AlturasPreparadas alturas;
+
+    prepararAlturas(heights, gradientes, intervalo, w, h, heightmapGenerator(), alturas);
+    carregarNormais(smapID, alturas.normais.data(), alturas.mipsNormais, w, h);
+    carregarTexturaAlturas(dmapID, alturas.niveis());
+    std::swap(heightPyramid(), alturas.pyramid);
+
+    if (chaveCache)
+        gravarAlturasNoCache(chaveCache, alturas);
+
+    double now = glfwGetTime();
+    std::cout << "Tempo de execução para geração de normais: " << now - nowNormal << " segundos" << std::endl;
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// Geração na CPU: usada quando o compute shader não está disponível
+bool gerarTexturaCpu(int dmapID, int smapID, uint64_t chaveCache)
+{
+    double lastTime = glfwGetTime();
+    int w = heightmapSize;
+    int h = heightmapSize;
+    std::vector<float> zf_arr(w * h);
+    std::vector<float> gradientes(w * h * 2);
+
+    const HeightRange intervalo = gerarAlturaCpu(w, h, zf_arr.data(), gradientes.data());
+
+    double now = glfwGetTime();
+    std::cout << "Tempo de execução da geração do heightmap na CPU: " << now - lastTime << " segundos" << std::endl;
+
+    bool success = carregarAlturas(dmapID, smapID, zf_arr.data(), gradientes.data(),
+                                   intervalo, w, h, chaveCache);
+
+    std::cout << "Tempo total de execução: " << glfwGetTime() - lastTime << " segundos" << std::endl;
+
+    return success;
+}
+
+// Envio de AlturasPreparadas para texturas novas, algumas linhas por quadro;
+// as texturas atuais continuam ligadas até o fim do envio, quando são
+// trocadas pelas novas junto com a pirâmide da CPU
+struct EnvioAlturas {
+    struct Nivel {
+        GLuint textura;
+        GLint nivel;
+        int width, height;
+        GLenum tipo;        // GL_UNSIGNED_SHORT (dmap) ou GL_UNSIGNED_BYTE (normais)
+        const void *texels; // RG, linha a linha
+    };
+
+    AlturasPreparadas alturas;
+    std::vector<Nivel> niveis;  // na ordem de envio
+    size_t nivel;               // nível em envio e a sua próxima linha
+    int linha;
+    int dmapID, smapID;
+    GLuint dmap, smap;          // 0 se não há envio em andamento
+};
+
+EnvioAlturas envioAlturas;
+
+// Bytes enviados por quadro: alguns milissegundos de cópia, no máximo
+#define BYTES_ENVIO_POR_QUADRO (8 << 20)
+
+static bool enviandoAlturas() {
+    return envioAlturas.dmap != 0;
+}
+
+// Abandonar o envio em andamento, que seria de um heightmap antigo
+static void descartarEnvio() {
+    EnvioAlturas& envio = envioAlturas;
+
+    if (envio.dmap) {
+        glDeleteTextures(1, &envio.dmap);
+        glDeleteTextures(1, &envio.smap);
+    }
+    envio.dmap = envio.smap = 0;
+    envio.niveis.clear();
+}
+
+static GLuint criarTexturaDeEnvio(GLsizei mipcnt, GLenum formato, int w, int h) {
+    GLuint textura;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &textura);
+    glTextureStorage2D(textura, mipcnt, formato, w, h);
+    glTextureParameteri(textura, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(textura, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(textura, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(textura, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return textura;
+}
+
+// Começar o envio das texturas preparadas; alturas fica com as do envio
+// anterior, que podem ser reaproveitadas
+static void iniciarEnvio(int dmapID, int smapID, AlturasPreparadas& alturas) {
+    EnvioAlturas& envio = envioAlturas;
+
+    descartarEnvio();
+    std::swap(envio.alturas, alturas);
+
+    const AlturasPreparadas& a = envio.alturas;
+    const std::vector<HeightmapCache::Level> niveis = a.niveis();
+
+    envio.dmap = criarTexturaDeEnvio((GLsizei)niveis.size(), GL_RG16, a.w, a.h);
+    envio.smap = criarTexturaDeEnvio(1 + (GLsizei)a.mipsNormais.size(), GL_RG8, a.w, a.h);
+    for (size_t nivel = 0; nivel < niveis.size(); ++nivel) {
+        const EnvioAlturas::Nivel n = {
+            envio.dmap, (GLint)nivel, niveis[nivel].width, niveis[nivel].height,
+            GL_UNSIGNED_SHORT, niveis[nivel].texels
+        };
+
+        envio.niveis.push_back(n);
+    }
+    for (size_t nivel = 0; nivel <= a.mipsNormais.size(); ++nivel) {
+        const EnvioAlturas::Nivel n = {
+            envio.smap, (GLint)nivel, std::max(a.w >> nivel, 1), std::max(a.h >> nivel, 1),
+            GL_UNSIGNED_BYTE, nivel == 0 ? a.normais.data() : a.mipsNormais[nivel - 1].data()
+        };
+
+        envio.niveis.push_back(n);
+    }
+    envio.nivel = 0;
+    envio.linha = 0;
+    envio.dmapID = dmapID;
+    envio.smapID = smapID;
+}
+
+// Enviar até bytes bytes (ao menos uma linha) do envio em andamento. Ao
+// terminar, liga as texturas novas no lugar das atuais e retorna true
+static bool continuarEnvio(size_t bytes) {
+    EnvioAlturas& envio = envioAlturas;
+    size_t enviados = 0;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    while (envio.nivel < envio.niveis.size() && enviados < bytes) {
+        const EnvioAlturas::Nivel& nivel = envio.niveis[envio.nivel];
+        const size_t bytesPorLinha = (size_t)nivel.width * (nivel.tipo == GL_UNSIGNED_SHORT ? 4 : 2);
+        const int linhas = (int)std::min((size_t)(nivel.height - envio.linha),
+                                         std::max((bytes - enviados) / bytesPorLinha, (size_t)1));
+
+        glTextureSubImage2D(nivel.textura, nivel.nivel, 0, envio.linha, nivel.width, linhas,
+                            GL_RG, nivel.tipo,
+                            (const uint8_t *)nivel.texels + bytesPorLinha * envio.linha);
+        enviados+= bytesPorLinha * linhas;
+        envio.linha+= linhas;
+        if (envio.linha == nivel.height) {
+            ++envio.nivel;
+            envio.linha = 0;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (envio.nivel < envio.niveis.size())
+        return false;
+
+    const int ids[] = {envio.dmapID, envio.smapID};
+    const GLuint texturas[] = {envio.dmap, envio.smap};
+
+    for (int k = 0; k < 2; ++k) {
+        glActiveTexture(GL_TEXTURE0 + ids[k]);
+        if (glIsTexture(g_gl.textures[ids[k]]))
+            glDeleteTextures(1, &g_gl.textures[ids[k]]);
+        g_gl.textures[ids[k]] = texturas[k];
+        glBindTexture(GL_TEXTURE_2D, texturas[k]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    std::swap(heightPyramid(), envio.alturas.pyramid);
+
+    envio.dmap = envio.smap = 0;
+    envio.niveis.clear();
+
+    return true;
+}
+
+// Geração progressiva na CPU: o nível grosso é enviado imediatamente e os
+// níveis mais finos chegam nos quadros seguintes (atualizarTexturaProgressiva).
+// A pirâmide, as normais e as mipmaps de cada nível são preparadas na thread
+// do refinamento, que também grava o último nível no cache em disco; a thread
+// de render só envia as texturas. Não usa o cache de oitavas, que só guarda
+// mapas na resolução completa
+AlturasPreparadas alturasProgressivas;
+
+bool gerarTexturaProgressiva(int dmapID, int smapID, uint64_t chaveCache)
+{
+    const ParametrosFbm p = parametrosFbm();
+    const Simplex::NoiseContext ruido(p.seed, p.base);
+    ProgressiveHeightmap& progressive = progressiveHeightmap();
+
+    progressive.start(heightmapSize, heightmapSize,
+        [ruido, p](ProgressiveHeightmap::Level& level, int x0, int y0, int x1, int y1,
+                   bool pularPares) {
+            gerarAlturaTile(ruido, p, x0, y0, x1, y1, level.width, level.stride, pularPares,
+                            level.heights.data(), level.gradients.data());
+        },
+        [chaveCache](const ProgressiveHeightmap::Level& level, HeightmapGenerator& generator) {
+            prepararAlturas(level.heights.data(), level.gradients.data(), level.range,
+                            level.width, level.height, generator, alturasProgressivas);
+            if (level.stride == 1 && chaveCache)
+                gravarAlturasNoCache(chaveCache, alturasProgressivas);
+        });
+
+    const ProgressiveHeightmap::Level& level = progressive.level();
+
+    LOG("Heightmap progressivo: nível %ix%i\n", level.width, level.height);
+
+    iniciarEnvio(dmapID, smapID, alturasProgressivas);
+    continuarEnvio(SIZE_MAX);
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// Chamada a cada quadro: começa a enviar o nível mais fino, se uma passada
+// terminou, e continua o envio em andamento; retorna true quando o dmap mudou.
+// Durante um envio o refinamento não é consultado: a próxima passada começa
+// no quadro seguinte ao fim do envio
+bool atualizarTexturaProgressiva()
+{
+    ProgressiveHeightmap& progressive = progressiveHeightmap();
+
+    if (!enviandoAlturas()) {
+        if (!progressive.poll())
+            return false;
+
+        const ProgressiveHeightmap::Level& level = progressive.level();
+
+        LOG("Heightmap progressivo: nível %ix%i\n", level.width, level.height);
+        iniciarEnvio(TEXTURE_DMAP, TEXTURE_SMAP, alturasProgressivas);
+    }
+
+    return continuarEnvio(BYTES_ENVIO_POR_QUADRO);
+}
+
+// Parâmetros da NoiseSpec, copiados dos globais. A frequência é calculada
+// uma única vez aqui, para que a CPU e a GPU multipliquem pelo mesmo float
+NoiseSpec::Params parametrosEspec() {
+    NoiseSpec::Params parametros = {
+        (uint32_t)seeds, octaves, 1.0f / wavelength, lacunarity, gain, elevation
+    };
+
+    return parametros;
+}
+
+// Buffer dos ladrilhos gerados na GPU, mantido entre gerações
+NoiseSpecGpu& noiseSpecGpu() {
+    static NoiseSpecGpu gpu;
+
+    return gpu;
+}
+
+// Divide os ladrilhos da NoiseSpec entre a GPU e as threads da CPU
+TileScheduler& tileScheduler() {
+    static TileScheduler scheduler(threadPool());
+
+    return scheduler;
+}
+
+static_assert(TileScheduler::TILE_SIZE % HeightmapGenerator::TILE_SIZE == 0,
+              "os ladrilhos do escalonador devem conter blocos inteiros do HeightRangeReducer");
+
+// Geração com a NoiseSpec: cada ladrilho vai para o backend livre (ou o mais
+// rápido no fim da fila), e a CPU e a GPU dão exatamente as mesmas alturas.
+// Sem o compute shader, ou se ele falhar, tudo é gerado na CPU
+bool gerarTexturaEspec(int dmapID, int smapID, uint64_t chaveCache)
+{
+    double lastTime = glfwGetTime();
+    const int w = heightmapSize;
+    const int h = heightmapSize;
+    const NoiseSpec::Params p = parametrosEspec();
+    const GLuint programa = g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION];
+    std::vector<float> heights((size_t)w * h);
+    HeightRangeReducer intervalo(w, h);
+    TileScheduler::TileKernel naGpu;
+
+    // o min/max é reduzido nos blocos do ladrilho, ainda em cache
+    const auto reduzir = [&](int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y += HeightmapGenerator::TILE_SIZE)
+            for (int x = x0; x < x1; x += HeightmapGenerator::TILE_SIZE)
+                intervalo.reduce(heights.data(), w, x, y,
+                                 std::min(x + (int)HeightmapGenerator::TILE_SIZE, x1),
+                                 std::min(y + (int)HeightmapGenerator::TILE_SIZE, y1));
+    };
+
+    if (glIsProgram(programa)) {
+        naGpu = [&](int x0, int y0, int x1, int y1) {
+            if (!noiseSpecGpu().generate(programa, p, x0, y0, x1, y1, &heights[x0 + (size_t)w * y0], w))
+                return false;
+
+            reduzir(x0, y0, x1, y1);
+            return true;
+        };
+    } else {
+        LOG("Erro: Programa de compute shader inválido, gerando na CPU\n");
+    }
+
+    const TileScheduler::Stats stats = tileScheduler().run(w, h,
+        [&](int x0, int y0, int x1, int y1) {
+            for (int j = y0; j < y1; ++j)
+                NoiseSpec::heights(p, x0, j, x1 - x0, &heights[x0 + (size_t)w * j]);
+
+            reduzir(x0, y0, x1, y1);
+            return true;
+        },
+        naGpu, (TileScheduler::Mode)heightmapBackend);
+
+    if (stats.gpuFailed) {
+        LOG("Erro na geração na GPU, ladrilhos gerados na CPU\n");
+    }
+    LOG("Heightmap %ix%i: %i ladrilhos na GPU, %i na CPU (%i threads)\n", w, h,
+        stats.tileCount[TileScheduler::GPU], stats.tileCount[TileScheduler::CPU],
+        tileScheduler().threadCount());
+    std::cout << "Tempo de execução da geração do heightmap: " << glfwGetTime() - lastTime << " segundos" << std::endl;
+
+    intervaloEspec = intervalo.range();
+
+    bool success = carregarAlturas(dmapID, smapID, heights.data(), NULL, intervaloEspec, w, h, chaveCache);
+
+    std::cout << "Tempo total de execução: " << glfwGetTime() - lastTime << " segundos" << std::endl;
+
+    return success;
+}
+
+bool gerarTextura(int dmapID, int smapID)
+{
+    // um refinamento em andamento seria de parâmetros antigos
+    progressiveHeightmap().cancel();
+    descartarEnvio();
+    intervaloEspec = HeightRange();
+
+    const uint64_t chaveCache = diskCache ? chaveCacheAlturas(cpuGeneration) : 0;
+
+    if (chaveCache && carregarAlturasDoCache(dmapID, smapID, chaveCache))
+        return true;
+
+    if (cpuGeneration && progressiveGeneration)
+        return gerarTexturaProgressiva(dmapID, smapID, chaveCache);
+
+    if (cpuGeneration)
+        return gerarTexturaCpu(dmapID, smapID, chaveCache);
+
+    return gerarTexturaEspec(dmapID, smapID, chaveCache);
+}
+
+// Heightmap em arquivo .thm (ladrilhos mapeados em memória): mantido aberto
+// para as consultas da CPU, no lugar da pirâmide
+TiledHeightmapFile& tiledHeightmapFile() {
+    static TiledHeightmapFile file;
+
+    return file;
+}
+
+// Enviar um nível de um canal do arquivo, ladrilho a ladrilho, direto do mmap
+static void carregarLadrilhos(const TiledHeightmapFile& arquivo, int nivel, bool normais) {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, arquivo.tileSize());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int ty = 0; ty < arquivo.tileCountY(nivel); ++ty) {
+        for (int tx = 0; tx < arquivo.tileCountX(nivel); ++tx) {
+            const TiledHeightmapFile::Tile tile = arquivo.tile(nivel, tx, ty);
+
+            if (normais)
+                glTexSubImage2D(GL_TEXTURE_2D, nivel, tile.x0, tile.y0, tile.width, tile.height,
+                                GL_RG, GL_UNSIGNED_BYTE, tile.normals);
+            else
+                glTexSubImage2D(GL_TEXTURE_2D, nivel, tile.x0, tile.y0, tile.width, tile.height,
+                                GL_RG, GL_UNSIGNED_SHORT, tile.texels);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// Carregar o dmap (e as normais, se houver) de um arquivo .thm. O SO só lê
+// as páginas dos ladrilhos à medida que são enviados
+bool carregarAlturasDeArquivo(int dmapID, int smapID, const std::string& caminho)
+{
+    double lastTime = glfwGetTime();
+    TiledHeightmapFile& arquivo = tiledHeightmapFile();
+
+    progressiveHeightmap().cancel();
+    descartarEnvio();
+    intervaloEspec = HeightRange();
+    if (!arquivo.open(caminho)) {
+        LOG("Erro ao abrir o heightmap %s\n", caminho.c_str());
+        return false;
+    }
+
+    heightPyramid() = HeightPyramid();
+
+    glActiveTexture(GL_TEXTURE0 + dmapID);
+    if (glIsTexture(g_gl.textures[dmapID]))
+        glDeleteTextures(1, &g_gl.textures[dmapID]);
+    glGenTextures(1, &g_gl.textures[dmapID]);
+    glBindTexture(GL_TEXTURE_2D, g_gl.textures[dmapID]);
+    glTexStorage2D(GL_TEXTURE_2D, arquivo.levelCount(), GL_RG16, arquivo.width(0), arquivo.height(0));
+    for (int nivel = 0; nivel < arquivo.levelCount(); ++nivel)
+        carregarLadrilhos(arquivo, nivel, false);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    if (arquivo.hasNormals()) {
+        glActiveTexture(GL_TEXTURE0 + smapID);
+        if (glIsTexture(g_gl.textures[smapID]))
+            glDeleteTextures(1, &g_gl.textures[smapID]);
+        glGenTextures(1, &g_gl.textures[smapID]);
+        glBindTexture(GL_TEXTURE_2D, g_gl.textures[smapID]);
+        glTexStorage2D(GL_TEXTURE_2D, arquivo.levelCount(), GL_RG8, arquivo.width(0), arquivo.height(0));
+        for (int nivel = 0; nivel < arquivo.levelCount(); ++nivel)
+            carregarLadrilhos(arquivo, nivel, true);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        LOG("Heightmap %s sem normais\n", caminho.c_str());
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    std::cout << "Tempo de carregamento do heightmap em ladrilhos: " << glfwGetTime() - lastTime << " segundos" << std::endl;
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// Gravar o heightmap atual (pirâmide da CPU e normais lidas da textura) em .thm.
+// Um .thm aberto não tem pirâmide: ela é reconstruída do nível 0 do arquivo
+bool exportarAlturas(const std::string& caminho)
+{
+    const TiledHeightmapFile& arquivo = tiledHeightmapFile();
+    const HeightPyramid *pyramid = &heightPyramid();
+    HeightPyramid doArquivo;
+    bool temNormais = true;
+
+    if (pyramid->levelCount() == 0 && arquivo.isOpen()) {
+        const int w = arquivo.width(0);
+
+        doArquivo.resize(arquivo.width(0), arquivo.height(0));
+        heightmapGenerator().generate(arquivo.width(0), arquivo.height(0),
+            [&](int x0, int y0, int x1, int y1) {
+                for (int j = y0; j < y1; ++j)
+                    for (int i = x0; i < x1; ++i)
+                        doArquivo.baseHeights()[i + w * j] = arquivo.height(0, i, j);
+            });
+        doArquivo.build(heightmapGenerator());
+        pyramid = &doArquivo;
+        temNormais = arquivo.hasNormals();
+    }
+
+    if (pyramid->levelCount() == 0) {
+        LOG("Nenhum heightmap carregado para exportar\n");
+        return false;
+    }
+
+    std::vector<unsigned char> normais;
+
+    if (temNormais) {
+        normais.resize((size_t)pyramid->width() * pyramid->height() * 2);
+        glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_SMAP]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_UNSIGNED_BYTE, normais.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    const bool success = TiledHeightmapWriter::write(caminho, *pyramid,
+                                                     temNormais ? normais.data() : NULL);
+
+    LOG("Heightmap exportado para %s: %i\n", caminho.c_str(), success);
+
+    return success;
+}
+
+// Exportar o terreno procedural em PNG de 16 bits (tons de cinza) em qualquer
+// resolução, cobrindo a mesma área do heightmap atual. Nada é guardado além
+// das linhas em compressão: uma primeira passada só reduz o min/max, e a
+// segunda gera as linhas de novo, normaliza e as grava
+bool exportarPng(const std::string& caminho, int tamanho)
+{
+    double lastTime = glfwGetTime();
+    ParametrosFbm p = parametrosFbm();
+    const Simplex::NoiseContext ruido(p.seed, p.base);
+    HeightRangeReducer intervalo(tamanho, tamanho);
+
+    p.tamAmostra *= (float)heightmapSize / (float)tamanho;
+
+    heightmapGenerator().generate(tamanho, tamanho,
+        [&](int x0, int y0, int x1, int y1) {
+            std::vector<float> alturas(x1 - x0);
+            HeightRange bloco;
+
+            for (int j = y0; j < y1; ++j) {
+                gerarAlturaLinha(ruido, p, x0, x1, j, alturas.data());
+                bloco.extend(alturas.data(), x1 - x0);
+            }
+            intervalo.reduce(x0, y0, bloco);
+        },
+        [](float progress) {
+            LOG("-- %3i%%\n", (int)(progress * 100.0f));
+        });
+
+    const HeightRange range = intervalo.range();
+    const float escala = range.isEmpty() || range.max <= range.min
+                       ? 0.0f : 1.0f / (range.max - range.min);
+    PngHeightmapWriter writer(threadPool());
+    const bool success = writer.write(caminho, tamanho, tamanho,
+        [&](int j, uint16_t *linha) {
+            std::vector<float> alturas(tamanho);
+
+            gerarAlturaLinha(ruido, p, 0, tamanho, j, alturas.data());
+            for (int i = 0; i < tamanho; ++i)
+                linha[i] = (uint16_t)((alturas[i] - range.min) * escala * ((1 << 16) - 1));
+        });
+
+    LOG("PNG %ix%i exportado para %s: %i\n", tamanho, tamanho, caminho.c_str(), success);
+    std::cout << "Tempo de exportação do PNG: " << glfwGetTime() - lastTime << " segundos" << std::endl;
+
+    return success;
+}
+
+// -----------------------------------------------------------------------------
+// Terreno infinito: em vez do heightmap fixo, o TileStreamer gera ladrilhos da
+// NoiseSpec em janelas aninhadas ao redor da câmera. O nível L tem texels
+// 2^(L - STREAMING_DETAIL_LEVELS) texels do mapa fixo de lado, e o quadrado
+// da LEB cobre só 4 ladrilhos do nível mais grosso em volta da câmera
+struct StreamingManager {
+    double originX, originY;    // canto do quadrado da LEB, em texels do nível 0
+    double size;                // lado do quadrado, em texels do nível 0
+    double cameraX, cameraY;    // câmera, em texels do nível 0
+} g_streaming = {0.0, 0.0, 0.0, 0.0, 0.0};
+
+bool streamingAtivo() {
+    return streamedTerrain && g_terrain.flags.displace;
+}
+
+TileStreamer& tileStreamer() {
+    static TileStreamer streamer(threadPool());
+
+    return streamer;
+}
+
+// Transformação do quadrado [0, 1]² do heightmap fixo para o mundo
+dja::mat4 modeloMapa()
+{
+    float width = g_terrain.dmap.width;
+    float height = g_terrain.dmap.height;
+    float zMin = g_terrain.dmap.zMin;
+    float zMax = g_terrain.dmap.zMax;
+    dja::vec3 scale = dja::vec3(width, zMax - zMin, height);
+
+    return dja::mat4::homogeneous::translation(dja::vec3(-width / 2.0f, zMin, +height / 2.0f))
+            * dja::mat4::homogeneous::scale(dja::vec3(scale))
+            * dja::mat4::homogeneous::rotation(dja::vec3(1, 0, 0), M_PI / 2.0f);
+}
+
+// Transformação do quadrado da LEB: o mapa inteiro, ou, no terreno infinito,
+// a parte dele em volta da câmera
+dja::mat4 modeloTerreno()
+{
+    const double texels = heightmapSize * (double)(1 << STREAMING_DETAIL_LEVELS);
+
+    if (!streamingAtivo())
+        return modeloMapa();
+
+    return modeloMapa()
+            * dja::mat4::homogeneous::translation(dja::vec3(g_streaming.originX / texels,
+                                                            g_streaming.originY / texels, 0.0f))
+            * dja::mat4::homogeneous::scale(dja::vec3(g_streaming.size / texels,
+                                                      g_streaming.size / texels, 1.0f));
+}
+
+// Intervalo com o qual os ladrilhos são normalizados: o do dmap da NoiseSpec,
+// ou, se o dmap veio da CPU ou de arquivo, o de uma amostra grossa da mesma
+// área do mapa
+HeightRange intervaloStreaming(const NoiseSpec::Params& p)
+{
+    const int n = 256;
+    NoiseSpec::Params q = p;
+    std::vector<float> linha(n);
+    HeightRange intervalo;
+
+    if (!intervaloEspec.isEmpty())
+        return intervaloEspec;
+
+    q.frequency = p.frequency * (float)heightmapSize / (float)n;
+    for (int j = 0; j < n; ++j) {
+        NoiseSpec::heights(q, 0, j, n, linha.data());
+        intervalo.extend(linha.data(), n);
     }
-    glActiveTexture(GL_TEXTURE0);
 
-    return (glGetError() == GL_NO_ERROR);
+    return intervalo;
 }
 
-// -----------------------------------------------------------------------------
-/**
- * Load the Normal Texture Map
- *
- */
+// Descarta os ladrilhos gerados; chamada quando os parâmetros do ruído ou o
+// dmap mudam
+void reiniciarStreaming()
+{
+    const NoiseSpec::Params p = parametrosEspec();
 
-template <typename T, typename I, typename O>
-int MapInRange(T x, I in_min, I in_max, O out_min, O out_max)
+    if (!streamingAtivo())
+        return;
+
+    const HeightRange intervalo = intervaloStreaming(p);
+    const float minimo = intervalo.min;
+    const float escala = intervalo.max > intervalo.min
+                       ? 1.0f / (intervalo.max - intervalo.min) : 0.0f;
+
+    tileStreamer().reset([p, minimo, escala](int nivel, int x0, int y0, float *alturas) {
+        NoiseSpec::Params q = p;
+
+        // escala exata por potência de 2: o nível L amostra os mesmos
+        // pontos que os níveis mais finos nos seus texels pares
+        q.frequency = ldexpf(p.frequency, nivel - STREAMING_DETAIL_LEVELS);
+        for (int j = 0; j < TileStreamer::TILE_TEXELS; ++j)
+            NoiseSpec::heights(q, x0, y0 + j, TileStreamer::TILE_TEXELS,
+                               &alturas[TileStreamer::TILE_TEXELS * j]);
+
+        // a mesma normalização do dmap e do clipmap
+        for (int i = 0; i < TileStreamer::TILE_TEXELS * TileStreamer::TILE_TEXELS; ++i)
+            alturas[i] = (alturas[i] - minimo) * escala;
+    });
+}
+
+// Texturas do terreno infinito: um array com um ladrilho por camada (os
+// slots do cache LRU) e a tabela de páginas, uma camada por nível
+bool LoadStreamingTextures()
 {
-	if(x < in_min) x = in_min;
-	if(x > in_max) x = in_max;
-	return (int)((x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min);
+    GLuint *alturas = &g_gl.textures[TEXTURE_STREAM_HEIGHTS];
+    GLuint *paginas = &g_gl.textures[TEXTURE_STREAM_PAGES];
+
+    if (glIsTexture(*alturas))
+        glDeleteTextures(1, alturas);
+    if (glIsTexture(*paginas))
+        glDeleteTextures(1, paginas);
+    *alturas = *paginas = 0;
+
+    if (!streamingAtivo())
+        return (glGetError() == GL_NO_ERROR);
+
+    glGenTextures(1, alturas);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_STREAM_HEIGHTS);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, *alturas);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R32F,
+                   TileStreamer::TILE_TEXELS, TileStreamer::TILE_TEXELS,
+                   tileStreamer().slotCount());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, paginas);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_STREAM_PAGES);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, *paginas);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R16I,
+                   TileStreamer::RING_SIZE, TileStreamer::RING_SIZE,
+                   TileStreamer::LEVEL_COUNT);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                    TileStreamer::RING_SIZE, TileStreamer::RING_SIZE, TileStreamer::LEVEL_COUNT,
+                    GL_RED_INTEGER, GL_SHORT, std::vector<int16_t>(
+                        TileStreamer::RING_SIZE * TileStreamer::RING_SIZE * TileStreamer::LEVEL_COUNT, -1).data());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glActiveTexture(GL_TEXTURE0);
+
+    // os slots foram perdidos com a textura
+    reiniciarStreaming();
+
+    return (glGetError() == GL_NO_ERROR);
 }
 
-void gerarNormal(int smapID, const std::vector<uint16_t>& texels, int w, int h) {
-    // Criar vetores para armazenar as normais
-    std::vector<glm::vec3> normais(w * h, glm::vec3(0.0f));
-    
-    // Calcular as normais para cada ponto usando diferenças de h
-    for (int z = 0; z < h - 1; z++) {
-        for (int x = 0; x < w - 1; x++) {
-            // Obter hs dos pontos vizinhos
-            glm::vec2 pos = glm::vec2(x, z);
-            float h00 = texels[z * w + x] * g_terrain.dmap.scale;
-            float h10 = texels[z * w + (x + 1)] * g_terrain.dmap.scale;
-            float h01 = texels[(z + 1) * w + x] * g_terrain.dmap.scale;
-            
-            // Calcular vetores tangentes
-            glm::vec3 tangentX(1.0f, h10 - h00, 0.0f);
-            glm::vec3 tangentZ(0.0f, h01 - h00, 1.0f);
-            
-            // Calcular normal usando produto vetorial
-            glm::vec3 normal = glm::normalize(glm::cross(tangentZ, tangentX));
-            glm::vec3 dnormal = Simplex::dfBm(pos, 16,1.9495,0.5);
-            normal = glm::vec3(dnormal.y, dnormal.z, 1);
-            
-            // Acumular a normal para este vértice
-            normais[z * w + x] = normal;
-        }
-    }
-    
-    // Normalizar todos os vetores normais
-    for (auto& normal : normais) {
-        normal = glm::normalize(normal);
+// Chamada a cada quadro: recentra as janelas na câmera, envia os ladrilhos
+// prontos para os seus slots e a tabela de páginas, se mudou
+void atualizarTerrenoStreaming()
+{
+    if (!streamingAtivo())
+        return;
+
+    TileStreamer& streamer = tileStreamer();
+    const double texels = heightmapSize * (double)(1 << STREAMING_DETAIL_LEVELS);
+    const double ladrilhoGrosso = (double)TileStreamer::TILE_SIZE * (1 << (TileStreamer::LEVEL_COUNT - 1));
+    const dja::vec4 camera = dja::inverse(modeloMapa())
+                           * dja::vec4(g_camera.pos.x, g_camera.pos.y, g_camera.pos.z, 1.0f);
+
+    g_streaming.cameraX = camera.x * texels;
+    g_streaming.cameraY = camera.y * texels;
+    // o quadrado anda de um ladrilho grosso por vez, uma fração diádica do
+    // seu lado, para que a subdivisão da LEB continue válida após o salto
+    g_streaming.size = 4.0 * ladrilhoGrosso;
+    g_streaming.originX = (floor(g_streaming.cameraX / ladrilhoGrosso) - 2.0) * ladrilhoGrosso;
+    g_streaming.originY = (floor(g_streaming.cameraY / ladrilhoGrosso) - 2.0) * ladrilhoGrosso;
+
+    const bool paginasMudaram = streamer.update(g_streaming.cameraX, g_streaming.cameraY);
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_STREAM_HEIGHTS);
+    for (size_t i = 0; i < streamer.uploads().size(); ++i) {
+        const TileStreamer::Tile& ladrilho = streamer.uploads()[i];
+
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, ladrilho.slot,
+                        TileStreamer::TILE_TEXELS, TileStreamer::TILE_TEXELS, 1,
+                        GL_RED, GL_FLOAT, ladrilho.heights.data());
     }
-    
-    // Converter normais para formato de textura (RGB de 0-255)
-    std::vector<unsigned char> dadosTextura(w * h * 3);
-    for (int i = 0; i < w * h; i++) {
-        // Mapear componentes de -1,1 para 0,255
-        dadosTextura[i * 3 + 0] = static_cast<unsigned char>((normais[i].x));
-        dadosTextura[i * 3 + 1] = static_cast<unsigned char>((normais[i].y));
-        dadosTextura[i * 3 + 2] = static_cast<unsigned char>((normais[i].z));
+    if (paginasMudaram) {
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_STREAM_PAGES);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                        TileStreamer::RING_SIZE, TileStreamer::RING_SIZE, TileStreamer::LEVEL_COUNT,
+                        GL_RED_INTEGER, GL_SHORT, streamer.pageTable().data());
     }
-    
-    // Criar e configurar a textura de normais
-    glActiveTexture(GL_TEXTURE0 + smapID);
-    if (glIsTexture(g_gl.textures[smapID]))
-        glDeleteTextures(1, &g_gl.textures[smapID]);
+    glActiveTexture(GL_TEXTURE0);
+}
 
+// -----------------------------------------------------------------------------
+// Clipmap: janelas aninhadas ao redor da câmera com alturas da NoiseSpec mais
+// finas que o dmap, que continua valendo fora delas. O nível L tem texels
+// 2^(L - HeightClipmap::LEVEL_COUNT) texels do dmap de lado, então até o mais
+// grosso tem o dobro da resolução do dmap, e o shader escolhe o nível pela
+// profundidade do nó da LEB
+bool clipmapAtivo() {
+    return clipmapTerrain && g_terrain.flags.displace && !streamingAtivo();
+}
 
-    glGenTextures(1, &g_gl.textures[smapID]);
-    glActiveTexture(GL_TEXTURE0 + smapID);
-    glBindTexture(GL_TEXTURE_2D, g_gl.textures[smapID]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, dadosTextura.data());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glGenerateMipmap(GL_TEXTURE_2D);
+HeightClipmap& heightClipmap() {
+    static HeightClipmap clipmap(threadPool());
+
+    return clipmap;
 }
-////////////////////////////////////////////////////////////////////////////////
-// Funções para geração de altura e normalização do terreno
-////////////////////////////////////////////////////////////////////////////////
 
-// Gerar altura utilizando ruído procedural
-void gerarAltura(int startH, int endH, int w, float tamAmostra, float *zf_arr) {
-    for (int j = startH; j < endH; j++) {
-        for (int i = 0; i < w; i++) {
-
-            // Define-se uma altura base
-            float height = -2000.5f;
-            
-            // Cria-se o vetor de posição. Note que "height" entra como y
-            glm::vec3 pos = glm::vec3(
-                (float)(i) * tamAmostra,
-                height,
-                (float)(j) * tamAmostra
-            );
-
-            // Calcula-se o ruído fBm
-            float noiseFBM = glm::abs(
-                Simplex::fBm(wavelength * pos, octaves, lacunarity, gain)
-                / (float)(wavelength)
-            );
-
-            // Aplica elevação do valor (potência) e a nova altura a partir do ruído
-            noiseFBM = pow(noiseFBM, (float)(elevation));
-            noiseFBM *= (float)(wavelength);
-
-            // Trunca em 6 casas decimais
-            int trunc = (int)(noiseFBM * 1000000);
-            noiseFBM = (float)(noiseFBM) / 1000000.0f;
+// Texels do nível 0 do clipmap por unidade de textura
+double texelsClipmap() {
+    return heightmapSize * (double)(1 << HeightClipmap::LEVEL_COUNT);
+}
 
-            // Salva no array de alturas
-            zf_arr[i + w * j] = noiseFBM;
-        }
+// Descarta os níveis; chamada quando o dmap muda. Sem o intervalo da
+// NoiseSpec (dmap da CPU ou de arquivo), o shader só usa o dmap
+void reiniciarClipmap()
+{
+    const NoiseSpec::Params p = parametrosEspec();
+    const float minimo = intervaloEspec.min;
+    const float escala = intervaloEspec.max > intervaloEspec.min
+                       ? 1.0f / (intervaloEspec.max - intervaloEspec.min) : 0.0f;
+
+    if (!clipmapAtivo())
+        return;
+
+    if (intervaloEspec.isEmpty()) {
+        heightClipmap().reset(HeightClipmap::RowKernel());
+        return;
     }
+
+    heightClipmap().reset([p, minimo, escala](int nivel, int x0, int y, int n, float *alturas) {
+        // o texel t do nível L fica no ponto t * 2^(L - LEVEL_COUNT) - 1/2
+        // do dmap, um número inteiro de texels do nível, já que L < LEVEL_COUNT
+        const int meioTexel = 1 << (HeightClipmap::LEVEL_COUNT - 1 - nivel);
+        NoiseSpec::Params q = p;
+
+        // escala exata por potência de 2, como no terreno infinito, e a
+        // mesma normalização de carregarAlturas
+        q.frequency = ldexpf(p.frequency, nivel - HeightClipmap::LEVEL_COUNT);
+        NoiseSpec::heights(q, x0 - meioTexel, y - meioTexel, n, alturas);
+        for (int i = 0; i < n; ++i)
+            alturas[i] = (alturas[i] - minimo) * escala;
+    });
 }
 
-bool gerarTextura(int dmapID, int smapID)
+// Textura do clipmap: uma camada por nível. A repetição nas bordas lê o
+// endereçamento toroidal do HeightClipmap sem remapeamento
+bool LoadClipmapTexture()
 {
-    double lastTime = glfwGetTime();
-    
-    int size = 1024;
-    int w = size;
-    int h = size;
-    int mipcnt = djgt__mipcnt(w, h, 1);
-    
-    if (!glIsProgram(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION])) {
-        LOG("Erro: Programa de compute shader inválido\n");
-        return false;
-    }
+    GLuint *clipmap = &g_gl.textures[TEXTURE_CLIPMAP];
+
+    if (glIsTexture(*clipmap))
+        glDeleteTextures(1, clipmap);
+    *clipmap = 0;
+
+    if (!clipmapAtivo())
+        return (glGetError() == GL_NO_ERROR);
+
+    glGenTextures(1, clipmap);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_CLIPMAP);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, *clipmap);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R32F,
+                   HeightClipmap::SIZE, HeightClipmap::SIZE, HeightClipmap::LEVEL_COUNT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glActiveTexture(GL_TEXTURE0);
 
-    glUseProgram(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION]);
-    GLenum err = glGetError();
-    if (err != GL_NO_ERROR) {
-        LOG("Erro ao ativar programa: 0x%x\n", err);
-        return false;
-    }
+    // os níveis foram perdidos com a textura
+    reiniciarClipmap();
 
-    LOG("Heighmap %i\n", g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION]);
-    if (!glIsProgram(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION])) {
-        std::cerr << "Erro: Programa de compute shader para heightmap não está disponível" << std::endl;
-        return false;
-    }
-    
-    if (glIsBuffer(g_gl.buffers[BUFFER_HEIGHTMAP_OUTPUT]))
-        glDeleteBuffers(1, &g_gl.buffers[BUFFER_HEIGHTMAP_OUTPUT]);
-        
-    glGenBuffers(1, &g_gl.buffers[BUFFER_HEIGHTMAP_OUTPUT]);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_gl.buffers[BUFFER_HEIGHTMAP_OUTPUT]);
-    
-    glBufferData(GL_SHADER_STORAGE_BUFFER, size * size * sizeof(float) * 2, NULL, GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, g_gl.buffers[BUFFER_HEIGHTMAP_OUTPUT]);
-    
-    err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cerr << "Erro ao criar buffer do heightmap: " << err << std::endl;
-        return false;
-    }
-    
-    int numGroupsX = (size + 15) / 16;
-    int numGroupsY = (size + 15) / 16;
-    
-    double gpuStartTime = glfwGetTime();
-    
-    glUseProgram(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION]);
-    
-    err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cerr << "Erro ao ativar programa do compute shader: " << err << std::endl;
-        return false;
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// Chamada a cada quadro: envia as faixas dos níveis cuja geração terminou e
+// recentra os outros na câmera, sem esperar pelas threads
+void atualizarClipmap()
+{
+    if (!clipmapAtivo())
+        return;
+
+    HeightClipmap& clipmap = heightClipmap();
+    const dja::vec4 camera = dja::inverse(modeloMapa())
+                           * dja::vec4(g_camera.pos.x, g_camera.pos.y, g_camera.pos.z, 1.0f);
+
+    clipmap.update(camera.x * texelsClipmap(), camera.y * texelsClipmap());
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_CLIPMAP);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, HeightClipmap::SIZE);
+    for (size_t i = 0; i < clipmap.uploads().size(); ++i) {
+        const HeightClipmap::Region& faixa = clipmap.uploads()[i];
+
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, faixa.x, faixa.y, faixa.level,
+                        faixa.width, faixa.height, 1, GL_RED, GL_FLOAT,
+                        clipmap.heights(faixa.level) + faixa.x + (size_t)HeightClipmap::SIZE * faixa.y);
     }
-    
-    GLint sizeLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "size");
-    GLint seedLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "seed");
-    GLint elevationLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "elevation");
-    GLint octavesLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "octaves");
-    GLint wavelengthLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "wavelength");
-    GLint lacunarityLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "lacunarity");
-    GLint gainLocation = glGetUniformLocation(g_gl.programs[PROGRAM_HEIGHTMAP_GENERATION], "gain");
-    
-    if (sizeLocation != -1) glUniform1i(sizeLocation, size);
-    if (seedLocation != -1) glUniform1i(seedLocation, seeds);
-    if (elevationLocation != -1) glUniform1f(elevationLocation, elevation);
-    if (octavesLocation != -1) glUniform1i(octavesLocation, octaves);
-    if (wavelengthLocation != -1) glUniform1f(wavelengthLocation, wavelength);
-    if (lacunarityLocation != -1) glUniform1f(lacunarityLocation, lacunarity);
-    if (gainLocation != -1) glUniform1f(gainLocation, gain);
-    
-    err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cerr << "Erro ao definir uniformes: " << err << std::endl;
-        return false;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Máscaras de cor em preparo no pool compartilhado. As threads leem uma cópia
+// das alturas, e a textura atual continua em uso até as novas ficarem prontas
+struct AssamentoSplat {
+    ThreadPool& pool;
+    ThreadPool::Group grupo;
+    std::atomic<int> geracao;
+    bool pendente;
+    int w, h;
+    float escalaMinima;
+    std::vector<float> alturas;
+    std::vector<uint8_t> mascaras;
+    double inicio;
+
+    explicit AssamentoSplat(ThreadPool& pool): pool(pool), geracao(0), pendente(false),
+                                               w(0), h(0), escalaMinima(0.0f), inicio(0.0) {}
+    ~AssamentoSplat() { cancelar(); }
+
+    // as linhas que faltam são puladas, então a espera é curta
+    void cancelar() {
+        ++geracao;
+        pool.wait(grupo);
+        pendente = false;
     }
-    
-    glDispatchCompute(numGroupsX, numGroupsY, 1);
-    
-    err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cerr << "Erro ao executar compute shader: " << err << std::endl;
-        return false;
+};
+
+AssamentoSplat& assamentoSplat() {
+    static AssamentoSplat assamento(threadPool());
+
+    return assamento;
+}
+
+// Pré-calcular as máscaras de cor do sombreamento difuso (SplatMap) sobre os
+// texels do dmap atual, com a escala de altura e as escalas de ruído atuais.
+// Chamada quando o dmap, a DmapScale ou um "Noise Value" muda; descarta o
+// preparo anterior e retorna sem esperar: atualizarSplat() envia a textura
+bool assarSplat()
+{
+    AssamentoSplat& assamento = assamentoSplat();
+    const HeightPyramid& pyramid = heightPyramid();
+    const TiledHeightmapFile& arquivo = tiledHeightmapFile();
+    const bool daPiramide = pyramid.levelCount() > 0;
+    const int w = daPiramide ? pyramid.width() : arquivo.levelCount() > 0 ? arquivo.width(0) : 0;
+    const int h = daPiramide ? pyramid.height() : arquivo.levelCount() > 0 ? arquivo.height(0) : 0;
+    const float escalas[SplatMap::LAYER_COUNT] = {noiseH0, noiseH1, noiseH2, noiseH3};
+    const dja::mat4 modelo = modeloMapa();
+    const float dmapFactor = g_terrain.dmap.scale;
+    const int linhasPorTarefa = 16;
+
+    assamento.cancelar();
+    if (w == 0 || h == 0)
+        return (glGetError() == GL_NO_ERROR);
+
+    // o passo no mundo entre texels vizinhos, no eixo mais esticado
+    const dja::vec4 passoX = modelo * dja::vec4(1.0f / w, 0.0f, 0.0f, 0.0f);
+    const dja::vec4 passoY = modelo * dja::vec4(0.0f, 1.0f / h, 0.0f, 0.0f);
+    const float tamanhoTexel = std::max(dja::norm(dja::vec3(passoX.x, passoX.y, passoX.z)),
+                                        dja::norm(dja::vec3(passoY.x, passoY.y, passoY.z)));
+    const int geracao = assamento.geracao.load();
+    std::vector<ThreadPool::Task> tarefas;
+
+    assamento.inicio = glfwGetTime();
+    assamento.w = w;
+    assamento.h = h;
+    assamento.escalaMinima = SplatMap::MIN_TEXELS * tamanhoTexel;
+    if (daPiramide) {
+        assamento.alturas = pyramid.level(0).mean;
+    } else {
+        assamento.alturas.resize((size_t)w * h);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                assamento.alturas[i + (size_t)w * j] = arquivo.height(0, i, j);
     }
-    
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    
-    double gpuEndTime = glfwGetTime();
-    double gpuDeltaTime = gpuEndTime - gpuStartTime;
-    std::cout << "Tempo de execução da geração do heightmap na GPU: " << gpuDeltaTime << " segundos" << std::endl;
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_gl.buffers[BUFFER_HEIGHTMAP_OUTPUT]);
-    void* mappedData = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
-    
-    if (mappedData) {
-        struct vec2 { float x, y; };
-        vec2* heightmapData = (vec2*)mappedData;
-        
-        float min = INFINITY;
-        float max = -INFINITY;
-        
-        for (int j = 0; j < h; ++j) {
-            for (int i = 0; i < w; ++i) {
-                float height = heightmapData[i + w * j].x;
-                min = std::min(min, height);
-                max = std::max(max, height);
-            }
-        }
-        
-        std::vector<uint16_t> dmap(w * h * 2);
-        std::vector<uint16_t> texels2(w * h);
-        
-        for (int j = 0; j < h; ++j) {
-            for (int i = 0; i < w; ++i) {
-                float h_value = (heightmapData[i + w * j].x - min) / (max - min);
-                
-                uint16_t h16 = uint16_t(h_value * ((1 << 16) - 1));
-                uint16_t h2 = h_value * h_value * ((1 << 16) - 1);
-                texels2[i + w * j] = h16;
-                
-                dmap[    2 * (i + w * j)] = h16;
-                dmap[1 + 2 * (i + w * j)] = h2;
+    assamento.mascaras.resize((size_t)w * h * 4);
+
+    // a posição no mundo de cada texel é a do vértice que o shader gera
+    // para a mesma coordenada de textura
+    for (int y0 = 0; y0 < h; y0+= linhasPorTarefa) {
+        tarefas.push_back([&assamento, geracao, y0, w, h, escalas, modelo, dmapFactor, tamanhoTexel] {
+            const int y1 = std::min(y0 + linhasPorTarefa, h);
+            std::vector<float> posicoes(3 * w);
+
+            for (int j = y0; j < y1 && assamento.geracao.load() == geracao; ++j) {
+                for (int i = 0; i < w; ++i) {
+                    const float altura = assamento.alturas[i + (size_t)w * j];
+                    const dja::vec4 p = modelo * dja::vec4((i + 0.5f) / w, (j + 0.5f) / h,
+                                                           dmapFactor * altura, 1.0f);
+
+                    posicoes[3 * i    ] = p.x;
+                    posicoes[3 * i + 1] = p.y;
+                    posicoes[3 * i + 2] = p.z;
+                }
+
+                SplatMap::bake(posicoes.data(), w, escalas, tamanhoTexel,
+                               &assamento.mascaras[4 * (size_t)w * j]);
             }
-        }
-        
-        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-        
-        double now = glfwGetTime();
-        double deltaTime1 = now - lastTime;
-        std::cout << "Tempo de processamento após geração na GPU: " << deltaTime1 << " segundos" << std::endl;
-        
-        double nowNormal = glfwGetTime();
-        
-        gerarNormal(smapID, texels2, w, h);
-        
-        glActiveTexture(GL_TEXTURE0 + dmapID);
-        if (glIsTexture(g_gl.textures[dmapID]))
-            glDeleteTextures(1, &g_gl.textures[dmapID]);
-        
-        glGenTextures(1, &g_gl.textures[dmapID]);
-        glActiveTexture(GL_TEXTURE0 + dmapID);
-        glBindTexture(GL_TEXTURE_2D, g_gl.textures[dmapID]);
-        glTexStorage2D(GL_TEXTURE_2D, mipcnt, GL_RG16, w, h);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RG, GL_UNSIGNED_SHORT, &dmap[0]);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glActiveTexture(GL_TEXTURE0);
-        
-        now = glfwGetTime();
-        double deltaTime2 = now - nowNormal;
-        std::cout << "Tempo de execução para geração de normais: " << deltaTime2 << " segundos" << std::endl;
-        std::cout << "Tempo total de execução: " << now - lastTime << " segundos" << std::endl;
-    } else {
-        std::cerr << "Erro ao mapear o buffer do heightmap" << std::endl;
-        return false;
+        });
     }
-    // Desativa o programa do compute shader
-    glUseProgram(0);
+    assamento.pool.submit(tarefas, assamento.grupo);
+    assamento.pendente = true;
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+// Chamada a cada quadro: troca a textura das máscaras quando o preparo
+// termina. Retorna true se a textura mudou
+bool atualizarSplat()
+{
+    AssamentoSplat& assamento = assamentoSplat();
+    GLuint *splat = &g_gl.textures[TEXTURE_SPLAT];
+
+    if (!assamento.pendente || !assamento.grupo.isDone())
+        return false;
+    assamento.pendente = false;
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_SPLAT);
+    if (glIsTexture(*splat))
+        glDeleteTextures(1, splat);
+    glGenTextures(1, splat);
+    glBindTexture(GL_TEXTURE_2D, *splat);
+    glTexStorage2D(GL_TEXTURE_2D, djgt__mipcnt(assamento.w, assamento.h, 1), GL_RGBA8,
+                   assamento.w, assamento.h);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, assamento.w, assamento.h,
+                    GL_RGBA, GL_UNSIGNED_BYTE, assamento.mascaras.data());
+    // as máscaras são pesos de mistura: a média do driver serve
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+
+    // as camadas abaixo da escala mínima não foram assadas
+    escalaMinimaSplat = assamento.escalaMinima;
+    ConfigureTerrainPrograms();
+
+    std::cout << "Tempo de cálculo das máscaras de cor: " << glfwGetTime() - assamento.inicio << " segundos" << std::endl;
 
     return (glGetError() == GL_NO_ERROR);
 }
@@ -1821,8 +3201,23 @@ bool LoadDmapTexture()
 
     //LOG("%s", g_terrain.dmap.pathToFile.c_str());
     if (!g_terrain.dmap.pathToFile.empty()) {
-        return gerarTextura(TEXTURE_DMAP,
-                                 TEXTURE_SMAP);
+        const std::string& caminho = g_terrain.dmap.pathToFile;
+
+        bool success;
+
+        if (caminho.size() > 4 && caminho.compare(caminho.size() - 4, 4, ".thm") == 0) {
+            success = carregarAlturasDeArquivo(TEXTURE_DMAP, TEXTURE_SMAP, caminho);
+        } else {
+            success = gerarTextura(TEXTURE_DMAP,
+                                   TEXTURE_SMAP);
+            // os ladrilhos são normalizados com o intervalo do novo dmap
+            reiniciarStreaming();
+        }
+
+        // o detalhe do clipmap é normalizado com o intervalo do novo dmap
+        reiniciarClipmap();
+
+        return success && assarSplat();
     }
 
     return (glGetError() == GL_NO_ERROR);
@@ -1891,6 +3286,8 @@ bool LoadTextures()
 
     if (v) v &= LoadSceneFramebufferTexture();
     if (v) v &= LoadDmapTexture();
+    if (v) v &= LoadStreamingTextures();
+    if (v) v &= LoadClipmapTexture();
     if (v) v &= LoadBrunetonAtmosphereTextures();
 
     return v;
@@ -1963,17 +3360,10 @@ bool LoadTerrainVariables()
 #endif
     }
 
-    float width = g_terrain.dmap.width;
-    float height = g_terrain.dmap.height;
-    float zMin = g_terrain.dmap.zMin;
-    float zMax = g_terrain.dmap.zMax;
-    dja::vec3 scale = dja::vec3(width, zMax - zMin, height);
     dja::mat4 viewInv = dja::mat4::homogeneous::translation(g_camera.pos)
         * dja::mat4::homogeneous::from_mat3(g_camera.axis);
     dja::mat4 view = dja::inverse(viewInv);
-    dja::mat4 model = dja::mat4::homogeneous::translation(dja::vec3(-width / 2.0f, zMin, +height / 2.0f))
-            * dja::mat4::homogeneous::scale(dja::vec3(scale))
-            * dja::mat4::homogeneous::rotation(dja::vec3(1, 0, 0), M_PI / 2.0f);
+    dja::mat4 model = modeloTerreno();
 
     // set transformations (column-major)
     variables.model = dja::transpose(model);
@@ -2007,31 +3397,130 @@ bool LoadTerrainVariables()
     return (glGetError() == GL_NO_ERROR);
 }
 
+// -----------------------------------------------------------------------------
+/**
+ * Load Terrain Streaming UBO
+ *
+ * This procedure updates the windows of the streamed terrain levels, relative
+ * to the corner of the LEB square; it is updated each frame.
+ */
+bool LoadTerrainStreamingVariables()
+{
+    static bool first = true;
+    struct StreamingVariables {
+        dja::vec4 levels[TileStreamer::LEVEL_COUNT];    // xy: first texel of the window
+        dja::vec4 camera;   // xy: camera, z: texels per unit, w: height / width in meters
+    } variables;
+
+    if (first) {
+        g_gl.streams[STREAM_TERRAIN_STREAMING] = djgb_create(sizeof(variables));
+        first = false;
+    }
+
+    // the origin is a multiple of the coarsest tile: the offsets are exact
+    for (int level = 0; level < TileStreamer::LEVEL_COUNT; ++level) {
+        const double scale = 1.0 / (double)(1 << level);
+
+        variables.levels[level].x = (float)((double)tileStreamer().windowX(level) * TileStreamer::TILE_SIZE
+                                            - g_streaming.originX * scale);
+        variables.levels[level].y = (float)((double)tileStreamer().windowY(level) * TileStreamer::TILE_SIZE
+                                            - g_streaming.originY * scale);
+        variables.levels[level].z = variables.levels[level].w = 0.0f;
+    }
+    variables.camera.x = (float)(g_streaming.cameraX - g_streaming.originX);
+    variables.camera.y = (float)(g_streaming.cameraY - g_streaming.originY);
+    variables.camera.z = (float)g_streaming.size;
+    variables.camera.w = (g_terrain.dmap.zMax - g_terrain.dmap.zMin) * heightmapSize
+                       * (float)(1 << STREAMING_DETAIL_LEVELS)
+                       / (g_terrain.dmap.width * (float)g_streaming.size);
+
+    djgb_to_gl(g_gl.streams[STREAM_TERRAIN_STREAMING], (const void *)&variables, NULL);
+    djgb_glbindrange(g_gl.streams[STREAM_TERRAIN_STREAMING],
+                     GL_UNIFORM_BUFFER,
+                     STREAM_TERRAIN_STREAMING);
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
+/**
+ * Load Terrain Clipmap UBO
+ *
+ * This procedure updates the windows of the clipmap levels; it is updated
+ * each frame.
+ */
+bool LoadTerrainClipmapVariables()
+{
+    static bool first = true;
+    struct ClipmapVariables {
+        dja::vec4 levels[HeightClipmap::LEVEL_COUNT];   // xy: first texel of the window, z: 1 if generated
+        dja::vec4 scale;    // x: texels of level 0 per unit, y: level of the nodes of depth 0
+    } variables;
+    const HeightClipmap& clipmap = heightClipmap();
+    int zeros = 0;
+
+    if (first) {
+        g_gl.streams[STREAM_TERRAIN_CLIPMAP] = djgb_create(sizeof(variables));
+        first = false;
+    }
+
+    // the vertices of the nodes of depth d sit on a grid of 2^-floor(d/2)
+    // units, which holds texels of level L for L <= zeros + LEVEL_COUNT - floor(d/2)
+    while (zeros < 16 && !((heightmapSize >> zeros) & 1))
+        ++zeros;
+
+    for (int level = 0; level < HeightClipmap::LEVEL_COUNT; ++level) {
+        variables.levels[level].x = (float)clipmap.windowX(level);
+        variables.levels[level].y = (float)clipmap.windowY(level);
+        variables.levels[level].z = clipmap.isValid(level) ? 1.0f : 0.0f;
+        variables.levels[level].w = 0.0f;
+    }
+    variables.scale.x = (float)texelsClipmap();
+    variables.scale.y = (float)(zeros + HeightClipmap::LEVEL_COUNT);
+    variables.scale.z = variables.scale.w = 0.0f;
+
+    djgb_to_gl(g_gl.streams[STREAM_TERRAIN_CLIPMAP], (const void *)&variables, NULL);
+    djgb_glbindrange(g_gl.streams[STREAM_TERRAIN_CLIPMAP],
+                     GL_UNIFORM_BUFFER,
+                     STREAM_TERRAIN_CLIPMAP);
+
+    return (glGetError() == GL_NO_ERROR);
+}
+
 // -----------------------------------------------------------------------------
 /**
  * Load LEB Buffer
  *
- * This procedure initializes the subdivision buffer.
+ * This procedure initializes the subdivision buffer. The buffer is only
+ * reallocated when its size changes (i.e., when the max depth changes);
+ * otherwise it is cleared on the GPU and only the non-zero words of the
+ * initial heap are uploaded.
  */
 bool LoadLebBuffer()
 {
     cbt_Tree *cbt = cbt_CreateAtDepth(g_terrain.maxDepth, 1);
+    GLuint *buffer = &g_gl.buffers[BUFFER_LEB];
+    GLint64 bufferSize = 0;
 
     //LOG("%s\n", "LoadLebBuffer");
     //LOG("Loading {Subd-Buffer}\n");
 
-    if (glIsBuffer(g_gl.buffers[BUFFER_LEB]))
-        glDeleteBuffers(1, &g_gl.buffers[BUFFER_LEB]);
-    glGenBuffers(1, &g_gl.buffers[BUFFER_LEB]);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_gl.buffers[BUFFER_LEB]);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,
-                 cbt_HeapByteSize(cbt),
-                 cbt_GetHeap(cbt),
-                 GL_STATIC_DRAW);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (glIsBuffer(*buffer))
+        glGetNamedBufferParameteri64v(*buffer, GL_BUFFER_SIZE, &bufferSize);
+
+    if (bufferSize != cbt_HeapByteSize(cbt)) {
+        if (glIsBuffer(*buffer))
+            glDeleteBuffers(1, buffer);
+        glCreateBuffers(1, buffer);
+        glNamedBufferStorage(*buffer,
+                             cbt_HeapByteSize(cbt),
+                             NULL,
+                             GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    UploadHeapSparse(*buffer, cbt_GetHeap(cbt), cbt_HeapByteSize(cbt));
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
                      BUFFER_LEB,
-                     g_gl.buffers[BUFFER_LEB]);
+                     *buffer);
 
     cbt_Release(cbt);
 
@@ -2493,6 +3982,7 @@ void release()
     for (i = 0; i < PROGRAM_COUNT; ++i)
         if (glIsProgram(g_gl.programs[i]))
             glDeleteProgram(g_gl.programs[i]);
+    noiseSpecGpu().release();
     for (i = 0; i < TEXTURE_COUNT; ++i)
         if (glIsTexture(g_gl.textures[i]))
             glDeleteTextures(1, &g_gl.textures[i]);
@@ -2854,6 +4344,10 @@ void renderTerrain()
     djgc_start(g_gl.clocks[CLOCK_ALL]);
 
     LoadTerrainVariables();
+    if (streamingAtivo())
+        LoadTerrainStreamingVariables();
+    if (clipmapAtivo())
+        LoadTerrainClipmapVariables();
     lebUpdate();
     lebReductionPass();
     lebBatchingPass();
@@ -3183,7 +4677,7 @@ void renderViewer()
 
         // Terrain Parameters
         ImGui::SetNextWindowPos(ImVec2(270, 10), ImGuiCond_FirstUseEver);
-        ImGui::SetNextWindowSize(ImVec2(380, 235), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(380, 255), ImGuiCond_FirstUseEver);
         ImGui::Begin("CBT Terrain Settings");
         {
             const char* eShadings[] = {
@@ -3217,12 +4711,36 @@ void renderViewer()
             if (!g_terrain.dmap.pathToFile.empty()) {
                 ImGui::SameLine();
                 if (ImGui::Checkbox("Displace", &g_terrain.flags.displace)) {
+                    LoadStreamingTextures();
+                    LoadClipmapTexture();
                     LoadTerrainPrograms();
                     LoadTopViewProgram();
                 }
             }
             ImGui::SameLine();
             ImGui::Checkbox("TopView", &g_terrain.flags.topView);
+            if (g_terrain.flags.displace) {
+                if (ImGui::Checkbox("Streaming", &streamedTerrain)) {
+                    LoadStreamingTextures();
+                    LoadClipmapTexture();
+                    LoadTerrainPrograms();
+                }
+                if (streamedTerrain) {
+                    ImGui::SameLine();
+                    ImGui::Text("Tiles: %i/%i (%i pending)", tileStreamer().residentCount(),
+                                tileStreamer().slotCount(), tileStreamer().pendingCount());
+                } else {
+                    ImGui::SameLine();
+                    if (ImGui::Checkbox("Clipmap", &clipmapTerrain)) {
+                        LoadClipmapTexture();
+                        LoadTerrainPrograms();
+                    }
+                    if (clipmapTerrain && intervaloEspec.isEmpty()) {
+                        ImGui::SameLine();
+                        ImGui::Text("(NoiseSpec only)");
+                    }
+                }
+            }
             if (ImGui::SliderFloat("PixelsPerEdge", &g_terrain.primitivePixelLengthTarget, 1, 32)) {
                 ConfigureTerrainPrograms();
             }
@@ -3230,6 +4748,9 @@ void renderViewer()
                 ConfigureTerrainPrograms();
                 ConfigureTopViewProgram();
             }
+            // as máscaras de cor dependem da altura no mundo: só ao soltar
+            if (ImGui::IsItemDeactivatedAfterEdit())
+                assarSplat();
             if (ImGui::SliderFloat("LodStdev", &g_terrain.minLodStdev, 0.f, 1.0f, "%.4f")) {
                 ConfigureTerrainPrograms();
             }
@@ -3259,7 +4780,7 @@ void renderViewer()
 
 
         ImGui::SetNextWindowPos(ImVec2(10, 185), ImGuiCond_FirstUseEver);
-        ImGui::SetNextWindowSize(ImVec2(250, 215), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(250, 255), ImGuiCond_FirstUseEver);
         ImGui::Begin("Terrain fBm Settings");
         {
             const char* eTerrain[] = {
@@ -3321,12 +4842,40 @@ void renderViewer()
             }
             if (ImGui::Checkbox("Derivative Normals", &derivative_normals))
                 LOG("Derivative Normals= %i\n", derivative_normals);
+            if (ImGui::SliderInt("Resolution", &heightmapSize, 64, 4096)){
+                LOG("Resolution = %i\n", heightmapSize);
+                LoadDmapTexture();
+            }
+            if (ImGui::Checkbox("CPU Generation", &cpuGeneration)){
+                LOG("CPU Generation = %i\n", cpuGeneration);
+                LoadDmapTexture();
+            }
+            // a NoiseSpec dá as mesmas alturas em qualquer backend: só muda o tempo
+            if (!cpuGeneration) {
+                const char* eBackends[] = {"Automatic", "CPU", "GPU"};
+
+                if (ImGui::Combo("Backend", &heightmapBackend, &eBackends[0], BUFFER_SIZE(eBackends))){
+                    LOG("Backend = %i\n", heightmapBackend);
+                }
+            }
+            if (ImGui::Checkbox("Progressive", &progressiveGeneration)){
+                LOG("Progressive = %i\n", progressiveGeneration);
+                LoadDmapTexture();
+            }
+            // só o ruído 3D da CPU tem a variante com hash inteiro
+            if (cpuGeneration && ImGui::Checkbox("Integer Hash", &integerHash)){
+                LOG("Integer Hash = %i\n", integerHash);
+                LoadDmapTexture();
+            }
+            if (ImGui::Checkbox("Disk Cache", &diskCache)){
+                LOG("Disk Cache = %i\n", diskCache);
+            }
         }
         ImGui::End();
    
 
         ImGui::SetNextWindowPos(ImVec2(10, 405), ImGuiCond_FirstUseEver);
-        ImGui::SetNextWindowSize(ImVec2(250, 80), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(250, 130), ImGuiCond_FirstUseEver);
         ImGui::Begin("Generate Buttons");
         {
             if (ImGui::Button("Terrain A")){
@@ -3394,6 +4943,15 @@ void renderViewer()
 
             if (ImGui::Button("Generate Terrain"))
                 LoadDmapTexture();
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Export .thm"))
+                exportarAlturas(PATH_TO_SRC_DIRECTORY "heightmap.thm");
+
+            ImGui::SliderInt("PNG Size", &pngExportSize, 256, 16384);
+            if (ImGui::Button("Export PNG"))
+                exportarPng(PATH_TO_SRC_DIRECTORY "heightmap.png", pngExportSize);
         }
         ImGui::End();
 
@@ -3402,6 +4960,8 @@ void renderViewer()
         ImGui::Begin("Color Picker3");
         ImGui::SliderFloat("Height", &height3, 1.f, 6000.f, "%1.f");
         ImGui::SliderFloat("Noise Value", &noiseH3, 1.f, 10000.f, "ratio = %1.f");
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            assarSplat();
 
         ImGui::ColorPicker3("ColorPicker3", (float*)&color0);
         {
@@ -3418,6 +4978,8 @@ void renderViewer()
         ImGui::Begin("Color Picker2");
         ImGui::SliderFloat("Height", &height2, 1.f, 6000.f, "%1.f");
         ImGui::SliderFloat("Noise Value", &noiseH2, 1.f, 10000.f, "ratio = %1.f");
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            assarSplat();
 
         ImGui::ColorPicker3("ColorPicker3", (float*)&color1);
         {
@@ -3437,6 +4999,8 @@ void renderViewer()
         ImGui::Begin("Color Picker1");
         ImGui::SliderFloat("Height", &height1, 1.f, 6000.f, "%1.f");
         ImGui::SliderFloat("Noise Value", &noiseH1, 1.f, 10000.f, "ratio = %1.f");
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            assarSplat();
 
         ImGui::ColorPicker3("ColorPicker3", (float*)&color2);
         {   
@@ -3454,6 +5018,8 @@ void renderViewer()
         ImGui::Begin("Color Picker0");
         ImGui::SliderFloat("Height", &height0, 1.f, 6000.f, "%1.f");
         ImGui::SliderFloat("Noise Value", &noiseH0, 1.f, 10000.f, "ratio = %1.f");
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            assarSplat();
         ImGui::ColorPicker3("ColorPicker3", (float*)&color3);
         {
             color_backGround3[0] = color3[0];
@@ -3494,6 +5060,12 @@ void render()
 {
     //LOG("%s\n", "*render");
 
+    if (atualizarTexturaProgressiva())
+        assarSplat();
+    atualizarSplat();
+    atualizarTerrenoStreaming();
+    atualizarClipmap();
+
     glBindFramebuffer(GL_FRAMEBUFFER, g_gl.framebuffers[FRAMEBUFFER_SCENE]);
     glViewport(0, 0, g_framebuffer.w, g_framebuffer.h);
     glClearColor(0.5, 0.5, 0.5, 1.0);
@@ -3633,8 +5205,12 @@ void usage(const char *app)
 
 
 // -----------------------------------------------------------------------------
-int main(int, char **)
+int main(int argc, char **argv)
 {
+    // terrain [mapa.thm]: abre um heightmap em ladrilhos no lugar do procedural
+    if (argc > 1)
+        g_terrain.dmap.pathToFile = argv[1];
+
     double lastTime = glfwGetTime();
     double deltaTime = 0;
 
@@ -0,0 +1,122 @@
+#include "tile_scheduler.hpp"
+#include <algorithm>
+
+TileScheduler::TileScheduler(ThreadPool &pool):
+    m_pool(pool),
+    m_nextTile(0),
+    m_remainingTexels(0)
+{}
+
+// Claims the next tile for a worker of backend, or returns false (and the
+// worker stops) when the queue is empty or the other workers would finish
+// the rest of the queue before this one finishes the tile
+bool TileScheduler::claim(Backend backend, Tile *tile) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_nextTile < m_tiles.size()) {
+        const Tile &next = m_tiles[m_nextTile];
+        const double texels = (double)(next.x1 - next.x0) * (next.y1 - next.y0);
+        const double seconds = texels * m_stats.secondsPerTexel[backend];
+        double otherRate = 0.0, bestOtherRate = 0.0;
+
+        for (int b = 0; b < BACKEND_COUNT; ++b) {
+            const int workerCount = m_workerCount[b] - (b == backend ? 1 : 0);
+
+            if (workerCount > 0 && m_stats.secondsPerTexel[b] > 0.0) {
+                otherRate+= workerCount / m_stats.secondsPerTexel[b];
+                bestOtherRate = std::max(bestOtherRate, 1.0 / m_stats.secondsPerTexel[b]);
+            }
+        }
+
+        // a tile is not split: the others need at least one tile time
+        if (seconds == 0.0 || otherRate == 0.0
+            || seconds <= std::max((double)m_remainingTexels / otherRate, texels / bestOtherRate)) {
+            *tile = next;
+            ++m_nextTile;
+            m_remainingTexels-= (int64_t)texels;
+            return true;
+        }
+    }
+
+    --m_workerCount[backend];
+    return false;
+}
+
+void TileScheduler::finish(Backend backend, const Tile &tile, double seconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const double secondsPerTexel = seconds / ((double)(tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+    double &average = m_stats.secondsPerTexel[backend];
+
+    average = (average == 0.0) ? secondsPerTexel : 0.75 * average + 0.25 * secondsPerTexel;
+    ++m_stats.tileCount[backend];
+}
+
+void TileScheduler::work(Backend backend, const TileKernel &kernel) {
+    Tile tile;
+
+    while (claim(backend, &tile)) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        kernel(tile.x0, tile.y0, tile.x1, tile.y1);
+        finish(backend, tile, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+TileScheduler::Stats TileScheduler::run(int width, int height, const TileKernel &cpuKernel,
+                                        const TileKernel &gpuKernel, Mode mode) {
+    const bool useGpu = gpuKernel && mode != CPU_ONLY;
+    const bool useCpu = !useGpu || mode != GPU_ONLY;
+
+    m_tiles.clear();
+    for (int y0 = 0; y0 < height; y0+= TILE_SIZE) {
+        for (int x0 = 0; x0 < width; x0+= TILE_SIZE) {
+            Tile tile = {x0, y0, std::min(x0 + TILE_SIZE, width), std::min(y0 + TILE_SIZE, height)};
+
+            m_tiles.push_back(tile);
+        }
+    }
+    m_nextTile = 0;
+    m_remainingTexels = (int64_t)width * height;
+    m_workerCount[CPU] = useCpu ? threadCount() : 0;
+    m_workerCount[GPU] = useGpu ? 1 : 0;
+    for (int b = 0; b < BACKEND_COUNT; ++b) {
+        m_stats.tileCount[b] = 0;
+        m_stats.secondsPerTexel[b] = 0.0;
+    }
+    m_stats.gpuFailed = false;
+
+    if (useCpu) {
+        std::vector<ThreadPool::Task> tasks(threadCount(), [this, &cpuKernel] {
+            work(CPU, cpuKernel);
+        });
+
+        m_pool.submit(tasks, m_group);
+    }
+
+    if (useGpu) {
+        Tile tile;
+
+        while (claim(GPU, &tile)) {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            if (!gpuKernel(tile.x0, tile.y0, tile.x1, tile.y1)) {
+                cpuKernel(tile.x0, tile.y0, tile.x1, tile.y1);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    m_stats.gpuFailed = true;
+                    ++m_stats.tileCount[CPU];
+                    --m_workerCount[GPU];
+                    ++m_workerCount[CPU];
+                }
+                work(CPU, cpuKernel);
+                break;
+            }
+            finish(GPU, tile, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    m_pool.wait(m_group);
+
+    return m_stats;
+}
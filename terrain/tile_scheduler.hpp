@@ -0,0 +1,71 @@
+#ifndef TILE_SCHEDULER_HPP
+#define TILE_SCHEDULER_HPP
+
+#include "heightmap_generator.hpp"
+
+/*******************************************************************************
+ * TileScheduler -- Generates a map tile by tile on the GPU and the CPU at once
+ *
+ * The map is cut into TILE_SIZE x TILE_SIZE tiles (the last row and column
+ * of tiles may be smaller) that both backends pull from one queue, so the
+ * backend that is free takes the next tile. The GPU kernel runs on the
+ * calling thread, which owns the GL context, and the CPU kernel on every
+ * worker of the shared thread pool.
+ *
+ * Each backend times its tiles. When a worker claims a tile, it leaves it
+ * to the others if they would finish the whole rest of the queue before it
+ * finishes that tile, and stops: on a fast GPU, the last tiles are not
+ * held up by a slow CPU worker, and the other way around. The kernels must
+ * write the same texels (see NoiseSpec), so the map does not depend on
+ * which backend generated which tile. If the GPU kernel fails, its tile is
+ * generated on the CPU and the calling thread carries on as a CPU worker.
+ *
+ * Usage:
+ *      TileScheduler scheduler(pool);
+ *      TileScheduler::Stats stats = scheduler.run(w, h,
+ *          [&](int x0, int y0, int x1, int y1) { ... on the CPU ... return true; },
+ *          [&](int x0, int y0, int x1, int y1) { ... on the GPU ... return ok; });
+ *
+ */
+class TileScheduler {
+public:
+    enum {TILE_SIZE = 128};
+    enum Backend {CPU, GPU, BACKEND_COUNT};
+    enum Mode {AUTOMATIC, CPU_ONLY, GPU_ONLY};
+    // generates the texels [x0, x1) x [y0, y1); returns false on failure
+    typedef std::function<bool(int x0, int y0, int x1, int y1)> TileKernel;
+    struct Stats {
+        int tileCount[BACKEND_COUNT];
+        double secondsPerTexel[BACKEND_COUNT];  // 0 if the backend was not used
+        bool gpuFailed;
+    };
+
+    explicit TileScheduler(ThreadPool &pool);
+
+    // Without a GPU kernel, only the CPU is used. With GPU_ONLY, the CPU
+    // kernel only runs if the GPU kernel fails
+    Stats run(int width, int height, const TileKernel &cpuKernel,
+              const TileKernel &gpuKernel = TileKernel(), Mode mode = AUTOMATIC);
+
+    int threadCount() const { return m_pool.threadCount(); }
+
+private:
+    struct Tile {
+        int x0, y0, x1, y1;
+    };
+
+    bool claim(Backend backend, Tile *tile);
+    void finish(Backend backend, const Tile &tile, double seconds);
+    void work(Backend backend, const TileKernel &kernel);
+
+    ThreadPool &m_pool;
+    ThreadPool::Group m_group;
+    std::mutex m_mutex;
+    std::vector<Tile> m_tiles;
+    size_t m_nextTile;
+    int64_t m_remainingTexels;
+    int m_workerCount[BACKEND_COUNT];
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "tile_streamer.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+size_t TileStreamer::KeyHash::operator()(const Key &key) const {
+    uint64_t h = (uint64_t)(uint32_t)key.x * 0x9e3779b97f4a7c15ull;
+
+    h^= (uint64_t)(uint32_t)key.y * 0xc2b2ae3d27d4eb4full + (h << 6) + (h >> 2);
+    h^= (uint64_t)key.level * 0x165667b19e3779f9ull + (h << 6) + (h >> 2);
+
+    return (size_t)h;
+}
+
+TileStreamer::TileStreamer(ThreadPool &pool, int slotCount):
+    m_slotCount(std::max(slotCount, (int)(LEVEL_COUNT * RING_SIZE * RING_SIZE + 1))),
+    m_pageTable(LEVEL_COUNT * RING_SIZE * RING_SIZE, -1),
+    m_generation(0),
+    m_pool(pool)
+{
+    for (int i = 0; i < LEVEL_COUNT; ++i)
+        m_windows[i].x = m_windows[i].y = 0;
+
+    for (int i = m_slotCount - 1; i >= 0; --i)
+        m_freeSlots.push_back(i);
+}
+
+// the pool outlives the streamer: the tasks in flight skip their tile and
+// must be done before the members they use die
+TileStreamer::~TileStreamer() {
+    ++m_generation;
+    m_pool.wait(m_group);
+}
+
+void TileStreamer::reset(const TileKernel &kernel) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ++m_generation;
+        m_done.clear();
+    }
+
+    m_kernel = kernel;
+    m_lru.clear();
+    m_resident.clear();
+    m_pending.clear();
+    m_uploads.clear();
+    m_freeSlots.clear();
+    for (int i = m_slotCount - 1; i >= 0; --i)
+        m_freeSlots.push_back(i);
+}
+
+bool TileStreamer::isInWindow(const Key &key) const {
+    const Window &window = m_windows[key.level];
+
+    return key.x >= window.x && key.x < window.x + RING_SIZE
+        && key.y >= window.y && key.y < window.y + RING_SIZE;
+}
+
+// a free slot, or the slot of the least recently used tile
+int TileStreamer::acquireSlot() {
+    if (!m_freeSlots.empty()) {
+        const int slot = m_freeSlots.back();
+
+        m_freeSlots.pop_back();
+        return slot;
+    }
+
+    const Key key = m_lru.back();
+    const int slot = m_resident[key].slot;
+
+    m_resident.erase(key);
+    m_lru.pop_back();
+
+    return slot;
+}
+
+// moves the tiles finished by the workers into slots
+void TileStreamer::collect() {
+    std::vector<Tile> done;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        done.swap(m_done);
+    }
+
+    for (size_t i = 0; i < done.size(); ++i) {
+        Tile &tile = done[i];
+        const Key key = {tile.level, tile.x, tile.y};
+        Resident resident;
+
+        m_pending.erase(key);
+        // the window moved on before the tile was done: the cache keeps it
+        // only if a slot is free, and it never evicts a tile of the windows
+        if (!isInWindow(key) && m_freeSlots.empty() && isInWindow(m_lru.back()))
+            continue;
+
+        tile.slot = resident.slot = acquireSlot();
+        m_lru.push_front(key);
+        resident.lru = m_lru.begin();
+        m_resident[key] = resident;
+        m_uploads.push_back(std::move(tile));
+    }
+}
+
+void TileStreamer::request(const Key &key) {
+    const TileKernel kernel = m_kernel;
+    const int generation = m_generation.load();
+
+    m_pending.insert(key);
+    m_pool.submit(std::vector<ThreadPool::Task>(1, [this, kernel, key, generation] {
+        Tile tile;
+
+        if (m_generation.load() != generation)
+            return;
+
+        tile.level = key.level;
+        tile.x = key.x;
+        tile.y = key.y;
+        tile.slot = -1;
+        tile.heights.resize(TILE_TEXELS * TILE_TEXELS);
+        kernel(key.level, key.x * TILE_SIZE, key.y * TILE_SIZE, tile.heights.data());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_generation.load() == generation)
+            m_done.push_back(std::move(tile));
+    }), m_group);
+}
+
+bool TileStreamer::update(double x, double y) {
+    const size_t maxPending = 2 * (size_t)m_pool.threadCount();
+    std::vector<std::pair<int, Key> > missing;
+    std::vector<int16_t> pageTable(m_pageTable.size(), -1);
+
+    m_uploads.clear();
+    if (!m_kernel)
+        return false;
+
+    // centre each window on the tile under (x, y), so that (x, y) is at
+    // least RING_SIZE / 2 - 1/2 tiles away from its borders
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        const double scale = 1.0 / ((double)TILE_SIZE * (double)(1 << level));
+
+        m_windows[level].x = (int)floor(x * scale - RING_SIZE / 2 + 0.5);
+        m_windows[level].y = (int)floor(y * scale - RING_SIZE / 2 + 0.5);
+    }
+
+    // touch the resident tiles of the windows, from the finest level, so
+    // that the coarse tiles are evicted last
+    for (int level = 0; level < LEVEL_COUNT; ++level)
+    for (int j = 0; j < RING_SIZE; ++j)
+    for (int i = 0; i < RING_SIZE; ++i) {
+        const Key key = {level, m_windows[level].x + i, m_windows[level].y + j};
+        const std::unordered_map<Key, Resident, KeyHash>::iterator it = m_resident.find(key);
+
+        if (it != m_resident.end())
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    }
+
+    collect();
+
+    // queue the missing tiles: coarse levels first, then near tiles first
+    for (int level = 0; level < LEVEL_COUNT; ++level)
+    for (int j = 0; j < RING_SIZE; ++j)
+    for (int i = 0; i < RING_SIZE; ++i) {
+        const Key key = {level, m_windows[level].x + i, m_windows[level].y + j};
+        const std::unordered_map<Key, Resident, KeyHash>::iterator it = m_resident.find(key);
+
+        if (it != m_resident.end()) {
+            pageTable[i + RING_SIZE * (j + RING_SIZE * level)] = (int16_t)it->second.slot;
+        } else if (m_pending.find(key) == m_pending.end()) {
+            const int distance = std::max(std::abs(2 * i + 1 - RING_SIZE),
+                                          std::abs(2 * j + 1 - RING_SIZE));
+
+            missing.push_back(std::make_pair(level * 2 * RING_SIZE - distance, key));
+        }
+    }
+
+    std::stable_sort(missing.begin(), missing.end(),
+                     [](const std::pair<int, Key> &a, const std::pair<int, Key> &b) {
+                         return a.first > b.first;
+                     });
+    for (size_t i = 0; i < missing.size() && m_pending.size() < maxPending; ++i)
+        request(missing[i].second);
+
+    if (pageTable == m_pageTable)
+        return false;
+
+    m_pageTable.swap(pageTable);
+    return true;
+}
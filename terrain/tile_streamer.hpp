@@ -0,0 +1,118 @@
+#ifndef TILE_STREAMER_HPP
+#define TILE_STREAMER_HPP
+
+#include "heightmap_generator.hpp"
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+/*******************************************************************************
+ * TileStreamer -- Camera-centred heightmap tiles generated in the background
+ *
+ * The terrain is seen through LEVEL_COUNT nested windows of RING_SIZE x
+ * RING_SIZE tiles centred on the camera. The texels of level L are 2^L
+ * texels of level 0 apart, so each level covers twice the extent of the
+ * previous one with the same number of tiles, and memory and generation
+ * cost scale with the view distance instead of the size of the world.
+ * A tile holds TILE_TEXELS x TILE_TEXELS heights: tile (x, y) of a level
+ * covers the texels [x * TILE_SIZE, (x + 1) * TILE_SIZE] of that level,
+ * both ends included, so bilinear filtering never leaves a tile.
+ *
+ * Generated tiles live in slotCount slots (the layers of a texture array,
+ * for the owner) managed as an LRU cache: the tiles of the windows are
+ * touched every update, and the least recently used tile outside them is
+ * evicted when a new one needs a slot. Missing tiles are generated on the
+ * shared thread pool, coarse levels first and near tiles first.
+ *
+ * The owner calls update() once per frame, uploads the tiles returned by
+ * uploads() into their slots and, when update() returns true, uploads the
+ * page table: the slot of each tile of the windows, or -1.
+ *
+ * Usage:
+ *      streamer.reset(kernel);                 // and whenever the noise changes
+ *      each frame:
+ *          bool pagesChanged = streamer.update(cameraX, cameraY);
+ *          for (const Tile &tile : streamer.uploads()) upload(tile);
+ *          if (pagesChanged) upload(streamer.pageTable());
+ *
+ */
+class TileStreamer {
+public:
+    enum {
+        TILE_SIZE = 64,
+        TILE_TEXELS = TILE_SIZE + 1,
+        LEVEL_COUNT = 10,
+        RING_SIZE = 8
+    };
+    struct Tile {
+        int level, x, y;
+        int slot;
+        std::vector<float> heights; // TILE_TEXELS x TILE_TEXELS, row major
+    };
+    // fills the heights of the texels [x0, x0 + TILE_TEXELS) x
+    // [y0, y0 + TILE_TEXELS) of level, row major
+    typedef std::function<void(int level, int x0, int y0, float *heights)> TileKernel;
+
+    explicit TileStreamer(ThreadPool &pool,
+                          int slotCount = 3 * LEVEL_COUNT * RING_SIZE * RING_SIZE / 2);
+    ~TileStreamer();
+
+    // drops every tile; the ones in flight are discarded when they finish
+    void reset(const TileKernel &kernel);
+    // centres the windows on (x, y), in texels of level 0; returns true
+    // when the page table changed
+    bool update(double x, double y);
+
+    // tiles generated since the last update, with their slot
+    const std::vector<Tile> &uploads() const { return m_uploads; }
+    // LEVEL_COUNT x RING_SIZE x RING_SIZE slots, row major, -1 if missing
+    const std::vector<int16_t> &pageTable() const { return m_pageTable; }
+    // first tile of the window of level, in tiles of that level
+    int windowX(int level) const { return m_windows[level].x; }
+    int windowY(int level) const { return m_windows[level].y; }
+
+    int slotCount() const { return m_slotCount; }
+    int residentCount() const { return (int)m_resident.size(); }
+    int pendingCount() const { return (int)m_pending.size(); }
+
+private:
+    struct Key {
+        int level, x, y;
+        bool operator==(const Key &key) const {
+            return level == key.level && x == key.x && y == key.y;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+    struct Resident {
+        int slot;
+        std::list<Key>::iterator lru;
+    };
+    struct Window {
+        int x, y;
+    };
+
+    void collect();
+    void request(const Key &key);
+    int acquireSlot();
+    bool isInWindow(const Key &key) const;
+
+    TileKernel m_kernel;
+    int m_slotCount;
+    std::vector<int> m_freeSlots;
+    std::list<Key> m_lru;   // most recently used first
+    std::unordered_map<Key, Resident, KeyHash> m_resident;
+    std::unordered_set<Key, KeyHash> m_pending;
+    std::vector<Tile> m_uploads;
+    std::vector<int16_t> m_pageTable;
+    Window m_windows[LEVEL_COUNT];
+    // tiles finished by the workers, collected by update()
+    std::mutex m_mutex;
+    std::vector<Tile> m_done;
+    std::atomic<int> m_generation;
+    ThreadPool &m_pool;
+    ThreadPool::Group m_group;
+};
+
+#endif
@@ -0,0 +1,307 @@
+#include "tiled_heightmap_file.hpp"
+#include "normal_map.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+enum {PAGE_SIZE = 4096, HAS_NORMALS = 1};
+
+// file layout: header, level table, tile index, then the tiles; the index
+// and each tile channel start on a page boundary
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    int32_t tileSize;
+    int32_t levelCount;
+    uint64_t tileCount;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+};
+struct FileLevel {
+    int32_t width, height;
+    int32_t tileCountX, tileCountY;
+    uint64_t firstTile;
+};
+struct FileTile {
+    uint64_t texelOffset;
+    uint64_t normalOffset;  // 0 without normals
+    uint16_t min, max;
+    uint32_t reserved;
+};
+
+static const char s_magic[8] = {'T', 'C', 'C', 'T', 'H', 'M', 'F', '\0'};
+
+static uint64_t pageAlign(uint64_t offset) {
+    return (offset + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+}
+
+static uint64_t tileTexelByteSize(int tileSize) {
+    return (uint64_t)tileSize * tileSize * 2 * sizeof(uint16_t);
+}
+
+static uint64_t tileNormalByteSize(int tileSize) {
+    return (uint64_t)tileSize * tileSize * 2;
+}
+
+// -----------------------------------------------------------------------------
+// Reader
+
+TiledHeightmapFile::TiledHeightmapFile():
+    m_index(NULL),
+    m_levelCount(0),
+    m_tileSize(0),
+    m_hasNormals(false)
+{}
+
+bool TiledHeightmapFile::open(const std::string &path) {
+    FileHeader header;
+    uint64_t tileCount = 0;
+
+    close();
+    if (!m_file.open(path))
+        return false;
+
+    const uint8_t *data = m_file.data();
+    const size_t size = m_file.size();
+
+    if (size < sizeof(header)) {
+        close();
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, s_magic, sizeof(s_magic)) != 0
+        || header.version != VERSION || header.fileSize != size
+        || header.levelCount <= 0 || header.levelCount > MAX_LEVEL_COUNT
+        || header.tileSize <= 0 || (header.tileSize & (header.tileSize - 1))
+        || sizeof(header) + header.levelCount * sizeof(FileLevel) > header.indexOffset
+        || header.indexOffset + header.tileCount * sizeof(FileTile) > size) {
+        close();
+        return false;
+    }
+
+    m_tileSize = header.tileSize;
+    m_levelCount = header.levelCount;
+    m_hasNormals = (header.flags & HAS_NORMALS) != 0;
+    m_index = data + header.indexOffset;
+
+    for (int i = 0; i < m_levelCount; ++i) {
+        FileLevel level;
+
+        memcpy(&level, data + sizeof(header) + i * sizeof(FileLevel), sizeof(level));
+        if (level.width <= 0 || level.height <= 0
+            || level.tileCountX != (level.width + m_tileSize - 1) / m_tileSize
+            || level.tileCountY != (level.height + m_tileSize - 1) / m_tileSize
+            || level.firstTile != tileCount) {
+            close();
+            return false;
+        }
+
+        m_levels[i].width = level.width;
+        m_levels[i].height = level.height;
+        m_levels[i].tileCountX = level.tileCountX;
+        m_levels[i].tileCountY = level.tileCountY;
+        m_levels[i].firstTile = level.firstTile;
+        tileCount+= (uint64_t)level.tileCountX * level.tileCountY;
+    }
+
+    if (tileCount != header.tileCount) {
+        close();
+        return false;
+    }
+
+    // only the index is read here; the tiles are paged in on demand
+    for (uint64_t i = 0; i < tileCount; ++i) {
+        FileTile tile;
+
+        memcpy(&tile, m_index + i * sizeof(FileTile), sizeof(tile));
+        if (tile.texelOffset + tileTexelByteSize(m_tileSize) > size
+            || (m_hasNormals && tile.normalOffset + tileNormalByteSize(m_tileSize) > size)) {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void TiledHeightmapFile::close() {
+    m_file.close();
+    m_index = NULL;
+    m_levelCount = 0;
+    m_tileSize = 0;
+    m_hasNormals = false;
+}
+
+TiledHeightmapFile::Tile TiledHeightmapFile::tile(int level, int tx, int ty) const {
+    const Level &l = m_levels[level];
+    const uint64_t id = l.firstTile + (uint64_t)ty * l.tileCountX + tx;
+    FileTile entry;
+    Tile tile;
+
+    memcpy(&entry, m_index + id * sizeof(FileTile), sizeof(entry));
+    tile.x0 = tx * m_tileSize;
+    tile.y0 = ty * m_tileSize;
+    tile.width = std::min(m_tileSize, l.width - tile.x0);
+    tile.height = std::min(m_tileSize, l.height - tile.y0);
+    tile.min = (float)entry.min / (float)((1 << 16) - 1);
+    tile.max = (float)entry.max / (float)((1 << 16) - 1);
+    tile.texels = (const uint16_t *)(m_file.data() + entry.texelOffset);
+    tile.normals = m_hasNormals ? m_file.data() + entry.normalOffset : NULL;
+
+    return tile;
+}
+
+float TiledHeightmapFile::height(int level, int i, int j) const {
+    const Tile t = tile(level, i / m_tileSize, j / m_tileSize);
+    const int x = i - t.x0, y = j - t.y0;
+
+    return (float)t.texels[2 * (x + m_tileSize * y)] / (float)((1 << 16) - 1);
+}
+
+// -----------------------------------------------------------------------------
+// Writer
+
+bool TiledHeightmapWriter::write(const std::string &path, const HeightPyramid &pyramid,
+                                 const uint8_t *normals, int tileSize) {
+    const int levelCount = std::min(pyramid.levelCount(), (int)TiledHeightmapFile::MAX_LEVEL_COUNT);
+    const std::string tmpPath = path + ".tmp";
+    const std::vector<uint8_t> padding(PAGE_SIZE, 0);
+    std::vector<FileLevel> levels(levelCount);
+    std::vector<FileTile> index;
+    std::vector<uint16_t> texels((size_t)tileSize * tileSize * 2);
+    std::vector<uint8_t> tileNormals((size_t)tileSize * tileSize * 2);
+    std::vector<uint8_t> levelNormals;
+    FileHeader header;
+    uint64_t offset;
+    FILE *file;
+    bool success;
+
+    if (levelCount == 0 || tileSize <= 0 || (tileSize & (tileSize - 1)))
+        return false;
+
+    // lay out the level table and the tile index
+    for (int l = 0; l < levelCount; ++l) {
+        const HeightPyramid::Level &level = pyramid.level(l);
+
+        levels[l].width = level.width;
+        levels[l].height = level.height;
+        levels[l].tileCountX = (level.width + tileSize - 1) / tileSize;
+        levels[l].tileCountY = (level.height + tileSize - 1) / tileSize;
+        levels[l].firstTile = index.size();
+        index.resize(index.size() + (size_t)levels[l].tileCountX * levels[l].tileCountY);
+    }
+
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = TiledHeightmapFile::VERSION;
+    header.flags = normals ? HAS_NORMALS : 0;
+    header.tileSize = tileSize;
+    header.levelCount = levelCount;
+    header.tileCount = index.size();
+    header.indexOffset = pageAlign(sizeof(header) + levels.size() * sizeof(FileLevel));
+
+    offset = pageAlign(header.indexOffset + index.size() * sizeof(FileTile));
+    for (size_t i = 0; i < index.size(); ++i) {
+        index[i].texelOffset = offset;
+        offset = pageAlign(offset + tileTexelByteSize(tileSize));
+        index[i].normalOffset = 0;
+        if (normals) {
+            index[i].normalOffset = offset;
+            offset = pageAlign(offset + tileNormalByteSize(tileSize));
+        }
+        index[i].reserved = 0;
+    }
+    header.fileSize = offset;
+
+    // the tile bounds are needed before the index is written
+    for (int l = 0; l < levelCount; ++l)
+    for (int ty = 0; ty < levels[l].tileCountY; ++ty)
+    for (int tx = 0; tx < levels[l].tileCountX; ++tx) {
+        const int x1 = std::min((tx + 1) * tileSize, levels[l].width);
+        const int y1 = std::min((ty + 1) * tileSize, levels[l].height);
+        FileTile &tile = index[levels[l].firstTile + (uint64_t)ty * levels[l].tileCountX + tx];
+        float min = INFINITY, max = -INFINITY;
+
+        for (int j = ty * tileSize; j < y1; ++j)
+        for (int i = tx * tileSize; i < x1; ++i) {
+            const HeightPyramid::Texel texel = pyramid.texel(l, i, j);
+
+            min = std::min(min, texel.min);
+            max = std::max(max, texel.max);
+        }
+
+        tile.min = (uint16_t)std::max(floorf(min * ((1 << 16) - 1)), 0.0f);
+        tile.max = (uint16_t)std::min(ceilf(max * ((1 << 16) - 1)), (float)((1 << 16) - 1));
+    }
+
+    file = fopen(tmpPath.c_str(), "wb");
+    if (!file)
+        return false;
+
+    success = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(levels.data(), sizeof(FileLevel), levels.size(), file) == levels.size();
+    offset = sizeof(header) + levels.size() * sizeof(FileLevel);
+
+    success = success
+           && fwrite(padding.data(), 1, header.indexOffset - offset, file) == header.indexOffset - offset
+           && fwrite(index.data(), sizeof(FileTile), index.size(), file) == index.size();
+    offset = header.indexOffset + index.size() * sizeof(FileTile);
+
+    if (normals)
+        levelNormals.assign(normals, normals + (size_t)levels[0].width * levels[0].height * 2);
+
+    for (int l = 0; l < levelCount && success; ++l) {
+        const int w = levels[l].width, h = levels[l].height;
+
+        if (normals && l > 0) {
+            std::vector<uint8_t> coarse((size_t)w * h * 2);
+
+            NormalMap::reduce(levelNormals.data(), levels[l - 1].width, levels[l - 1].height,
+                              coarse.data(), w, h, 0, 0, w, h);
+            levelNormals.swap(coarse);
+        }
+
+        for (int ty = 0; ty < levels[l].tileCountY && success; ++ty)
+        for (int tx = 0; tx < levels[l].tileCountX && success; ++tx) {
+            const FileTile &tile = index[levels[l].firstTile + (uint64_t)ty * levels[l].tileCountX + tx];
+
+            // edge tiles are padded by clamping
+            for (int y = 0; y < tileSize; ++y)
+            for (int x = 0; x < tileSize; ++x) {
+                const int i = std::min(tx * tileSize + x, w - 1);
+                const int j = std::min(ty * tileSize + y, h - 1);
+                const HeightPyramid::Texel texel = pyramid.texel(l, i, j);
+                const size_t id = (size_t)x + (size_t)tileSize * y;
+
+                texels[2 * id    ] = (uint16_t)(texel.mean * ((1 << 16) - 1));
+                texels[2 * id + 1] = (uint16_t)(texel.meanSq * ((1 << 16) - 1));
+                if (normals)
+                    memcpy(&tileNormals[2 * id], &levelNormals[2 * (i + (size_t)w * j)], 2);
+            }
+
+            success = fwrite(padding.data(), 1, tile.texelOffset - offset, file) == tile.texelOffset - offset
+                   && fwrite(texels.data(), 1, texels.size() * sizeof(uint16_t), file) == texels.size() * sizeof(uint16_t);
+            offset = tile.texelOffset + tileTexelByteSize(tileSize);
+
+            if (normals && success) {
+                success = fwrite(padding.data(), 1, tile.normalOffset - offset, file) == tile.normalOffset - offset
+                       && fwrite(tileNormals.data(), 1, tileNormals.size(), file) == tileNormals.size();
+                offset = tile.normalOffset + tileNormalByteSize(tileSize);
+            }
+        }
+    }
+
+    // the last tile may end before the end of its page
+    success = success
+           && fwrite(padding.data(), 1, header.fileSize - offset, file) == header.fileSize - offset;
+
+    success = (fclose(file) == 0) && success;
+    if (success)
+        success = (rename(tmpPath.c_str(), path.c_str()) == 0);
+    if (!success)
+        remove(tmpPath.c_str());
+
+    return success;
+}
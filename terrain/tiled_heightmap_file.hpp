@@ -0,0 +1,93 @@
+#ifndef TILED_HEIGHTMAP_FILE_HPP
+#define TILED_HEIGHTMAP_FILE_HPP
+
+#include "height_pyramid.hpp"
+#include "mapped_file.hpp"
+
+/*******************************************************************************
+ * TiledHeightmapFile -- Tiled, mip-chained heightmap container (.thm)
+ *
+ * Every mip level of the map is cut into tileSize x tileSize tiles. A tile
+ * stores its texels in the format of the displacement map, RG16 (h, h²)
+ * with h normalized to [0, 1], so it can be uploaded as is; edge tiles are
+ * padded by clamping so that every tile has the same size. An optional
+ * octahedral RG8 normal channel (see NormalMap) is stored the same way, and
+ * the tile index gives the min and max heights that each tile covers
+ * (conservatively, over the footprint of its texels in level 0).
+ *
+ * The header, the level table and the tile index come first, and every
+ * section starts on a page boundary. The reader maps the file and returns
+ * pointers into the mapping, so opening a file of any size only reads the
+ * index, and the tiles are paged in by the OS when they are touched.
+ *
+ * Usage:
+ *      TiledHeightmapWriter::write("map.thm", pyramid, normals);
+ *      TiledHeightmapFile file;
+ *      file.open("map.thm");
+ *      TiledHeightmapFile::Tile tile = file.tile(level, tx, ty);
+ *      upload(tile.texels) with GL_UNPACK_ROW_LENGTH = file.tileSize()
+ *
+ */
+class TiledHeightmapFile {
+public:
+    enum {VERSION = 2, MAX_LEVEL_COUNT = 32};
+    struct Tile {
+        int x0, y0;             // first texel in the level
+        int width, height;      // texels inside the level (the rest is padding)
+        float min, max;         // normalized heights
+        const uint16_t *texels; // RG16 (h, h²), tileSize x tileSize
+        const uint8_t *normals; // RG8, tileSize x tileSize, or NULL
+    };
+
+    TiledHeightmapFile();
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    bool hasNormals() const { return m_hasNormals; }
+    int tileSize() const { return m_tileSize; }
+    int levelCount() const { return m_levelCount; }
+    int width(int level) const { return m_levels[level].width; }
+    int height(int level) const { return m_levels[level].height; }
+    int tileCountX(int level) const { return m_levels[level].tileCountX; }
+    int tileCountY(int level) const { return m_levels[level].tileCountY; }
+
+    Tile tile(int level, int tx, int ty) const;
+    // normalized height of a texel, read through its tile
+    float height(int level, int i, int j) const;
+
+private:
+    struct Level {
+        int width, height;
+        int tileCountX, tileCountY;
+        uint64_t firstTile;
+    };
+
+    MappedFile m_file;
+    Level m_levels[MAX_LEVEL_COUNT];
+    const uint8_t *m_index;
+    int m_levelCount;
+    int m_tileSize;
+    bool m_hasNormals;
+};
+
+/*******************************************************************************
+ * TiledHeightmapWriter -- Writes a HeightPyramid as a TiledHeightmapFile
+ *
+ * The texels and the tile bounds come from the pyramid (heights normalized
+ * to [0, 1]); the normals, if any, are RG8 texels of level 0 and are
+ * reduced by NormalMap for the other levels. The file is written to a
+ * temporary name and renamed once complete.
+ *
+ */
+class TiledHeightmapWriter {
+public:
+    enum {DEFAULT_TILE_SIZE = 128};
+
+    static bool write(const std::string &path, const HeightPyramid &pyramid,
+                      const uint8_t *normals = NULL,
+                      int tileSize = DEFAULT_TILE_SIZE);
+};
+
+#endif
@@ -0,0 +1,196 @@
+// noise_parity -- Diffs the heightmap noise of the CPU and the GPU
+//
+// Generates maps of NoiseSpec heights for a few parameter sets three times
+// (CPU only, GPU only, and both through the TileScheduler) and compares
+// them bit for bit. The GL context is created headless with EGL, so the
+// tool also runs on a software rasterizer, e.g.:
+//      EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 ./noise_parity
+// Returns 0 when every map matches.
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "glad/glad.h"
+#include "noise_spec.hpp"
+#include "noise_spec_gpu.hpp"
+#include "tile_scheduler.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifndef PATH_TO_SRC_DIRECTORY
+#define PATH_TO_SRC_DIRECTORY "./"
+#endif
+
+struct ParityCase {
+    const char *name;
+    NoiseSpec::Params params;
+    int originX, originY;   // texel (0, 0) of the map
+};
+
+static bool createContext() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    const EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context;
+    EGLint major, minor;
+
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (!eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    // compute shaders only: no surface and no config
+    context = eglCreateContext(display, (EGLConfig)0, EGL_NO_CONTEXT, attributes);
+
+    return context != EGL_NO_CONTEXT
+        && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)
+        && gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+}
+
+static GLuint loadProgram(const std::string &shaderDirectory) {
+    const std::string source = NoiseSpecGpu::source(shaderDirectory);
+    const char *text = source.c_str();
+    GLuint shader, program;
+    GLint success;
+    char log[4096];
+
+    if (source.empty()) {
+        fprintf(stderr, "noise_parity: cannot read the shaders in %s\n", shaderDirectory.c_str());
+        return 0;
+    }
+
+    shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &text, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "noise_parity: compilation failed\n%s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "noise_parity: link failed\n%s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+static void generate(TileScheduler &scheduler, NoiseSpecGpu &gpu, GLuint program,
+                     const ParityCase &c, int size, TileScheduler::Mode mode,
+                     std::vector<float> &heights) {
+    heights.assign((size_t)size * size, -1.0f);
+
+    const TileScheduler::Stats stats = scheduler.run(size, size,
+        [&](int x0, int y0, int x1, int y1) {
+            for (int j = y0; j < y1; ++j)
+                NoiseSpec::heights(c.params, c.originX + x0, c.originY + j, x1 - x0,
+                                   &heights[x0 + (size_t)size * j]);
+            return true;
+        },
+        [&](int x0, int y0, int x1, int y1) {
+            return gpu.generate(program, c.params, c.originX + x0, c.originY + y0,
+                                c.originX + x1, c.originY + y1,
+                                &heights[x0 + (size_t)size * y0], size);
+        },
+        mode);
+
+    if (stats.gpuFailed)
+        fprintf(stderr, "noise_parity: the GPU kernel failed, tiles fell back to the CPU\n");
+    printf("    %-9s %4i tiles on the CPU, %4i on the GPU\n",
+           mode == TileScheduler::CPU_ONLY ? "cpu" : mode == TileScheduler::GPU_ONLY ? "gpu" : "automatic",
+           stats.tileCount[TileScheduler::CPU], stats.tileCount[TileScheduler::GPU]);
+}
+
+// number of texels whose bits differ, and the largest difference in ulps
+static int64_t compare(const std::vector<float> &a, const std::vector<float> &b, int64_t *maxUlps) {
+    int64_t count = 0;
+
+    *maxUlps = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int32_t x, y;
+
+        memcpy(&x, &a[i], sizeof(x));
+        memcpy(&y, &b[i], sizeof(y));
+        if (x != y) {
+            const int64_t ulps = llabs((int64_t)x - (int64_t)y);
+
+            ++count;
+            if (ulps > *maxUlps)
+                *maxUlps = ulps;
+        }
+    }
+
+    return count;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? atoi(argv[1]) : 512;
+    const std::string shaderDirectory = argc > 2 ? argv[2] : PATH_TO_SRC_DIRECTORY "terrain/shaders/";
+    const ParityCase cases[] = {
+        {"default",         {0u, 8, 1.0f / 200.0f, 2.0f, 0.5f, 1.0f}, 0, 0},
+        {"steep",           {12345u, 12, 1.0f / 37.5f, 2.3f, 0.45f, 2.7f}, 0, 0},
+        {"negative origin", {0xdeadbeefu, 6, 1.0f / 91.0f, 1.9f, 0.6f, 0.35f}, -70000, -1234},
+        {"far origin",      {7u, 5, 1.0f / 1000.0f, 2.0f, 0.5f, 1.5f}, 3000000, 2500000},
+        {"tiny gain",       {42u, 16, 1.0f / 64.0f, 2.7f, 0.01f, 0.8f}, 0, 0},
+    };
+    std::vector<float> cpu, gpuHeights, automatic;
+    ThreadPool pool;
+    TileScheduler scheduler(pool);
+    NoiseSpecGpu gpu;
+    GLuint program;
+    bool success = true;
+
+    if (size <= 0 || !createContext()) {
+        fprintf(stderr, "usage: %s [size] [shader_dir]\n", argv[0]);
+        fprintf(stderr, "noise_parity: no OpenGL 4.5 context\n");
+        return EXIT_FAILURE;
+    }
+    printf("%s, %s\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+
+    program = loadProgram(shaderDirectory);
+    if (!program)
+        return EXIT_FAILURE;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        const ParityCase &c = cases[i];
+        int64_t gpuUlps, automaticUlps;
+
+        printf("%s, %ix%i:\n", c.name, size, size);
+        generate(scheduler, gpu, program, c, size, TileScheduler::CPU_ONLY, cpu);
+        generate(scheduler, gpu, program, c, size, TileScheduler::GPU_ONLY, gpuHeights);
+        generate(scheduler, gpu, program, c, size, TileScheduler::AUTOMATIC, automatic);
+
+        const int64_t gpuCount = compare(cpu, gpuHeights, &gpuUlps);
+        const int64_t automaticCount = compare(cpu, automatic, &automaticUlps);
+
+        printf("    gpu:       %lli texels differ (max %lli ulps)\n", (long long)gpuCount, (long long)gpuUlps);
+        printf("    automatic: %lli texels differ (max %lli ulps)\n", (long long)automaticCount, (long long)automaticUlps);
+        success = success && gpuCount == 0 && automaticCount == 0;
+    }
+
+    gpu.release();
+    glDeleteProgram(program);
+    printf("%s\n", success ? "PASS" : "FAIL");
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
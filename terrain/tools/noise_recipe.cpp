@@ -0,0 +1,113 @@
+// noise_recipe -- Checks and times the shared-octave layers of a NoiseRecipe
+//
+// Evaluates an fBm + ridged + iq + flow recipe over a size x size grid in
+// one pass, with the sum of each layer written out, and compares:
+//  - the fBm layer with the batch fBm,
+//  - the ridged layer with ridgedMF,
+//  - the iq layer with iqfBm, which damps differently (see NoiseRecipe):
+//    its difference is printed, not checked.
+// Then times the recipe against one pass per layer, e.g.:
+//      ./noise_recipe 1024
+// Returns 0 when the fBm and ridged layers match.
+#include "simplex.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct RecipeCase {
+    uint8_t octaves;
+    float lacunarity, gain, ridgeOffset, angle;
+};
+
+static double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static float maxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+    float difference = 0.0f;
+
+    for (size_t i = 0; i < a.size(); ++i)
+        difference = std::max(difference, fabsf(a[i] - b[i]));
+
+    return difference;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? atoi(argv[1]) : 512;
+    const RecipeCase c = {8, 2.0f, 0.5f, 1.0f, 0.8f};
+    // the layers are sums of up to 2 per octave: a few ulps of 2 apart
+    const float tolerance = 1e-5f;
+    Simplex::NoiseRecipe recipe(c.octaves, c.lacunarity);
+    std::vector<float> x, y, z, out, single;
+    std::vector<std::vector<float> > layers(Simplex::NoiseRecipe::MAX_LAYERS);
+    std::vector<float> fbm, ridged, iq;
+    float *layerPointers[Simplex::NoiseRecipe::MAX_LAYERS];
+    std::chrono::steady_clock::time_point start;
+    double recipeSeconds, layerSeconds = 0.0;
+
+    if (size <= 0) {
+        fprintf(stderr, "usage: %s [size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    recipe.addFbm(1.0f, c.gain)
+          .addRidged(0.5f, c.gain, c.ridgeOffset)
+          .addIq(0.5f, c.gain)
+          .addFlow(0.25f, c.gain, c.angle);
+
+    // a size x size grid in the xz plane, off the lattice points
+    for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+            x.push_back(0.0173f * i + 0.31f);
+            y.push_back(-2.5f);
+            z.push_back(0.0173f * j + 0.77f);
+        }
+    }
+    out.resize(x.size());
+    single.resize(x.size());
+    for (int k = 0; k < Simplex::NoiseRecipe::MAX_LAYERS; ++k) {
+        layers[k].resize(x.size());
+        layerPointers[k] = layers[k].data();
+    }
+
+    start = std::chrono::steady_clock::now();
+    Simplex::fBm(recipe, x.data(), y.data(), z.data(), out.data(), x.size(), layerPointers);
+    recipeSeconds = secondsSince(start);
+
+    // the same layers, one pass each
+    for (int k = 0; k < recipe.layerCount; ++k) {
+        const Simplex::NoiseRecipe::Layer &layer = recipe.layers[k];
+        Simplex::NoiseRecipe alone(c.octaves, c.lacunarity);
+
+        alone.add(layer.type, layer.weight, layer.gain, layer.param);
+        start = std::chrono::steady_clock::now();
+        Simplex::fBm(alone, x.data(), y.data(), z.data(), single.data(), x.size());
+        layerSeconds+= secondsSince(start);
+    }
+
+    fbm.resize(x.size());
+    Simplex::fBm(x.data(), y.data(), z.data(), fbm.data(), x.size(), c.octaves, c.lacunarity, c.gain);
+    for (size_t i = 0; i < x.size(); ++i) {
+        const glm::vec3 p(x[i], y[i], z[i]);
+
+        ridged.push_back(Simplex::ridgedMF(p, c.ridgeOffset, c.octaves, c.lacunarity, c.gain));
+        iq.push_back(Simplex::iqfBm(p, c.octaves, c.lacunarity, c.gain));
+    }
+
+    const float fbmDifference = maxDifference(layers[0], fbm);
+    const float ridgedDifference = maxDifference(layers[1], ridged);
+
+    printf("%ix%i texels, %i octaves, batch width %i\n", size, size, c.octaves, Simplex::batchWidth());
+    printf("fbm    layer vs fBm      : max |diff| %g %s\n", fbmDifference,
+           fbmDifference <= tolerance ? "ok" : "FAILED");
+    printf("ridged layer vs ridgedMF : max |diff| %g %s\n", ridgedDifference,
+           ridgedDifference <= tolerance ? "ok" : "FAILED");
+    printf("iq     layer vs iqfBm    : max |diff| %g (different damping)\n", maxDifference(layers[2], iq));
+    printf("recipe: %.1f ms, one pass per layer: %.1f ms (%.2fx)\n",
+           recipeSeconds * 1e3, layerSeconds * 1e3, layerSeconds / recipeSeconds);
+
+    return fbmDifference <= tolerance && ridgedDifference <= tolerance ? EXIT_SUCCESS : EXIT_FAILURE;
+}